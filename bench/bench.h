@@ -0,0 +1,41 @@
+#ifndef __JSON_TOY_BENCH_H__
+#define __JSON_TOY_BENCH_H__
+
+#include <chrono>
+#include <functional>
+#include <string>
+
+namespace jst {
+
+// Best time of `rounds` runs, in seconds.
+inline double bench_time(int rounds, const std::function<void()>& f) {
+  double best = 1e30;
+  for (int r = 0; r < rounds; r++) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+    if (d.count() < best) best = d.count();
+  }
+  return best;
+}
+
+// Record i of the synthetic documents: an id, a name, two tags, a small object and a score.
+inline std::string bench_record(int i, const char* name = "user ") {
+  return "{\"id\":" + std::to_string(i) + ",\"name\":\"" + name + std::to_string(i) +
+         "\",\"tags\":[\"a\",\"bc\"],\"extra\":{\"x\":[1,2,3]},\"score\":" +
+         std::to_string(i * 0.25) + "}";
+}
+
+// An array of records 0 to count - 1.
+inline std::string bench_records(int count) {
+  std::string json = "[";
+  for (int i = 0; i < count; i++) {
+    if (i != 0) json += ",";
+    json += bench_record(i);
+  }
+  return json + "]";
+}
+
+}  // namespace jst
+
+#endif  // __JSON_TOY_BENCH_H__
@@ -0,0 +1,75 @@
+// Struct binding against parsing into a tree and copying the fields out of it.
+//
+//   ./bench_bind [rounds]
+//
+// Uses a synthetic array of records.
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "bind.h"
+#include "parser.h"
+
+namespace users {
+struct User {
+  int64_t id = 0;
+  std::string name;
+  std::vector<std::string> tags;
+  double score = 0.0;
+};
+JST_BIND(User, id, name, tags, score)
+}  // namespace users
+
+namespace jst {
+
+using users::User;
+
+// What binding replaces: the whole tree first, then one lookup per field.
+static void bench_copy_out(const JNode& root, std::vector<User>& users) {
+  const JArray& arr = root.data().as<JArray>();
+  users.clear();
+  users.resize(arr.size());
+  JString id("id"), name("name"), tags("tags"), score("score");
+  for (size_t i = 0; i < arr.size(); i++) {
+    const JObject& obj = arr[i].data().as<JObject>();
+    User& u = users[i];
+    const JNode* v = obj.find_value(id);
+    if (v != nullptr) u.id = v->data().as<JNumber>().int_value();
+    v = obj.find_value(name);
+    if (v != nullptr) u.name = v->data().as<JString>().value();
+    v = obj.find_value(tags);
+    if (v != nullptr) {
+      const JArray& t = v->data().as<JArray>();
+      u.tags.clear();
+      for (size_t j = 0; j < t.size(); j++) u.tags.push_back(t[j].data().as<JString>().value());
+    }
+    v = obj.find_value(score);
+    if (v != nullptr) u.score = v->data().as<JNumber>().value();
+  }
+}
+
+static int bench_bind(int argc, char** argv) {
+  std::string json = bench_records(20000);
+  int rounds = argc > 1 ? atoi(argv[1]) : 10;
+
+  std::vector<User> users;
+  double tree = bench_time(rounds, [&]() {
+    JParser p(json);
+    p.parser();
+    bench_copy_out(p.root, users);
+  });
+  double bind = bench_time(rounds, [&]() { jst_bind_parse(json, users); });
+  std::string out;
+  double write = bench_time(rounds, [&]() { jst_bind_stringify(users, out); });
+  printf("tree and copy %zu bytes: %9.3f ms\n", json.size(), tree * 1e3);
+  printf("bind:                    %9.3f ms\n", bind * 1e3);
+  printf("bind stringify:          %9.3f ms\n", write * 1e3);
+  return 0;
+}
+
+}  // namespace jst
+
+int main(int argc, char** argv) { return jst::bench_bind(argc, argv); }
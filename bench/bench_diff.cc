@@ -0,0 +1,70 @@
+// Structural diff between two versions of a document, against comparing them with operator==.
+//
+//   ./bench_diff [rounds]
+//
+// Uses a synthetic array of records; the second version renames, drops and inserts a few.
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include "bench.h"
+#include "diff.h"
+#include "parser.h"
+#include "patch.h"
+
+namespace jst {
+
+static std::string bench_sample(int count, bool changed) {
+  std::string json = "[";
+  for (int i = 0; i < count; i++) {
+    if (changed && i % 2000 == 7) continue;
+    if (json.size() > 1) json += ",";
+    json += bench_record(i, changed && i % 1000 == 3 ? "renamed " : "user ");
+    if (changed && i % 5000 == 11) json += "," + bench_record(-i, "inserted ");
+  }
+  return json + "]";
+}
+
+static int bench_diff(int argc, char** argv) {
+  int rounds = argc > 1 ? atoi(argv[1]) : 10;
+  JParser old_doc(bench_sample(20000, false)), new_doc(bench_sample(20000, true));
+  if (old_doc.parser() != JST_PARSE_OK || new_doc.parser() != JST_PARSE_OK) return 1;
+
+  JNode ops;
+  double diff = bench_time(rounds, [&]() { ops = jst_diff(old_doc.root, new_doc.root); });
+  JNode merge;
+  double merge_diff = bench_time(rounds, [&]() {
+    merge = jst_merge_diff(old_doc.root, new_doc.root);
+  });
+  std::string patch;
+  old_doc.stringify(ops, patch);
+
+  JParser small(bench_sample(2000, false));
+  if (small.parser() != JST_PARSE_OK) return 1;
+  JNode copy = small.root;
+  bool same = false;
+  double equal = bench_time(1, [&]() { same = small.root == copy; });
+  JNode small_ops;
+  double small_diff = bench_time(rounds, [&]() { small_ops = jst_diff(small.root, copy); });
+  if (!same || !small_ops.data().as<JArray>().empty()) return 1;
+
+  JPatch p;
+  JNode doc = old_doc.root;
+  if (p.compile(ops) != JST_PARSE_OK || p.apply(doc) != JST_PARSE_OK) return 1;
+  std::string a, b;
+  old_doc.stringify(doc, a);
+  new_doc.stringify(new_doc.root, b);
+  if (a != b) return 1;
+
+  printf("diff of 20000 records:       %9.3f ms, %zu operations, %zu bytes\n", diff * 1e3,
+         ops.data().as<JArray>().size(), patch.size());
+  printf("merge diff:                  %9.3f ms\n", merge_diff * 1e3);
+  printf("operator== on 2000 records:  %9.3f ms\n", equal * 1e3);
+  printf("diff of the same:            %9.3f ms\n", small_diff * 1e3);
+  return 0;
+}
+
+}  // namespace jst
+
+int main(int argc, char** argv) { return jst::bench_diff(argc, argv); }
@@ -0,0 +1,60 @@
+// Deep equality of large documents, with and without cached structural hashes.
+//
+//   ./bench_equal [rounds]
+//
+// Uses a synthetic array of 100000 records, a copy of it, and a copy with its last record changed,
+// then an object of 100000 members against the same members in reverse order.
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include "bench.h"
+#include "parser.h"
+
+namespace jst {
+
+static int bench_equal(int argc, char** argv) {
+  int rounds = argc > 1 ? atoi(argv[1]) : 10;
+  JParser jc(bench_records(100000));
+  if (jc.parser() != JST_PARSE_OK) return 1;
+  JNode same = jc.root, changed = jc.root;
+  JArray& records = changed.mutable_data().as<JArray>();
+  records[records.size() - 1].mutable_data().as<JObject>()[0].get_value() = JNode(-1.0);
+
+  bool eq = false, ne = true;
+  double equal = bench_time(rounds, [&]() { eq = jc.root == same; });
+  double unequal = bench_time(rounds, [&]() { ne = jc.root == changed; });
+  if (!eq || ne) return 1;
+
+  uint64_t h = 0;
+  double hash = bench_time(1, [&]() { h = jc.root.hash() ^ same.hash() ^ changed.hash(); });
+  double hashed_equal = bench_time(rounds, [&]() { eq = jc.root == same; });
+  double hashed_unequal = bench_time(rounds, [&]() { ne = jc.root == changed; });
+  if (!eq || ne || h == 0) return 1;
+
+  // one wide object against the same members in reverse order, which takes the key sort.
+  std::string wide = "{", reversed = "{";
+  for (int i = 0; i < 100000; i++) {
+    std::string member = "\"k" + std::to_string(i) + "\":" + std::to_string(i);
+    wide += (i != 0 ? "," : "") + member;
+    std::string back = "\"k" + std::to_string(99999 - i) + "\":" + std::to_string(99999 - i);
+    reversed += (i != 0 ? "," : "") + back;
+  }
+  JParser wide_doc(wide + "}"), reversed_doc(reversed + "}");
+  if (wide_doc.parser() != JST_PARSE_OK || reversed_doc.parser() != JST_PARSE_OK) return 1;
+  double members = bench_time(rounds, [&]() { eq = wide_doc.root == reversed_doc.root; });
+  if (!eq) return 1;
+
+  printf("operator== on 100000 equal records:  %9.3f ms\n", equal * 1e3);
+  printf("operator== on the last one changed:  %9.3f ms\n", unequal * 1e3);
+  printf("hash() of the three documents:       %9.3f ms\n", hash * 1e3);
+  printf("operator== on equal, hashed:         %9.3f ms\n", hashed_equal * 1e3);
+  printf("operator== on changed, hashed:       %9.3f ms\n", hashed_unequal * 1e3);
+  printf("operator== on reordered members:     %9.3f ms\n", members * 1e3);
+  return 0;
+}
+
+}  // namespace jst
+
+int main(int argc, char** argv) { return jst::bench_equal(argc, argv); }
@@ -0,0 +1,65 @@
+// Structural hashing: the string kernel against byte-at-a-time FNV-1a, and JNode::hash() of a
+// document from scratch, cached, and after one change.
+//
+//   ./bench_hash [rounds]
+//
+// Uses a synthetic array of 20000 records.
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include "bench.h"
+#include "hash.h"
+#include "parser.h"
+
+namespace jst {
+
+static uint64_t bench_fnv1a(const char* s, size_t len) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < len; i++) h = (h ^ (unsigned char)s[i]) * 0x100000001b3ULL;
+  return h;
+}
+
+static int bench_hash(int argc, char** argv) {
+  int rounds = argc > 1 ? atoi(argv[1]) : 10;
+  std::string json = bench_records(20000);
+
+  volatile uint64_t sink = 0;
+  double kernel = bench_time(rounds, [&]() { sink = jst_hash_bytes(json.data(), json.size()); });
+  double fnv = bench_time(rounds, [&]() { sink = bench_fnv1a(json.data(), json.size()); });
+  std::string keys[4] = {"id", "name", "user 12345", "a somewhat longer member name"};
+  double short_kernel = bench_time(rounds, [&]() {
+    for (int i = 0; i < 1000000; i++) sink = jst_hash_bytes(keys[i & 3].data(), keys[i & 3].size());
+  });
+  double short_fnv = bench_time(rounds, [&]() {
+    for (int i = 0; i < 1000000; i++) sink = bench_fnv1a(keys[i & 3].data(), keys[i & 3].size());
+  });
+
+  JParser jc(json);
+  if (jc.parser() != JST_PARSE_OK) return 1;
+  uint64_t h = 0;
+  double cold = bench_time(1, [&]() { h = jc.root.hash(); });
+  double cached = bench_time(rounds, [&]() { sink = jc.root.hash(); });
+  JArray& records = jc.root.mutable_data().as<JArray>();
+  double changed = bench_time(rounds, [&]() {
+    records[10000].mutable_data().as<JObject>()[0].get_value() = JNode(1e6);
+    sink = jc.root.hash();
+  });
+  if (jc.root.hash() == h) return 1;
+
+  double mb = json.size() / 1e6;
+  printf("jst_hash_bytes, %zu bytes: %9.3f ms, %7.0f MB/s\n", json.size(), kernel * 1e3,
+         mb / kernel);
+  printf("FNV-1a:                        %9.3f ms, %7.0f MB/s\n", fnv * 1e3, mb / fnv);
+  printf("jst_hash_bytes, 1M short keys: %9.3f ms\n", short_kernel * 1e3);
+  printf("FNV-1a, 1M short keys:         %9.3f ms\n", short_fnv * 1e3);
+  printf("hash() of 20000 records:       %9.3f ms\n", cold * 1e3);
+  printf("hash() again, cached:          %9.3f ms\n", cached * 1e3);
+  printf("hash() after one change:       %9.3f ms\n", changed * 1e3);
+  return 0;
+}
+
+}  // namespace jst
+
+int main(int argc, char** argv) { return jst::bench_hash(argc, argv); }
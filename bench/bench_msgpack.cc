@@ -0,0 +1,71 @@
+// Size and throughput of MessagePack against text JSON on the same tree.
+//
+//   ./bench_msgpack [file.json] [rounds]
+//
+// Without a file a synthetic array of records is used.
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include "bench.h"
+#include "msgpack.h"
+#include "parser.h"
+
+namespace jst {
+
+static std::string bench_sample() {
+  std::string json = "[";
+  for (int i = 0; i < 20000; i++) {
+    if (i != 0) json += ",";
+    json += "{\"id\":" + std::to_string(i) + ",\"name\":\"user " + std::to_string(i) +
+            "\",\"active\":" + (i % 3 ? "true" : "false") + ",\"score\":" +
+            std::to_string(i * 0.25) + ",\"tags\":[\"a\",\"bc\",\"def\"],\"parent\":null}";
+  }
+  return json + "]";
+}
+
+static void bench_report(const char* what, size_t bytes, double seconds) {
+  printf("%-18s %10zu bytes %9.3f ms %9.1f MB/s\n", what, bytes, seconds * 1e3,
+         bytes / seconds / (1 << 20));
+}
+
+static int bench_msgpack(int argc, char** argv) {
+  std::string json;
+  if (argc > 1) {
+    JMappedFile file;
+    if (file.open(argv[1]) != JST_PARSE_OK) {
+      fprintf(stderr, "cannot read %s\n", argv[1]);
+      return 1;
+    }
+    json.assign(file.data(), file.size());
+  } else {
+    json = bench_sample();
+  }
+  int rounds = argc > 2 ? atoi(argv[2]) : 10;
+
+  JParser jc(json);
+  if (jc.parser() != JST_PARSE_OK) {
+    fprintf(stderr, "invalid JSON at offset %zu\n", jc.error_offset());
+    return 1;
+  }
+  std::string text, bin;
+  JNode back;
+
+  bench_report("json stringify", json.size(),
+               bench_time(rounds, [&]() { jc.stringify(jc.root, text); }));
+  bench_report("json parse", text.size(), bench_time(rounds, [&]() {
+                 JParser p(text);
+                 p.parser(&back);
+               }));
+  bench_report("msgpack encode", jst_msgpack_size(jc.root),
+               bench_time(rounds, [&]() { jst_msgpack_encode(jc.root, bin); }));
+  bench_report("msgpack decode", bin.size(),
+               bench_time(rounds, [&]() { jst_msgpack_decode(bin.data(), bin.size(), back); }));
+  printf("msgpack / json size: %.1f%%\n", 100.0 * bin.size() / text.size());
+  return 0;
+}
+
+}  // namespace jst
+
+int main(int argc, char** argv) { return jst::bench_msgpack(argc, argv); }
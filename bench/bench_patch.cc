@@ -0,0 +1,67 @@
+// JSON Patch applied in place against rebuilding the document around it.
+//
+//   ./bench_patch [rounds]
+//
+// Uses a synthetic array of records and a patch of a few operations on one of them.
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include "bench.h"
+#include "parser.h"
+#include "patch.h"
+
+namespace jst {
+
+// Leaves the document as it found it, so every round starts from the same tree.
+static const char* bench_patch_ok =
+    "[{\"op\":\"test\",\"path\":\"/10000/id\",\"value\":10000},"
+    "{\"op\":\"replace\",\"path\":\"/10000/name\",\"value\":\"user 10000\"},"
+    "{\"op\":\"add\",\"path\":\"/10000/tags/-\",\"value\":\"new\"},"
+    "{\"op\":\"move\",\"from\":\"/10000/extra\",\"path\":\"/10001/extra2\"},"
+    "{\"op\":\"move\",\"from\":\"/10001/extra2\",\"path\":\"/10000/extra\"},"
+    "{\"op\":\"remove\",\"path\":\"/10000/tags/2\"}]";
+
+// Fails on its last operation and is rolled back.
+static const char* bench_patch_fail =
+    "[{\"op\":\"replace\",\"path\":\"/10000/name\",\"value\":\"renamed\"},"
+    "{\"op\":\"remove\",\"path\":\"/0\"},"
+    "{\"op\":\"add\",\"path\":\"/-\",\"value\":{\"id\":-1}},"
+    "{\"op\":\"test\",\"path\":\"/0/id\",\"value\":0}]";
+
+static int bench_patch(int argc, char** argv) {
+  std::string json = bench_records(20000);
+  int rounds = argc > 1 ? atoi(argv[1]) : 10;
+
+  JParser jc(json);
+  if (jc.parser() != JST_PARSE_OK) return 1;
+  JNode doc = jc.root;
+  JPatch ok, fail;
+  if (ok.compile(std::string(bench_patch_ok)) != JST_PARSE_OK) return 1;
+  if (fail.compile(std::string(bench_patch_fail)) != JST_PARSE_OK) return 1;
+
+  JRetType ok_ret = JST_PARSE_OK, fail_ret = JST_PARSE_OK;
+  double reparse = bench_time(rounds, [&]() {
+    JParser p(json);
+    p.parser();
+    ok.apply(p.root);
+  });
+  double copy = bench_time(rounds, [&]() {
+    JNode scratch = doc;
+    if (ok.apply(scratch) == JST_PARSE_OK) doc = std::move(scratch);
+  });
+  double in_place = bench_time(rounds, [&]() { ok_ret = ok.apply(doc); });
+  double rollback = bench_time(rounds, [&]() { fail_ret = fail.apply(doc); });
+  if (ok_ret != JST_PARSE_OK || fail_ret != JST_PARSE_PATCH_TEST_FAILED) return 1;
+
+  printf("reparse and patch %zu bytes: %9.3f ms\n", json.size(), reparse * 1e3);
+  printf("copy and patch:                %9.3f ms\n", copy * 1e3);
+  printf("patch in place:                %9.3f ms\n", in_place * 1e3);
+  printf("patch rolled back:             %9.3f ms\n", rollback * 1e3);
+  return 0;
+}
+
+}  // namespace jst
+
+int main(int argc, char** argv) { return jst::bench_patch(argc, argv); }
@@ -0,0 +1,60 @@
+// Schema validation: parsing into a tree and walking it, against validating the text directly.
+//
+//   ./bench_schema [rounds]
+//
+// Uses a synthetic array of records; the last one violates the schema.
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include "bench.h"
+#include "parser.h"
+#include "schema.h"
+
+namespace jst {
+
+static const char* bench_schema_json =
+    "{\"type\":\"array\",\"items\":{\"type\":\"object\",\"required\":[\"id\",\"name\",\"tags\"],"
+    "\"properties\":{\"id\":{\"type\":\"integer\",\"minimum\":0},"
+    "\"name\":{\"type\":\"string\",\"maxLength\":32},"
+    "\"tags\":{\"type\":\"array\",\"items\":{\"enum\":[\"a\",\"bc\"]}},"
+    "\"score\":{\"type\":\"number\",\"exclusiveMaximum\":1e9}}}}";
+
+static std::string bench_sample(bool valid) {
+  std::string json = bench_records(20000);
+  if (!valid) json.insert(json.size() - 1, ",{\"id\":-1,\"name\":\"\",\"tags\":[]}");
+  return json;
+}
+
+static int bench_schema(int argc, char** argv) {
+  int rounds = argc > 1 ? atoi(argv[1]) : 10;
+  JSchema schema;
+  if (schema.compile(std::string(bench_schema_json)) != JST_PARSE_OK) return 1;
+
+  for (int valid = 1; valid >= 0; valid--) {
+    std::string json = bench_sample(valid != 0);
+    JRetType tree_ret = JST_PARSE_OK, text_ret = JST_PARSE_OK;
+    double tree = bench_time(rounds, [&]() {
+      JParser p(json);
+      tree_ret = p.parser();
+      if (tree_ret == JST_PARSE_OK) tree_ret = schema.validate(p.root);
+    });
+    double text = bench_time(rounds, [&]() { text_ret = schema.validate(json); });
+    double parse = bench_time(rounds, [&]() {
+      JNode out;
+      schema.parse(json.c_str(), json.size(), out);
+    });
+    if (tree_ret != text_ret) return 1;
+    printf("%s %zu bytes (%s)\n", valid ? "valid" : "invalid", json.size(),
+           jst_ret_type_name[tree_ret]);
+    printf("  parse and validate tree: %9.3f ms\n", tree * 1e3);
+    printf("  validate text:           %9.3f ms\n", text * 1e3);
+    printf("  validate then parse:     %9.3f ms\n", parse * 1e3);
+  }
+  return 0;
+}
+
+}  // namespace jst
+
+int main(int argc, char** argv) { return jst::bench_schema(argc, argv); }
@@ -0,0 +1,71 @@
+// Startup cost of a snapshot against parsing the same document.
+//
+//   ./bench_snapshot [file.json] [rounds]
+//
+// Without a file a synthetic array of records is used.
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include "bench.h"
+#include "parser.h"
+#include "snapshot.h"
+
+namespace jst {
+
+static std::string bench_sample() {
+  std::string json = "[";
+  for (int i = 0; i < 20000; i++) {
+    if (i != 0) json += ",";
+    json += "{\"id\":" + std::to_string(i) + ",\"name\":\"user " + std::to_string(i) +
+            "\",\"tags\":[\"a\",\"bc\"],\"score\":" + std::to_string(i * 0.25) + "}";
+  }
+  return json + "]";
+}
+
+static int bench_snapshot(int argc, char** argv) {
+  std::string json;
+  if (argc > 1) {
+    JMappedFile file;
+    if (file.open(argv[1]) != JST_PARSE_OK) {
+      fprintf(stderr, "cannot read %s\n", argv[1]);
+      return 1;
+    }
+    json.assign(file.data(), file.size());
+  } else {
+    json = bench_sample();
+  }
+  int rounds = argc > 2 ? atoi(argv[2]) : 10;
+
+  JParser jc(json);
+  if (jc.parser() != JST_PARSE_OK) {
+    fprintf(stderr, "invalid JSON at offset %zu\n", jc.error_offset());
+    return 1;
+  }
+  const char* path = "bench_snapshot.bin";
+  JSnapshot::write(jc.root, path);
+
+  double parse = bench_time(rounds, [&]() {
+    JParser p(json);
+    p.parser();
+  });
+  double open = bench_time(rounds, [&]() {
+    JSnapshot snap;
+    snap.open(path);
+  });
+  double verify = bench_time(rounds, [&]() {
+    JSnapshot snap;
+    snap.open(path);
+    snap.verify();
+  });
+  printf("parse %zu bytes:         %9.3f ms\n", json.size(), parse * 1e3);
+  printf("open snapshot:           %9.3f ms\n", open * 1e3);
+  printf("open and verify:         %9.3f ms\n", verify * 1e3);
+  remove(path);
+  return 0;
+}
+
+}  // namespace jst
+
+int main(int argc, char** argv) { return jst::bench_snapshot(argc, argv); }
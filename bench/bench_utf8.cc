@@ -0,0 +1,70 @@
+// UTF-8 validation on non-ASCII text: jst_utf8_validate against a sequence at a time, and
+// parsing with validate_utf8 on and off.
+//
+//   ./bench_utf8 [rounds]
+//
+// Uses a synthetic array of 20000 records whose strings are mostly CJK, with some emoji.
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include "bench.h"
+#include "parser.h"
+#include "utf8.h"
+
+namespace jst {
+
+static std::string bench_sample() {
+  const char* words[] = {"\xE4\xB8\xAD\xE6\x96\x87", "\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E",
+                         "\xED\x95\x9C\xEA\xB5\xAD\xEC\x96\xB4", "\xF0\x9F\x98\x80",
+                         "\xD0\xBF\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82", " "};
+  std::string json = "[";
+  for (int i = 0; i < 20000; i++) {
+    std::string text;
+    for (int k = 0; k < 24; k++) text += words[(i * 7 + k * 3) % 6];
+    if (i != 0) json += ",";
+    json += "{\"id\":" + std::to_string(i) + ",\"title\":\"" + text + "\",\"tags\":[\"" +
+            words[i % 3] + "\",\"" + words[(i + 1) % 3] + "\"]}";
+  }
+  return json + "]";
+}
+
+static size_t bench_sequences(const char* s, size_t len) {
+  size_t i = 0;
+  while (i < len) {
+    size_t n = jst_utf8_sequence((const unsigned char*)s + i, len - i);
+    if (n == 0) return i;
+    i += n;
+  }
+  return len;
+}
+
+static int bench_utf8(int argc, char** argv) {
+  int rounds = argc > 1 ? atoi(argv[1]) : 10;
+  std::string json = bench_sample();
+
+  volatile size_t sink = 0;
+  double vector = bench_time(rounds, [&]() { sink = jst_utf8_validate(json.data(), json.size()); });
+  double scalar = bench_time(rounds, [&]() { sink = bench_sequences(json.data(), json.size()); });
+  if (jst_utf8_validate(json.data(), json.size()) != json.size()) return 1;
+
+  JParserOptions opts;
+  JRetType ret = JST_PARSE_OK;
+  double parse = bench_time(rounds, [&]() { ret = JParser(json, opts).parser(); });
+  opts.validate_utf8 = true;
+  double parse_checked = bench_time(rounds, [&]() { ret = JParser(json, opts).parser(); });
+  if (ret != JST_PARSE_OK) return 1;
+
+  double mb = json.size() / 1e6;
+  printf("jst_utf8_validate, %zu bytes: %9.3f ms, %7.0f MB/s\n", json.size(), vector * 1e3,
+         mb / vector);
+  printf("a sequence at a time:             %9.3f ms, %7.0f MB/s\n", scalar * 1e3, mb / scalar);
+  printf("parse:                            %9.3f ms\n", parse * 1e3);
+  printf("parse with validate_utf8:         %9.3f ms\n", parse_checked * 1e3);
+  return 0;
+}
+
+}  // namespace jst
+
+int main(int argc, char** argv) { return jst::bench_utf8(argc, argv); }
@@ -4,6 +4,7 @@
 #include <assert.h>
 
 #include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -15,32 +16,84 @@ namespace jst {
 
 class JNode;
 
-struct NumberExp {
-  bool is_have;
-  int exp_index;
-  NumberExp() : is_have(false), exp_index(0) {}
-};
-
-struct NumberPoint {
-  bool is_have;
-  int point_index;
-  NumberPoint() : is_have(false), point_index(0) {}
-};
-
 class JData {
  public:
   JData() = default;
+  // a copy has the same JSON, so it may share the fragment, but it belongs to no container yet.
+  JData(const JData& data)
+      : fragment_(data.fragment_), hash_(data.hash_), hashed_(data.hashed_) {}
+  JData& operator=(const JData& data) {
+    touch();
+    fragment_ = data.fragment_;
+    hash_ = data.hash_;
+    hashed_ = data.hashed_;
+    return *this;
+  }
   virtual ~JData(){};
   template <typename Type>
   const Type& as() const {
     return *dynamic_cast<const Type*>(this);
   }
+  template <typename Type>
+  Type& as() {
+    return *dynamic_cast<Type*>(this);
+  }
+
+  // Serialized JSON of this array or object, kept by stringify when fragment caching is on and
+  // dropped by any mutation of the subtree. Filling it happens during a const stringify, so a
+  // tree that is being stringified with caching must not be shared between threads.
+  const std::string* fragment() const { return fragment_.get(); }
+  void set_fragment(const char* json, size_t len) const {
+    fragment_ = std::make_shared<const std::string>(json, len);
+  }
+
+  // Structural hash of this array or object (see JNode::hash()), kept like the fragment until
+  // the subtree is modified.
+  bool hashed() const { return hashed_; }
+  uint64_t cached_hash() const { return hash_; }
+  void set_hash(uint64_t h) const {
+    hash_ = h;
+    hashed_ = true;
+  }
+
+ protected:
+  friend class JNode;
+  friend class JOjectElement;
+  // Make this container the owner of jn, so mutations of jn reach our fragment.
+  void adopt(JNode& jn);
+  // Drop the fragments and hashes of this container and of every container above it.
+  void touch() const {
+    for (const JData* d = this; d != nullptr; d = d->parent_) {
+      d->fragment_.reset();
+      d->hashed_ = false;
+    }
+  }
+
+  // the container holding the node that holds this data, if any.
+  JData* parent_ = nullptr;
+  mutable std::shared_ptr<const std::string> fragment_;
+  mutable uint64_t hash_ = 0;
+  mutable bool hashed_ = false;
 };
 
 class JString : virtual public JData {
  private:
   size_t length = 0;
-  char* s = nullptr;
+  mutable char* s = nullptr;
+  // s points into a buffer owned by a JDocument and is never freed here. Copies always own
+  // their characters, so only the document's own tree can hold borrowed strings.
+  mutable bool borrowed = false;
+  // Lazy strings: s is the raw source between the quotes (raw_length bytes, neither decoded nor
+  // NUL-terminated) and is only turned into owned characters by the first c_str(). length is
+  // already the decoded length; raw_length == length means there was nothing to unescape.
+  mutable bool pending = false;
+  size_t raw_length = 0;
+
+  friend class JParser;
+  static JString borrow(char* s, size_t len);
+  static JString lazy(const char* raw, size_t raw_len, size_t len);
+  void materialize() const;
+  void copy_chars(char* dst) const;
 
  public:
   explicit JString() = default;
@@ -53,24 +106,61 @@ class JString : virtual public JData {
   ~JString();
 
   const size_t size() const { return length; };
-  const char* c_str() const { return s; }
+  const char* c_str() const {
+    if (pending) materialize();
+    return s;
+  }
   const bool empty() const { return s == nullptr || length == 0; }
-  std::string value() const { return std::string(s, length); }
+  std::string value() const {
+    return pending && raw_length == length ? std::string(s, length) : std::string(c_str(), length);
+  }
+  // JSON source of a lazy string that has not been read yet, to be copied out verbatim;
+  // nullptr for every other string.
+  const char* raw_source(size_t& len) const {
+    len = raw_length;
+    return pending ? s : nullptr;
+  }
 
  public:
   friend bool operator==(const JString& str_1, const JString& str_2);
+  // Bytewise order, a prefix first.
+  friend bool operator<(const JString& str_1, const JString& str_2);
 };
 
+// Parsed integers that fit 64 bits are kept exactly; every other number keeps its source text
+// and is only converted to double when value() is called. stringify writes integers and source
+// text back unchanged, so numbers round-trip losslessly.
 class JNumber : public JData {
  private:
-  double num = 0.0;
+  JNumType kind = JST_NUM_DOUBLE;
+  // a JST_NUM_TEXT number keeps its conversion in d once value() has run, so hashing and
+  // comparing it do not go back to strtod every time.
+  union {
+    mutable double d;
+    int64_t i;
+    uint64_t u;
+  };
+  mutable bool converted = false;
+  std::string text;
 
  public:
-  JNumber() = default;
+  JNumber() : d(0.0) {}
+  explicit JNumber(double n) : d(n) {}
+  static JNumber from_int(int64_t n);
+  static JNumber from_uint(uint64_t n);
+  // Validate a complete JSON number and store it. Leading zeros give JST_PARSE_SINGULAR, values
+  // beyond the double range JST_PARSE_NUMBER_TOO_BIG.
+  static JRetType from_text(const char* s, size_t len, JNumber& num);
+
   friend bool operator==(const JNumber& num_1, const JNumber& num_2);
-  explicit JNumber(double n) : num(n){};
-  const double get() const { return num; };
-  double value() const { return num; }
+  JNumType type() const { return kind; }
+  bool is_int() const { return kind == JST_NUM_INT || kind == JST_NUM_UINT; }
+  int64_t int_value() const { return kind == JST_NUM_UINT ? (int64_t)u : i; }
+  uint64_t uint_value() const { return kind == JST_NUM_INT ? (uint64_t)i : u; }
+  // Source text of a JST_NUM_TEXT number, empty otherwise.
+  const std::string& source() const { return text; }
+  const double get() const { return value(); };
+  double value() const;
 };
 
 class JArray : public JData {
@@ -88,8 +178,8 @@ class JArray : public JData {
   JArray& operator=(JArray&& arr) noexcept;
   ~JArray();
 
-  JNode& operator[](int index);
-  const JNode& operator[](int index) const;
+  JNode& operator[](size_t index);
+  const JNode& operator[](size_t index) const;
 
   size_t find(const JNode& jn) const;
   size_t size() const { return len_; };
@@ -102,6 +192,8 @@ class JArray : public JData {
 
  public:
   size_t insert(size_t pos, JNode& jn);
+  // Takes the node over instead of copying it, so inserting a subtree costs no deep copy.
+  size_t insert(size_t pos, JNode&& jn);
   size_t erase(size_t pos, size_t count = 1);
   void push_back(const JNode& jn);
   void pop_back();
@@ -111,6 +203,9 @@ class JArray : public JData {
 
  public:
   friend bool operator==(const JArray& left, const JArray& right);
+
+ private:
+  void adopt_all();
 };
 
 // object
@@ -124,6 +219,7 @@ class JOjectElement {
   JOjectElement(const JString& key, const JNode& value);
   JOjectElement(JString&& key, JNode&& value);
   JOjectElement(const JOjectElement& om);
+  friend class JObject;
   JOjectElement(JOjectElement&& om) noexcept;
 
   JOjectElement& operator=(const JOjectElement& om);
@@ -133,6 +229,7 @@ class JOjectElement {
  public:
   const JString& get_key() const { return *key; }
   const JNode& get_value() const { return *value; }
+  JNode& get_value() { return *value; }
 
  public:
   friend bool operator==(const JOjectElement& left, const JOjectElement& right);
@@ -146,9 +243,13 @@ class JObject : public JData {
  public:
   JObject() = default;
   explicit JObject(size_t length) { obj_.reserve(length); }
+  JObject(const JObject& obj);
+  JObject(JObject&& obj) noexcept;
+  JObject& operator=(const JObject& obj);
+  JObject& operator=(JObject&& obj) noexcept;
 
-  const JOjectElement& operator[](int index) const { return this->obj_[index]; }
-  JOjectElement& operator[](int index) { return this->obj_[index]; }
+  const JOjectElement& operator[](size_t index) const { return this->obj_[index]; }
+  JOjectElement& operator[](size_t index) { return this->obj_[index]; }
 
   size_t find_index(const JString& key) const;
   const JNode* find_value(const JString& key) const;
@@ -161,12 +262,15 @@ class JObject : public JData {
 
   const JString& get_key(size_t index) const { return obj_[index].get_key(); }
   const JNode& get_value(size_t index) const { return obj_[index].get_value(); }
+  JNode& get_value(size_t index) { return obj_[index].get_value(); }
 
   JObject value() const { return JObject(*this); }
 
   size_t insert(size_t pos, JOjectElement& objm);
+  size_t insert(size_t pos, JOjectElement&& objm);
   size_t erase(size_t pos, size_t count = 1);
   void push_back(const JOjectElement& objm);
+  void push_back(JOjectElement&& objm);
   void pop_back();
   void clear();
   void reserve(size_t new_cap);
@@ -175,6 +279,9 @@ class JObject : public JData {
  public:
   friend bool operator==(const JObject& left, const JObject& right);
   friend bool operator!=(const JObject& left, const JObject& right);
+
+ private:
+  void adopt_all();
 };
 
 }  // namespace jst
@@ -0,0 +1,477 @@
+#ifndef __JSON_TOY_BIND_H__
+#define __JSON_TOY_BIND_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <limits>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "enum.h"
+#include "parser.h"
+#include "reader.h"
+#include "writer.h"
+
+namespace jst {
+
+// Struct binding: JSON read straight into C++ structs and written straight out of them, with no
+// JNode tree in between. A struct lists its fields once, at namespace scope in its own namespace:
+//
+//   struct Point { int x; double y; };
+//   JST_BIND(Point, x, y)
+//   struct Path { std::vector<Point> points; JOptional<std::string> name; };
+//   JST_BIND(Path, points, name)
+//
+// Parsing runs JReader and fills every field as its value comes by; keys are looked up in a
+// perfect hash table built at compile time from the field names. Unknown keys are skipped (their
+// subtree is not validated, see JReader::skip()), missing fields keep the value they had, and of
+// duplicate keys the last one wins. Writing runs JWriter over the fields in declaration order and
+// leaves out empty optionals.
+//
+// Supported field types: bool, integers (out-of-range values give JST_PARSE_NUMBER_TOO_BIG),
+// floating point, std::string, std::vector, JOptional and other bound structs. Other types can
+// be added by specializing JBindCodec. A value of the wrong JSON type gives
+// JST_PARSE_TYPE_MISMATCH.
+
+// Up to 32 fields, each a non-static data member named as in JSON.
+#define JST_BIND(Type, ...)                                                       \
+  inline constexpr auto jst_bind_fields(const Type*) {                            \
+    return std::make_tuple(JST_BIND_EACH(JST_BIND_FIELD, Type, __VA_ARGS__));     \
+  }
+
+// A value that may be absent: null in JSON, or left out of an object altogether.
+template <class T>
+class JOptional {
+ public:
+  JOptional() = default;
+  JOptional(const T& v) : has(true), val(v) {}
+  JOptional(T&& v) : has(true), val(std::move(v)) {}
+
+  bool has_value() const { return has; }
+  explicit operator bool() const { return has; }
+  T& value() { return val; }
+  const T& value() const { return val; }
+  T& operator*() { return val; }
+  const T& operator*() const { return val; }
+  T* operator->() { return &val; }
+  const T* operator->() const { return &val; }
+
+  T& emplace() {
+    has = true;
+    val = T();
+    return val;
+  }
+  void reset() {
+    has = false;
+    val = T();
+  }
+
+  friend bool operator==(const JOptional& a, const JOptional& b) {
+    return a.has == b.has && (!a.has || a.val == b.val);
+  }
+  friend bool operator!=(const JOptional& a, const JOptional& b) { return !(a == b); }
+
+ private:
+  bool has = false;
+  T val = T();
+};
+
+// One entry of a struct's field table.
+template <class S, class M>
+struct JBindField {
+  const char* name;
+  size_t len;
+  M S::*member;
+};
+
+template <class S, class M>
+constexpr JBindField<S, M> jst_bind_field(const char* name, size_t len, M S::*member) {
+  return {name, len, member};
+}
+
+// How a type is read and written. read() is called with the reader on the value's first token
+// and leaves it on its last one; write() emits exactly one value.
+template <class T, class = void>
+struct JBindCodec;
+
+template <class T>
+JRetType jst_bind_read(JReader& r, T& v) {
+  return JBindCodec<T>::read(r, v);
+}
+template <class T>
+void jst_bind_write(JWriter& w, const T& v) {
+  JBindCodec<T>::write(w, v);
+}
+
+// Whether a field is written at all.
+template <class T>
+bool jst_bind_present(const T&) {
+  return true;
+}
+template <class T>
+bool jst_bind_present(const JOptional<T>& v) {
+  return v.has_value();
+}
+
+// The reader's own error when it stopped on one, otherwise the token is of the wrong type.
+inline JRetType jst_bind_mismatch(const JReader& r) {
+  return r.token() == JST_TOKEN_ERROR ? r.error() : JST_PARSE_TYPE_MISMATCH;
+}
+
+template <>
+struct JBindCodec<bool> {
+  static JRetType read(JReader& r, bool& v) {
+    if (r.token() != JST_TOKEN_TRUE && r.token() != JST_TOKEN_FALSE) return jst_bind_mismatch(r);
+    v = r.token() == JST_TOKEN_TRUE;
+    return JST_PARSE_OK;
+  }
+  static void write(JWriter& w, bool v) { w.value(v); }
+};
+
+// Only exact integers are accepted: 1.0 and 1e3 do not bind to an integer field.
+template <class T>
+struct JBindCodec<T, typename std::enable_if<std::is_integral<T>::value &&
+                                             !std::is_same<T, bool>::value>::type> {
+  static JRetType read(JReader& r, T& v) {
+    if (r.token() != JST_TOKEN_NUMBER) return jst_bind_mismatch(r);
+    const JNumber& num = r.get_number();
+    if (!num.is_int()) return JST_PARSE_TYPE_MISMATCH;
+    if (num.type() == JST_NUM_UINT) {
+      if (num.uint_value() > (uint64_t)std::numeric_limits<T>::max()) {
+        return JST_PARSE_NUMBER_TOO_BIG;
+      }
+      v = (T)num.uint_value();
+      return JST_PARSE_OK;
+    }
+    int64_t n = num.int_value();
+    if (n < 0 ? n < (int64_t)std::numeric_limits<T>::min()
+              : (uint64_t)n > (uint64_t)std::numeric_limits<T>::max()) {
+      return JST_PARSE_NUMBER_TOO_BIG;
+    }
+    v = (T)n;
+    return JST_PARSE_OK;
+  }
+  static void write(JWriter& w, T v) {
+    if (std::is_signed<T>::value) {
+      w.value((int64_t)v);
+    } else {
+      w.value((uint64_t)v);
+    }
+  }
+};
+
+template <class T>
+struct JBindCodec<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+  static JRetType read(JReader& r, T& v) {
+    if (r.token() != JST_TOKEN_NUMBER) return jst_bind_mismatch(r);
+    v = (T)r.get_number().value();
+    return JST_PARSE_OK;
+  }
+  static void write(JWriter& w, T v) { w.value((double)v); }
+};
+
+template <>
+struct JBindCodec<std::string> {
+  static JRetType read(JReader& r, std::string& v) {
+    if (r.token() != JST_TOKEN_STRING) return jst_bind_mismatch(r);
+    const JString& str = r.get_string();
+    v.assign(str.c_str(), str.size());
+    return JST_PARSE_OK;
+  }
+  static void write(JWriter& w, const std::string& v) { w.value(v); }
+};
+
+template <class T>
+struct JBindCodec<std::vector<T>> {
+  static_assert(!std::is_same<T, bool>::value, "std::vector<bool> cannot be bound");
+
+  static JRetType read(JReader& r, std::vector<T>& v) {
+    if (r.token() != JST_TOKEN_BEGIN_ARRAY) return jst_bind_mismatch(r);
+    v.clear();
+    while (r.next() != JST_TOKEN_END_ARRAY) {
+      v.emplace_back();
+      JRetType ret = JBindCodec<T>::read(r, v.back());
+      if (ret != JST_PARSE_OK) return ret;
+    }
+    return JST_PARSE_OK;
+  }
+  static void write(JWriter& w, const std::vector<T>& v) {
+    w.begin_array();
+    for (const T& item : v) JBindCodec<T>::write(w, item);
+    w.end_array();
+  }
+};
+
+template <class T>
+struct JBindCodec<JOptional<T>> {
+  static JRetType read(JReader& r, JOptional<T>& v) {
+    if (r.token() == JST_TOKEN_NULL) {
+      v.reset();
+      return JST_PARSE_OK;
+    }
+    return JBindCodec<T>::read(r, v.emplace());
+  }
+  static void write(JWriter& w, const JOptional<T>& v) {
+    if (!v.has_value()) {
+      w.null();
+    } else {
+      JBindCodec<T>::write(w, *v);
+    }
+  }
+};
+
+// Compile-time perfect hash of a struct's field names: the first seed under which every name
+// lands in its own slot of a table with at least four slots per field. A lookup is then one hash
+// of the key, one slot and one memcmp, however many fields there are.
+#define JST_BIND_NO_FIELD 0xff
+#define JST_BIND_MAX_SEED 4096
+
+struct JBindKey {
+  const char* name;
+  size_t len;
+};
+
+template <size_t N>
+struct JBindKeys {
+  JBindKey key[N];
+};
+
+constexpr size_t jst_bind_table_size(size_t n) {
+  size_t size = 8;
+  while (size < 4 * n) size *= 2;
+  return size;
+}
+
+template <size_t N>
+struct JBindHash {
+  static constexpr size_t size = jst_bind_table_size(N);
+  uint32_t seed;  // 0 when two fields share a name
+  uint8_t slot[size];
+};
+
+constexpr uint32_t jst_bind_hash(const char* s, size_t len, uint32_t seed) {
+  uint32_t h = seed * 2654435761u;
+  for (size_t i = 0; i < len; i++) h = (h ^ (uint8_t)s[i]) * 16777619u;
+  return h ^ (h >> 16);
+}
+
+constexpr bool jst_bind_same_key(const JBindKey& a, const JBindKey& b) {
+  if (a.len != b.len) return false;
+  for (size_t i = 0; i < a.len; i++) {
+    if (a.name[i] != b.name[i]) return false;
+  }
+  return true;
+}
+
+template <size_t N>
+constexpr JBindHash<N> jst_bind_perfect_hash(const JBindKeys<N>& keys) {
+  JBindHash<N> h = {};
+  for (size_t i = 0; i < N; i++) {
+    for (size_t j = i + 1; j < N; j++) {
+      if (jst_bind_same_key(keys.key[i], keys.key[j])) return h;
+    }
+  }
+  for (uint32_t seed = 1; seed <= JST_BIND_MAX_SEED; seed++) {
+    for (size_t i = 0; i < h.size; i++) h.slot[i] = JST_BIND_NO_FIELD;
+    size_t i = 0;
+    for (; i < N; i++) {
+      size_t s = jst_bind_hash(keys.key[i].name, keys.key[i].len, seed) & (h.size - 1);
+      if (h.slot[s] != JST_BIND_NO_FIELD) break;
+      h.slot[s] = (uint8_t)i;
+    }
+    if (i == N) {
+      h.seed = seed;
+      return h;
+    }
+  }
+  return h;
+}
+
+template <class S, size_t... I>
+constexpr JBindKeys<sizeof...(I)> jst_bind_keys(std::index_sequence<I...>) {
+  return {{{std::get<I>(jst_bind_fields((const S*)nullptr)).name,
+            std::get<I>(jst_bind_fields((const S*)nullptr)).len}...}};
+}
+
+template <class S, size_t I>
+JRetType jst_bind_read_field(JReader& r, S& s) {
+  constexpr auto field = std::get<I>(jst_bind_fields((const S*)nullptr));
+  return jst_bind_read(r, s.*(field.member));
+}
+
+// Reader of every field, indexed like the field table.
+template <class S, class Seq>
+struct JBindReaders;
+
+template <class S, size_t... I>
+struct JBindReaders<S, std::index_sequence<I...>> {
+  using Fn = JRetType (*)(JReader&, S&);
+  static constexpr Fn fn[sizeof...(I)] = {&jst_bind_read_field<S, I>...};
+};
+
+template <class S, size_t... I>
+constexpr typename JBindReaders<S, std::index_sequence<I...>>::Fn
+    JBindReaders<S, std::index_sequence<I...>>::fn[sizeof...(I)];
+
+// Structs declared with JST_BIND.
+template <class S>
+struct JBindCodec<S, decltype((void)jst_bind_fields((const S*)nullptr))> {
+  using Fields = decltype(jst_bind_fields((const S*)nullptr));
+  static constexpr size_t N = std::tuple_size<Fields>::value;
+  static_assert(N < JST_BIND_NO_FIELD, "too many fields to bind");
+  static constexpr JBindKeys<N> keys = jst_bind_keys<S>(std::make_index_sequence<N>());
+  static constexpr JBindHash<N> hash = jst_bind_perfect_hash(jst_bind_keys<S>(
+      std::make_index_sequence<N>()));
+  static_assert(hash.seed != 0, "two bound fields have the same name");
+
+  static JRetType read(JReader& r, S& s) {
+    if (r.token() != JST_TOKEN_BEGIN_OBJECT) return jst_bind_mismatch(r);
+    for (;;) {
+      JTokenType tok = r.next();
+      if (tok == JST_TOKEN_END_OBJECT) return JST_PARSE_OK;
+      if (tok != JST_TOKEN_KEY) return r.error();
+      size_t index = find(r);
+      JRetType ret;
+      if (index == JST_BIND_NO_FIELD) {
+        ret = r.skip();
+      } else {
+        r.next();
+        ret = JBindReaders<S, std::make_index_sequence<N>>::fn[index](r, s);
+      }
+      if (ret != JST_PARSE_OK) return ret;
+    }
+  }
+
+  static void write(JWriter& w, const S& s) {
+    w.begin_object();
+    write_fields(w, s, std::make_index_sequence<N>());
+    w.end_object();
+  }
+
+ private:
+  // Index of the field named by the reader's current key, or JST_BIND_NO_FIELD. Keys without
+  // escapes are hashed straight from the input.
+  static size_t find(const JReader& r) {
+    size_t len;
+    const char* key = r.raw(len);
+    const JString& str = r.get_string();
+    if (str.size() != len) {
+      key = str.c_str();
+      len = str.size();
+    }
+    size_t index = hash.slot[jst_bind_hash(key, len, hash.seed) & (hash.size - 1)];
+    if (index == JST_BIND_NO_FIELD || keys.key[index].len != len ||
+        memcmp(keys.key[index].name, key, len) != 0) {
+      return JST_BIND_NO_FIELD;
+    }
+    return index;
+  }
+
+  template <size_t I>
+  static void write_field(JWriter& w, const S& s) {
+    constexpr auto field = std::get<I>(jst_bind_fields((const S*)nullptr));
+    const auto& v = s.*(field.member);
+    if (!jst_bind_present(v)) return;
+    w.key(field.name, field.len);
+    jst_bind_write(w, v);
+  }
+
+  template <size_t... I>
+  static void write_fields(JWriter& w, const S& s, std::index_sequence<I...>) {
+    int unused[] = {0, (write_field<I>(w, s), 0)...};
+    (void)unused;
+  }
+};
+
+template <class S>
+constexpr JBindKeys<JBindCodec<S, decltype((void)jst_bind_fields((const S*)nullptr))>::N>
+    JBindCodec<S, decltype((void)jst_bind_fields((const S*)nullptr))>::keys;
+template <class S>
+constexpr JBindHash<JBindCodec<S, decltype((void)jst_bind_fields((const S*)nullptr))>::N>
+    JBindCodec<S, decltype((void)jst_bind_fields((const S*)nullptr))>::hash;
+
+// Read one value that fills the whole input into v. As with JReader, json[len] must be readable
+// and '\0'. On error err_offset receives the position of the offending token and v may be
+// partly filled.
+template <class T>
+JRetType jst_bind_parse(const char* json, size_t len, T& v, size_t* err_offset = nullptr,
+                        const JParserOptions& opts = JParserOptions()) {
+  JReader r(json, len, opts);
+  r.next();
+  JRetType ret = jst_bind_read(r, v);
+  if (ret == JST_PARSE_OK && r.next() != JST_TOKEN_END) ret = r.error();
+  if (ret != JST_PARSE_OK && err_offset != nullptr) {
+    *err_offset = r.token() == JST_TOKEN_ERROR ? r.error_offset() : r.offset();
+  }
+  return ret;
+}
+
+template <class T>
+JRetType jst_bind_parse(const std::string& json, T& v, size_t* err_offset = nullptr,
+                        const JParserOptions& opts = JParserOptions()) {
+  return jst_bind_parse(json.c_str(), json.size(), v, err_offset, opts);
+}
+
+template <class T>
+void jst_bind_stringify(const T& v, std::string& out) {
+  out.clear();
+  JWriter w(out);
+  jst_bind_write(w, v);
+}
+
+#define JST_BIND_FIELD(Type, f) ::jst::jst_bind_field<Type>(#f, sizeof(#f) - 1, &Type::f)
+
+#define JST_BIND_EXPAND(x) x
+#define JST_BIND_CAT_(a, b) a##b
+#define JST_BIND_CAT(a, b) JST_BIND_CAT_(a, b)
+#define JST_BIND_EACH(m, t, ...) \
+  JST_BIND_EXPAND(JST_BIND_CAT(JST_BIND_EACH_, JST_BIND_COUNT(__VA_ARGS__))(m, t, __VA_ARGS__))
+#define JST_BIND_COUNT_(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, \
+                        _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30,  \
+                        _31, _32, n, ...)                                                      \
+  n
+#define JST_BIND_COUNT(...)                                                                     \
+  JST_BIND_EXPAND(JST_BIND_COUNT_(__VA_ARGS__, 32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, \
+                                  20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, \
+                                  3, 2, 1))
+#define JST_BIND_EACH_1(m, t, x) m(t, x)
+#define JST_BIND_EACH_2(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_1(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_3(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_2(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_4(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_3(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_5(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_4(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_6(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_5(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_7(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_6(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_8(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_7(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_9(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_8(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_10(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_9(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_11(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_10(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_12(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_11(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_13(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_12(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_14(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_13(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_15(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_14(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_16(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_15(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_17(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_16(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_18(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_17(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_19(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_18(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_20(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_19(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_21(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_20(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_22(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_21(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_23(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_22(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_24(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_23(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_25(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_24(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_26(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_25(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_27(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_26(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_28(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_27(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_29(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_28(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_30(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_29(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_31(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_30(m, t, __VA_ARGS__))
+#define JST_BIND_EACH_32(m, t, x, ...) m(t, x), JST_BIND_EXPAND(JST_BIND_EACH_31(m, t, __VA_ARGS__))
+
+}  // namespace jst
+
+#endif  // __JSON_TOY_BIND_H__
@@ -0,0 +1,45 @@
+#ifndef __JSON_TOY_DIFF_H__
+#define __JSON_TOY_DIFF_H__
+
+#include <stddef.h>
+
+#include <string>
+
+#include "node.h"
+
+namespace jst {
+
+struct JDiffOptions {
+  // Arrays of objects that carry an identity member (an "id", say): elements with equal values
+  // of this member are lined up with each other and diffed member by member, even where their
+  // other contents changed. Empty: elements only line up when they are equal.
+  std::string array_key;
+  // Above this many cells (old length x new length, after trimming the common prefix and suffix)
+  // an array is not aligned by a full LCS table but cut at the elements that occur once on each
+  // side first (patience diff); pieces without any are compared position by position.
+  size_t max_lcs_cells = 1 << 22;
+};
+
+// An RFC 6902 patch, as a JST_ARR of operations that JPatch applies, turning from into to.
+//
+// Subtrees are compared by JNode::hash(), which each tree caches: subtrees whose hashes differ
+// are known to differ at once, equal hashes are confirmed with one walk, and an unchanged
+// subtree is never visited again. Filling the caches writes to both trees, so neither may be
+// hashed or diffed by another thread at the same time; a later diff against the same tree finds
+// its hashes ready.
+// Objects are matched by key in linear time. Arrays trim their common prefix and suffix, line up
+// the rest along a longest common subsequence (see max_lcs_cells for long ones), and diff the
+// elements that were replaced position by position, so one changed field of a record is one
+// replace, not a new record.
+// The patch uses add, remove and replace only; values are copied out of to.
+JNode jst_diff(const JNode& from, const JNode& to, const JDiffOptions& opts = JDiffOptions());
+
+// An RFC 7386 merge patch from from to to. Arrays are replaced as a whole, and a member of to
+// whose value is null cannot be expressed (the format reads null as "remove").
+JNode jst_merge_diff(const JNode& from, const JNode& to);
+// Apply an RFC 7386 merge patch to target in place.
+void jst_merge_apply(JNode& target, const JNode& patch);
+
+}  // namespace jst
+
+#endif  // __JSON_TOY_DIFF_H__
@@ -0,0 +1,57 @@
+#ifndef __JSON_TOY_DOCUMENT_H__
+#define __JSON_TOY_DOCUMENT_H__
+
+#include <memory>
+#include <string>
+
+#include "enum.h"
+#include "file.h"
+#include "node.h"
+#include "parser.h"
+
+namespace jst {
+
+// A parsed tree together with the parse status. Documents are move-only so that any storage
+// backing the tree travels with it.
+//
+// parse_insitu() takes ownership of the input and decodes strings in place: string values and
+// keys in the tree point into that buffer instead of owning a copy. The buffer lives exactly as
+// long as the document, and the tree is only reachable through root() by const reference; any
+// JNode/JString copied out of it owns its characters and may outlive the document.
+//
+// parse_file() with JParserOptions::lazy_strings keeps the file mapped and leaves every string as
+// a span into it; a string is unescaped and copied the first time its c_str() is read, and
+// stringify writes untouched strings back verbatim. That first read writes to the string, so
+// threads sharing such a document must not race on it.
+class JDocument {
+ public:
+  JDocument() = default;
+  JDocument(const JDocument&) = delete;
+  JDocument& operator=(const JDocument&) = delete;
+  JDocument(JDocument&& doc) noexcept = default;
+  JDocument& operator=(JDocument&& doc) noexcept = default;
+  ~JDocument() = default;
+
+  static JDocument parse_file(const std::string& path,
+                              const JParserOptions& opts = JParserOptions());
+  static JDocument parse_insitu(std::string&& json, const JParserOptions& opts = JParserOptions());
+
+  JRetType status() const { return status_; }
+  bool ok() const { return status_ == JST_PARSE_OK; }
+  const JNode& root() const { return root_; }
+  // Location of the failure; only filled in when !ok(). For in-situ documents the context shows
+  // the buffer as far as it had been decoded.
+  const JErrorInfo& error() const { return error_; }
+
+ private:
+  // declared before root_ so that they are released after the tree that borrows from them.
+  std::unique_ptr<std::string> buffer_;
+  std::unique_ptr<JMappedFile> file_;
+  JNode root_;
+  JRetType status_ = JST_PARSE_OK;
+  JErrorInfo error_;
+};
+
+}  // namespace jst
+
+#endif  // __JSON_TOY_DOCUMENT_H__
@@ -33,6 +33,26 @@ typedef enum { JST_NULL = 0, JST_TRUE, JST_FALSE, JST_NUM, JST_STR, JST_ARR, JST
 
 extern const char* jst_node_type_name[7];
 
+// How a JNumber holds its value: an exact 64-bit integer, a double, or the source text.
+typedef enum { JST_NUM_DOUBLE = 0, JST_NUM_INT, JST_NUM_UINT, JST_NUM_TEXT } JNumType;
+
+// What JReader::next() stopped on.
+typedef enum {
+  JST_TOKEN_NONE = 0,  // before the first next()
+  JST_TOKEN_BEGIN_OBJECT,
+  JST_TOKEN_END_OBJECT,
+  JST_TOKEN_BEGIN_ARRAY,
+  JST_TOKEN_END_ARRAY,
+  JST_TOKEN_KEY,
+  JST_TOKEN_STRING,
+  JST_TOKEN_NUMBER,
+  JST_TOKEN_TRUE,
+  JST_TOKEN_FALSE,
+  JST_TOKEN_NULL,
+  JST_TOKEN_END,    // the top-level value is complete and only whitespace followed it
+  JST_TOKEN_ERROR,  // see JReader::error()
+} JTokenType;
+
 typedef enum {
   JST_PARSE_OK = 0,
   JST_PARSE_EXCEPT_VALUE,
@@ -49,10 +69,27 @@ typedef enum {
   JST_PARSE_MISS_KEY,
   JST_PARSE_MISS_COLON,
   JST_PARSE_MISS_COMMA_OR_CURLY_BRACKET,
+  JST_PARSE_EXCEED_MAX_BYTES,
+  JST_PARSE_EXCEED_MAX_NODES,
+  JST_PARSE_EXCEED_MAX_STRING_LENGTH,
+  JST_PARSE_EXCEED_MAX_DEPTH,
+  JST_PARSE_TIMEOUT,
+  JST_PARSE_FILE_ERROR,
+  JST_PARSE_INVALID_UTF8,
+  JST_PARSE_TRUNCATED,
+  JST_PARSE_UNSUPPORTED_TYPE,
+  JST_PARSE_INVALID_SNAPSHOT,
+  JST_PARSE_TYPE_MISMATCH,
+  JST_PARSE_INVALID_SCHEMA,
+  JST_PARSE_SCHEMA_VIOLATION,
+  JST_PARSE_INVALID_PATCH,
+  JST_PARSE_PATH_NOT_FOUND,
+  JST_PARSE_PATCH_TEST_FAILED,
   JST_STRINGIFY_OK,
+  JST_STRINGIFY_BUFFER_TOO_SMALL,
 } JRetType;
 
-extern const char* jst_ret_type_name[16];
+extern const char* jst_ret_type_name[33];
 
 typedef enum { JST_WS_BEFORE, JST_WS_AFTER } jst_ws_state;
 }  // namespace jst
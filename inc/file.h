@@ -0,0 +1,37 @@
+#ifndef __JSON_TOY_FILE_H__
+#define __JSON_TOY_FILE_H__
+
+#include <string>
+
+#include "enum.h"
+
+namespace jst {
+
+// Read-only view of a whole file. On POSIX systems the file is mmap'ed, otherwise it is read
+// into a heap buffer. Either way data()[size()] is readable and '\0', so the parser can use
+// the mapping directly as its NUL-terminated input.
+class JMappedFile {
+ public:
+  JMappedFile() = default;
+  JMappedFile(const JMappedFile&) = delete;
+  JMappedFile& operator=(const JMappedFile&) = delete;
+  JMappedFile(JMappedFile&& file) noexcept;
+  JMappedFile& operator=(JMappedFile&& file) noexcept;
+  ~JMappedFile();
+
+  JRetType open(const std::string& path);
+  void close();
+
+  const char* data() const { return data_ != nullptr ? data_ : ""; }
+  size_t size() const { return size_; }
+
+ private:
+  char* data_ = nullptr;
+  size_t size_ = 0;
+  // length of the address range to release; 0 when data_ is a heap buffer.
+  size_t map_size_ = 0;
+};
+
+}  // namespace jst
+
+#endif  // __JSON_TOY_FILE_H__
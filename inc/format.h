@@ -0,0 +1,52 @@
+#ifndef __JSON_TOY_FORMAT_H__
+#define __JSON_TOY_FORMAT_H__
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "basic.h"
+#include "node.h"
+
+namespace jst {
+
+// Two-pass serializer. jst_stringify_size() walks the tree once and returns the exact length of
+// its JSON text; jst_stringify_write() then fills a buffer of at least that many bytes in a
+// single pass, with no bounds checks and no growth. No terminator is written.
+//
+// Arrays and objects that carry a cached fragment (see JData::fragment) are sized and written
+// straight from it. With cache_min != 0 the write pass also stores the fragment of every array
+// or object whose JSON is at least cache_min bytes, so unchanged subtrees are copied with one
+// memcpy next time. Nested fragments overlap, which costs memory proportional to the depth.
+size_t jst_stringify_size(const JNode& jn);
+char* jst_stringify_write(const JNode& jn, char* out, size_t cache_min = 0);
+
+// Parallel form for a large top-level array or object. The size pass measures every child on
+// up to `threads` threads and groups consecutive children into batches of at least chunk bytes;
+// since every batch then knows its exact offset, the write pass fills all of them at once,
+// straight into the final buffer. The output is byte-identical to jst_stringify_write().
+struct JStringifyPlan {
+  std::vector<size_t> first;   // first child of every batch, then the number of children
+  std::vector<size_t> offset;  // output offset of every batch, then of the closing bracket
+  size_t size = 0;             // total length
+};
+// False, with nothing planned, for a scalar, a container with a cached fragment or fewer than
+// two children: use the serial functions for those.
+bool jst_stringify_plan(const JNode& jn, unsigned threads, size_t chunk, JStringifyPlan& plan);
+char* jst_stringify_write(const JNode& jn, char* out, const JStringifyPlan& plan,
+                          unsigned threads, size_t cache_min = 0);
+
+// The same for a single string, quotes included.
+size_t jst_string_size(const JString& str);
+char* jst_string_write(const JString& str, char* out);
+size_t jst_escaped_size(const char* s, size_t len);
+char* jst_escaped_write(const char* s, size_t len, char* out);
+
+// The same for a single number. NaN and the infinities, which JSON cannot represent, are
+// written as null.
+size_t jst_number_size(const JNumber& num);
+char* jst_number_write(const JNumber& num, char* out);
+
+}  // namespace jst
+
+#endif  // __JSON_TOY_FORMAT_H__
@@ -0,0 +1,35 @@
+#ifndef __JSON_TOY_HASH_H__
+#define __JSON_TOY_HASH_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace jst {
+
+// Final mix of a 64-bit value: every input bit affects every output bit.
+inline uint64_t jst_hash_mix(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+// Non-cryptographic 64-bit hash of len bytes. The result depends on nothing but the bytes and
+// the seed: it is the same on every run, build and platform, whichever kernel computed it, so it
+// may be stored. Inputs of 32 bytes and more are consumed in four lanes that are vectorized with
+// AVX2 or SSE2 where available.
+uint64_t jst_hash_bytes(const char* s, size_t len, uint64_t seed = 0);
+
+// The kernels jst_hash_bytes can run on. The best one the CPU supports is picked at startup.
+typedef enum { JST_HASH_SCALAR = 0, JST_HASH_SSE2, JST_HASH_AVX2 } JHashKernel;
+
+// Switch to another kernel, to check them against each other. Returns false, and keeps the
+// current one, if the build or the CPU lacks it. Not safe while other threads are hashing.
+bool jst_hash_set_kernel(JHashKernel kernel);
+JHashKernel jst_hash_kernel();
+
+}  // namespace jst
+
+#endif  // __JSON_TOY_HASH_H__
@@ -0,0 +1,497 @@
+#ifndef __JSON_TOY_LITERAL_H__
+#define __JSON_TOY_LITERAL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "enum.h"
+#include "snapshot.h"
+
+namespace jst {
+
+// JSON literals parsed by the compiler. JST_LITERAL turns a string literal into the bytes of a
+// snapshot (see snapshot.h) during constant evaluation, so a constexpr literal sits in the
+// binary's read-only data, fully laid out, and costs nothing at startup:
+//
+//   constexpr auto kDefaults = JST_LITERAL(R"({"retries": 3, "hosts": ["a", "b"]})");
+//   int64_t retries = kDefaults.root().find("retries").int_value();
+//
+// The grammar and the number and string handling are the parser's, and the bytes are exactly
+// what JSnapshot::write() produces for the parsed tree, so the usual JSnapView accessors (and
+// to_node() for a mutable copy) read it. Invalid JSON fails the compile; the diagnostic points
+// at jst_literal_error() with the JRetType the parser would have returned.
+//
+// Meant for small documents such as default configurations: the compiler's constant evaluation
+// limits apply, and member keys are sorted by insertion sort.
+template <size_t N>
+struct JLiteral {
+  alignas(8) char bytes[N];
+
+  const char* data() const { return bytes; }
+  constexpr size_t size() const { return N; }
+  // Checks the header only, like JSnapshot::open().
+  JSnapView root() const {
+    JSnapshot snap;
+    snap.open(bytes, N);
+    return snap.root();
+  }
+};
+
+#define JST_LITERAL(json)                                                     \
+  ::jst::jst_literal<::jst::jst_literal_size(json, sizeof(json) - 1)>(json,   \
+                                                                      sizeof(json) - 1)
+
+// Not constexpr: reaching it during constant evaluation is what turns a syntax error into a
+// compile error.
+inline void jst_literal_error(JRetType) {}
+
+// Snapshot integers are in host byte order, which the compiler knows.
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define JST_LITERAL_BIG_ENDIAN 1
+#else
+#define JST_LITERAL_BIG_ENDIAN 0
+#endif
+
+// Lays a document out as JSnapWriter does. With out == nullptr it only measures the size.
+class JLiteralBuilder {
+ public:
+  constexpr JLiteralBuilder(const char* json, size_t len, char* out)
+      : json(json), len(len), out(out) {}
+
+  constexpr size_t build() {
+    append(sizeof(JSnapHeader));
+    size_t root = append(sizeof(JSnapRecord));
+    ws();
+    value(root);
+    if (err != JST_PARSE_OK) return top;
+    ws();
+    if (pos != len) return fail(JST_PARSE_SINGULAR);
+
+    const char magic[8] = JST_SNAP_MAGIC;
+    for (size_t i = 0; i < 8; i++) put(i, (uint8_t)magic[i], 1);
+    put(8, JST_SNAP_VERSION, 4);
+    put(12, JST_SNAP_BYTE_ORDER, 4);
+    put(16, top, 8);
+    put(24, root, 8);
+    return top;
+  }
+
+ private:
+  constexpr size_t fail(JRetType ret) {
+    if (ret != JST_PARSE_OK) jst_literal_error(ret);
+    if (err == JST_PARSE_OK) err = ret;
+    pos = len;
+    return top;
+  }
+
+  constexpr char peek() const { return pos < len ? json[pos] : '\0'; }
+  static constexpr bool digit(char c) { return c >= '0' && c <= '9'; }
+
+  constexpr void ws() {
+    while (pos < len && (json[pos] == ' ' || json[pos] == '\t' || json[pos] == '\n' ||
+                         json[pos] == '\r')) {
+      pos++;
+    }
+  }
+
+  constexpr size_t append(size_t n) {
+    size_t off = top;
+    top += (n + 7) & ~(size_t)7;
+    return off;
+  }
+
+  constexpr void put(size_t off, uint64_t v, size_t width) {
+    if (out == nullptr) return;
+    for (size_t i = 0; i < width; i++) {
+      out[off + (JST_LITERAL_BIG_ENDIAN ? width - 1 - i : i)] = (char)((v >> (8 * i)) & 0xff);
+    }
+  }
+
+  constexpr uint64_t get(size_t off, size_t width) const {
+    uint64_t v = 0;
+    for (size_t i = 0; i < width; i++) {
+      uint64_t b = (uint8_t)out[off + (JST_LITERAL_BIG_ENDIAN ? width - 1 - i : i)];
+      v |= b << (8 * i);
+    }
+    return v;
+  }
+
+  constexpr void record(size_t off, JNType type, uint64_t length, uint64_t payload,
+                        JNumType num_type = JST_NUM_DOUBLE) {
+    put(off, type, 1);
+    put(off + 1, num_type, 1);
+    put(off + 4, length, 4);
+    put(off + 8, payload, 8);
+  }
+
+  constexpr void value(size_t rec) {
+    switch (peek()) {
+      case '\0':
+        fail(JST_PARSE_EXCEPT_VALUE);
+        return;
+      case '{':
+      case '[':
+        container(rec);
+        return;
+      case '\"':
+        string(rec);
+        return;
+      case 't':
+        symbol("true", rec, JST_TRUE);
+        return;
+      case 'f':
+        symbol("false", rec, JST_FALSE);
+        return;
+      case 'n':
+        symbol("null", rec, JST_NULL);
+        return;
+      default:
+        number(rec);
+        return;
+    }
+  }
+
+  constexpr void symbol(const char* word, size_t rec, JNType type) {
+    for (size_t i = 0; word[i] != '\0'; i++, pos++) {
+      if (peek() != word[i]) {
+        fail(JST_PARSE_INVALID_VALUE);
+        return;
+      }
+    }
+    record(rec, type, 0, 0);
+  }
+
+  // Elements or members of the container opening at pos, found by bracket counting. Only
+  // exact for valid JSON; the parse that follows rejects everything else.
+  constexpr size_t count() const {
+    size_t i = pos + 1;
+    while (i < len && (json[i] == ' ' || json[i] == '\t' || json[i] == '\n' || json[i] == '\r')) {
+      i++;
+    }
+    if (i == len || json[i] == ']' || json[i] == '}') return 0;
+    size_t n = 1, nest = 0;
+    for (; i < len; i++) {
+      char c = json[i];
+      if (c == '\"') {
+        for (i++; i < len && json[i] != '\"'; i++) {
+          if (json[i] == '\\') i++;
+        }
+      } else if (c == '[' || c == '{') {
+        nest++;
+      } else if (c == ']' || c == '}') {
+        if (nest-- == 0) break;
+      } else if (c == ',' && nest == 0) {
+        n++;
+      }
+    }
+    return n;
+  }
+
+  constexpr void container(size_t rec) {
+    bool is_object = json[pos] == '{';
+    char close = is_object ? '}' : ']';
+    size_t n = count();
+    size_t slot = is_object ? 2 * sizeof(JSnapRecord) : sizeof(JSnapRecord);
+    size_t block = append(n * slot + (is_object ? n * sizeof(uint32_t) : 0));
+    record(rec, is_object ? JST_OBJ : JST_ARR, n, block);
+    pos++;
+    ws();
+    if (peek() == close) {
+      pos++;
+      return;
+    }
+    for (size_t i = 0;; i++) {
+      if (i == n) {
+        fail(JST_PARSE_INVALID_VALUE);
+        return;
+      }
+      size_t item = block + i * slot;
+      if (is_object) {
+        if (peek() != '\"') {
+          fail(JST_PARSE_MISS_KEY);
+          return;
+        }
+        string(item);
+        if (err != JST_PARSE_OK) return;
+        ws();
+        if (peek() != ':') {
+          fail(JST_PARSE_MISS_COLON);
+          return;
+        }
+        pos++;
+        ws();
+        item += sizeof(JSnapRecord);
+      }
+      value(item);
+      if (err != JST_PARSE_OK) return;
+      ws();
+      if (peek() == close) {
+        pos++;
+        break;
+      }
+      if (peek() != ',') {
+        // spelled out so that the diagnostic names the error.
+        if (is_object) {
+          fail(JST_PARSE_MISS_COMMA_OR_CURLY_BRACKET);
+        } else {
+          fail(JST_PARSE_MISS_COMMA_OR_SQUARE_BRACKET);
+        }
+        return;
+      }
+      pos++;
+      ws();
+    }
+    if (is_object) sort_keys(block, n);
+  }
+
+  // The member index table of an object, stably sorted by key bytes.
+  constexpr void sort_keys(size_t block, size_t n) {
+    if (out == nullptr) return;
+    size_t order = block + n * 2 * sizeof(JSnapRecord);
+    for (size_t i = 0; i < n; i++) {
+      size_t j = i;
+      for (; j > 0 && key_less(block, i, get(order + (j - 1) * 4, 4)); j--) {
+        put(order + j * 4, get(order + (j - 1) * 4, 4), 4);
+      }
+      put(order + j * 4, i, 4);
+    }
+  }
+
+  constexpr bool key_less(size_t block, uint64_t a, uint64_t b) const {
+    size_t ka = block + a * 2 * sizeof(JSnapRecord), kb = block + b * 2 * sizeof(JSnapRecord);
+    uint64_t la = get(ka + 4, 4), lb = get(kb + 4, 4);
+    uint64_t pa = get(ka + 8, 8), pb = get(kb + 8, 8);
+    for (uint64_t i = 0; i < la && i < lb; i++) {
+      uint8_t ca = (uint8_t)out[pa + i], cb = (uint8_t)out[pb + i];
+      if (ca != cb) return ca < cb;
+    }
+    return la < lb;
+  }
+
+  static constexpr int hex(char c) {
+    return c >= '0' && c <= '9'   ? c - '0'
+           : c >= 'a' && c <= 'f' ? c - 'a' + 10
+           : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                                  : -1;
+  }
+
+  constexpr bool hex4(size_t i, unsigned& v) const {
+    v = 0;
+    if (i + 4 > len) return false;
+    for (size_t k = 0; k < 4; k++) {
+      int h = hex(json[i + k]);
+      if (h < 0) return false;
+      v = v * 16 + (unsigned)h;
+    }
+    return true;
+  }
+
+  // Writes (when dst != npos and there is output) the UTF-8 of cp; returns its length.
+  constexpr size_t utf8(unsigned cp, size_t dst) {
+    size_t n = cp <= 0x7F ? 1 : cp <= 0x7FF ? 2 : cp <= 0xFFFF ? 3 : 4;
+    if (out == nullptr || dst == (size_t)-1) return n;
+    if (n == 1) {
+      out[dst] = (char)cp;
+    } else {
+      const unsigned lead[5] = {0, 0, 0xC0, 0xE0, 0xF0};
+      out[dst] = (char)(lead[n] | (cp >> (6 * (n - 1))));
+      for (size_t k = 1; k < n; k++) {
+        out[dst + k] = (char)(0x80 | ((cp >> (6 * (n - 1 - k))) & 0x3F));
+      }
+    }
+    return n;
+  }
+
+  // Decodes the string opening at pos into dst (or just measures it with dst == npos) and
+  // leaves end past the closing quote.
+  constexpr size_t decode(size_t dst, size_t& end) {
+    size_t n = 0;
+    for (size_t i = pos + 1;; i++) {
+      if (i >= len) {
+        fail(JST_PARSE_MISS_QUOTATION_MARK);
+        return 0;
+      }
+      char c = json[i];
+      if (c == '\"') {
+        end = i + 1;
+        return n;
+      }
+      if ((uint8_t)c < 0x20) {
+        fail(JST_PARSE_INVALID_STRING_CHAR);
+        return 0;
+      }
+      if (c != '\\') {
+        if (out != nullptr && dst != (size_t)-1) out[dst + n] = c;
+        n++;
+        continue;
+      }
+      if (++i >= len) {
+        fail(JST_PARSE_INVALID_VALUE);
+        return 0;
+      }
+      char e = json[i];
+      char simple = e == '\"'  ? '\"'
+                    : e == '\\' ? '\\'
+                    : e == '/'  ? '/'
+                    : e == 'b'  ? '\b'
+                    : e == 'f'  ? '\f'
+                    : e == 'n'  ? '\n'
+                    : e == 'r'  ? '\r'
+                    : e == 't'  ? '\t'
+                                : 0;
+      if (simple != 0) {
+        if (out != nullptr && dst != (size_t)-1) out[dst + n] = simple;
+        n++;
+        continue;
+      }
+      if (e != 'u') {
+        fail(JST_PARSE_INVALID_STRING_ESCAPE);
+        return 0;
+      }
+      unsigned cp = 0;
+      if (!hex4(i + 1, cp)) {
+        fail(JST_PARSE_INVALID_UNICODE_HEX);
+        return 0;
+      }
+      i += 4;
+      if (cp >= 0xD800 && cp <= 0xDBFF) {
+        unsigned low = 0;
+        if (i + 6 >= len || json[i + 1] != '\\' || json[i + 2] != 'u' || !hex4(i + 3, low) ||
+            low < 0xDC00 || low > 0xDFFF) {
+          fail(JST_PARSE_INVALID_UNICODE_SURROGATE);
+          return 0;
+        }
+        cp = 0x10000 + (cp - 0xD800) * 0x400 + (low - 0xDC00);
+        i += 6;
+      }
+      n += utf8(cp, dst == (size_t)-1 ? dst : dst + n);
+    }
+  }
+
+  constexpr void string(size_t rec) {
+    size_t end = 0;
+    size_t n = decode((size_t)-1, end);
+    if (err != JST_PARSE_OK) return;
+    size_t off = append(n + 1);
+    decode(off, end);
+    record(rec, JST_STR, n, off);
+    pos = end;
+  }
+
+  // JNumber::from_text: integers that fit 64 bits are exact, everything else keeps its text.
+  constexpr void number(size_t rec) {
+    size_t start = pos;
+    bool negative = peek() == '-';
+    if (negative) pos++;
+    if (!digit(peek())) {
+      fail(JST_PARSE_INVALID_VALUE);
+      return;
+    }
+    uint64_t mantissa = 0;
+    bool exact = true;
+    long int_digits = 0;
+    if (peek() == '0') {
+      pos++;
+      if (digit(peek())) {
+        fail(JST_PARSE_SINGULAR);
+        return;
+      }
+    } else {
+      for (; digit(peek()); pos++, int_digits++) {
+        unsigned d = (unsigned)(json[pos] - '0');
+        if (mantissa > (UINT64_MAX - d) / 10) {
+          exact = false;
+        } else {
+          mantissa = mantissa * 10 + d;
+        }
+      }
+    }
+    size_t int_end = pos;
+    bool zero = int_digits == 0;
+    long e10 = zero ? 0 : int_digits - 1;
+    if (peek() == '.') {
+      pos++;
+      if (!digit(peek())) {
+        fail(JST_PARSE_INVALID_VALUE);
+        return;
+      }
+      for (; digit(peek()); pos++) {
+        if (zero && json[pos] != '0') {
+          zero = false;
+          e10 = -(long)(pos - int_end);
+        }
+      }
+    }
+    if (peek() == 'e' || peek() == 'E') {
+      pos++;
+      bool exp_negative = false;
+      if (peek() == '+' || peek() == '-') exp_negative = json[pos++] == '-';
+      if (!digit(peek())) {
+        fail(JST_PARSE_INVALID_VALUE);
+        return;
+      }
+      long exp = 0;
+      for (; digit(peek()); pos++) {
+        if (exp < 100000) exp = exp * 10 + (json[pos] - '0');
+      }
+      e10 += exp_negative ? -exp : exp;
+    }
+
+    if (int_end == pos && exact && !(negative && mantissa == 0)) {
+      if (!negative) {
+        record(rec, JST_NUM, 0, mantissa,
+               mantissa <= (uint64_t)INT64_MAX ? JST_NUM_INT : JST_NUM_UINT);
+        return;
+      }
+      if (mantissa <= (uint64_t)INT64_MAX + 1) {
+        record(rec, JST_NUM, 0, (uint64_t)0 - mantissa, JST_NUM_INT);
+        return;
+      }
+    }
+    if (!zero && (e10 > 308 || (e10 == 308 && !below_max(start)))) {
+      fail(JST_PARSE_NUMBER_TOO_BIG);
+      return;
+    }
+    size_t n = pos - start;
+    size_t off = append(n + 1);
+    if (out != nullptr) {
+      for (size_t i = 0; i < n; i++) out[off + i] = json[start + i];
+    }
+    record(rec, JST_NUM, n, off, JST_NUM_TEXT);
+  }
+
+  // Whether the significant digits of a number with exponent 308 stay below the point where
+  // strtod rounds to infinity (compared to 40 digits).
+  constexpr bool below_max(size_t start) const {
+    const char limit[] = "1797693134862315807937289714053034150799";
+    size_t k = 0;
+    for (size_t i = start; i < pos && json[i] != 'e' && json[i] != 'E' && k < 40; i++) {
+      if (!digit(json[i]) || (k == 0 && json[i] == '0')) continue;
+      if (json[i] != limit[k]) return json[i] < limit[k];
+      k++;
+    }
+    return k < 40;
+  }
+
+  const char* json;
+  size_t len;
+  char* out;
+  size_t pos = 0;
+  size_t top = 0;
+  JRetType err = JST_PARSE_OK;
+};
+
+constexpr size_t jst_literal_size(const char* json, size_t len) {
+  return JLiteralBuilder(json, len, nullptr).build();
+}
+
+template <size_t N>
+constexpr JLiteral<N> jst_literal(const char* json, size_t len) {
+  JLiteral<N> lit = {};
+  JLiteralBuilder(json, len, lit.bytes).build();
+  return lit;
+}
+
+}  // namespace jst
+
+#endif  // __JSON_TOY_LITERAL_H__
@@ -0,0 +1,46 @@
+#ifndef __JSON_TOY_MSGPACK_H__
+#define __JSON_TOY_MSGPACK_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "enum.h"
+#include "node.h"
+
+namespace jst {
+
+// MessagePack encoding of a JNode tree, for hops where both ends speak it.
+//
+// null, true and false map to nil, true and false; strings to str; arrays to array and objects
+// to map with str keys, in order and with duplicate keys kept. Exact integers use the smallest
+// int or uint encoding, every other number is a float64 (numbers kept as source text included,
+// so those come back as doubles).
+//
+// Encoding is two-pass like stringify: jst_msgpack_size() is exact and jst_msgpack_write() fills
+// that many bytes without checks.
+//
+// A str, array or map holds at most UINT32_MAX entries, or max_length if that is lower (for
+// peers with smaller limits). Beyond it jst_msgpack_size() returns JST_MSGPACK_TOO_LARGE with
+// *err set to JST_PARSE_EXCEED_MAX_STRING_LENGTH for a string or key and to
+// JST_PARSE_EXCEED_MAX_NODES for an array or object, and jst_msgpack_encode() returns that code
+// and leaves out untouched.
+#define JST_MSGPACK_TOO_LARGE SIZE_MAX
+size_t jst_msgpack_size(const JNode& jn, JRetType* err = nullptr, size_t max_length = UINT32_MAX);
+char* jst_msgpack_write(const JNode& jn, char* out);
+JRetType jst_msgpack_encode(const JNode& jn, std::string& out, size_t max_length = UINT32_MAX);
+
+// Nesting beyond this is rejected with JST_PARSE_EXCEED_MAX_DEPTH.
+#define JST_MSGPACK_MAX_DEPTH 1024
+
+// Decode exactly one value that fills the whole buffer. Arrays and objects are allocated at
+// their final size up front. Data cut short gives JST_PARSE_TRUNCATED, bin, ext, the unused
+// 0xc1 byte and non-string keys JST_PARSE_UNSUPPORTED_TYPE, trailing bytes JST_PARSE_SINGULAR;
+// err_offset receives the position of the offending byte.
+JRetType jst_msgpack_decode(const char* data, size_t len, JNode& out,
+                            size_t* err_offset = nullptr);
+
+}  // namespace jst
+
+#endif  // __JSON_TOY_MSGPACK_H__
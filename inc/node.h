@@ -1,6 +1,8 @@
 #ifndef __JSON_TOY_NODE_H__
 #define __JSON_TOY_NODE_H__
 
+#include <stdint.h>
+
 #include <memory>
 
 #include "basic.h"
@@ -15,9 +17,13 @@ class JNode {
   JNode(JNType t, const char* str, size_t len = 0);
   explicit JNode(JNType t) : _type(t), _data(nullptr) {}
   JNode(const JString& s) : _type(JST_STR), _data(std::make_shared<JString>(s)) {}
+  JNode(JString&& s) : _type(JST_STR), _data(std::make_shared<JString>(std::move(s))) {}
   JNode(double num) : _type(JST_NUM), _data(std::make_shared<JNumber>(num)) {}
+  JNode(const JNumber& num) : _type(JST_NUM), _data(std::make_shared<JNumber>(num)) {}
   JNode(const JArray& arr) : _type(JST_ARR), _data(std::make_shared<JArray>(arr)) {}
+  JNode(JArray&& arr) : _type(JST_ARR), _data(std::make_shared<JArray>(std::move(arr))) {}
   JNode(const JObject& obj) : _type(JST_OBJ), _data(std::make_shared<JObject>(obj)) {}
+  JNode(JObject&& obj) : _type(JST_OBJ), _data(std::make_shared<JObject>(std::move(obj))) {}
 
   JNode(const JNode& node);
   JNode(JNode&& node) noexcept;
@@ -33,12 +39,35 @@ class JNode {
 
   JNType type() const { return _type; }
   const JData& data() const { return *_data; }
+  // Writable access to a string, number, array or object. Handing it out counts as a
+  // modification: cached fragments and hashes of the enclosing containers are dropped.
+  JData& mutable_data();
+
+  // Structural (Merkle) hash: computed bottom-up, each array and object folding in the hashes of
+  // its children. Equal nodes (as operator== sees them) hash alike, members of an object count
+  // regardless of their order, and numbers in [-1, 1], which operator== compares with an absolute
+  // tolerance, all hash alike. The value depends on the content alone, the same on every run and
+  // platform, so it can key dedup caches or content-addressed stores; a match still has to be
+  // confirmed with operator== before two documents are taken for the same.
+  // Arrays and objects keep their hash until the subtree is modified, so after a change only the
+  // path up to the root is hashed again, and operator== returns false at once when both sides
+  // hold differing hashes. Like the fragment cache, filling it writes to the tree: threads must
+  // not hash a shared tree concurrently.
+  uint64_t hash() const;
 
  private:
-  JRetType jst_node_parser_num(const std::string& str);
+  JRetType jst_node_parser_num(const char* str, size_t len);
+  // the new _data joins owner_'s subtree, whose fragments are now stale.
+  void changed();
+
+  friend class JData;
+  friend class JOjectElement;
 
   shared_ptr<JData> _data = nullptr;
   JNType _type = JST_NULL;
+  // Array or object holding this node, set by the container itself. Copies and moves start out
+  // unowned, and assigning into an owned node keeps its owner.
+  JData* owner_ = nullptr;
 };
 
 }  // namespace jst
@@ -0,0 +1,19 @@
+#ifndef __JSON_TOY_PARALLEL_H__
+#define __JSON_TOY_PARALLEL_H__
+
+#include <stddef.h>
+
+#include <functional>
+
+namespace jst {
+
+// Number of worker threads to use for a request of `threads` (0: one per core).
+unsigned jst_thread_count(unsigned threads);
+
+// Run task(0) .. task(n - 1) on up to `threads` threads, the calling thread included. Tasks are
+// handed out in order from a shared counter and the call returns when all of them are done.
+void jst_parallel_for(size_t n, unsigned threads, const std::function<void(size_t)>& task);
+
+}  // namespace jst
+
+#endif  // __JSON_TOY_PARALLEL_H__
@@ -1,19 +1,67 @@
 #ifndef __JSON_TOY_H__
 #define __JSON_TOY_H__
 
+#include <chrono>
+#include <cstdint>
 #include <iostream>
 #include <string>
 #include <vector>
 
 #include "basic.h"
 #include "enum.h"
+#include "file.h"
 #include "node.h"
 
 namespace jst {
+
+// Per-parser options. For the resource budget a zero field disables the corresponding check.
+struct JParserOptions {
+  size_t max_bytes = 0;          // input size
+  size_t max_nodes = 0;          // total values, including containers
+  size_t max_string_length = 0;  // decoded length of a single string or key
+  size_t max_depth = 0;          // array/object nesting
+  uint64_t max_time_us = 0;      // soft deadline, checked every JST_DEADLINE_STRIDE nodes
+  // reject strings that are not well-formed UTF-8 with JST_PARSE_INVALID_UTF8.
+  bool validate_utf8 = false;
+  // JDocument::parse_file only: keep strings as raw spans into the mapping and unescape them on
+  // first access. Escapes are still validated during the parse.
+  bool lazy_strings = false;
+  // parse_parallel and stringify: target bytes per chunk of the top-level array or object.
+  size_t parallel_chunk = 1 << 20;
+  // stringify: cache the JSON of every array/object of at least this many bytes on the tree
+  // and reuse it until the subtree is modified (0 = off).
+  size_t cache_fragments = 0;
+  // stringify: threads for a large top-level array or object (0: one per core), which is cut
+  // into batches of about parallel_chunk bytes.
+  unsigned stringify_threads = 1;
+};
+
+// Where a failed parse stopped. Everything but offset is derived from the input on request, so
+// a successful parse does no line bookkeeping at all.
+struct JErrorInfo {
+  size_t offset = 0;          // byte offset into the input
+  size_t line = 0;            // 1-based
+  size_t column = 0;          // 1-based, in bytes
+  std::string context;        // input around offset, clipped to its line
+  size_t context_offset = 0;  // position of offset inside context
+};
+
+#define JST_NO_ERROR_OFFSET ((size_t)-1)
+#define JST_DEADLINE_STRIDE 1024
+// longest UTF-8 output of a single escape sequence (a surrogate pair).
+#define JST_ESCAPE_MAX 4
+
+class JDocument;
+class JReader;
+struct JStringifyPlan;
+
 class JParser {
  public:
-  JParser(const std::string& j_str)
-      : str(j_str), root(), top(0), stack(nullptr), size(0), str_index(0) {}
+  JParser(const std::string& j_str, const JParserOptions& opts = JParserOptions())
+      : str(j_str), root(), top(0), stack(nullptr), size(0), str_index(0), options(opts) {
+    json = str.c_str();
+    json_len = str.size();
+  }
 
   JParser(const JParser& context);
   JParser& operator=(const JParser& context);
@@ -22,41 +70,104 @@ class JParser {
   ~JParser();
 
   void reset(const std::string& j_str);
+  // Parse from an external buffer without copying it. The buffer must outlive the parse and
+  // j_str[len] must be readable and '\0'.
+  void reset(const char* j_str, size_t len);
+  void set_options(const JParserOptions& opts) { options = opts; }
+  const JParserOptions& get_options() const { return options; }
+  // Byte offset at which the last parse failed.
+  size_t error_offset() const { return err_offset; }
+  // Line, column and surrounding text of the last failure. The input must still be available:
+  // a failed parse_file keeps its mapping until the next reset or parse.
+  JErrorInfo error_info(size_t context_radius = 20) const;
 
   JRetType parser(JNode* node = nullptr);
+  // Map the file read-only and parse straight from the mapping.
+  JRetType parse_file(const std::string& path, JNode* node = nullptr);
+  // Same result as parser(), on up to `threads` threads (0: one per core). The innermost array
+  // or object holding more than half of the input (the root if there is none) is found by a
+  // parallel scan that also does the UTF-8 validation (see jst_structural_split), its members
+  // are split into runs of about options.parallel_chunk bytes that are parsed concurrently, and
+  // the text around it is parsed serially. A root that is not an array or object is not scanned
+  // at all. Any other unsplittable input, a node or time budget, or an error anywhere falls back
+  // to the serial parse, so errors and offsets are always the serial ones.
+  JRetType parse_parallel(JNode* node = nullptr, unsigned threads = 0);
+  // The result points into the parser's stack and stays valid until its next use.
   JRetType stringify(const JNode& jn, char** json_str, size_t& len);
+  // Serialize into a single allocation of exactly the right size.
+  JRetType stringify(const JNode& jn, std::string& json_str);
+  // Serialize into a caller buffer. len always receives the full length; if it exceeds capacity
+  // nothing is written and JST_STRINGIFY_BUFFER_TOO_SMALL is returned. No terminator is added.
+  JRetType stringify(const JNode& jn, char* buf, size_t capacity, size_t& len);
 
   JNode root;
 
  private:
+  friend class JDocument;
+  // the pull reader drives the string and number grammar directly on its own view.
+  friend class JReader;
+  // Decode strings in place inside buf; the resulting strings borrow from buf, so this is only
+  // reachable through JDocument, which owns the buffer for as long as the tree lives.
+  JRetType parse_insitu(char* buf, size_t len, JNode* node);
+  // Parse the current view with strings left as raw spans into it (see JString::lazy).
+  JRetType parse_lazy(JNode* node);
+
   JRetType main_parser(JNode& node, bool is_local = false);
+  // Parse the comma separated elements or members that make up the whole current view.
+  JRetType parse_elements(std::vector<JNode>& out);
+  JRetType parse_members(std::vector<JOjectElement>& out);
 
   JRetType parser_symbol(JNode& node);
   JRetType parser_number(JNode& node);
+  // bytes of the number candidate at str_index; the grammar is checked by JNumber::from_text.
+  size_t number_length() const;
 
   // parser spefical char
-  JRetType parser_specifical_str(int& char_index, std::vector<char>& sp_char);
+  JRetType parser_specifical_str(size_t& char_index, char*& out);
   // parser utf code
-  JRetType parser_utf_str(unsigned hex, std::vector<char>& sp_vec);
+  JRetType parser_utf_str(unsigned hex, char*& out);
   JRetType parser_string_base(JString& s);
   JRetType parser_string(JNode& node);
 
   JRetType parser_array(JNode& node);
   JRetType parser_object_member(JOjectElement& objm);
   JRetType parser_object(JNode& node);
+  // Take the container parse_parallel built for the text at splice_at.
+  JRetType parser_splice(JNode& node);
+
+  // Size and write through a JStringifyPlan when stringify_threads allows it.
+  size_t stringify_size(const JNode& jn, JStringifyPlan& plan) const;
+  void stringify_write(const JNode& jn, char* out, const JStringifyPlan& plan) const;
 
   JRetType jst_ws_parser(jst_ws_state state, JNType t = JST_NULL);
-  JRetType stringify_value(const JNode& jn);
-  void stringify_string(const JNode& jn);
+  JRetType check_budget();
+  void attach_input(const JParser& parser);
 
   void* stack_push(size_t size);
   void* stack_pop(size_t size);
 
   std::string str = "";
-  int str_index = 0;
+  // the text being parsed: either str or a caller/file buffer; json[json_len] == '\0'.
+  const char* json = nullptr;
+  size_t json_len = 0;
+  bool own_input = true;
+  // mapping behind json after a failed parse_file, shared by copies of this parser.
+  std::shared_ptr<JMappedFile> file;
+  char* insitu = nullptr;
+  bool lazy = false;
+  size_t str_index = 0;
   char* stack = nullptr;
   size_t top = 0, size = 0;
 
+  JParserOptions options;
+  size_t node_count = 0, depth = 0;
+  size_t err_offset = 0;
+  // parse_parallel: the container at splice_at, ending right before splice_end, is already
+  // built in splice.
+  size_t splice_at = SIZE_MAX, splice_end = 0;
+  JNode splice;
+  std::chrono::steady_clock::time_point deadline;
+
   const size_t init_stack_size = 256;
 };
 
@@ -0,0 +1,79 @@
+#ifndef __JSON_TOY_PATCH_H__
+#define __JSON_TOY_PATCH_H__
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include "enum.h"
+#include "node.h"
+
+namespace jst {
+
+// The value a JSON Pointer (RFC 6901) names, nullptr when the pointer is malformed or names
+// nothing. "" is the whole document; array indexes have no leading zeros, and "-" names nothing.
+const JNode* jst_pointer_find(const JNode& root, const std::string& pointer);
+
+// JSON Patch (RFC 6902): add, remove, replace, move, copy and test, applied to the tree in place.
+//
+// compile() checks the patch document once and splits every pointer into its tokens. apply()
+// then walks to each target and edits the containers there: values are moved rather than copied
+// (copy and the values carried by the patch aside), so a patch costs in proportion to its own
+// size and to the width of the containers it touches, not to the size of the document.
+//
+// A patch is atomic. Every edit is recorded in an undo log holding what it displaced, and when an
+// operation fails the log is played backwards, putting the very same nodes back where they were.
+// The document is never copied up front.
+class JPatch {
+ public:
+  // JST_PARSE_INVALID_PATCH for anything that is not an array of well-formed operations;
+  // *failed_op is the index of the offending entry.
+  JRetType compile(const JNode& patch, size_t* failed_op = nullptr);
+  JRetType compile(const std::string& patch, size_t* failed_op = nullptr);
+
+  // JST_PARSE_OK, or the error of the first operation that failed, *failed_op being its index,
+  // with the document as it was before the call:
+  //   JST_PARSE_PATH_NOT_FOUND     a path (or from) that does not resolve, an array index out of
+  //                                range, or a move into the value being moved
+  //   JST_PARSE_PATCH_TEST_FAILED  a test whose value differs
+  JRetType apply(JNode& doc, size_t* failed_op = nullptr) const;
+
+  bool compiled() const { return ready; }
+  size_t size() const { return ops.size(); }
+
+ private:
+  enum OpKind { ADD, REMOVE, REPLACE, MOVE, COPY, TEST };
+
+  struct Op {
+    OpKind kind;
+    std::vector<std::string> path;
+    std::vector<std::string> from;
+    JNode value;
+  };
+
+  // One edit, and how to take it back. container is the array or object edited (nullptr for the
+  // document itself), index the position in it.
+  struct Undo {
+    enum Kind { INSERTED, REMOVED, REPLACED } kind;
+    JData* container;
+    size_t index;
+    JString key;   // REMOVED from an object
+    JNode value;   // what was removed or replaced
+    bool carried;  // REMOVED by a move: the value is wherever the move put it
+  };
+
+  JRetType apply_op(JNode& doc, const Op& op, std::vector<Undo>& log) const;
+  static JRetType take(JNode& doc, const std::vector<std::string>& path, JNode* out,
+                       std::vector<Undo>& log);
+  static JRetType put(JNode& doc, const std::vector<std::string>& path, JNode&& value,
+                      bool replace, std::vector<Undo>& log);
+  static void rollback(JNode& doc, std::vector<Undo>& log);
+
+  std::vector<Op> ops;
+  bool ready = false;
+};
+
+}  // namespace jst
+
+#endif  // __JSON_TOY_PATCH_H__
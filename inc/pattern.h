@@ -0,0 +1,54 @@
+#ifndef __JSON_TOY_PATTERN_H__
+#define __JSON_TOY_PATTERN_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "enum.h"
+
+namespace jst {
+
+// A JSON Schema "pattern": the subset of ECMAScript regular expressions the specification
+// recommends, compiled into a Thompson automaton and run as a Pike VM. The input is read once,
+// one code point at a time, carrying the set of live states along, so a search takes time
+// linear in the string for a given pattern, needs no backtracking and never recurses, whatever
+// the pattern and however long the string.
+//
+// Syntax: literal code points, '.', classes [...] and [^...] with ranges, \d \D \w \W \s \S, the
+// escapes \t \n \v \f \r \0 \cX \xHH \uHHHH \u{H...} and escaped punctuation, groups (...),
+// (?:...) and (?<name>...), alternation, the quantifiers * + ? {n} {n,} {n,m} and their lazy
+// forms (which cannot change whether there is a match), and the assertions ^ $ \b \B.
+// Backreferences and lookaround need backtracking and are rejected.
+class JPattern {
+ public:
+  // JST_PARSE_INVALID_SCHEMA for anything outside the subset, a quantifier above 1000, or a
+  // pattern whose automaton would exceed 65536 states; err_offset is then the byte of the
+  // pattern where compiling stopped.
+  JRetType compile(const char* pattern, size_t len, size_t* err_offset = nullptr);
+  JRetType compile(const std::string& pattern, size_t* err_offset = nullptr) {
+    return compile(pattern.data(), pattern.size(), err_offset);
+  }
+
+  // Whether the pattern matches anywhere in the UTF-8 string s (a byte that does not start a
+  // valid sequence stands for itself). A compiled pattern may be searched by several threads.
+  bool search(const char* s, size_t len) const;
+
+  struct Range {
+    uint32_t lo, hi;
+  };
+  struct Inst {
+    uint8_t op;
+    uint32_t x, y;  // code point, class or jump targets, depending on op
+  };
+
+ private:
+  std::vector<Inst> prog;
+  std::vector<std::vector<Range>> classes;  // sorted, disjoint
+};
+
+}  // namespace jst
+
+#endif  // __JSON_TOY_PATTERN_H__
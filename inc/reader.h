@@ -0,0 +1,91 @@
+#ifndef __JSON_TOY_READER_H__
+#define __JSON_TOY_READER_H__
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "basic.h"
+#include "enum.h"
+#include "parser.h"
+
+namespace jst {
+
+// Forward-only pull reader: walks the input one token at a time without building a tree.
+// Strings, keys, literals and numbers go through the same code as in JParser, so they are
+// accepted, rejected and located exactly as the parser does.
+//
+// Nothing is copied: get_string() is a lazy JString whose source stays in the input until it
+// is read (raw() gives the span itself), and get_number() is filled from the source text. The
+// input must outlive the reader and every lazy string taken from it, and json[len] must be
+// readable and '\0'.
+//
+// skip() only tracks brackets and string boundaries, so the contents of a skipped subtree are
+// not validated. Of the parser options, max_bytes, max_depth, max_string_length and
+// validate_utf8 apply.
+class JReader {
+ public:
+  JReader(const char* json, size_t len, const JParserOptions& opts = JParserOptions());
+  explicit JReader(const std::string& json, const JParserOptions& opts = JParserOptions())
+      : JReader(json.c_str(), json.size(), opts) {}
+  explicit JReader(const char* json, const JParserOptions& opts = JParserOptions())
+      : JReader(json, strlen(json), opts) {}
+  // the reader points into its input, so a temporary string would dangle.
+  JReader(std::string&&, const JParserOptions& = JParserOptions()) = delete;
+  JReader(const JReader&) = delete;
+  JReader& operator=(const JReader&) = delete;
+
+  // Advance to the next token. After JST_TOKEN_END or JST_TOKEN_ERROR it keeps returning it.
+  JTokenType next();
+  // After JST_TOKEN_BEGIN_*: move past the matching end token. After JST_TOKEN_KEY: move past
+  // that key's value. Anything else is already a whole value and is left alone.
+  JRetType skip();
+
+  JTokenType token() const { return tok; }
+  // Input offset where the current token starts.
+  size_t offset() const { return tok_pos; }
+  // Containers currently open around the reader.
+  size_t depth() const { return levels.size(); }
+
+  // JST_TOKEN_KEY and JST_TOKEN_STRING: the string, decoded on first read.
+  const JString& get_string() const { return str; }
+  // JST_TOKEN_NUMBER.
+  const JNumber& get_number() const { return num; }
+  // Source of the current string/key (between the quotes, still escaped) or number.
+  const char* raw(size_t& len) const {
+    len = raw_len;
+    return p.json + raw_pos;
+  }
+
+  JRetType error() const { return err; }
+  size_t error_offset() const { return p.error_offset(); }
+  JErrorInfo error_info(size_t context_radius = 20) const { return p.error_info(context_radius); }
+
+ private:
+  JTokenType value();
+  JTokenType fail(JRetType ret);
+  void skip_ws();
+  JRetType skip_container();
+
+  struct Level {
+    bool is_object;
+    bool empty;
+    bool want_value;  // object: a key has been read and its value is due
+  };
+
+  // holds the view and runs the string/number grammar; never builds a tree.
+  JParser p;
+  std::vector<Level> levels;
+  bool has_root = false;
+  JTokenType tok = JST_TOKEN_NONE;
+  JRetType err = JST_PARSE_OK;
+  JString str;
+  JNumber num;
+  size_t raw_pos = 0, raw_len = 0;
+  size_t tok_pos = 0;
+};
+
+}  // namespace jst
+
+#endif  // __JSON_TOY_READER_H__
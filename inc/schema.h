@@ -0,0 +1,112 @@
+#ifndef __JSON_TOY_SCHEMA_H__
+#define __JSON_TOY_SCHEMA_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "enum.h"
+#include "pattern.h"
+#include "node.h"
+#include "parser.h"
+#include "reader.h"
+
+namespace jst {
+
+// Where validation failed. path is a JSON Pointer: into the instance for a violation, into the
+// schema for a schema that does not compile.
+struct JSchemaError {
+  std::string path;
+  std::string keyword;  // the keyword that failed, empty for a syntax error in the payload
+  size_t offset = 0;    // text validation only: input offset of the failing value
+};
+
+// JSON Schema (draft 2020-12) compiled into a flat program of per-schema nodes: every keyword is
+// checked once at compile time and turned into plain fields, property names are sorted for
+// binary search, required names become bits, and patterns are compiled automata.
+//
+// Supported keywords: type, enum, const, minimum, maximum, exclusiveMinimum, exclusiveMaximum,
+// minLength, maxLength, pattern, items, minItems, maxItems, properties, required and
+// additionalProperties, plus the boolean schemas true and false. Other keywords are ignored,
+// as annotations are. Lengths count code points; a pattern matches anywhere in the string
+// (the ECMAScript subset of JPattern, matched in linear time whatever the string's length).
+//
+// A compiled schema is immutable and may be shared between threads.
+class JSchema {
+ public:
+  // JST_PARSE_INVALID_SCHEMA for a malformed keyword or pattern, err->path pointing at it.
+  JRetType compile(const JNode& schema, JSchemaError* err = nullptr);
+  JRetType compile(const std::string& schema, JSchemaError* err = nullptr);
+
+  // JST_PARSE_OK or JST_PARSE_SCHEMA_VIOLATION, stopping at the first violation.
+  JRetType validate(const JNode& doc, JSchemaError* err = nullptr) const;
+  // The same straight over the text with a JReader, without building a tree (except for the
+  // values an enum or const has to compare). Syntax errors come back as the reader reports
+  // them. As with JReader, json[len] must be readable and '\0'.
+  JRetType validate(const char* json, size_t len, JSchemaError* err = nullptr,
+                    const JParserOptions& opts = JParserOptions()) const;
+  JRetType validate(const std::string& json, JSchemaError* err = nullptr,
+                    const JParserOptions& opts = JParserOptions()) const {
+    return validate(json.c_str(), json.size(), err, opts);
+  }
+  // Validate the text and only build the tree when it passes, so an invalid payload never
+  // costs a tree.
+  JRetType parse(const char* json, size_t len, JNode& out, JSchemaError* err = nullptr,
+                 const JParserOptions& opts = JParserOptions()) const;
+
+  bool compiled() const { return ready; }
+
+ private:
+  // child index of a node that accepts or rejects everything.
+  static const int32_t ALLOW = -1;
+  static const int32_t DENY = -2;
+
+  struct Property {
+    std::string key;
+    int32_t schema;    // the properties entry, or additionalProperties for a required name
+    int32_t required;  // bit in the required mask, -1 if not required
+    bool declared;     // listed under properties
+  };
+
+  struct Node {
+    uint8_t types = 0;  // JST_SCHEMA_* bits, 0 = any
+    bool has_enum = false, has_const = false;
+    std::vector<JNode> enum_values;
+    JNode const_value;
+    size_t value_depth = 0;  // deepest nesting of those values
+
+    uint8_t bounds = 0;  // which of the four limits below apply
+    double minimum = 0.0, maximum = 0.0, exclusive_minimum = 0.0, exclusive_maximum = 0.0;
+
+    size_t min_length = 0, max_length = SIZE_MAX;
+    std::shared_ptr<JPattern> pattern;
+
+    int32_t items = ALLOW;
+    size_t min_items = 0, max_items = SIZE_MAX;
+
+    std::vector<Property> properties;  // sorted by key
+    size_t required = 0;
+    int32_t additional = ALLOW;
+  };
+
+  int32_t compile_node(const JNode& schema, JSchemaError* err, std::string& path);
+  JRetType compile_keyword(Node& node, const std::string& key, const JNode& value,
+                           JSchemaError* err, std::string& path,
+                           std::vector<std::string>& required);
+
+  const Property* find(const Node& node, const char* key, size_t len) const;
+  JRetType check(int32_t index, const JNode& v, JSchemaError* err) const;
+  JRetType check(int32_t index, JReader& r, JSchemaError* err) const;
+  JRetType consume(JReader& r) const;
+
+  std::vector<Node> nodes;
+  int32_t root = ALLOW;
+  bool ready = false;
+};
+
+}  // namespace jst
+
+#endif  // __JSON_TOY_SCHEMA_H__
@@ -0,0 +1,116 @@
+#ifndef __JSON_TOY_SNAPSHOT_H__
+#define __JSON_TOY_SNAPSHOT_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "enum.h"
+#include "file.h"
+#include "node.h"
+
+namespace jst {
+
+// Snapshot layout. All offsets are from the start of the snapshot, so the bytes can be mapped
+// anywhere, and every record is 8-byte aligned. Integers are in host byte order; a snapshot
+// only opens on a machine with the byte order it was written on.
+//
+// A value is a 16-byte JSnapRecord. Arrays point to their elements' records, stored back to
+// back; objects point to their members, each a key record followed by a value record, and then
+// to a table of member indices sorted by key for find(). Strings, keys and number source text
+// are stored NUL-terminated.
+struct JSnapHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;  // JST_SNAP_BYTE_ORDER as written
+  uint64_t size;        // whole snapshot, header included
+  uint64_t root;        // offset of the root record
+};
+
+struct JSnapRecord {
+  uint8_t type;      // JNType
+  uint8_t num_type;  // JNumType of a number
+  uint16_t reserved;
+  uint32_t length;   // bytes of a string or number text, elements of an array or object
+  uint64_t payload;  // double/integer bits of a number, offset of everything else
+};
+
+#define JST_SNAP_MAGIC "JSTSNAP"
+#define JST_SNAP_VERSION 1
+#define JST_SNAP_BYTE_ORDER 0x01020304u
+
+// Read-only handle on one value of a snapshot: two pointers, cheap to copy, and nothing it does
+// allocates. A default-constructed view, or one returned by a failed find(), is !valid().
+// Accessors for the wrong type return empty values, as JData::as<> does not apply here.
+class JSnapView {
+ public:
+  JSnapView() = default;
+
+  bool valid() const { return rec != nullptr; }
+  JNType type() const { return rec != nullptr ? (JNType)rec->type : JST_NULL; }
+
+  // JST_NUM.
+  JNumType num_type() const { return type() == JST_NUM ? (JNumType)rec->num_type : JST_NUM_DOUBLE; }
+  double number() const;
+  int64_t int_value() const;
+  uint64_t uint_value() const;
+
+  // JST_STR, and the source text of a JST_NUM_TEXT number: NUL-terminated, size() bytes.
+  const char* c_str() const;
+  // bytes of a string or number text, elements of an array or object.
+  size_t size() const { return rec != nullptr ? rec->length : 0; }
+
+  // JST_ARR and JST_OBJ.
+  JSnapView operator[](size_t index) const;
+  JSnapView key(size_t index) const;
+  // First member with this key, by binary search over the sorted member table.
+  JSnapView find(const char* key, size_t len) const;
+  JSnapView find(const std::string& key) const { return find(key.data(), key.size()); }
+
+  // Copy the value out into an ordinary tree.
+  JNode to_node() const;
+
+ private:
+  friend class JSnapshot;
+  JSnapView(const char* base, const JSnapRecord* rec) : base(base), rec(rec) {}
+  const char* at(uint64_t offset) const { return base + offset; }
+
+  const char* base = nullptr;
+  const JSnapRecord* rec = nullptr;
+};
+
+// A snapshot opened from a file (mapped read-only, so processes opening the same file share
+// its pages) or from a caller buffer that must stay alive and 8-byte aligned.
+//
+// open() checks the header only, which keeps startup independent of the document size; a file
+// that may have been damaged or tampered with should be checked once with verify().
+class JSnapshot {
+ public:
+  JSnapshot() = default;
+  JSnapshot(const JSnapshot&) = delete;
+  JSnapshot& operator=(const JSnapshot&) = delete;
+  JSnapshot(JSnapshot&&) noexcept = default;
+  JSnapshot& operator=(JSnapshot&&) noexcept = default;
+
+  // Fails with JST_PARSE_EXCEED_MAX_STRING_LENGTH for a string or number text, and with
+  // JST_PARSE_EXCEED_MAX_NODES for an array or object, too long for a record's 32-bit length.
+  static JRetType write(const JNode& root, std::string& out);
+  static JRetType write(const JNode& root, const std::string& path);
+
+  JRetType open(const std::string& path);
+  JRetType open(const char* data, size_t len);
+  // Bounds, alignment and type check of every record reachable from the root.
+  JRetType verify() const;
+
+  JSnapView root() const;
+
+ private:
+  JMappedFile file_;
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+}  // namespace jst
+
+#endif  // __JSON_TOY_SNAPSHOT_H__
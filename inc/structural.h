@@ -0,0 +1,49 @@
+#ifndef __JSON_TOY_STRUCTURAL_H__
+#define __JSON_TOY_STRUCTURAL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "enum.h"
+
+namespace jst {
+
+// Stage-1 structural index: the offsets of every '{', '}', '[', ']', ':' and ',' outside
+// strings and of the opening quote of every string, in input order.
+//
+// The input is cut into one chunk per thread and indexed in two parallel passes. Chunk
+// boundaries never follow a backslash or split a UTF-8 sequence, so every chunk starts
+// unescaped and can be validated on its own. The first pass counts the unescaped quotes of each
+// chunk; a prefix over those parities tells the second pass whether its chunk starts inside a
+// string. Backslashes are treated as escapes wherever they are, which is exact for valid JSON;
+// for anything else the index is only a hint and the grammar has to be checked again.
+//
+// Returns JST_PARSE_MISS_QUOTATION_MARK if the input ends inside a string, and
+// JST_PARSE_INVALID_UTF8 (with err_offset at the first bad sequence) if validate_utf8 is set and
+// the input is not UTF-8. Offsets are 64-bit, so an input of any size is indexed.
+JRetType jst_structural_index(const char* json, size_t len, unsigned threads,
+                              std::vector<uint64_t>& index, bool validate_utf8 = false,
+                              size_t* err_offset = nullptr);
+
+// Where parse_parallel cuts the input: the container that holds most of it and the starts of
+// runs of its members about `chunk` bytes long.
+struct JSplitPlan {
+  size_t open = 0, close = 0;  // offsets of the container's brackets
+  size_t depth = 0;            // containers around its members, itself included
+  std::vector<size_t> bounds;  // start of every run, then close
+};
+
+// Plans the split without materializing the index. The root must be an array or an object
+// (checked before anything is scanned); the container split is the innermost one that holds
+// more than half of the input, found by pairing up the brackets each thread's chunk leaves
+// unmatched. Memory is bounded by the nesting depth and the number of runs. Returns false if
+// there are fewer than two runs, the nesting is deeper than 1024 across a chunk, or the input
+// is not valid as far as this scan can tell (the parse reports why).
+bool jst_structural_split(const char* json, size_t len, unsigned threads, size_t chunk,
+                          JSplitPlan& plan, bool validate_utf8 = false);
+
+}  // namespace jst
+
+#endif  // __JSON_TOY_STRUCTURAL_H__
@@ -0,0 +1,86 @@
+#ifndef __JSON_TOY_UTF8_H__
+#define __JSON_TOY_UTF8_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace jst {
+
+// value of each hex digit, -1 for every other byte.
+extern const int8_t jst_hex_table[256];
+// decoded byte of each single-character escape, 0 for 'u' and invalid escapes.
+extern const char jst_escape_table[256];
+
+// Digits are checked one at a time so a short input stops at its terminating '\0'.
+inline bool jst_parse_hex4(const char* p, unsigned& hex) {
+  int h0, h1, h2, h3;
+  if ((h0 = jst_hex_table[(unsigned char)p[0]]) < 0 ||
+      (h1 = jst_hex_table[(unsigned char)p[1]]) < 0 ||
+      (h2 = jst_hex_table[(unsigned char)p[2]]) < 0 ||
+      (h3 = jst_hex_table[(unsigned char)p[3]]) < 0)
+    return false;
+  hex = (h0 << 12) | (h1 << 8) | (h2 << 4) | h3;
+  return true;
+}
+
+// Encode a code point up to U+10FFFF and return the position after it.
+inline char* jst_utf8_encode(unsigned cp, char* out) {
+  if (cp <= 0x7F) {
+    *out++ = (char)cp;
+  } else if (cp <= 0x7FF) {
+    *out++ = (char)(0xC0 | (cp >> 6));
+    *out++ = (char)(0x80 | (cp & 0x3F));
+  } else if (cp <= 0xFFFF) {
+    *out++ = (char)(0xE0 | (cp >> 12));
+    *out++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+    *out++ = (char)(0x80 | (cp & 0x3F));
+  } else {
+    *out++ = (char)(0xF0 | (cp >> 18));
+    *out++ = (char)(0x80 | ((cp >> 12) & 0x3F));
+    *out++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+    *out++ = (char)(0x80 | (cp & 0x3F));
+  }
+  return out;
+}
+
+// Length of the well-formed UTF-8 sequence at p (1 to 4), or 0 if it is invalid: a stray
+// continuation byte, an overlong form, a surrogate, a value above U+10FFFF, or a sequence cut
+// short by the end of the avail bytes.
+inline size_t jst_utf8_sequence(const unsigned char* p, size_t avail) {
+  unsigned char c = p[0];
+  if (c < 0x80) return 1;
+  if (c < 0xC2 || c > 0xF4) return 0;
+  if (c < 0xE0) return (avail >= 2 && (p[1] & 0xC0) == 0x80) ? 2 : 0;
+  if (avail < 3) return 0;
+  // allowed range of the second byte, narrower than 80..BF for E0, ED, F0 and F4.
+  unsigned char lo = c == 0xE0 ? 0xA0 : c == 0xF0 ? 0x90 : 0x80;
+  unsigned char hi = c == 0xED ? 0x9F : c == 0xF4 ? 0x8F : 0xBF;
+  if (p[1] < lo || p[1] > hi || (p[2] & 0xC0) != 0x80) return 0;
+  if (c < 0xF0) return 3;
+  return (avail >= 4 && (p[3] & 0xC0) == 0x80) ? 4 : 0;
+}
+
+// Number of leading bytes of s that need no attention inside a JSON string: anything except
+// '"', '\\' and control characters, and when ascii_only is set, except bytes >= 0x80 as well.
+// Vectorized with AVX2 or SSE2 where available.
+size_t jst_scan_plain(const char* s, size_t len, bool ascii_only);
+
+// Offset of the first invalid UTF-8 sequence in s, or len if the whole buffer is valid.
+// Non-ASCII text is validated a vector at a time with AVX2 or SSSE3 where available.
+size_t jst_utf8_validate(const char* s, size_t len);
+
+// Number of leading bytes of s that jst_scan_plain(s, len, false) would skip and that are also
+// well-formed UTF-8; it stops at a special character or at the first invalid sequence.
+size_t jst_scan_plain_utf8(const char* s, size_t len);
+
+// Decode the body of a JSON string that the parser has already validated, returning the number
+// of bytes written to dst (never more than len).
+size_t jst_unescape(const char* src, size_t len, char* dst);
+
+// Number of '\n' in s. If last_line is given it receives the offset just past the last '\n'
+// (0 when there is none), i.e. the start of the line containing s[len].
+size_t jst_count_newlines(const char* s, size_t len, size_t* last_line = nullptr);
+
+}  // namespace jst
+
+#endif  // __JSON_TOY_UTF8_H__
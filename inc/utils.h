@@ -60,7 +60,7 @@ JVector<T>::JVector(const JVector<T>& v) {
   this->cap_ = v.cap_;
   this->len_ = v.len_;
   this->begin_ = new T[this->cap_];
-  for (int i = 0; i < this->len_; i++) this->begin_[i] = v.begin_[i];
+  for (size_t i = 0; i < this->len_; i++) this->begin_[i] = v.begin_[i];
 }
 
 template <typename T>
@@ -77,7 +77,7 @@ JVector<T>& JVector<T>::operator=(const JVector<T>& v) {
     this->cap_ = v.cap_;
     this->len_ = v.len_;
     this->begin_ = new T[this->cap_];
-    for (int i = 0; i < this->len_; i++) this->begin_[i] = v.begin_[i];
+    for (size_t i = 0; i < this->len_; i++) this->begin_[i] = v.begin_[i];
   }
   return *this;
 }
@@ -216,7 +216,7 @@ template <typename T>
 bool operator==(const JVector<T>& v_1, const JVector<T>& v_2) {
   if (v_1.size() != v_2.size()) return false;
   size_t size = v_1.size();
-  for (int i = 0; i < size; i++) {
+  for (size_t i = 0; i < size; i++) {
     size_t index;
     if ((index = v_1.find(v_2[i])) == JST_NODE_NOT_EXIST) return false;
   }
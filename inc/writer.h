@@ -0,0 +1,85 @@
+#ifndef __JSON_TOY_WRITER_H__
+#define __JSON_TOY_WRITER_H__
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "node.h"
+
+namespace jst {
+
+// longest output of a number built in code: "%.17g" of a double or a 64-bit integer.
+#define JST_NUMBER_MAX 32
+
+// Streaming serializer: emits JSON straight from begin/key/value/end calls, without building a
+// JNode tree first. Output is collected in a fixed buffer and handed to the sink whenever it
+// fills up, on flush() and on destruction. Escaping and number formatting are the ones
+// stringify uses (format.h), so a tree and the equivalent calls produce the same bytes.
+//
+// Commas and colons are inserted automatically. In debug builds every call is checked against
+// the current nesting: a key only inside an object, a value inside an object only after its
+// key, matching end calls, and nothing after the top-level value.
+class JWriter {
+ public:
+  using Sink = std::function<void(const char*, size_t)>;
+
+  explicit JWriter(std::string& out, size_t buffer_size = 4096);
+  explicit JWriter(FILE* fp, size_t buffer_size = 65536);
+  JWriter(Sink sink, size_t buffer_size);
+  JWriter(const JWriter&) = delete;
+  JWriter& operator=(const JWriter&) = delete;
+  ~JWriter();
+
+  void begin_object();
+  void end_object();
+  void begin_array();
+  void end_array();
+
+  void key(const char* s, size_t len);
+  void key(const char* s);
+  void key(const std::string& s) { key(s.data(), s.size()); }
+
+  void null();
+  void value(bool b);
+  void value(int n) { value((int64_t)n); }
+  void value(int64_t n);
+  void value(uint64_t n);
+  void value(double n);
+  void value(const char* s, size_t len);
+  void value(const char* s);
+  void value(const std::string& s) { value(s.data(), s.size()); }
+  // a whole subtree, serialized as stringify would.
+  void value(const JNode& jn);
+
+  // True once the top-level value is complete.
+  bool done() const { return levels.empty() && has_root; }
+  void flush();
+
+ private:
+  // Where the next value goes: adds the separator and checks the nesting in debug builds.
+  void before_value();
+  char* reserve(size_t len);
+  void put(const char* s, size_t len);
+  void put_c(char c);
+  void put_number(const JNumber& num);
+
+  struct Level {
+    bool is_object;
+    bool empty;
+    bool want_value;  // object: a key has been written and its value is due
+  };
+
+  Sink sink;
+  std::vector<char> buffer;
+  size_t used = 0;
+  std::vector<Level> levels;
+  bool has_root = false;
+};
+
+}  // namespace jst
+
+#endif  // __JSON_TOY_WRITER_H__
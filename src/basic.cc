@@ -2,12 +2,15 @@
 
 #include <assert.h>
 
+#include <algorithm>
 #include <cctype>
 #include <cmath>
 #include <cstring>
 #include <limits>
+#include <vector>
 
 #include "node.h"
+#include "utf8.h"
 
 namespace jst {
 /*
@@ -25,53 +28,242 @@ JString::JString(const char* str, size_t len) : length(len) {
   this->s[this->length] = '\0';
 }
 
-JString::JString(const JString& str) : length(str.length) {
+JString::JString(const JString& str) : JData(str), length(str.length) {
   ASSERT_VECTOR_NO_RET(str, s, length);
   this->s = new char[this->length + 1];
-  memcpy(this->s, str.s, this->length * sizeof(char));
+  str.copy_chars(this->s);
   this->s[this->length] = '\0';
 }
 
+JString JString::borrow(char* str, size_t len) {
+  JString ret;
+  ret.s = str;
+  ret.length = len;
+  ret.borrowed = true;
+  return ret;
+}
+
+JString JString::lazy(const char* raw, size_t raw_len, size_t len) {
+  JString ret;
+  ret.s = const_cast<char*>(raw);
+  ret.length = len;
+  ret.raw_length = raw_len;
+  ret.borrowed = true;
+  ret.pending = true;
+  return ret;
+}
+
+// Write the decoded characters (without terminator) to dst, which holds at least length bytes.
+void JString::copy_chars(char* dst) const {
+  if (this->pending && this->raw_length != this->length)
+    jst_unescape(this->s, this->raw_length, dst);
+  else
+    memcpy(dst, this->s, this->length * sizeof(char));
+}
+
+void JString::materialize() const {
+  char* owned = new char[this->length + 1];
+  copy_chars(owned);
+  owned[this->length] = '\0';
+  this->s = owned;
+  this->borrowed = false;
+  this->pending = false;
+}
+
 JString& JString::operator=(const JString& str) {
-  if (this->s != nullptr) delete[] this->s;
+  if (this == &str) return *this;
+  if (this->s != nullptr && !this->borrowed) delete[] this->s;
+  this->borrowed = false;
+  this->pending = false;
 
   ASSERT_VECTOR_HAS_RET(str, s, length, *this);
   this->length = str.length;
   this->s = new char[this->length + 1];
-  memcpy(this->s, str.s, this->length * sizeof(char));
+  str.copy_chars(this->s);
   this->s[this->length] = '\0';
   return *this;
 }
 
-JString::JString(JString&& str) noexcept : s(str.s), length(str.length) {
-  ASSERT_VECTOR_NO_RET(str, s, length);
+JString::JString(JString&& str) noexcept
+    : length(str.length),
+      s(str.s),
+      borrowed(str.borrowed),
+      pending(str.pending),
+      raw_length(str.raw_length) {
   str.s = nullptr;
   str.length = 0;
-  return;
+  str.borrowed = false;
+  str.pending = false;
 }
 
 JString& JString::operator=(JString&& str) noexcept {
-  if (this->s != nullptr) delete[] this->s;
-  ASSERT_VECTOR_HAS_RET(str, s, length, *this);
+  if (this == &str) return *this;
+  if (this->s != nullptr && !this->borrowed) delete[] this->s;
   this->s = str.s;
   this->length = str.length;
+  this->borrowed = str.borrowed;
+  this->pending = str.pending;
+  this->raw_length = str.raw_length;
   str.s = nullptr;
   str.length = 0;
+  str.borrowed = false;
+  str.pending = false;
   return *this;
 }
 
 JString::~JString() {
-  if (this->s != nullptr) delete[] this->s;
+  if (this->s != nullptr && !this->borrowed) delete[] this->s;
   this->length = 0;
   this->s = nullptr;
 }
 
+// Lazy strings without escapes are compared in place, so key lookups do not materialize them.
 bool operator==(const JString& str_1, const JString& str_2) {
-  return (str_1.length == str_2.length) && memcmp(str_1.c_str(), str_2.c_str(), str_1.size()) == 0;
+  if (str_1.length != str_2.length) return false;
+  const char* s_1 = str_1.pending && str_1.raw_length == str_1.length ? str_1.s : str_1.c_str();
+  const char* s_2 = str_2.pending && str_2.raw_length == str_2.length ? str_2.s : str_2.c_str();
+  return str_1.length == 0 || memcmp(s_1, s_2, str_1.length) == 0;
+}
+
+bool operator<(const JString& str_1, const JString& str_2) {
+  const char* s_1 = str_1.pending && str_1.raw_length == str_1.length ? str_1.s : str_1.c_str();
+  const char* s_2 = str_2.pending && str_2.raw_length == str_2.length ? str_2.s : str_2.c_str();
+  size_t len = std::min(str_1.length, str_2.length);
+  int c = len == 0 ? 0 : memcmp(s_1, s_2, len);
+  return c < 0 || (c == 0 && str_1.length < str_2.length);
+}
+
+/*
+number class implemention;
+*/
+JNumber JNumber::from_int(int64_t n) {
+  JNumber num;
+  num.kind = JST_NUM_INT;
+  num.i = n;
+  return num;
+}
+
+JNumber JNumber::from_uint(uint64_t n) {
+  JNumber num;
+  num.kind = JST_NUM_UINT;
+  num.u = n;
+  return num;
+}
+
+static inline bool jst_is_digit(char c) { return (unsigned)(c - '0') < 10; }
+
+// One pass over the grammar. Integers are accumulated on the way; for everything else only the
+// decimal exponent of the leading digit is tracked, which is enough to tell whether the value
+// can overflow a double without converting it.
+JRetType JNumber::from_text(const char* s, size_t len, JNumber& num) {
+  size_t index = 0;
+  bool negative = false;
+  if (index < len && s[index] == '-') {
+    negative = true;
+    index++;
+  }
+  if (index == len || !jst_is_digit(s[index])) return JST_PARSE_INVALID_VALUE;
+
+  uint64_t mantissa = 0;
+  bool exact = true;
+  size_t int_digits = 0;
+  if (s[index] == '0') {
+    index++;
+    if (index < len && jst_is_digit(s[index])) return JST_PARSE_SINGULAR;
+  } else {
+    for (; index < len && jst_is_digit(s[index]); index++, int_digits++) {
+      unsigned d = s[index] - '0';
+      if (mantissa > (std::numeric_limits<uint64_t>::max() - d) / 10)
+        exact = false;
+      else
+        mantissa = mantissa * 10 + d;
+    }
+  }
+  size_t int_end = index;
+
+  bool zero = int_digits == 0;
+  long e10 = zero ? 0 : (long)int_digits - 1;
+  if (index < len && s[index] == '.') {
+    index++;
+    if (index == len || !jst_is_digit(s[index])) return JST_PARSE_INVALID_VALUE;
+    for (; index < len && jst_is_digit(s[index]); index++) {
+      if (zero && s[index] != '0') {
+        zero = false;
+        e10 = -(long)(index - int_end);
+      }
+    }
+  }
+  if (index < len && (s[index] == 'e' || s[index] == 'E')) {
+    index++;
+    bool exp_negative = false;
+    if (index < len && (s[index] == '+' || s[index] == '-')) exp_negative = s[index++] == '-';
+    if (index == len || !jst_is_digit(s[index])) return JST_PARSE_INVALID_VALUE;
+    long exp = 0;
+    for (; index < len && jst_is_digit(s[index]); index++) {
+      if (exp < 100000) exp = exp * 10 + (s[index] - '0');
+    }
+    e10 += exp_negative ? -exp : exp;
+  }
+  if (index != len) return JST_PARSE_INVALID_VALUE;
+
+  num.text.clear();
+  // "-0" stays text so that the sign survives.
+  if (int_end == len && exact && !(negative && mantissa == 0)) {
+    if (!negative) {
+      num.kind = mantissa <= (uint64_t)std::numeric_limits<int64_t>::max() ? JST_NUM_INT
+                                                                             : JST_NUM_UINT;
+      num.u = mantissa;
+      return JST_PARSE_OK;
+    }
+    if (mantissa <= (uint64_t)std::numeric_limits<int64_t>::max() + 1) {
+      num.kind = JST_NUM_INT;
+      num.i = -(int64_t)(mantissa - 1) - 1;
+      return JST_PARSE_OK;
+    }
+  }
+
+  if (!zero && e10 > 308) return JST_PARSE_NUMBER_TOO_BIG;
+  num.kind = JST_NUM_TEXT;
+  num.text.assign(s, len);
+  num.converted = false;
+  if (!zero && e10 == 308) {
+    double n = std::strtod(num.text.c_str(), nullptr);
+    if (n == HUGE_VAL || n == -HUGE_VAL) return JST_PARSE_NUMBER_TOO_BIG;
+    num.d = n;
+    num.converted = true;
+  }
+  return JST_PARSE_OK;
+}
+
+double JNumber::value() const {
+  switch (kind) {
+    case JST_NUM_INT:
+      return (double)i;
+    case JST_NUM_UINT:
+      return (double)u;
+    case JST_NUM_TEXT:
+      if (!converted) {
+        d = std::strtod(text.c_str(), nullptr);
+        converted = true;
+      }
+      return d;
+    default:
+      return d;
+  }
 }
 
 bool operator==(const JNumber& num_1, const JNumber& num_2) {
-  return std::fabs((num_1.num) - (num_2.num)) < std::numeric_limits<double>::epsilon();
+  if (num_1.is_int() && num_2.is_int()) {
+    bool neg_1 = num_1.kind == JST_NUM_INT && num_1.i < 0;
+    bool neg_2 = num_2.kind == JST_NUM_INT && num_2.i < 0;
+    return neg_1 == neg_2 && num_1.uint_value() == num_2.uint_value();
+  }
+  return std::fabs(num_1.value() - num_2.value()) < std::numeric_limits<double>::epsilon();
+}
+
+void JData::adopt(JNode& jn) {
+  jn.owner_ = this;
+  if (jn._data != nullptr) jn._data->parent_ = this;
 }
 
 /*
@@ -80,51 +272,72 @@ array class implemention;
 
 // The expansion threshold is the nearest 2 to the NTH power of the input
 // capacity.
-inline int tableSizeFor(int cap) {
+inline size_t tableSizeFor(size_t cap) {
+  if (cap <= 1) return 1;
   // In case it's a power of two
-  int n = cap - 1;
+  size_t n = cap - 1;
   n |= n >> 1;
   n |= n >> 2;
   n |= n >> 4;
   n |= n >> 8;
   n |= n >> 16;
-  return (n < 0) ? 1 : n + 1;
+  n |= n >> 32;
+  return n + 1;
+}
+
+// Every slot up to capacity is owned, so assigning into any of them reaches our fragment.
+void JArray::adopt_all() {
+  for (size_t i = 0; i < this->cap_; i++) adopt(this->data_[i]);
 }
 
 JArray::JArray(size_t len) {
   this->cap_ = tableSizeFor(len);
   this->data_ = new JNode[this->cap_];
   this->len_ = len;
+  adopt_all();
 }
 
-JArray::JArray(const JArray& arr) {
+JArray::JArray(const JArray& arr) : JData(arr) {
   ASSERT_VECTOR_NO_RET(arr, data_, len_);
   this->cap_ = arr.cap_;
   this->len_ = arr.len_;
   this->data_ = new JNode[this->cap_];
-  for (int i = 0; i < this->len_; i++) this->data_[i] = arr.data_[i];
+  adopt_all();
+  for (size_t i = 0; i < this->len_; i++) this->data_[i] = arr.data_[i];
+  this->fragment_ = arr.fragment_;
+  this->hash_ = arr.hash_;
+  this->hashed_ = arr.hashed_;
 }
 
-JArray::JArray(JArray&& arr) noexcept : data_(arr.data_), len_(arr.len_), cap_(arr.cap_) {
+JArray::JArray(JArray&& arr) noexcept
+    : JData(arr), data_(arr.data_), len_(arr.len_), cap_(arr.cap_) {
   arr.data_ = nullptr;
   arr.len_ = 0;
   arr.cap_ = 0;
+  adopt_all();
 }
 
 JArray& JArray::operator=(const JArray& arr) {
   if (this != &arr) {
     if (this->data_ != nullptr) delete[] this->data_;
+    JData::operator=(arr);
     ASSERT_VECTOR_HAS_RET(arr, data_, len_, *this);
     this->cap_ = arr.cap_;
     this->len_ = arr.len_;
     this->data_ = new JNode[this->cap_];
-    for (int i = 0; i < this->len_; i++) this->data_[i] = arr.data_[i];
+    adopt_all();
+    for (size_t i = 0; i < this->len_; i++) this->data_[i] = arr.data_[i];
+    this->fragment_ = arr.fragment_;
+    this->hash_ = arr.hash_;
+    this->hashed_ = arr.hashed_;
   }
   return *this;
 }
 
 JArray& JArray::operator=(JArray&& arr) noexcept {
+  if (this == &arr) return *this;
   if (this->data_ != nullptr) delete[] this->data_;
+  JData::operator=(arr);
   ASSERT_VECTOR_HAS_RET(arr, data_, len_, *this);
   this->data_ = arr.data_;
   this->cap_ = arr.cap_;
@@ -132,6 +345,7 @@ JArray& JArray::operator=(JArray&& arr) noexcept {
   arr.data_ = nullptr;
   arr.len_ = 0;
   arr.cap_ = 0;
+  adopt_all();
   return *this;
 }
 
@@ -142,23 +356,24 @@ JArray::~JArray() {
   this->cap_ = 0;
 }
 
-JNode& JArray::operator[](int index) {
-  JST_DEBUG(index >= 0 && index < len_);
+JNode& JArray::operator[](size_t index) {
+  JST_DEBUG(index < len_);
   return this->data_[index];
 }
 
-const JNode& JArray::operator[](int index) const {
-  JST_DEBUG(index >= 0 && index < len_);
+const JNode& JArray::operator[](size_t index) const {
+  JST_DEBUG(index < len_);
   return this->data_[index];
 }
 
 #define JST_NODE_NOT_EXIST ((size_t)-1)
 
+// Element by element, in order. Hashes that both sides already hold settle a difference at once.
 bool operator==(const JArray& arr_1, const JArray& arr_2) {
   if (arr_1.len_ != arr_2.len_) return false;
-  size_t size = arr_1.size();
-  for (int i = 0; i < size; i++) {
-    if (arr_1.find(arr_2[i]) == JST_NODE_NOT_EXIST) return false;
+  if (arr_1.hashed_ && arr_2.hashed_ && arr_1.hash_ != arr_2.hash_) return false;
+  for (size_t i = 0; i < arr_1.len_; i++) {
+    if (!(arr_1.data_[i] == arr_2.data_[i])) return false;
   }
   return true;
 }
@@ -171,23 +386,28 @@ size_t JArray::find(const JNode& jn) const {
   return JST_NODE_NOT_EXIST;
 }
 
-size_t JArray::insert(size_t pos, JNode& jn) {
+size_t JArray::insert(size_t pos, JNode& jn) { return insert(pos, JNode(jn)); }
+
+size_t JArray::insert(size_t pos, JNode&& jn) {
   JST_DEBUG(pos <= size());
+  touch();
   if (this->cap_ == 0) {
     this->cap_ = 2;
     this->data_ = new JNode[this->cap_];
+    adopt_all();
   }
   if (this->len_ + 1 > this->cap_) {
-    this->cap_ += (this->cap_ >> 1);
+    this->cap_ = this->cap_ == 1 ? 2 : this->cap_ + (this->cap_ >> 1);
     JNode* tmp = this->data_;
     this->data_ = new JNode[this->cap_];
+    adopt_all();
     for (size_t i = 0; i < pos; i++) this->data_[i] = std::move(tmp[i]);
-    this->data_[pos] = jn;
-    for (size_t i = pos + 1; i < this->len_ + 1; i++) this->data_[i] = tmp[i - 1];
+    this->data_[pos] = std::move(jn);
+    for (size_t i = pos + 1; i < this->len_ + 1; i++) this->data_[i] = std::move(tmp[i - 1]);
     delete[] tmp;
   } else {
     for (size_t i = this->len_; i > pos; i--) this->data_[i] = std::move(this->data_[i - 1]);
-    this->data_[pos] = jn;
+    this->data_[pos] = std::move(jn);
   }
   this->len_ += 1;
   return pos;
@@ -196,6 +416,7 @@ size_t JArray::insert(size_t pos, JNode& jn) {
 size_t JArray::erase(size_t pos, size_t count) {
   JST_DEBUG(pos >= 0 && pos < this->len_);
   if (count == 0) return pos;
+  touch();
   count = std::min(count, this->len_ - pos);
   for (size_t i = pos; i + count < this->len_; i++)
     this->data_[i] = std::move(this->data_[i + count]);
@@ -207,11 +428,13 @@ void JArray::push_back(const JNode& jn) {
   if (this->cap_ == 0) {
     this->cap_ = 2;
     this->data_ = new JNode[this->cap_];
+    adopt_all();
   }
   if (this->len_ + 1 > this->cap_) {
     this->cap_ = this->cap_ == 1 ? 2 : this->cap_ + (this->cap_ >> 1);
     JNode* tmp = this->data_;
     this->data_ = new JNode[this->cap_];
+    adopt_all();
     for (size_t i = 0; i < this->len_; i++) this->data_[i] = std::move(tmp[i]);
     delete[] tmp;
   }
@@ -220,21 +443,24 @@ void JArray::push_back(const JNode& jn) {
 
 void JArray::pop_back() {
   if (this->len_ == 0) return;
+  touch();
   this->len_ -= 1;
 }
 
-void JArray::clear() { this->len_ = 0; }
+void JArray::clear() {
+  touch();
+  this->len_ = 0;
+}
 
 void JArray::reserve(size_t new_cap) {
   if (new_cap <= this->cap_) return;
+  size_t old_cap = this->cap_;
   this->cap_ = tableSizeFor(new_cap);
-  if (this->len_ > 0) {
-    JNode* tmp = this->data_;
-    this->data_ = new JNode[this->cap_];
-    for (size_t i = 0; i < this->len_; i++) this->data_[i] = std::move(tmp[i]);
-    delete[] tmp;
-  } else
-    this->data_ = new JNode[this->cap_];
+  JNode* tmp = this->data_;
+  this->data_ = new JNode[this->cap_];
+  adopt_all();
+  for (size_t i = 0; i < this->len_; i++) this->data_[i] = std::move(tmp[i]);
+  if (old_cap > 0) delete[] tmp;
 }
 
 void JArray::shrink_to_fit() {
@@ -242,6 +468,7 @@ void JArray::shrink_to_fit() {
   JNode* tmp = this->data_;
   this->cap_ = this->len_;
   this->data_ = new JNode[this->len_];
+  adopt_all();
   for (size_t i = 0; i < len_; i++) this->data_[i] = std::move(tmp[i]);
   delete[] tmp;
 }
@@ -264,8 +491,10 @@ JOjectElement::JOjectElement(const JOjectElement& om) {
   this->value = new JNode(*om.value);
 }
 
+// An element that sits in an object hands that object on to its new value.
 JOjectElement& JOjectElement::operator=(const JOjectElement& om) {
   if (this != &om) {
+    JData* owner = this->value != nullptr ? this->value->owner_ : nullptr;
     if (this->key != nullptr) {
       delete this->key;
     }
@@ -274,22 +503,38 @@ JOjectElement& JOjectElement::operator=(const JOjectElement& om) {
     }
     this->key = new JString(*om.key);
     this->value = new JNode(*om.value);
+    if (owner != nullptr) {
+      owner->adopt(*this->value);
+      owner->touch();
+    }
   }
   return *this;
 }
 
+// The value leaves its object; JObject re-adopts whatever it moves around internally.
 JOjectElement::JOjectElement(JOjectElement&& om) noexcept : key(om.key), value(om.value) {
   om.value = nullptr;
   om.key = nullptr;
+  if (this->value != nullptr && this->value->owner_ != nullptr) {
+    this->value->owner_->touch();
+    this->value->owner_ = nullptr;
+    if (this->value->_data != nullptr) this->value->_data->parent_ = nullptr;
+  }
 }
 
 JOjectElement& JOjectElement::operator=(JOjectElement&& om) noexcept {
+  if (this == &om) return *this;
+  JData* owner = this->value != nullptr ? this->value->owner_ : nullptr;
   if (this->key != nullptr) delete this->key;
   if (this->value != nullptr) delete this->value;
   this->key = om.key;
   this->value = om.value;
   om.value = nullptr;
   om.key = nullptr;
+  if (owner != nullptr && this->value != nullptr) {
+    owner->adopt(*this->value);
+    owner->touch();
+  }
   return *this;
 }
 JOjectElement::~JOjectElement() {
@@ -320,25 +565,136 @@ size_t JObject::find_index(const JString& ky) const {
 }
 
 const JNode* JObject::find_value(const JString& ky) const {
-  size_t size = this->size();
-  size_t i = JST_KEY_NOT_EXIST;
-  for (size_t t = 0; t < size; t++) {
-    if (ky == obj_[i].get_key()) {
-      i = t;
-      break;
-    }
-  }
+  size_t i = find_index(ky);
   return i != JST_KEY_NOT_EXIST ? &obj_[i].get_value() : nullptr;
 }
 
+// Values live behind pointers, so only a new or moved JObject has to re-adopt them.
+void JObject::adopt_all() {
+  for (auto& objm : obj_)
+    if (objm.value != nullptr) adopt(*objm.value);
+}
+
+JObject::JObject(const JObject& obj) : JData(obj), obj_(obj.obj_) { adopt_all(); }
+
+JObject::JObject(JObject&& obj) noexcept : JData(obj), obj_(std::move(obj.obj_)) { adopt_all(); }
+
+JObject& JObject::operator=(const JObject& obj) {
+  if (this == &obj) return *this;
+  JData::operator=(obj);
+  obj_ = obj.obj_;
+  adopt_all();
+  return *this;
+}
+
+JObject& JObject::operator=(JObject&& obj) noexcept {
+  if (this == &obj) return *this;
+  JData::operator=(obj);
+  obj_ = std::move(obj.obj_);
+  adopt_all();
+  return *this;
+}
+
+size_t JObject::insert(size_t pos, JOjectElement& objm) {
+  JST_DEBUG(pos <= size());
+  touch();
+  obj_.insert(obj_.begin() + pos, objm);
+  adopt_all();
+  return pos;
+}
+
+size_t JObject::insert(size_t pos, JOjectElement&& objm) {
+  JST_DEBUG(pos <= size());
+  touch();
+  obj_.insert(obj_.begin() + pos, std::move(objm));
+  adopt_all();
+  return pos;
+}
+
+size_t JObject::erase(size_t pos, size_t count) {
+  JST_DEBUG(pos < size());
+  touch();
+  count = std::min(count, obj_.size() - pos);
+  obj_.erase(obj_.begin() + pos, obj_.begin() + pos + count);
+  return pos;
+}
+
+void JObject::push_back(const JOjectElement& objm) {
+  touch();
+  bool grow = obj_.size() == obj_.capacity();
+  obj_.push_back(objm);
+  if (grow)
+    adopt_all();
+  else
+    adopt(*obj_.back().value);
+}
+
+void JObject::push_back(JOjectElement&& objm) {
+  touch();
+  bool grow = obj_.size() == obj_.capacity();
+  obj_.push_back(std::move(objm));
+  if (grow)
+    adopt_all();
+  else if (obj_.back().value != nullptr)
+    adopt(*obj_.back().value);
+}
+
+void JObject::pop_back() {
+  touch();
+  if (!obj_.empty()) obj_.pop_back();
+}
+
+void JObject::clear() {
+  touch();
+  obj_.clear();
+}
+
+void JObject::reserve(size_t new_cap) {
+  obj_.reserve(new_cap);
+  adopt_all();
+}
+
+void JObject::shrink_to_fit() {
+  obj_.shrink_to_fit();
+  adopt_all();
+}
+
+// Members are compared as multisets of key/value pairs, as JNode::hash() sums them, so a repeated
+// key counts once per occurrence. While both objects list the same members in the same order no
+// search is needed; past the first difference both sides are sorted by key, which must then line
+// up, and values are only searched for among the members sharing a key.
 bool operator==(const JObject& left, const JObject& right) {
   if (left.size() != right.size()) return false;
-  size_t size = left.size();
-  for (int i = 0; i < size; i++) {
-    size_t index;
-    if ((index = left.find_index(right[i].get_key())) == JST_KEY_NOT_EXIST ||
-        left[index] != right[i])
-      return false;
+  if (left.hashed_ && right.hashed_ && left.hash_ != right.hash_) return false;
+  size_t size = left.size(), i = 0;
+  while (i < size && left[i].get_key() == right[i].get_key() &&
+         left[i].get_value() == right[i].get_value()) {
+    i++;
+  }
+  if (i == size) return true;
+
+  size_t n = size - i;
+  std::vector<size_t> l(n), r(n);
+  for (size_t k = 0; k < n; k++) l[k] = r[k] = i + k;
+  std::sort(l.begin(), l.end(), [&left](size_t a, size_t b) {
+    return left[a].get_key() < left[b].get_key();
+  });
+  std::sort(r.begin(), r.end(), [&right](size_t a, size_t b) {
+    return right[a].get_key() < right[b].get_key();
+  });
+  for (size_t k = 0; k < n; k++) {
+    if (!(left[l[k]].get_key() == right[r[k]].get_key())) return false;
+  }
+  for (size_t g = 0; g < n;) {
+    size_t end = g + 1;
+    while (end < n && left[l[end]].get_key() == left[l[g]].get_key()) end++;
+    for (size_t k = g; k < end; k++) {
+      size_t j = k;
+      while (j < end && !(left[l[k]].get_value() == right[r[j]].get_value())) j++;
+      if (j == end) return false;
+      std::swap(r[k], r[j]);
+    }
+    g = end;
   }
   return true;
 }
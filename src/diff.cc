@@ -0,0 +1,373 @@
+#include "diff.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "basic.h"
+#include "hash.h"
+
+namespace jst {
+
+// Equal numbers hash alike whether they were written as integers or not (1 and 1.0).
+static uint64_t jst_diff_number(const JNumber& num) {
+  uint64_t bits;
+  bool negative;
+  if (num.is_int()) {
+    negative = num.type() == JST_NUM_INT && num.int_value() < 0;
+    bits = num.uint_value();
+  } else {
+    double d = num.value();
+    if (d == floor(d) && fabs(d) < 9.2e18) {
+      negative = d < 0;
+      bits = (uint64_t)(int64_t)d;
+    } else {
+      negative = false;
+      memcpy(&bits, &d, sizeof(bits));
+      bits = ~bits;
+    }
+  }
+  return jst_hash_mix(bits ^ (negative ? 0x6a09e667f3bcc908ULL : 0x3c6ef372fe94f82bULL));
+}
+
+// What array elements are lined up by: JNode::hash(), except that numbers are told apart
+// exactly, where JNode::hash() gives every number in [-1, 1] the same value.
+static uint64_t jst_diff_hash(const JNode& v) {
+  return v.type() == JST_NUM ? jst_diff_number(v.data().as<JNumber>()) : v.hash();
+}
+
+// Append one reference token to a JSON Pointer.
+static void jst_diff_token(std::string& path, const char* s, size_t len) {
+  path += '/';
+  for (size_t i = 0; i < len; i++) {
+    if (s[i] == '~') {
+      path += "~0";
+    } else if (s[i] == '/') {
+      path += "~1";
+    } else {
+      path += s[i];
+    }
+  }
+}
+
+static void jst_diff_index(std::string& path, size_t index) {
+  path += '/';
+  path += std::to_string(index);
+}
+
+static void jst_diff_member(JObject& obj, const char* key, JNode&& value) {
+  obj.push_back(JOjectElement(JString(key), std::move(value)));
+}
+
+static std::string jst_diff_key(const JString& key) { return std::string(key.c_str(), key.size()); }
+
+// The state of one diff. Subtree hashes are not kept here but in the trees themselves (see
+// JNode::hash()), so they outlive the diff and a later diff against the same tree reuses them.
+class JDiffer {
+ public:
+  explicit JDiffer(const JDiffOptions& opts) : opts(opts) {}
+
+  bool equal(const JNode& a, const JNode& b);
+  void diff(const JNode& a, const JNode& b, std::string& path, JArray& ops);
+
+ private:
+  void diff_object(const JObject& a, const JObject& b, std::string& path, JArray& ops);
+  void diff_array(const JArray& a, const JArray& b, std::string& path, JArray& ops);
+
+  typedef std::vector<std::pair<size_t, size_t>> Matches;
+  void align(const std::vector<uint64_t>& ia, const std::vector<uint64_t>& ib, size_t a0,
+             size_t a1, size_t b0, size_t b1, Matches& match);
+  void lcs(const std::vector<uint64_t>& ia, const std::vector<uint64_t>& ib, size_t a0,
+           size_t rows, size_t b0, size_t cols, Matches& match);
+  void patience(const std::vector<uint64_t>& ia, const std::vector<uint64_t>& ib, size_t a0,
+                size_t a1, size_t b0, size_t b1, Matches& match);
+  uint64_t identity(const JNode& v);
+  void emit(JArray& ops, const char* op, const std::string& path, const JNode* value);
+
+  const JDiffOptions& opts;
+};
+
+// Containers whose hashes differ are different; equal hashes are confirmed by operator==, which
+// finds the hashes of the whole subtree cached and so stops at the first child that differs.
+bool JDiffer::equal(const JNode& a, const JNode& b) {
+  if (a.type() != b.type()) return false;
+  if ((a.type() == JST_ARR || a.type() == JST_OBJ) && a.hash() != b.hash()) return false;
+  return a == b;
+}
+
+// What lines elements up in an array: the value of the identity member, or the whole element.
+uint64_t JDiffer::identity(const JNode& v) {
+  if (!opts.array_key.empty() && v.type() == JST_OBJ) {
+    const JNode* id = v.data().as<JObject>().find_value(JString(opts.array_key.c_str()));
+    if (id != nullptr) return jst_hash_mix(jst_diff_hash(*id) ^ 0x9216d5d98979fb1bULL);
+  }
+  return jst_diff_hash(v);
+}
+
+void JDiffer::emit(JArray& ops, const char* op, const std::string& path, const JNode* value) {
+  JObject entry(value != nullptr ? 3 : 2);
+  jst_diff_member(entry, "op", JNode(JString(op)));
+  jst_diff_member(entry, "path", JNode(JString(path.c_str(), path.size())));
+  if (value != nullptr) jst_diff_member(entry, "value", JNode(*value));
+  ops.insert(ops.size(), JNode(std::move(entry)));
+}
+
+void JDiffer::diff(const JNode& a, const JNode& b, std::string& path, JArray& ops) {
+  if (equal(a, b)) return;
+  if (a.type() == JST_OBJ && b.type() == JST_OBJ) {
+    diff_object(a.data().as<JObject>(), b.data().as<JObject>(), path, ops);
+  } else if (a.type() == JST_ARR && b.type() == JST_ARR) {
+    diff_array(a.data().as<JArray>(), b.data().as<JArray>(), path, ops);
+  } else {
+    emit(ops, "replace", path, &b);
+  }
+}
+
+void JDiffer::diff_object(const JObject& a, const JObject& b, std::string& path, JArray& ops) {
+  size_t base = path.size();
+  bool same_keys = a.size() == b.size();
+  for (size_t i = 0; same_keys && i < a.size(); i++) same_keys = a.get_key(i) == b.get_key(i);
+  if (same_keys) {
+    for (size_t i = 0; i < a.size(); i++) {
+      jst_diff_token(path, a.get_key(i).c_str(), a.get_key(i).size());
+      diff(a.get_value(i), b.get_value(i), path, ops);
+      path.resize(base);
+    }
+    return;
+  }
+
+  std::unordered_map<std::string, size_t> in_a, in_b;
+  for (size_t i = 0; i < a.size(); i++) in_a.emplace(jst_diff_key(a.get_key(i)), i);
+  for (size_t i = 0; i < b.size(); i++) in_b.emplace(jst_diff_key(b.get_key(i)), i);
+  for (size_t i = 0; i < a.size(); i++) {
+    const JString& key = a.get_key(i);
+    std::string k = jst_diff_key(key);
+    if (in_b.count(k) != 0 || in_a[k] != i) continue;
+    jst_diff_token(path, key.c_str(), key.size());
+    emit(ops, "remove", path, nullptr);
+    path.resize(base);
+  }
+  for (size_t i = 0; i < b.size(); i++) {
+    const JString& key = b.get_key(i);
+    std::string k = jst_diff_key(key);
+    if (in_b[k] != i) continue;
+    jst_diff_token(path, key.c_str(), key.size());
+    auto it = in_a.find(k);
+    if (it != in_a.end()) {
+      diff(a.get_value(it->second), b.get_value(i), path, ops);
+    } else {
+      emit(ops, "add", path, &b.get_value(i));
+    }
+    path.resize(base);
+  }
+}
+
+// Matched pairs of ia[a0, a1) and ib[b0, b1), in order: the common prefix and suffix, and in
+// between a longest common subsequence while its table stays within max_lcs_cells. Larger
+// middles are cut at the elements that occur exactly once on either side, keeping the longest
+// run of them that is in order on both (patience diff), and every piece is aligned again.
+void JDiffer::align(const std::vector<uint64_t>& ia, const std::vector<uint64_t>& ib, size_t a0,
+                    size_t a1, size_t b0, size_t b1, Matches& match) {
+  while (a0 < a1 && b0 < b1 && ia[a0] == ib[b0]) match.emplace_back(a0++, b0++);
+  size_t suffix = 0;
+  while (a0 < a1 - suffix && b0 < b1 - suffix && ia[a1 - 1 - suffix] == ib[b1 - 1 - suffix]) {
+    suffix++;
+  }
+  size_t rows = a1 - suffix - a0, cols = b1 - suffix - b0;
+  if (rows != 0 && cols != 0) {
+    if ((rows + 1) * (cols + 1) <= opts.max_lcs_cells) {
+      lcs(ia, ib, a0, rows, b0, cols, match);
+    } else {
+      patience(ia, ib, a0, a1 - suffix, b0, b1 - suffix, match);
+    }
+  }
+  for (size_t k = suffix; k > 0; k--) match.emplace_back(a1 - k, b1 - k);
+}
+
+void JDiffer::lcs(const std::vector<uint64_t>& ia, const std::vector<uint64_t>& ib, size_t a0,
+                  size_t rows, size_t b0, size_t cols, Matches& match) {
+  std::vector<uint32_t> len((rows + 1) * (cols + 1), 0);
+  for (size_t i = rows; i-- > 0;) {
+    for (size_t j = cols; j-- > 0;) {
+      uint32_t* cell = &len[i * (cols + 1) + j];
+      if (ia[a0 + i] == ib[b0 + j]) {
+        *cell = cell[cols + 2] + 1;
+      } else {
+        *cell = std::max(cell[cols + 1], cell[1]);
+      }
+    }
+  }
+  for (size_t i = 0, j = 0; i < rows && j < cols;) {
+    if (ia[a0 + i] == ib[b0 + j]) {
+      match.emplace_back(a0 + i++, b0 + j++);
+    } else if (len[(i + 1) * (cols + 1) + j] >= len[i * (cols + 1) + j + 1]) {
+      i++;
+    } else {
+      j++;
+    }
+  }
+}
+
+void JDiffer::patience(const std::vector<uint64_t>& ia, const std::vector<uint64_t>& ib,
+                       size_t a0, size_t a1, size_t b0, size_t b1, Matches& match) {
+  struct Seen {
+    size_t in_a = 0, at_a = 0, in_b = 0, at_b = 0;
+  };
+  std::unordered_map<uint64_t, Seen> seen;
+  for (size_t i = a0; i < a1; i++) {
+    Seen& e = seen[ia[i]];
+    e.in_a++;
+    e.at_a = i;
+  }
+  for (size_t j = b0; j < b1; j++) {
+    auto it = seen.find(ib[j]);
+    if (it == seen.end()) continue;
+    it->second.in_b++;
+    it->second.at_b = j;
+  }
+  Matches unique;
+  for (size_t i = a0; i < a1; i++) {
+    const Seen& e = seen[ia[i]];
+    if (e.in_a == 1 && e.in_b == 1) unique.emplace_back(i, e.at_b);
+  }
+  if (unique.empty()) return;
+
+  // longest run increasing in b: tails[k] ends the best run of length k + 1 found so far
+  std::vector<size_t> tails, prev(unique.size());
+  for (size_t k = 0; k < unique.size(); k++) {
+    size_t lo = 0, hi = tails.size();
+    while (lo < hi) {
+      size_t mid = (lo + hi) / 2;
+      if (unique[tails[mid]].second < unique[k].second) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    prev[k] = lo > 0 ? tails[lo - 1] : k;
+    if (lo == tails.size()) {
+      tails.push_back(k);
+    } else {
+      tails[lo] = k;
+    }
+  }
+  Matches anchors(tails.size());
+  for (size_t k = tails.back(), n = tails.size(); n-- > 0; k = prev[k]) anchors[n] = unique[k];
+
+  for (const auto& anchor : anchors) {
+    align(ia, ib, a0, anchor.first, b0, anchor.second, match);
+    match.push_back(anchor);
+    a0 = anchor.first + 1;
+    b0 = anchor.second + 1;
+  }
+  align(ia, ib, a0, a1, b0, b1, match);
+}
+
+// The patch is written against the array as it is being edited: pos is where the next old
+// element currently sits.
+void JDiffer::diff_array(const JArray& a, const JArray& b, std::string& path, JArray& ops) {
+  size_t base = path.size();
+  size_t n = a.size(), m = b.size();
+  std::vector<uint64_t> ia(n), ib(m);
+  for (size_t i = 0; i < n; i++) ia[i] = identity(a[i]);
+  for (size_t j = 0; j < m; j++) ib[j] = identity(b[j]);
+  Matches match;
+  align(ia, ib, 0, n, 0, m, match);
+  match.emplace_back(n, m);
+
+  size_t pos = 0, i = 0, j = 0;
+  for (const auto& next : match) {
+    // the gap before the next match: replaced elements first, then what was dropped or added
+    size_t paired = std::min(next.first - i, next.second - j);
+    for (size_t k = 0; k < paired; k++, pos++) {
+      jst_diff_index(path, pos);
+      diff(a[i++], b[j++], path, ops);
+      path.resize(base);
+    }
+    for (; i < next.first; i++) {
+      jst_diff_index(path, pos);
+      emit(ops, "remove", path, nullptr);
+      path.resize(base);
+    }
+    for (; j < next.second; j++, pos++) {
+      jst_diff_index(path, pos);
+      emit(ops, "add", path, &b[j]);
+      path.resize(base);
+    }
+    if (i == n) break;
+    jst_diff_index(path, pos++);
+    diff(a[i++], b[j++], path, ops);
+    path.resize(base);
+  }
+}
+
+JNode jst_diff(const JNode& from, const JNode& to, const JDiffOptions& opts) {
+  JDiffer differ(opts);
+  JArray ops;
+  std::string path;
+  differ.diff(from, to, path, ops);
+  return JNode(std::move(ops));
+}
+
+static JNode jst_merge_diff(JDiffer& differ, const JNode& from, const JNode& to) {
+  if (from.type() != JST_OBJ || to.type() != JST_OBJ) return to;
+  const JObject& a = from.data().as<JObject>();
+  const JObject& b = to.data().as<JObject>();
+  std::unordered_map<std::string, size_t> in_a, in_b;
+  for (size_t i = 0; i < a.size(); i++) in_a.emplace(jst_diff_key(a.get_key(i)), i);
+  for (size_t i = 0; i < b.size(); i++) in_b.emplace(jst_diff_key(b.get_key(i)), i);
+
+  JObject patch;
+  for (size_t i = 0; i < a.size(); i++) {
+    std::string k = jst_diff_key(a.get_key(i));
+    if (in_b.count(k) == 0 && in_a[k] == i) {
+      patch.push_back(JOjectElement(JString(a.get_key(i)), JNode(JST_NULL)));
+    }
+  }
+  for (size_t i = 0; i < b.size(); i++) {
+    std::string k = jst_diff_key(b.get_key(i));
+    if (in_b[k] != i) continue;
+    auto it = in_a.find(k);
+    if (it == in_a.end()) {
+      patch.push_back(JOjectElement(b.get_key(i), b.get_value(i)));
+    } else if (!differ.equal(a.get_value(it->second), b.get_value(i))) {
+      patch.push_back(JOjectElement(
+          JString(b.get_key(i)), jst_merge_diff(differ, a.get_value(it->second), b.get_value(i))));
+    }
+  }
+  return JNode(std::move(patch));
+}
+
+JNode jst_merge_diff(const JNode& from, const JNode& to) {
+  JDiffOptions opts;
+  JDiffer differ(opts);
+  return jst_merge_diff(differ, from, to);
+}
+
+void jst_merge_apply(JNode& target, const JNode& patch) {
+  if (patch.type() != JST_OBJ) {
+    target = patch;
+    return;
+  }
+  if (target.type() != JST_OBJ) target = JNode(JObject());
+  JObject& obj = target.mutable_data().as<JObject>();
+  const JObject& members = patch.data().as<JObject>();
+  for (size_t i = 0; i < members.size(); i++) {
+    const JString& key = members.get_key(i);
+    const JNode& value = members.get_value(i);
+    size_t at = obj.find_index(key);
+    if (value.type() == JST_NULL) {
+      if (at != (size_t)-1) obj.erase(at);
+    } else if (at != (size_t)-1) {
+      jst_merge_apply(obj.get_value(at), value);
+    } else {
+      JNode added;
+      jst_merge_apply(added, value);
+      obj.push_back(JOjectElement(JString(key), std::move(added)));
+    }
+  }
+}
+
+}  // namespace jst
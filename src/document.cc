@@ -0,0 +1,33 @@
+#include "document.h"
+
+namespace jst {
+
+JDocument JDocument::parse_file(const std::string& path, const JParserOptions& opts) {
+  JDocument doc;
+  JParser parser("", opts);
+  if (!opts.lazy_strings) {
+    doc.status_ = parser.parse_file(path, &doc.root_);
+    if (!doc.ok()) doc.error_ = parser.error_info();
+    return doc;
+  }
+  // lazy strings point into the mapping, so the document keeps it.
+  doc.file_ = std::make_unique<JMappedFile>();
+  doc.status_ = doc.file_->open(path);
+  if (!doc.ok()) return doc;
+  parser.reset(doc.file_->data(), doc.file_->size());
+  doc.status_ = parser.parse_lazy(&doc.root_);
+  if (!doc.ok()) doc.error_ = parser.error_info();
+  return doc;
+}
+
+JDocument JDocument::parse_insitu(std::string&& json, const JParserOptions& opts) {
+  JDocument doc;
+  // The string object lives on the heap so moving the document never moves the characters.
+  doc.buffer_ = std::make_unique<std::string>(std::move(json));
+  JParser parser("", opts);
+  doc.status_ = parser.parse_insitu(&(*doc.buffer_)[0], doc.buffer_->size(), &doc.root_);
+  if (!doc.ok()) doc.error_ = parser.error_info();
+  return doc;
+}
+
+}  // namespace jst
@@ -16,7 +16,24 @@ const char* jst_ret_type_name[] = {"JST_PARSE_OK",
                                    "JST_PARSE_MISS_KEY",
                                    "JST_PARSE_MISS_COLON",
                                    "JST_PARSE_MISS_COMMA_OR_CURLY_BRACKET",
-                                   "JST_STRINGIFY_OK"};
+                                   "JST_PARSE_EXCEED_MAX_BYTES",
+                                   "JST_PARSE_EXCEED_MAX_NODES",
+                                   "JST_PARSE_EXCEED_MAX_STRING_LENGTH",
+                                   "JST_PARSE_EXCEED_MAX_DEPTH",
+                                   "JST_PARSE_TIMEOUT",
+                                   "JST_PARSE_FILE_ERROR",
+                                   "JST_PARSE_INVALID_UTF8",
+                                   "JST_PARSE_TRUNCATED",
+                                   "JST_PARSE_UNSUPPORTED_TYPE",
+                                   "JST_PARSE_INVALID_SNAPSHOT",
+                                   "JST_PARSE_TYPE_MISMATCH",
+                                   "JST_PARSE_INVALID_SCHEMA",
+                                   "JST_PARSE_SCHEMA_VIOLATION",
+                                   "JST_PARSE_INVALID_PATCH",
+                                   "JST_PARSE_PATH_NOT_FOUND",
+                                   "JST_PARSE_PATCH_TEST_FAILED",
+                                   "JST_STRINGIFY_OK",
+                                   "JST_STRINGIFY_BUFFER_TOO_SMALL"};
 
 const char* jst_node_type_name[] = {"JST_NULL", "JST_TRUE", "JST_FALSE", "JST_NUM",
                                     "JST_STR",  "JST_ARR",  "JST_OBJ"};
@@ -0,0 +1,128 @@
+#include "file.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define JST_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace jst {
+
+JMappedFile::JMappedFile(JMappedFile&& file) noexcept
+    : data_(file.data_), size_(file.size_), map_size_(file.map_size_) {
+  file.data_ = nullptr;
+  file.size_ = 0;
+  file.map_size_ = 0;
+}
+
+JMappedFile& JMappedFile::operator=(JMappedFile&& file) noexcept {
+  if (this != &file) {
+    close();
+    this->data_ = file.data_;
+    this->size_ = file.size_;
+    this->map_size_ = file.map_size_;
+    file.data_ = nullptr;
+    file.size_ = 0;
+    file.map_size_ = 0;
+  }
+  return *this;
+}
+
+JMappedFile::~JMappedFile() { close(); }
+
+void JMappedFile::close() {
+  if (this->data_ != nullptr) {
+#ifdef JST_HAVE_MMAP
+    if (this->map_size_ != 0)
+      munmap(this->data_, this->map_size_);
+    else
+      free(this->data_);
+#else
+    free(this->data_);
+#endif
+  }
+  this->data_ = nullptr;
+  this->size_ = 0;
+  this->map_size_ = 0;
+}
+
+#ifdef JST_HAVE_MMAP
+
+JRetType JMappedFile::open(const std::string& path) {
+  close();
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return JST_PARSE_FILE_ERROR;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    ::close(fd);
+    return JST_PARSE_FILE_ERROR;
+  }
+  size_t len = static_cast<size_t>(st.st_size);
+  if (len == 0) {
+    ::close(fd);
+    return JST_PARSE_OK;
+  }
+
+  // The kernel zero-fills the tail of the last page, which gives us the terminating '\0' for
+  // free. When the file ends exactly on a page boundary there is no tail, so reserve one extra
+  // anonymous (zeroed) page and map the file over the front of the reservation.
+  size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t map_len = (len / page + 1) * page;
+  void* base = MAP_FAILED;
+  if (len % page == 0) {
+    base = mmap(nullptr, map_len, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base != MAP_FAILED &&
+        mmap(base, len, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+      munmap(base, map_len);
+      base = MAP_FAILED;
+    }
+  } else {
+    base = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  ::close(fd);
+  if (base == MAP_FAILED) return JST_PARSE_FILE_ERROR;
+
+  madvise(base, len, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+  madvise(base, len, MADV_HUGEPAGE);
+#endif
+  this->data_ = static_cast<char*>(base);
+  this->size_ = len;
+  this->map_size_ = len % page == 0 ? map_len : len;
+  return JST_PARSE_OK;
+}
+
+#else
+
+JRetType JMappedFile::open(const std::string& path) {
+  close();
+  FILE* fp = fopen(path.c_str(), "rb");
+  if (fp == nullptr) return JST_PARSE_FILE_ERROR;
+  fseek(fp, 0, SEEK_END);
+  long len = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  if (len < 0) {
+    fclose(fp);
+    return JST_PARSE_FILE_ERROR;
+  }
+  this->data_ = (char*)malloc(len + 1);
+  if (fread(this->data_, 1, len, fp) != static_cast<size_t>(len)) {
+    fclose(fp);
+    close();
+    return JST_PARSE_FILE_ERROR;
+  }
+  fclose(fp);
+  this->data_[len] = '\0';
+  this->size_ = static_cast<size_t>(len);
+  return JST_PARSE_OK;
+}
+
+#endif
+
+}  // namespace jst
@@ -0,0 +1,311 @@
+#include "format.h"
+
+#include <assert.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "parallel.h"
+#include "utf8.h"
+
+namespace jst {
+
+// Escaped form of every byte that cannot appear raw inside a JSON string, "" for the rest.
+static const char* jst_escape_text(unsigned char ch) {
+  switch (ch) {
+    case '\"':
+      return "\\\"";
+    case '\\':
+      return "\\\\";
+    case '\n':
+      return "\\n";
+    case '\b':
+      return "\\b";
+    case '\f':
+      return "\\f";
+    case '\r':
+      return "\\r";
+    case '\t':
+      return "\\t";
+    default:
+      return "";
+  }
+}
+
+// bytes written for a byte that jst_scan_plain() stopped at: a short escape or \u00XX.
+static inline size_t jst_escape_size(unsigned char ch) {
+  return *jst_escape_text(ch) != '\0' ? 2 : 6;
+}
+
+static size_t jst_uint_size(uint64_t n) {
+  size_t len = 1;
+  while (n >= 10) {
+    n /= 10;
+    len++;
+  }
+  return len;
+}
+
+static char* jst_uint_write(uint64_t n, char* out) {
+  size_t len = jst_uint_size(n);
+  char* p = out + len;
+  do {
+    *--p = (char)('0' + n % 10);
+    n /= 10;
+  } while (n != 0);
+  return out + len;
+}
+
+size_t jst_number_size(const JNumber& num) {
+  char buffer[32];
+  switch (num.type()) {
+    case JST_NUM_INT:
+      return num.int_value() < 0 ? 1 + jst_uint_size(0 - num.uint_value())
+                                 : jst_uint_size(num.uint_value());
+    case JST_NUM_UINT:
+      return jst_uint_size(num.uint_value());
+    case JST_NUM_TEXT:
+      return num.source().size();
+    default:
+      if (!std::isfinite(num.value())) return 4;
+      return snprintf(buffer, sizeof(buffer), "%.17g", num.value());
+  }
+}
+
+char* jst_number_write(const JNumber& num, char* out) {
+  char buffer[32];
+  switch (num.type()) {
+    case JST_NUM_INT:
+      if (num.int_value() >= 0) return jst_uint_write(num.uint_value(), out);
+      *out++ = '-';
+      return jst_uint_write(0 - num.uint_value(), out);
+    case JST_NUM_UINT:
+      return jst_uint_write(num.uint_value(), out);
+    case JST_NUM_TEXT:
+      memcpy(out, num.source().data(), num.source().size());
+      return out + num.source().size();
+    default: {
+      // JSON has no NaN or infinity; they are written as null, as JSON.stringify does.
+      if (!std::isfinite(num.value())) {
+        memcpy(out, "null", 4);
+        return out + 4;
+      }
+      int len = snprintf(buffer, sizeof(buffer), "%.17g", num.value());
+      memcpy(out, buffer, len);
+      return out + len;
+    }
+  }
+}
+
+size_t jst_string_size(const JString& str) {
+  size_t raw_len;
+  if (str.raw_source(raw_len) != nullptr) return raw_len + 2;
+  return jst_escaped_size(str.c_str(), str.size());
+}
+
+size_t jst_escaped_size(const char* s, size_t len) {
+  size_t total = 2;
+  for (size_t i = 0; i < len; i++) {
+    size_t run = jst_scan_plain(s + i, len - i, false);
+    total += run;
+    i += run;
+    if (i == len) break;
+    total += jst_escape_size((unsigned char)s[i]);
+  }
+  return total;
+}
+
+char* jst_string_write(const JString& str, char* out) {
+  size_t len = 0;
+  const char* raw = str.raw_source(len);
+  if (raw == nullptr) return jst_escaped_write(str.c_str(), str.size(), out);
+  *out++ = '"';
+  memcpy(out, raw, len);
+  out += len;
+  *out++ = '"';
+  return out;
+}
+
+char* jst_escaped_write(const char* s, size_t len, char* out) {
+  *out++ = '"';
+  for (size_t i = 0; i < len; i++) {
+    size_t run = jst_scan_plain(s + i, len - i, false);
+    memcpy(out, s + i, run);
+    out += run;
+    i += run;
+    if (i == len) break;
+    unsigned char ch = (unsigned char)s[i];
+    const char* esc = jst_escape_text(ch);
+    if (*esc != '\0') {
+      *out++ = esc[0];
+      *out++ = esc[1];
+    } else {
+      char buffer[7];
+      snprintf(buffer, sizeof(buffer), "\\u%04x", ch);
+      memcpy(out, buffer, 6);
+      out += 6;
+    }
+  }
+  *out++ = '"';
+  return out;
+}
+
+size_t jst_stringify_size(const JNode& jn) {
+  switch (jn.type()) {
+    case JST_NULL:
+    case JST_TRUE:
+      return 4;
+    case JST_FALSE:
+      return 5;
+    case JST_NUM:
+      return jst_number_size(jn.data().as<JNumber>());
+    case JST_STR:
+      return jst_string_size(jn.data().as<JString>());
+    case JST_ARR: {
+      const JArray& arr = jn.data().as<JArray>();
+      if (arr.fragment() != nullptr) return arr.fragment()->size();
+      size_t total = 2 + (arr.empty() ? 0 : arr.size() - 1);
+      for (size_t i = 0; i < arr.size(); i++) total += jst_stringify_size(arr[i]);
+      return total;
+    }
+    case JST_OBJ: {
+      const JObject& obj = jn.data().as<JObject>();
+      if (obj.fragment() != nullptr) return obj.fragment()->size();
+      // one ':' per member and a ',' between members.
+      size_t total = 2 + (obj.size() == 0 ? 0 : 2 * obj.size() - 1);
+      for (size_t i = 0; i < obj.size(); i++) {
+        total += jst_string_size(obj[i].get_key());
+        total += jst_stringify_size(obj[i].get_value());
+      }
+      return total;
+    }
+  }
+  return 0;
+}
+
+static char* jst_fragment_write(const JData& data, char* out) {
+  const std::string* fragment = data.fragment();
+  memcpy(out, fragment->data(), fragment->size());
+  return out + fragment->size();
+}
+
+static char* jst_fragment_keep(const JData& data, char* start, char* end, size_t cache_min) {
+  if (cache_min != 0 && (size_t)(end - start) >= cache_min) data.set_fragment(start, end - start);
+  return end;
+}
+
+char* jst_stringify_write(const JNode& jn, char* out, size_t cache_min) {
+  char* start = out;
+  switch (jn.type()) {
+    case JST_NULL:
+      memcpy(out, "null", 4);
+      return out + 4;
+    case JST_TRUE:
+      memcpy(out, "true", 4);
+      return out + 4;
+    case JST_FALSE:
+      memcpy(out, "false", 5);
+      return out + 5;
+    case JST_NUM:
+      return jst_number_write(jn.data().as<JNumber>(), out);
+    case JST_STR:
+      return jst_string_write(jn.data().as<JString>(), out);
+    case JST_ARR: {
+      const JArray& arr = jn.data().as<JArray>();
+      if (arr.fragment() != nullptr) return jst_fragment_write(arr, out);
+      *out++ = '[';
+      for (size_t i = 0; i < arr.size(); i++) {
+        if (i > 0) *out++ = ',';
+        out = jst_stringify_write(arr[i], out, cache_min);
+      }
+      *out++ = ']';
+      return jst_fragment_keep(arr, start, out, cache_min);
+    }
+    case JST_OBJ: {
+      const JObject& obj = jn.data().as<JObject>();
+      if (obj.fragment() != nullptr) return jst_fragment_write(obj, out);
+      *out++ = '{';
+      for (size_t i = 0; i < obj.size(); i++) {
+        if (i > 0) *out++ = ',';
+        out = jst_string_write(obj[i].get_key(), out);
+        *out++ = ':';
+        out = jst_stringify_write(obj[i].get_value(), out, cache_min);
+      }
+      *out++ = '}';
+      return jst_fragment_keep(obj, start, out, cache_min);
+    }
+  }
+  return out;
+}
+
+// Children of a container, seen the same way for arrays and objects.
+static size_t jst_child_count(const JNode& jn) {
+  return jn.type() == JST_ARR ? jn.data().as<JArray>().size() : jn.data().as<JObject>().size();
+}
+
+// Member i of an object is its key, the ':' and the value.
+static size_t jst_child_size(const JNode& jn, size_t i) {
+  if (jn.type() == JST_ARR) return jst_stringify_size(jn.data().as<JArray>()[i]);
+  const JOjectElement& objm = jn.data().as<JObject>()[i];
+  return jst_string_size(objm.get_key()) + 1 + jst_stringify_size(objm.get_value());
+}
+
+static char* jst_child_write(const JNode& jn, size_t i, char* out, size_t cache_min) {
+  if (jn.type() == JST_ARR) return jst_stringify_write(jn.data().as<JArray>()[i], out, cache_min);
+  const JOjectElement& objm = jn.data().as<JObject>()[i];
+  out = jst_string_write(objm.get_key(), out);
+  *out++ = ':';
+  return jst_stringify_write(objm.get_value(), out, cache_min);
+}
+
+bool jst_stringify_plan(const JNode& jn, unsigned threads, size_t chunk, JStringifyPlan& plan) {
+  plan = JStringifyPlan();
+  if ((jn.type() != JST_ARR && jn.type() != JST_OBJ) || jn.data().fragment() != nullptr) {
+    return false;
+  }
+  size_t n = jst_child_count(jn);
+  if (n < 2) return false;
+
+  threads = jst_thread_count(threads);
+  std::vector<size_t> sizes(n);
+  size_t tasks = std::min<size_t>(n, threads * 8);
+  jst_parallel_for(tasks, threads, [&](size_t t) {
+    for (size_t i = n * t / tasks; i < n * (t + 1) / tasks; i++) sizes[i] = jst_child_size(jn, i);
+  });
+
+  // a batch is its children and the comma in front of each of them but the very first.
+  size_t offset = 1, batch = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (batch == 0) {
+      plan.first.push_back(i);
+      plan.offset.push_back(offset);
+    }
+    batch += sizes[i] + (i > 0);
+    offset += sizes[i] + (i > 0);
+    if (batch >= chunk) batch = 0;
+  }
+  plan.first.push_back(n);
+  plan.offset.push_back(offset);
+  plan.size = offset + 1;
+  return true;
+}
+
+char* jst_stringify_write(const JNode& jn, char* out, const JStringifyPlan& plan,
+                          unsigned threads, size_t cache_min) {
+  JST_DEBUG(!plan.first.empty());
+  out[0] = jn.type() == JST_ARR ? '[' : '{';
+  jst_parallel_for(plan.first.size() - 1, threads, [&](size_t b) {
+    char* p = out + plan.offset[b];
+    for (size_t i = plan.first[b]; i < plan.first[b + 1]; i++) {
+      if (i > 0) *p++ = ',';
+      p = jst_child_write(jn, i, p, cache_min);
+    }
+    JST_DEBUG(p == out + plan.offset[b + 1]);
+  });
+  out[plan.size - 1] = jn.type() == JST_ARR ? ']' : '}';
+  return jst_fragment_keep(jn.data(), out, out + plan.size, cache_min);
+}
+
+}  // namespace jst
@@ -0,0 +1,158 @@
+#include "hash.h"
+
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define JST_HAVE_SSE2 1
+#define JST_HAVE_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#define JST_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace jst {
+
+static const uint64_t jst_hash_p1 = 0x9e3779b185ebca87ULL;
+static const uint64_t jst_hash_p2 = 0xc2b2ae3d27d4eb4fULL;
+// the key of each lane for the first stripe; every stripe adds jst_hash_step to all four.
+static const uint64_t jst_hash_key[4] = {0x1cad21f72c81017cULL, 0xdb979083e96dd4deULL,
+                                         0x1f67b3b7a4a44072ULL, 0x78e5c0cc4ee679cbULL};
+static const uint64_t jst_hash_step = 0x9e3779b97f4a7c15ULL;
+
+// Little-endian on every platform, so the hash does not depend on the byte order.
+static inline uint64_t jst_hash_read64(const char* p) {
+  uint64_t w;
+  memcpy(&w, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  w = __builtin_bswap64(w);
+#endif
+  return w;
+}
+
+static inline uint64_t jst_hash_rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+// Each 32-byte stripe adds to lane j its word w and lo32(k) * hi32(k) of k = w ^ key[j]; keys
+// move on with every stripe, so reordered stripes hash differently. Returns the bytes consumed,
+// whole stripes only. The vector kernels below compute exactly this.
+static size_t jst_hash_stripes_scalar(const char* s, size_t len, uint64_t acc[4]) {
+  uint64_t key[4] = {jst_hash_key[0], jst_hash_key[1], jst_hash_key[2], jst_hash_key[3]};
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    for (int j = 0; j < 4; j++) {
+      uint64_t w = jst_hash_read64(s + i + 8 * j);
+      uint64_t k = w ^ key[j];
+      acc[j] += w + (k & 0xffffffffULL) * (k >> 32);
+      key[j] += jst_hash_step;
+    }
+  }
+  return i;
+}
+
+#ifdef JST_HAVE_SSE2
+static size_t jst_hash_stripes_sse2(const char* s, size_t len, uint64_t acc[4]) {
+  __m128i acc_lo = _mm_loadu_si128((const __m128i*)acc);
+  __m128i acc_hi = _mm_loadu_si128((const __m128i*)(acc + 2));
+  __m128i key_lo = _mm_loadu_si128((const __m128i*)jst_hash_key);
+  __m128i key_hi = _mm_loadu_si128((const __m128i*)(jst_hash_key + 2));
+  const __m128i step = _mm_set1_epi64x((long long)jst_hash_step);
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m128i w_lo = _mm_loadu_si128((const __m128i*)(s + i));
+    __m128i w_hi = _mm_loadu_si128((const __m128i*)(s + i + 16));
+    __m128i k_lo = _mm_xor_si128(w_lo, key_lo);
+    __m128i k_hi = _mm_xor_si128(w_hi, key_hi);
+    // _mm_mul_epu32 multiplies the low halves of each 64-bit lane.
+    __m128i m_lo = _mm_mul_epu32(k_lo, _mm_srli_epi64(k_lo, 32));
+    __m128i m_hi = _mm_mul_epu32(k_hi, _mm_srli_epi64(k_hi, 32));
+    acc_lo = _mm_add_epi64(acc_lo, _mm_add_epi64(w_lo, m_lo));
+    acc_hi = _mm_add_epi64(acc_hi, _mm_add_epi64(w_hi, m_hi));
+    key_lo = _mm_add_epi64(key_lo, step);
+    key_hi = _mm_add_epi64(key_hi, step);
+  }
+  _mm_storeu_si128((__m128i*)acc, acc_lo);
+  _mm_storeu_si128((__m128i*)(acc + 2), acc_hi);
+  return i;
+}
+#endif
+
+#ifdef JST_HAVE_AVX2
+__attribute__((target("avx2"))) static size_t jst_hash_stripes_avx2(const char* s, size_t len,
+                                                                    uint64_t acc[4]) {
+  __m256i a = _mm256_loadu_si256((const __m256i*)acc);
+  __m256i key = _mm256_loadu_si256((const __m256i*)jst_hash_key);
+  const __m256i step = _mm256_set1_epi64x((long long)jst_hash_step);
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m256i w = _mm256_loadu_si256((const __m256i*)(s + i));
+    __m256i k = _mm256_xor_si256(w, key);
+    a = _mm256_add_epi64(a, _mm256_add_epi64(w, _mm256_mul_epu32(k, _mm256_srli_epi64(k, 32))));
+    key = _mm256_add_epi64(key, step);
+  }
+  _mm256_storeu_si256((__m256i*)acc, a);
+  return i;
+}
+#endif
+
+typedef size_t (*jst_hash_stripes_func)(const char*, size_t, uint64_t[4]);
+
+// the stripes of a kernel, or nullptr if this build or CPU lacks it.
+static jst_hash_stripes_func jst_hash_kernel_stripes(JHashKernel kernel) {
+  switch (kernel) {
+    case JST_HASH_SCALAR:
+      return jst_hash_stripes_scalar;
+#ifdef JST_HAVE_SSE2
+    case JST_HASH_SSE2:
+      return jst_hash_stripes_sse2;
+#endif
+#ifdef JST_HAVE_AVX2
+    case JST_HASH_AVX2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2") ? jst_hash_stripes_avx2 : nullptr;
+#endif
+    default:
+      return nullptr;
+  }
+}
+
+static JHashKernel jst_hash_best_kernel() {
+  if (jst_hash_kernel_stripes(JST_HASH_AVX2) != nullptr) return JST_HASH_AVX2;
+  if (jst_hash_kernel_stripes(JST_HASH_SSE2) != nullptr) return JST_HASH_SSE2;
+  return JST_HASH_SCALAR;
+}
+
+static JHashKernel jst_hash_current = jst_hash_best_kernel();
+static jst_hash_stripes_func jst_hash_stripes = jst_hash_kernel_stripes(jst_hash_current);
+
+bool jst_hash_set_kernel(JHashKernel kernel) {
+  jst_hash_stripes_func stripes = jst_hash_kernel_stripes(kernel);
+  if (stripes == nullptr) return false;
+  jst_hash_current = kernel;
+  jst_hash_stripes = stripes;
+  return true;
+}
+
+JHashKernel jst_hash_kernel() { return jst_hash_current; }
+
+// Short inputs, and the tail of long ones, go through one multiply-rotate round per word.
+uint64_t jst_hash_bytes(const char* s, size_t len, uint64_t seed) {
+  uint64_t h = (seed + jst_hash_p2) ^ (len * jst_hash_p1);
+  size_t i = 0;
+  if (len >= 32) {
+    uint64_t acc[4] = {seed + jst_hash_p1, seed ^ jst_hash_p2, seed - jst_hash_p1,
+                       ~seed + jst_hash_p2};
+    i = jst_hash_stripes(s, len, acc);
+    for (int j = 0; j < 4; j++) h = jst_hash_rotl(h ^ jst_hash_mix(acc[j]), 27) * jst_hash_p1;
+  }
+  for (; i + 8 <= len; i += 8) {
+    h = jst_hash_rotl(h ^ (jst_hash_read64(s + i) * jst_hash_p2), 31) * jst_hash_p1;
+  }
+  if (i < len) {
+    uint64_t w = 0;
+    for (size_t k = len; k-- > i;) w = (w << 8) | (unsigned char)s[k];
+    h = jst_hash_rotl(h ^ (w * jst_hash_p2), 31) * jst_hash_p1;
+  }
+  return jst_hash_mix(h);
+}
+
+}  // namespace jst
@@ -0,0 +1,371 @@
+#include "msgpack.h"
+
+#include <cstring>
+
+namespace jst {
+
+static char* jst_put_be(char* out, uint64_t v, size_t bytes) {
+  for (size_t i = bytes; i-- > 0;) *out++ = (char)(v >> (8 * i));
+  return out;
+}
+
+static uint64_t jst_get_be(const unsigned char* p, size_t bytes) {
+  uint64_t v = 0;
+  for (size_t i = 0; i < bytes; i++) v = (v << 8) | p[i];
+  return v;
+}
+
+// Bytes of the header in front of a str/array/map of n elements; fix_max is the largest count
+// that fits the fix form (31 for str, 15 for array and map). str has an 8-bit form as well.
+static size_t jst_header_size(size_t n, size_t fix_max, bool has_8bit) {
+  if (n <= fix_max) return 1;
+  if (has_8bit && n <= 0xFF) return 2;
+  return n <= 0xFFFF ? 3 : 5;
+}
+
+static char* jst_header_write(char* out, size_t n, size_t fix_max, unsigned char fix,
+                              unsigned char first) {
+  if (n <= fix_max) {
+    *out++ = (char)(fix | n);
+  } else if (first == 0xd9 && n <= 0xFF) {
+    *out++ = (char)0xd9;
+    *out++ = (char)n;
+  } else if (n <= 0xFFFF) {
+    *out++ = (char)(first == 0xd9 ? 0xda : first);
+    out = jst_put_be(out, n, 2);
+  } else {
+    *out++ = (char)(first == 0xd9 ? 0xdb : first + 1);
+    out = jst_put_be(out, n, 4);
+  }
+  return out;
+}
+
+// Counts above max_length (at most UINT32_MAX, the 32-bit forms' limit) make the whole size
+// JST_MSGPACK_TOO_LARGE, with the reason in *err.
+static bool jst_length_fits(size_t n, size_t max_length, JRetType error, JRetType* err) {
+  if (n <= max_length && n <= UINT32_MAX) return true;
+  if (err != nullptr) *err = error;
+  return false;
+}
+
+static size_t jst_str_size(const JString& s, size_t max_length, JRetType* err) {
+  if (!jst_length_fits(s.size(), max_length, JST_PARSE_EXCEED_MAX_STRING_LENGTH, err)) {
+    return JST_MSGPACK_TOO_LARGE;
+  }
+  return jst_header_size(s.size(), 31, true) + s.size();
+}
+
+static char* jst_str_write(const JString& s, char* out) {
+  out = jst_header_write(out, s.size(), 31, 0xa0, 0xd9);
+  // a lazy string with nothing to unescape is already its own UTF-8.
+  size_t raw_len;
+  const char* raw = s.raw_source(raw_len);
+  memcpy(out, raw != nullptr && raw_len == s.size() ? raw : s.c_str(), s.size());
+  return out + s.size();
+}
+
+// Smallest encoding of an exact integer: fixint, then int/uint of 8 to 64 bits.
+static size_t jst_int_size(const JNumber& num) {
+  if (num.type() == JST_NUM_UINT || num.int_value() >= 0) {
+    uint64_t u = num.uint_value();
+    return u < 0x80 ? 1 : u <= 0xFF ? 2 : u <= 0xFFFF ? 3 : u <= 0xFFFFFFFF ? 5 : 9;
+  }
+  int64_t i = num.int_value();
+  return i >= -32 ? 1 : i >= INT8_MIN ? 2 : i >= INT16_MIN ? 3 : i >= INT32_MIN ? 5 : 9;
+}
+
+static char* jst_int_write(const JNumber& num, char* out) {
+  size_t size = jst_int_size(num);
+  if (size == 1) {
+    *out++ = (char)num.int_value();
+    return out;
+  }
+  bool is_uint = num.type() == JST_NUM_UINT || num.int_value() >= 0;
+  static const unsigned char uint_code[] = {0, 0, 0xcc, 0xcd, 0, 0xce, 0, 0, 0, 0xcf};
+  static const unsigned char int_code[] = {0, 0, 0xd0, 0xd1, 0, 0xd2, 0, 0, 0, 0xd3};
+  *out++ = (char)(is_uint ? uint_code[size] : int_code[size]);
+  return jst_put_be(out, num.uint_value(), size - 1);
+}
+
+size_t jst_msgpack_size(const JNode& jn, JRetType* err, size_t max_length) {
+  switch (jn.type()) {
+    case JST_NULL:
+    case JST_TRUE:
+    case JST_FALSE:
+      return 1;
+    case JST_NUM: {
+      const JNumber& num = jn.data().as<JNumber>();
+      return num.is_int() ? jst_int_size(num) : 9;
+    }
+    case JST_STR:
+      return jst_str_size(jn.data().as<JString>(), max_length, err);
+    case JST_ARR: {
+      const JArray& arr = jn.data().as<JArray>();
+      if (!jst_length_fits(arr.size(), max_length, JST_PARSE_EXCEED_MAX_NODES, err)) {
+        return JST_MSGPACK_TOO_LARGE;
+      }
+      size_t total = jst_header_size(arr.size(), 15, false);
+      for (size_t i = 0; i < arr.size(); i++) {
+        size_t size = jst_msgpack_size(arr[i], err, max_length);
+        if (size == JST_MSGPACK_TOO_LARGE) return size;
+        total += size;
+      }
+      return total;
+    }
+    case JST_OBJ: {
+      const JObject& obj = jn.data().as<JObject>();
+      if (!jst_length_fits(obj.size(), max_length, JST_PARSE_EXCEED_MAX_NODES, err)) {
+        return JST_MSGPACK_TOO_LARGE;
+      }
+      size_t total = jst_header_size(obj.size(), 15, false);
+      for (size_t i = 0; i < obj.size(); i++) {
+        size_t key = jst_str_size(obj.get_key(i), max_length, err);
+        if (key == JST_MSGPACK_TOO_LARGE) return key;
+        size_t value = jst_msgpack_size(obj.get_value(i), err, max_length);
+        if (value == JST_MSGPACK_TOO_LARGE) return value;
+        total += key + value;
+      }
+      return total;
+    }
+  }
+  return 0;
+}
+
+char* jst_msgpack_write(const JNode& jn, char* out) {
+  switch (jn.type()) {
+    case JST_NULL:
+      *out++ = (char)0xc0;
+      return out;
+    case JST_TRUE:
+      *out++ = (char)0xc3;
+      return out;
+    case JST_FALSE:
+      *out++ = (char)0xc2;
+      return out;
+    case JST_NUM: {
+      const JNumber& num = jn.data().as<JNumber>();
+      if (num.is_int()) return jst_int_write(num, out);
+      double d = num.value();
+      uint64_t bits;
+      memcpy(&bits, &d, sizeof(bits));
+      *out++ = (char)0xcb;
+      return jst_put_be(out, bits, 8);
+    }
+    case JST_STR:
+      return jst_str_write(jn.data().as<JString>(), out);
+    case JST_ARR: {
+      const JArray& arr = jn.data().as<JArray>();
+      out = jst_header_write(out, arr.size(), 15, 0x90, 0xdc);
+      for (size_t i = 0; i < arr.size(); i++) out = jst_msgpack_write(arr[i], out);
+      return out;
+    }
+    case JST_OBJ: {
+      const JObject& obj = jn.data().as<JObject>();
+      out = jst_header_write(out, obj.size(), 15, 0x80, 0xde);
+      for (size_t i = 0; i < obj.size(); i++) {
+        out = jst_str_write(obj.get_key(i), out);
+        out = jst_msgpack_write(obj.get_value(i), out);
+      }
+      return out;
+    }
+  }
+  return out;
+}
+
+JRetType jst_msgpack_encode(const JNode& jn, std::string& out, size_t max_length) {
+  JRetType ret = JST_PARSE_OK;
+  size_t size = jst_msgpack_size(jn, &ret, max_length);
+  if (size == JST_MSGPACK_TOO_LARGE) return ret;
+  out.resize(size);
+  jst_msgpack_write(jn, &out[0]);
+  return JST_PARSE_OK;
+}
+
+namespace {
+
+struct JMsgpackDecoder {
+  const unsigned char* data;
+  size_t len;
+  size_t pos = 0;
+  size_t depth = 0;
+
+  bool need(size_t n) const { return len - pos >= n; }
+
+  // Reads the big-endian count or value of `bytes` bytes after the type byte.
+  JRetType read_be(size_t bytes, uint64_t& v) {
+    if (!need(bytes)) return JST_PARSE_TRUNCATED;
+    v = jst_get_be(data + pos, bytes);
+    pos += bytes;
+    return JST_PARSE_OK;
+  }
+
+  // Type byte of a str at pos, and its length.
+  JRetType str_length(unsigned char c, size_t& n) {
+    uint64_t v;
+    JRetType ret = JST_PARSE_OK;
+    if ((c & 0xe0) == 0xa0) {
+      v = c & 0x1f;
+    } else if (c >= 0xd9 && c <= 0xdb) {
+      ret = read_be((size_t)1 << (c - 0xd9), v);
+    } else {
+      return JST_PARSE_UNSUPPORTED_TYPE;
+    }
+    if (ret != JST_PARSE_OK) return ret;
+    if (!need(v)) return JST_PARSE_TRUNCATED;
+    n = (size_t)v;
+    return JST_PARSE_OK;
+  }
+
+  JRetType string(JString& s) {
+    if (!need(1)) return JST_PARSE_TRUNCATED;
+    unsigned char c = data[pos++];
+    size_t n;
+    JRetType ret = str_length(c, n);
+    if (ret != JST_PARSE_OK) {
+      if (ret == JST_PARSE_UNSUPPORTED_TYPE) pos--;
+      return ret;
+    }
+    s = n == 0 ? JString("", 0) : JString((const char*)data + pos, n);
+    pos += n;
+    return JST_PARSE_OK;
+  }
+
+  JRetType value(JNode& node) {
+    if (!need(1)) return JST_PARSE_TRUNCATED;
+    unsigned char c = data[pos];
+    uint64_t v;
+    JRetType ret;
+    if (c <= 0x7f) {
+      pos++;
+      node = JNode(JNumber::from_int(c));
+      return JST_PARSE_OK;
+    }
+    if (c >= 0xe0) {
+      pos++;
+      node = JNode(JNumber::from_int((int8_t)c));
+      return JST_PARSE_OK;
+    }
+    if ((c & 0xe0) == 0xa0 || (c >= 0xd9 && c <= 0xdb)) {
+      JString s;
+      if ((ret = string(s)) != JST_PARSE_OK) return ret;
+      node = std::move(s);
+      return JST_PARSE_OK;
+    }
+    if ((c & 0xf0) == 0x90 || c == 0xdc || c == 0xdd) {
+      pos++;
+      if (c <= 0x9f) {
+        v = c & 0x0f;
+      } else if ((ret = read_be(c == 0xdc ? 2 : 4, v)) != JST_PARSE_OK) {
+        return ret;
+      }
+      return array((size_t)v, node);
+    }
+    if ((c & 0xf0) == 0x80 || c == 0xde || c == 0xdf) {
+      pos++;
+      if (c <= 0x8f) {
+        v = c & 0x0f;
+      } else if ((ret = read_be(c == 0xde ? 2 : 4, v)) != JST_PARSE_OK) {
+        return ret;
+      }
+      return object((size_t)v, node);
+    }
+
+    switch (c) {
+      case 0xc0:
+        pos++;
+        node = JNode(JST_NULL);
+        return JST_PARSE_OK;
+      case 0xc2:
+      case 0xc3:
+        pos++;
+        node = JNode(c == 0xc3 ? JST_TRUE : JST_FALSE);
+        return JST_PARSE_OK;
+      case 0xca:
+      case 0xcb: {
+        pos++;
+        if ((ret = read_be(c == 0xca ? 4 : 8, v)) != JST_PARSE_OK) return ret;
+        double d;
+        if (c == 0xca) {
+          float f;
+          uint32_t bits = (uint32_t)v;
+          memcpy(&f, &bits, sizeof(f));
+          d = f;
+        } else {
+          memcpy(&d, &v, sizeof(d));
+        }
+        node = JNode(d);
+        return JST_PARSE_OK;
+      }
+      case 0xcc:
+      case 0xcd:
+      case 0xce:
+      case 0xcf:
+        pos++;
+        if ((ret = read_be((size_t)1 << (c - 0xcc), v)) != JST_PARSE_OK) return ret;
+        node = JNode(v <= INT64_MAX ? JNumber::from_int((int64_t)v) : JNumber::from_uint(v));
+        return JST_PARSE_OK;
+      case 0xd0:
+      case 0xd1:
+      case 0xd2:
+      case 0xd3: {
+        pos++;
+        size_t bytes = (size_t)1 << (c - 0xd0);
+        if ((ret = read_be(bytes, v)) != JST_PARSE_OK) return ret;
+        // sign-extend from the encoded width.
+        int64_t i = bytes == 8 ? (int64_t)v : (int64_t)(v << (64 - 8 * bytes)) >> (64 - 8 * bytes);
+        node = JNode(JNumber::from_int(i));
+        return JST_PARSE_OK;
+      }
+      default:
+        return JST_PARSE_UNSUPPORTED_TYPE;
+    }
+  }
+
+  // Every element takes at least one byte, which bounds n before anything is allocated.
+  JRetType array(size_t n, JNode& node) {
+    if (!need(n)) return JST_PARSE_TRUNCATED;
+    if (++depth > JST_MSGPACK_MAX_DEPTH) return JST_PARSE_EXCEED_MAX_DEPTH;
+    JArray arr(n);
+    for (size_t i = 0; i < n; i++) {
+      JRetType ret = value(arr[i]);
+      if (ret != JST_PARSE_OK) return ret;
+    }
+    depth--;
+    node = std::move(arr);
+    return JST_PARSE_OK;
+  }
+
+  JRetType object(size_t n, JNode& node) {
+    if (!need(n) || !need(2 * n)) return JST_PARSE_TRUNCATED;
+    if (++depth > JST_MSGPACK_MAX_DEPTH) return JST_PARSE_EXCEED_MAX_DEPTH;
+    JObject obj(n);
+    for (size_t i = 0; i < n; i++) {
+      JString key;
+      JNode val;
+      JRetType ret = string(key);
+      if (ret != JST_PARSE_OK || (ret = value(val)) != JST_PARSE_OK) return ret;
+      obj.push_back(JOjectElement(std::move(key), std::move(val)));
+    }
+    depth--;
+    node = std::move(obj);
+    return JST_PARSE_OK;
+  }
+};
+
+}  // namespace
+
+JRetType jst_msgpack_decode(const char* data, size_t len, JNode& out, size_t* err_offset) {
+  JMsgpackDecoder decoder{(const unsigned char*)data, len};
+  JNode node;
+  JRetType ret = decoder.value(node);
+  if (ret == JST_PARSE_OK && decoder.pos != len) ret = JST_PARSE_SINGULAR;
+  if (ret != JST_PARSE_OK) {
+    if (err_offset != nullptr) *err_offset = decoder.pos;
+    out = JNode(JST_NULL);
+    return ret;
+  }
+  out = std::move(node);
+  return JST_PARSE_OK;
+}
+
+}  // namespace jst
@@ -11,31 +11,40 @@
 
 #include "basic.h"
 #include "enum.h"
+#include "hash.h"
 
 namespace jst {
 
-static shared_ptr<JData> jst_node_data_copy(JNType type, const JData& node) {
+static shared_ptr<JData> jst_node_data_copy(JNType type, const JData* node) {
+  if (node == nullptr) return nullptr;
   switch (type) {
     case JST_STR:
-      return std::make_shared<JString>(node.as<JString>());
+      return std::make_shared<JString>(node->as<JString>());
     case JST_NUM:
-      return std::make_shared<JNumber>(node.as<JNumber>());
+      return std::make_shared<JNumber>(node->as<JNumber>());
     case JST_ARR:
-      return std::make_shared<JArray>(node.as<JArray>());
+      return std::make_shared<JArray>(node->as<JArray>());
     case JST_OBJ:
-      return std::make_shared<JObject>(node.as<JObject>());
+      return std::make_shared<JObject>(node->as<JObject>());
     default:
       return nullptr;
   }
 }
 
+JData& JNode::mutable_data() {
+  JST_DEBUG(_data != nullptr);
+  _data->touch();
+  return *_data;
+}
+
+void JNode::changed() {
+  if (_data != nullptr) _data->parent_ = owner_;
+  if (owner_ != nullptr) owner_->touch();
+}
+
 JNode::JNode(JNType t, const char* str, size_t len) : _type(t), _data(nullptr) {
   if (_type == JST_NUM) {
-    if (len == 0) {
-      jst_node_parser_num(std::string(str));
-    } else {
-      jst_node_parser_num(std::string(str, len));
-    }
+    jst_node_parser_num(str, len == 0 ? strlen(str) : len);
   } else if (_type == JST_STR) {
     _data = std::make_shared<JString>(JString(str, len));
   }
@@ -43,29 +52,35 @@ JNode::JNode(JNType t, const char* str, size_t len) : _type(t), _data(nullptr) {
 
 // copy construct
 JNode::JNode(const JNode& node) : _type(node.type()) {
-  _data = jst_node_data_copy(node._type, *node._data);
+  _data = jst_node_data_copy(node._type, node._data.get());
 }
 
 // assigment construct
 JNode& JNode::operator=(const JNode& node) {
+  if (this == &node) return *this;
   _type = node._type;
-  _data = jst_node_data_copy(node._type, *node._data);
+  _data = jst_node_data_copy(node._type, node._data.get());
+  changed();
   return *this;
 }
 
 // move copy construct
-JNode::JNode(JNode&& node) noexcept : _type(node._type), _data(node._data) {
+JNode::JNode(JNode&& node) noexcept : _type(node._type), _data(std::move(node._data)) {
   node._data = nullptr;
   node._type = JST_NULL;
+  if (node.owner_ != nullptr) node.owner_->touch();
+  if (_data != nullptr) _data->parent_ = nullptr;
 }
 
 // move assigment construct
 JNode& JNode::operator=(JNode&& node) noexcept {
+  if (this == &node) return *this;
   _type = node._type;
-  _data = node._data;
+  _data = std::move(node._data);
   node._data = nullptr;
   node._type = JST_NULL;
-
+  if (node.owner_ != nullptr) node.owner_->touch();
+  changed();
   return *this;
 }
 
@@ -75,69 +90,15 @@ JNode::~JNode() {
   _data = nullptr;
 }
 
-JRetType JNode::jst_node_parser_num(const std::string& str) {
-  if (str[0] == '0' && str.size() > 1) {
-    _type = JST_NULL;
-    return JST_PARSE_SINGULAR;
-  }
-
-  auto ret = JST_PARSE_OK;
-  NumberExp exp_state;
-  NumberPoint point_state;
-
-  int index = 0;
-  if (str[0] == '-') index += 1;
-
-  while (index < str.size()) {
-    if (str[index] == ' ') {
-      break;
-    }
-    if (std::isdigit(str[index])) {
-      if (exp_state.is_have && point_state.is_have &&
-          exp_state.exp_index < point_state.point_index) {
-        ret = JST_PARSE_INVALID_VALUE;
-        break;
-      }
-    } else if (str[index] == 'E' || str[index] == 'e') {
-      if (exp_state.is_have || index + 1 >= str.size()) {
-        ret = JST_PARSE_INVALID_VALUE;
-        break;
-      }
-      exp_state.is_have = true;
-      if (str[index + 1] == '+' || str[index + 1] == '-') {
-        exp_state.exp_index = index + 2;
-        index++;
-      } else if (std::isdigit(str[index + 1]))
-        exp_state.exp_index = index + 1;
-      else {
-        ret = JST_PARSE_INVALID_VALUE;
-        break;
-      }
-    } else if (str[index] == '.') {
-      if (point_state.is_have || index + 1 >= str.size()) {
-        ret = JST_PARSE_INVALID_VALUE;
-        break;
-      }
-      point_state.is_have = true;
-      point_state.point_index = index;
-    } else {
-      ret = JST_PARSE_INVALID_VALUE;
-      break;
-    }
-    index++;
-  }
+JRetType JNode::jst_node_parser_num(const char* str, size_t len) {
+  auto num = std::make_shared<JNumber>();
+  JRetType ret = JNumber::from_text(str, len, *num);
   if (ret != JST_PARSE_OK) {
     _type = JST_NULL;
+    _data = nullptr;
     return ret;
   }
-  std::string n_str = str.substr(0, index);
-  double n = std::strtod(n_str.c_str(), NULL);
-
-  if (n == HUGE_VAL || n == -HUGE_VAL) {
-    _type = JST_NULL;
-    return JST_PARSE_NUMBER_TOO_BIG;
-  }
-  _data = std::make_shared<JNumber>(JNumber(n));
+  _data = std::move(num);
   return ret;
 }
 
@@ -146,18 +107,69 @@ JRetType JNode::data_set(JNType t, const char* str, const size_t len) {
   JRetType ret = JST_PARSE_OK;
   _type = t;
   if (t == JST_NULL || t == JST_TRUE || t == JST_FALSE)
-    ret = JST_PARSE_OK;
+    _data = nullptr;
   else if (_type == JST_NUM) {
-    ret = jst_node_parser_num(std::string(str, len));
+    ret = jst_node_parser_num(str, len);
   } else if (_type == JST_STR) {
     _data = std::make_shared<JString>(JString(str, len));
   }
   if (ret != JST_PARSE_OK) {
     _type = JST_NULL;
   }
+  changed();
   return ret;
 }
 
+// Numbers equal under JNumber's operator== have the same double value, except that its absolute
+// tolerance chains every value in [-1, 1] to its neighbours (they lie closer than epsilon); those
+// all share one hash. Above 1 in magnitude neighbours are epsilon apart or more, so never equal.
+static uint64_t jst_hash_number(const JNumber& num) {
+  double d = num.value();
+  if (std::fabs(d) <= 1.0) return 0x3c6ef372fe94f82bULL;
+  uint64_t bits;
+  memcpy(&bits, &d, sizeof(bits));
+  return jst_hash_mix(bits ^ 0x6a09e667f3bcc908ULL);
+}
+
+uint64_t JNode::hash() const {
+  switch (_type) {
+    case JST_NULL:
+      return 0x243f6a8885a308d3ULL;
+    case JST_TRUE:
+      return 0x13198a2e03707344ULL;
+    case JST_FALSE:
+      return 0xa4093822299f31d0ULL;
+    case JST_NUM:
+      return jst_hash_number(_data->as<JNumber>());
+    case JST_STR: {
+      const JString& s = _data->as<JString>();
+      return jst_hash_bytes(s.c_str(), s.size(), 0x082efa98ec4e6c89ULL);
+    }
+    default:
+      break;
+  }
+  if (_data->hashed()) return _data->cached_hash();
+  uint64_t h;
+  if (_type == JST_ARR) {
+    const JArray& arr = _data->as<JArray>();
+    h = 0x452821e638d01377ULL;
+    for (size_t i = 0; i < arr.size(); i++) h = jst_hash_mix(h + arr[i].hash());
+    h = jst_hash_mix(h ^ arr.size());
+  } else {
+    // a sum of the members, so their order does not count.
+    const JObject& obj = _data->as<JObject>();
+    h = 0;
+    for (size_t i = 0; i < obj.size(); i++) {
+      const JString& key = obj.get_key(i);
+      uint64_t k = jst_hash_bytes(key.c_str(), key.size(), 0xbe5466cf34e90c6cULL);
+      h += jst_hash_mix(k ^ (obj.get_value(i).hash() * 0x9e3779b97f4a7c15ULL));
+    }
+    h = jst_hash_mix(h ^ 0xc0ac29b7c97c50ddULL ^ obj.size());
+  }
+  _data->set_hash(h);
+  return h;
+}
+
 bool operator==(const JNode& left, const JNode& right) {
   if (left._type != right._type) {
     return false;
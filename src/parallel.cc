@@ -0,0 +1,123 @@
+#include "parallel.h"
+
+#include <assert.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "parser.h"
+#include "structural.h"
+
+namespace jst {
+
+unsigned jst_thread_count(unsigned threads) {
+  if (threads == 0) threads = std::thread::hardware_concurrency();
+  return std::max(threads, 1u);
+}
+
+void jst_parallel_for(size_t n, unsigned threads, const std::function<void(size_t)>& task) {
+  std::atomic<size_t> next(0);
+  auto work = [&]() {
+    for (size_t k; (k = next++) < n;) task(k);
+  };
+  std::vector<std::thread> pool;
+  for (unsigned t = 1; t < std::min<size_t>(jst_thread_count(threads), n); t++) {
+    pool.emplace_back(work);
+  }
+  work();
+  for (auto& t : pool) t.join();
+}
+
+JRetType JParser::parse_elements(std::vector<JNode>& out) {
+  for (;;) {
+    JST_FUNCTION_STATE(JST_PARSE_OK, jst_ws_parser(JST_WS_BEFORE), out);
+    out.emplace_back();
+    JST_FUNCTION_STATE(JST_PARSE_OK, main_parser(out.back(), true), out);
+    JST_FUNCTION_STATE(JST_PARSE_OK, jst_ws_parser(JST_WS_AFTER, JST_ARR), out);
+    if (this->str_index == this->json_len) return JST_PARSE_OK;
+    if (this->json[this->str_index] != ',') return JST_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+    this->str_index++;
+  }
+}
+
+JRetType JParser::parse_members(std::vector<JOjectElement>& out) {
+  for (;;) {
+    JST_FUNCTION_STATE(JST_PARSE_OK, jst_ws_parser(JST_WS_BEFORE), out);
+    out.emplace_back();
+    JST_FUNCTION_STATE(JST_PARSE_OK, parser_object_member(out.back()), out);
+    JST_FUNCTION_STATE(JST_PARSE_OK, jst_ws_parser(JST_WS_AFTER, JST_OBJ), out);
+    if (this->str_index == this->json_len) return JST_PARSE_OK;
+    if (this->json[this->str_index] != ',') return JST_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+    this->str_index++;
+  }
+}
+
+JRetType JParser::parse_parallel(JNode* node, unsigned threads) {
+  threads = jst_thread_count(threads);
+  if (threads == 1 || options.max_nodes != 0 || options.max_time_us != 0 ||
+      (options.max_bytes != 0 && this->json_len > options.max_bytes)) {
+    return parser(node);
+  }
+  // stage 1 validates the input and plans the split on all threads; the chunk parsers then
+  // only have to build the tree.
+  JSplitPlan plan;
+  if (!jst_structural_split(json, json_len, threads, options.parallel_chunk, plan,
+                            options.validate_utf8)) {
+    return parser(node);
+  }
+  const std::vector<size_t>& bounds = plan.bounds;
+  bool is_object = json[plan.open] == '{';
+
+  // chunk k is json[bounds[k], bounds[k + 1] - 1): the members between two split commas, or up
+  // to the closing bracket for the last one. Every chunk gets its own parser, and so its own
+  // stack, and its own list of nodes.
+  size_t chunks = bounds.size() - 1;
+  std::vector<std::vector<JNode>> elements(is_object ? 0 : chunks);
+  std::vector<std::vector<JOjectElement>> members(is_object ? chunks : 0);
+  JParserOptions sub_options = this->options;
+  sub_options.validate_utf8 = false;
+  std::atomic<bool> failed(false);
+  jst_parallel_for(chunks, threads, [&](size_t k) {
+    if (failed.load(std::memory_order_relaxed)) return;
+    size_t end = k + 1 == chunks ? bounds[k + 1] : bounds[k + 1] - 1;
+    JParser sub("", sub_options);
+    sub.json = this->json + bounds[k];
+    sub.json_len = end - bounds[k];
+    sub.own_input = false;
+    sub.depth = plan.depth;
+    JRetType ret = is_object ? sub.parse_members(members[k]) : sub.parse_elements(elements[k]);
+    if (ret != JST_PARSE_OK) failed = true;
+  });
+  if (failed) return parser(node);
+
+  size_t total = 0, i = 0;
+  if (is_object) {
+    for (auto& part : members) total += part.size();
+    JObject obj(total);
+    for (auto& part : members) {
+      for (auto& objm : part) obj.push_back(std::move(objm));
+    }
+    this->splice = std::move(obj);
+  } else {
+    for (auto& part : elements) total += part.size();
+    JArray arr(total);
+    for (auto& part : elements) {
+      for (auto& jn : part) arr[i++] = std::move(jn);
+    }
+    this->splice = std::move(arr);
+  }
+
+  // the text around the container is parsed serially and takes the container as built.
+  this->splice_at = plan.open;
+  this->splice_end = plan.close + 1;
+  JRetType ret = parser(node);
+  this->splice_at = SIZE_MAX;
+  this->splice = JNode();
+  if (ret == JST_PARSE_OK) return ret;
+  this->str_index = 0;
+  return parser(node);
+}
+
+}  // namespace jst
@@ -12,11 +12,15 @@
 
 #include "basic.h"
 #include "enum.h"
+#include "file.h"
+#include "format.h"
+#include "utf8.h"
 
 namespace jst {
 
 JParser::JParser(const JParser& parser)
-    : str(parser.str), str_index(parser.str_index), root(parser.root) {
+    : str(parser.str), str_index(parser.str_index), root(parser.root), options(parser.options) {
+  attach_input(parser);
   if (parser.stack == nullptr) {
     stack = nullptr, size = 0, top = 0;
     return;
@@ -32,6 +36,8 @@ JParser& JParser::operator=(const JParser& parser) {
   this->str = parser.str;
   this->root = parser.root;
   this->str_index = parser.str_index;
+  this->options = parser.options;
+  attach_input(parser);
 
   if (this->stack != nullptr) {
     free(this->stack);
@@ -44,7 +50,9 @@ JParser& JParser::operator=(const JParser& parser) {
   return *this;
 }
 
-JParser::JParser(JParser&& parser) : str(std::move(parser.str)), root(std::move(parser.root)) {
+JParser::JParser(JParser&& parser)
+    : str(std::move(parser.str)), root(std::move(parser.root)), options(parser.options) {
+  attach_input(parser);
   this->stack = parser.stack;
   this->size = parser.size;
   this->top = parser.top;
@@ -59,6 +67,8 @@ JParser::JParser(JParser&& parser) : str(std::move(parser.str)), root(std::move(
 JParser& JParser::operator=(JParser&& parser) {
   str = std::move(parser.str);
   root = std::move(parser.root);
+  options = parser.options;
+  attach_input(parser);
 
   if (this->stack != nullptr) {
     free(this->stack);
@@ -92,10 +102,10 @@ void* JParser::stack_push(size_t p_size) {
     this->size = init_stack_size;
     this->stack = (char*)calloc(this->size, sizeof(char));
   }
+  // every caller writes what it pushes, so the grown region is left uninitialized.
   if (this->top + p_size > this->size) {
     while (top + p_size >= size) this->size += (this->size >> 1);
     this->stack = (char*)realloc(this->stack, this->size);
-    memset(this->stack, 0, this->size);
   }
   void* ret = this->stack + this->top;
   this->top += p_size;
@@ -111,6 +121,10 @@ void* JParser::stack_pop(size_t p_size) {
 void JParser::reset(const std::string& j_str) {
   JST_DEBUG(top == 0);
   this->str = j_str;
+  this->json = this->str.c_str();
+  this->json_len = this->str.size();
+  this->own_input = true;
+  this->file = nullptr;
   if (this->stack != nullptr) free(stack);
   this->stack = 0;
   this->str_index = 0;
@@ -118,16 +132,124 @@ void JParser::reset(const std::string& j_str) {
   this->top = 0;
 }
 
+void JParser::reset(const char* j_str, size_t len) {
+  JST_DEBUG(top == 0);
+  JST_DEBUG(j_str != nullptr && j_str[len] == '\0');
+  this->str.clear();
+  this->json = j_str;
+  this->json_len = len;
+  this->own_input = false;
+  this->file = nullptr;
+  this->str_index = 0;
+}
+
+// `str` may have been copied or moved from `parser`; a borrowed buffer is shared as is.
+void JParser::attach_input(const JParser& parser) {
+  this->own_input = parser.own_input;
+  this->file = parser.file;
+  this->err_offset = parser.err_offset;
+  if (this->own_input) {
+    this->json = this->str.c_str();
+    this->json_len = this->str.size();
+  } else {
+    this->json = parser.json;
+    this->json_len = parser.json_len;
+  }
+}
+
+// On failure the view onto buf is kept so that error_info() can still read the input.
+JRetType JParser::parse_insitu(char* buf, size_t len, JNode* node) {
+  reset(buf, len);
+  this->insitu = buf;
+  JRetType ret = parser(node);
+  this->insitu = nullptr;
+  if (ret == JST_PARSE_OK) reset(std::string());
+  return ret;
+}
+
+JRetType JParser::parse_lazy(JNode* node) {
+  this->lazy = true;
+  JRetType ret = parser(node);
+  this->lazy = false;
+  return ret;
+}
+
+JRetType JParser::parse_file(const std::string& path, JNode* node) {
+  std::shared_ptr<JMappedFile> mapped = std::make_shared<JMappedFile>();
+  JRetType ret = mapped->open(path);
+  if (ret != JST_PARSE_OK) {
+    if (node != nullptr) *node = JNode(JST_NULL);
+    reset(std::string());
+    this->err_offset = 0;
+    return ret;
+  }
+  reset(mapped->data(), mapped->size());
+  ret = parser(node);
+  if (ret == JST_PARSE_OK)
+    reset(std::string());
+  else
+    this->file = std::move(mapped);
+  return ret;
+}
+
+JErrorInfo JParser::error_info(size_t context_radius) const {
+  JErrorInfo info;
+  info.offset = std::min(this->err_offset, this->json_len);
+  size_t line_start = 0;
+  info.line = 1 + jst_count_newlines(this->json, info.offset, &line_start);
+  info.column = info.offset - line_start + 1;
+
+  size_t from = info.offset - std::min(info.offset - line_start, context_radius);
+  size_t to = info.offset;
+  while (to < this->json_len && to - info.offset < context_radius && this->json[to] != '\n' &&
+         this->json[to] != '\r')
+    to++;
+  info.context.assign(this->json + from, to - from);
+  info.context_offset = info.offset - from;
+  return info;
+}
+
 JRetType JParser::parser(JNode* node) {
-  return node == nullptr ? main_parser(root) : main_parser(*node);
+  JNode& target = node == nullptr ? root : *node;
+  this->err_offset = JST_NO_ERROR_OFFSET;
+  if (options.max_bytes != 0 && this->json_len > options.max_bytes) {
+    target = JNode(JST_NULL);
+    this->err_offset = options.max_bytes;
+    return JST_PARSE_EXCEED_MAX_BYTES;
+  }
+  this->node_count = 0;
+  this->depth = 0;
+  if (options.max_time_us != 0) {
+    this->deadline =
+        std::chrono::steady_clock::now() + std::chrono::microseconds(options.max_time_us);
+  }
+  JRetType ret = main_parser(target);
+  // errors inside a string record their own position; everything else stops at str_index.
+  if (ret != JST_PARSE_OK && this->err_offset == JST_NO_ERROR_OFFSET)
+    this->err_offset = this->str_index;
+  return ret;
+}
+
+// Called once per value. The node budget is a single compare; the clock is only read every
+// JST_DEADLINE_STRIDE values so the deadline stays off the hot path.
+inline JRetType JParser::check_budget() {
+  this->node_count++;
+  if (options.max_nodes != 0 && this->node_count > options.max_nodes) {
+    return JST_PARSE_EXCEED_MAX_NODES;
+  }
+  if (options.max_time_us != 0 && this->node_count % JST_DEADLINE_STRIDE == 0 &&
+      std::chrono::steady_clock::now() > this->deadline) {
+    return JST_PARSE_TIMEOUT;
+  }
+  return JST_PARSE_OK;
 }
 
 JRetType JParser::jst_ws_parser(jst_ws_state state, JNType t) {
-  int ws_count = 0;
-  int index = this->str_index;
-  for (int i = index; i < this->str.size(); i++) {
-    if (this->str[i] == ' ' || this->str[i] == '\n' || this->str[i] == '\t' ||
-        this->str[i] == '\r') {
+  size_t ws_count = 0;
+  size_t index = this->str_index;
+  for (size_t i = index; i < this->json_len; i++) {
+    if (this->json[i] == ' ' || this->json[i] == '\n' || this->json[i] == '\t' ||
+        this->json[i] == '\r') {
       ws_count++;
       continue;
     }
@@ -136,16 +258,16 @@ JRetType JParser::jst_ws_parser(jst_ws_state state, JNType t) {
   this->str_index += ws_count;
 
   auto ret = JST_PARSE_OK;
-  if (state == JST_WS_BEFORE && this->str_index == this->str.size()) {
+  if (state == JST_WS_BEFORE && this->str_index == this->json_len) {
     ret = JST_PARSE_EXCEPT_VALUE;
   }
-  if (state == JST_WS_AFTER && this->str_index != this->str.size()) {
+  if (state == JST_WS_AFTER && this->str_index != this->json_len) {
     if (t == JST_ARR) {
-      if (this->str[this->str_index] != ',' && this->str[this->str_index] != ']')
+      if (this->json[this->str_index] != ',' && this->json[this->str_index] != ']')
         ret = JST_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
     } else if (t == JST_OBJ) {
-      if (this->str[this->str_index] != ',' && this->str[this->str_index] != ':' &&
-          this->str[this->str_index] != '}')
+      if (this->json[this->str_index] != ',' && this->json[this->str_index] != ':' &&
+          this->json[this->str_index] != '}')
         ret = JST_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
     } else {
       ret = JST_PARSE_SINGULAR;
@@ -159,25 +281,27 @@ JRetType JParser::parser_symbol(JNode& node) {
   auto index = this->str_index;
   auto ret = JST_PARSE_OK;
 
-  if (str[index] == 't') {
-    if (str.size() < 4 || str[index + 1] != 'r' || str[index + 2] != 'u' || str[index + 3] != 'e') {
+  if (json[index] == 't') {
+    if (index + 4 > json_len || json[index + 1] != 'r' || json[index + 2] != 'u' ||
+        json[index + 3] != 'e') {
       t = JST_NULL;
       ret = JST_PARSE_INVALID_VALUE;
       goto RETURN;
     }
     t = JST_TRUE;
     this->str_index += 4;
-  } else if (str[index] == 'f') {
-    if (str.size() < 5 || str[index + 1] != 'a' || str[index + 2] != 'l' || str[index + 3] != 's' ||
-        str[index + 4] != 'e') {
+  } else if (json[index] == 'f') {
+    if (index + 5 > json_len || json[index + 1] != 'a' || json[index + 2] != 'l' ||
+        json[index + 3] != 's' || json[index + 4] != 'e') {
       t = JST_NULL;
       ret = JST_PARSE_INVALID_VALUE;
       goto RETURN;
     }
     t = JST_FALSE;
     this->str_index += 5;
-  } else if (str[index] == 'n') {
-    if (str.size() < 4 || str[index + 1] != 'u' || str[index + 2] != 'l' || str[index + 3] != 'l') {
+  } else if (json[index] == 'n') {
+    if (index + 4 > json_len || json[index + 1] != 'u' || json[index + 2] != 'l' ||
+        json[index + 3] != 'l') {
       t = JST_NULL;
       ret = JST_PARSE_INVALID_VALUE;
       goto RETURN;
@@ -190,124 +314,113 @@ RETURN:
   return ret;
 }
 
-JRetType JParser::parser_number(JNode& node) {
-  JST_DEBUG(std::isdigit(this->str[this->str_index]) || this->str[this->str_index] == '+' ||
-            this->str[this->str_index] == '-');
-
-  int num_count = 0;
-  for (int i = this->str_index; i < str.size(); i++) {
-    if (std::isdigit(str[i]) || str[i] == '.' || str[i] == 'e' || str[i] == 'E' || str[i] == '+' ||
-        str[i] == '-') {
-      num_count++;
+size_t JParser::number_length() const {
+  size_t i = this->str_index;
+  for (; i < json_len; i++) {
+    char c = json[i];
+    if ((unsigned)(c - '0') < 10 || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
       continue;
     }
     break;
   }
-  JST_FUNCTION_STATE(
-      JST_PARSE_OK,
-      node.data_set(JST_NUM, str.substr(this->str_index, num_count).c_str(), num_count), node);
+  return i - this->str_index;
+}
+
+JRetType JParser::parser_number(JNode& node) {
+  JST_DEBUG(std::isdigit(this->json[this->str_index]) || this->json[this->str_index] == '+' ||
+            this->json[this->str_index] == '-');
+
+  size_t num_count = number_length();
+  JST_FUNCTION_STATE(JST_PARSE_OK, node.data_set(JST_NUM, json + this->str_index, num_count),
+                     node);
   this->str_index += num_count;
 
   return JST_PARSE_OK;
 }
 
-JRetType JParser::parser_utf_str(unsigned hex, std::vector<char>& sp_vec) {
-  if (hex >= 0x0000 && hex <= 0x007F) {
-    sp_vec.push_back(hex & 0x00FF);
-  } else if (hex >= 0x0080 && hex <= 0x07FF) {
-    sp_vec.push_back(0xC0 | ((hex >> 6) & 0xFF));
-    sp_vec.push_back(0x80 | (hex & 0x3F));
-  } else if (hex >= 0x0800 && hex <= 0xFFFF) {
-    sp_vec.push_back(0xE0 | ((hex >> 12) & 0xFF)); /* 0xE0 = 11100000 */
-    sp_vec.push_back(0x80 | ((hex >> 6) & 0x3F));  /* 0x80 = 10000000 */
-    sp_vec.push_back(0x80 | (hex & 0x3F));         /* 0x3F = 00111111 */
-  } else if (hex >= 0x10000 && hex <= 0x10FFFF) {
-    sp_vec.push_back(0xF0 | ((hex >> 18) & 0xFF));
-    sp_vec.push_back(0x80 | ((hex >> 12) & 0x3F));
-    sp_vec.push_back(0x80 | ((hex >> 6) & 0x3F));
-    sp_vec.push_back(0x80 | (hex & 0x3F));
+JRetType JParser::parser_utf_str(unsigned hex, char*& out) {
+  if (hex <= 0x007F) {
+    *out++ = hex & 0x00FF;
+  } else if (hex <= 0x07FF) {
+    *out++ = 0xC0 | ((hex >> 6) & 0xFF);
+    *out++ = 0x80 | (hex & 0x3F);
+  } else if (hex <= 0xFFFF) {
+    *out++ = 0xE0 | ((hex >> 12) & 0xFF); /* 0xE0 = 11100000 */
+    *out++ = 0x80 | ((hex >> 6) & 0x3F);  /* 0x80 = 10000000 */
+    *out++ = 0x80 | (hex & 0x3F);         /* 0x3F = 00111111 */
+  } else if (hex <= 0x10FFFF) {
+    *out++ = 0xF0 | ((hex >> 18) & 0xFF);
+    *out++ = 0x80 | ((hex >> 12) & 0x3F);
+    *out++ = 0x80 | ((hex >> 6) & 0x3F);
+    *out++ = 0x80 | (hex & 0x3F);
   } else
     return JST_PARSE_INVALID_UNICODE_SURROGATE;
   return JST_PARSE_OK;
 }
 
-#define CHAR_VECTOR_PUSH(vector, c, ret_type) \
-  vector.push_back(c);                        \
-  ret = ret_type;                             \
-  break
-
-inline JRetType JParser::parser_specifical_str(int& index, std::vector<char>& sp_char) {
-  JRetType ret = JST_PARSE_OK;
-  switch (this->str[index]) {
-    case 'n':
-      CHAR_VECTOR_PUSH(sp_char, '\n', JST_PARSE_OK);
-    case '\\':
-      CHAR_VECTOR_PUSH(sp_char, '\\', JST_PARSE_OK);
-    case 'b':
-      CHAR_VECTOR_PUSH(sp_char, '\b', JST_PARSE_OK);
-    case 'f':
-      CHAR_VECTOR_PUSH(sp_char, '\f', JST_PARSE_OK);
-    case 'r':
-      CHAR_VECTOR_PUSH(sp_char, '\r', JST_PARSE_OK);
-    case 't':
-      CHAR_VECTOR_PUSH(sp_char, '\t', JST_PARSE_OK);
-    case '\"':
-      CHAR_VECTOR_PUSH(sp_char, '\"', JST_PARSE_OK);
-    case '/':
-      CHAR_VECTOR_PUSH(sp_char, '/', JST_PARSE_OK);
-    case 'u': {
-      if (index + 4 > this->str.size() || !std::isxdigit(this->str[index + 1]) ||
-          !std::isxdigit(this->str[index + 2]) || !std::isxdigit(this->str[index + 3]) ||
-          !std::isxdigit(this->str[index + 4])) {
-        ret = JST_PARSE_INVALID_UNICODE_HEX;
-        break;
-      }
-      unsigned hex = std::strtol(this->str.substr(index + 1, 4).c_str(), NULL, 16);
-      index += 4;
-      if (hex >= 0xD800 && hex <= 0xDBFF) {
-        if (index + 6 > this->str.size() || this->str[index + 1] != '\\' ||
-            this->str[index + 2] != 'u' || !std::isxdigit(this->str[index + 3]) ||
-            !std::isxdigit(this->str[index + 4]) || !std::isxdigit(this->str[index + 5]) ||
-            !std::isxdigit(this->str[index + 6])) {
-          ret = JST_PARSE_INVALID_UNICODE_SURROGATE;
-          break;
-        }
-        unsigned low_hex = std::strtol(this->str.substr(index + 3, 4).c_str(), NULL, 16);
-        if (low_hex < 0xDC00 || low_hex > 0xDFFF) {
-          ret = JST_PARSE_INVALID_UNICODE_SURROGATE;
-          break;
-        }
-        hex = 0x10000 + (hex - 0xD800) * 0x400 + (low_hex - 0xDC00);
-        index += 6;
-      }
-      if (JST_PARSE_OK != parser_utf_str(hex, sp_char)) {
-        ret = JST_PARSE_INVALID_UNICODE_SURROGATE;
-        break;
-      }
-      break;
+// Decodes the escape whose letter is at json[index] into out (at most JST_ESCAPE_MAX bytes).
+// On success index is left on the last byte of the sequence and out is advanced.
+inline JRetType JParser::parser_specifical_str(size_t& index, char*& out) {
+  char c = jst_escape_table[(unsigned char)this->json[index]];
+  if (c != 0) {
+    *out++ = c;
+    return JST_PARSE_OK;
+  }
+  if (this->json[index] != 'u') return JST_PARSE_INVALID_STRING_ESCAPE;
+
+  unsigned hex;
+  if (index + 4 > this->json_len || !jst_parse_hex4(this->json + index + 1, hex)) {
+    return JST_PARSE_INVALID_UNICODE_HEX;
+  }
+  index += 4;
+  if (hex >= 0xD800 && hex <= 0xDBFF) {
+    unsigned low_hex;
+    if (index + 6 > this->json_len || this->json[index + 1] != '\\' ||
+        this->json[index + 2] != 'u' || !jst_parse_hex4(this->json + index + 3, low_hex) ||
+        low_hex < 0xDC00 || low_hex > 0xDFFF) {
+      return JST_PARSE_INVALID_UNICODE_SURROGATE;
     }
-    default:
-      ret = JST_PARSE_INVALID_STRING_ESCAPE;
-      break;
+    hex = 0x10000 + (hex - 0xD800) * 0x400 + (low_hex - 0xDC00);
+    index += 6;
   }
-  return ret;
+  return parser_utf_str(hex, out);
 }
 
 JRetType JParser::parser_string_base(JString& s) {
-  JST_DEBUG(this->str[this->str_index] == '\"');
+  JST_DEBUG(this->json[this->str_index] == '\"');
   JRetType ret = JST_PARSE_OK;
 
-  int index = this->str_index + 1;
+  size_t index = this->str_index + 1;
   size_t head = this->top;
-
-  const char* cstr = this->str.c_str();
-  int cstr_length = this->str.size() + 1;
+  // in-situ mode decodes over the input itself; the output never overtakes the read position
+  // because every escape sequence is at least as long as the bytes it decodes to. Lazy mode
+  // only counts the decoded bytes and decodes escapes into a scratch buffer to validate them.
+  size_t start = index, out = index;
+  bool counting = this->insitu != nullptr || this->lazy;
+  char scratch[JST_ESCAPE_MAX];
+
+  const char* cstr = this->json;
+  size_t cstr_length = this->json_len + 1;
   while (index < cstr_length) {
     switch (cstr[index]) {
       case '\"': {
-        size_t len = this->top - head;
-        char* str_head = (char*)stack_pop(len);
-        s = std::move(JString(str_head, len));
+        size_t len = counting ? out - start : this->top - head;
+        if (options.max_string_length != 0 && len > options.max_string_length) {
+          this->top = head;
+          ret = JST_PARSE_EXCEED_MAX_STRING_LENGTH;
+          goto RET;
+        }
+        if (this->insitu != nullptr) {
+          this->insitu[out] = '\0';
+          s = JString::borrow(this->insitu + start, len);
+        } else if (this->lazy) {
+          s = JString::lazy(cstr + start, index - start, len);
+        } else if (len == 0) {
+          s = JString("", 0);
+        } else {
+          char* str_head = (char*)stack_pop(len);
+          s = std::move(JString(str_head, len));
+        }
         index++;
         goto RET;
       }
@@ -316,33 +429,70 @@ JRetType JParser::parser_string_base(JString& s) {
         ret = JST_PARSE_MISS_QUOTATION_MARK;
         goto RET;
       case '\\': {
-        if ((++index) >= cstr_length) {
-          ret = JST_PARSE_INVALID_VALUE;
-          goto RET;
-        }
-        std::vector<char> sp_char;
-        if (JST_PARSE_OK != (ret = parser_specifical_str(index, sp_char))) {
-          this->top = head;
-          goto RET;
+        // Escapes are decoded straight into the output, and a run of them (typical for
+        // \u-encoded text) is consumed back to back without returning to the dispatch.
+        for (;;) {
+          if ((++index) >= cstr_length) {
+            this->top = head;
+            ret = JST_PARSE_INVALID_VALUE;
+            goto RET;
+          }
+          char* dst = this->insitu != nullptr ? this->insitu + out
+                      : this->lazy            ? scratch
+                                              : (char*)this->stack_push(JST_ESCAPE_MAX);
+          char* end = dst;
+          if (JST_PARSE_OK != (ret = parser_specifical_str(index, end))) {
+            this->top = head;
+            goto RET;
+          }
+          if (counting)
+            out += end - dst;
+          else
+            this->top -= JST_ESCAPE_MAX - (end - dst);
+          if (cstr[index + 1] != '\\') break;
+          index++;
         }
-        for (int i = 0; i < sp_char.size(); i++)
-          *(char*)this->stack_push(sizeof(char)) = sp_char[i];
         break;
       }
       default: {
-        if (cstr[index] < 32 || cstr[index] == '"') {
+        unsigned char ch = (unsigned char)cstr[index];
+        if (ch < 0x20) {
+          this->top = head;
           ret = JST_PARSE_INVALID_STRING_CHAR;
           goto RET;
         }
-        char& c = *(char*)this->stack_push(sizeof(char));
-        c = cstr[index];
+        // Copy the whole run of ordinary bytes at once. With validation on, the run is also
+        // checked to be UTF-8 and ends before the first invalid sequence.
+        size_t run;
+        if (options.validate_utf8) {
+          run = jst_scan_plain_utf8(cstr + index, this->json_len - index);
+          if (run == 0) {
+            this->top = head;
+            ret = JST_PARSE_INVALID_UTF8;
+            goto RET;
+          }
+        } else {
+          run = 1 + jst_scan_plain(cstr + index + 1, this->json_len - index - 1, false);
+        }
+        if (this->insitu != nullptr) {
+          if (out != index) memmove(this->insitu + out, cstr + index, run);
+          out += run;
+        } else if (this->lazy) {
+          out += run;
+        } else {
+          memcpy(this->stack_push(run), cstr + index, run);
+        }
+        index += run - 1;
         break;
       }
     }
     index++;
   }
 RET:
-  if (ret == JST_PARSE_OK) this->str_index = index;
+  if (ret == JST_PARSE_OK)
+    this->str_index = index;
+  else
+    this->err_offset = std::min(index, this->json_len);
   return ret;
 }
 
@@ -356,11 +506,12 @@ JRetType JParser::parser_string(JNode& node) {
 }
 
 JRetType JParser::parser_array(JNode& node) {
-  JST_DEBUG(this->str[this->str_index++] == '[');
+  JST_DEBUG(this->json[this->str_index] == '[');
+  this->str_index++;
   JST_FUNCTION_STATE(JST_PARSE_OK, jst_ws_parser(JST_WS_BEFORE), node);
 
   auto ret = JST_PARSE_OK;
-  if (this->str[this->str_index] == ']') {
+  if (this->json[this->str_index] == ']') {
     node = JArray();
     this->str_index++;
     return ret;
@@ -370,7 +521,7 @@ JRetType JParser::parser_array(JNode& node) {
   size_t head = this->top;
   std::unique_ptr<JNode> jn = std::make_unique<JNode>(JNode());
   for (;;) {
-    if (this->str_index == this->str.size()) {
+    if (this->str_index == this->json_len) {
       if (size != 0) ret = JST_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
       break;
     }
@@ -385,17 +536,19 @@ JRetType JParser::parser_array(JNode& node) {
       break;
     }
 
-    auto stack_node = (JNode*)this->stack_push(sizeof(JNode));
-    *stack_node = std::move(*jn);
+    new (this->stack_push(sizeof(JNode))) JNode(std::move(*jn));
     size++;
 
-    if (this->str[this->str_index] == ',') {
+    if (this->json[this->str_index] == ',') {
       this->str_index++;
-    } else if (this->str[this->str_index] == ']') {
+    } else if (this->json[this->str_index] == ']') {
       this->str_index++;
       std::unique_ptr<JArray> arr(new JArray(size));
       JNode* arr_head = (JNode*)this->stack_pop(size * sizeof(JNode));
-      for (int i = 0; i < size; i++) (*arr)[i] = std::move(arr_head[i]);
+      for (size_t i = 0; i < size; i++) {
+        (*arr)[i] = std::move(arr_head[i]);
+        arr_head[i].~JNode();
+      }
       node = std::move(*arr);
       size = 0;
       break;
@@ -406,9 +559,9 @@ JRetType JParser::parser_array(JNode& node) {
   }
   if (ret != JST_PARSE_OK) {
     node = std::move(JNode(JST_NULL));
+    JNode* arr_head = (JNode*)(this->stack + head);
+    for (size_t i = 0; i < size; i++) arr_head[i].~JNode();
     this->top = head;
-  } else {
-    JST_FUNCTION_STATE(JST_PARSE_OK, jst_ws_parser(JST_WS_AFTER, JST_ARR), node);
   }
   return ret;
 }
@@ -418,7 +571,7 @@ JRetType JParser::parser_object_member(JOjectElement& objm) {
   std::unique_ptr<JString> s = std::make_unique<JString>(JString());
   std::unique_ptr<JNode> jn = std::make_unique<JNode>(JNode());
 
-  if (this->str[this->str_index] != '\"') {
+  if (this->json[this->str_index] != '\"') {
     return JST_PARSE_MISS_KEY;
   }
   ret = parser_string_base(*s);
@@ -430,7 +583,7 @@ JRetType JParser::parser_object_member(JOjectElement& objm) {
     return ret;
   }
 
-  if (this->str[this->str_index++] != ':') {
+  if (this->json[this->str_index++] != ':') {
     ret = JST_PARSE_MISS_COLON;
     return ret;
   }
@@ -446,21 +599,22 @@ JRetType JParser::parser_object_member(JOjectElement& objm) {
 }
 
 JRetType JParser::parser_object(JNode& node) {
-  JST_DEBUG(this->str[this->str_index++] == '{');
+  JST_DEBUG(this->json[this->str_index] == '{');
+  this->str_index++;
   JST_FUNCTION_STATE(JST_PARSE_OK, jst_ws_parser(JST_WS_BEFORE), node);
 
   JRetType ret = JST_PARSE_OK;
-  if (this->str[this->str_index] == '}') {
+  if (this->json[this->str_index] == '}') {
     node = JObject();
     this->str_index++;
     return ret;
   }
 
   size_t size = 0;
-  int head = this->top;
+  size_t head = this->top;
   std::unique_ptr<JOjectElement> objm = std::make_unique<JOjectElement>(JOjectElement());
   for (;;) {
-    if (this->str_index == this->str.size()) {
+    if (this->str_index == this->json_len) {
       if (size != 0) ret = JST_PARSE_MISS_KEY;
       break;
     }
@@ -474,19 +628,20 @@ JRetType JParser::parser_object(JNode& node) {
       break;
     }
 
-    JOjectElement* stack_node = (JOjectElement*)this->stack_push(sizeof(JOjectElement));
-    memset(stack_node, 0, sizeof(JOjectElement));
-    *stack_node = std::move(*objm);
+    new (this->stack_push(sizeof(JOjectElement))) JOjectElement(std::move(*objm));
     size++;
 
-    if (this->str[this->str_index] == ',') {
+    if (this->json[this->str_index] == ',') {
       this->str_index++;
-    } else if (this->str[this->str_index] == '}') {
+    } else if (this->json[this->str_index] == '}') {
       this->str_index++;
       std::unique_ptr<JObject> obj(new JObject(size));
       JOjectElement* objm_head = (JOjectElement*)this->stack_pop(size * sizeof(JOjectElement));
 
-      for (int i = 0; i < size; i++) (*obj)[i] = std::move(objm_head[i]);
+      for (size_t i = 0; i < size; i++) {
+        obj->push_back(std::move(objm_head[i]));
+        objm_head[i].~JOjectElement();
+      }
       node = std::move(*obj);
       break;
     } else {
@@ -495,24 +650,22 @@ JRetType JParser::parser_object(JNode& node) {
     }
   }
 
-  if (ret == JST_PARSE_OK) {
-    auto ret = jst_ws_parser(JST_WS_AFTER, JST_OBJ);
-    if (ret != JST_PARSE_OK) {
-      node = JNode(JST_NULL);
-      return ret;
-    }
-  } else {
+  if (ret != JST_PARSE_OK) {
     if (size != 0) {
       JOjectElement* objm_head = (JOjectElement*)this->stack_pop(size * sizeof(JOjectElement));
-      for (int i = 0; i < size; i++)
-        std::unique_ptr<JOjectElement> objm =
-            std::make_unique<JOjectElement>(std::move(objm_head[i]));
+      for (size_t i = 0; i < size; i++) objm_head[i].~JOjectElement();
     }
     this->top = head;
   }
   return ret;
 }
 
+JRetType JParser::parser_splice(JNode& node) {
+  node = std::move(this->splice);
+  this->str_index = this->splice_end;
+  return JST_PARSE_OK;
+}
+
 JRetType JParser::main_parser(JNode& node, bool is_local) {
   if (!is_local) {
     auto ret = jst_ws_parser(JST_WS_BEFORE);
@@ -522,8 +675,12 @@ JRetType JParser::main_parser(JNode& node, bool is_local) {
     }
   }
 
-  JRetType ret = JST_PARSE_OK;
-  switch (str[this->str_index]) {
+  JRetType ret = check_budget();
+  if (ret != JST_PARSE_OK) {
+    node = JNode(JST_NULL);
+    return ret;
+  }
+  switch (json[this->str_index]) {
     case 'n':
       ret = parser_symbol(node);
       break;
@@ -537,10 +694,22 @@ JRetType JParser::main_parser(JNode& node, bool is_local) {
       ret = parser_string(node);
       break;
     case '[':
-      ret = parser_array(node);
+      if (options.max_depth != 0 && this->depth >= options.max_depth) {
+        ret = JST_PARSE_EXCEED_MAX_DEPTH;
+        break;
+      }
+      this->depth++;
+      ret = this->str_index == this->splice_at ? parser_splice(node) : parser_array(node);
+      this->depth--;
       break;
     case '{':
-      ret = parser_object(node);
+      if (options.max_depth != 0 && this->depth >= options.max_depth) {
+        ret = JST_PARSE_EXCEED_MAX_DEPTH;
+        break;
+      }
+      this->depth++;
+      ret = this->str_index == this->splice_at ? parser_splice(node) : parser_object(node);
+      this->depth--;
       break;
     case '0' ... '9':
       ret = parser_number(node);
@@ -556,7 +725,7 @@ JRetType JParser::main_parser(JNode& node, bool is_local) {
   }
 
   if (!is_local && ret == JST_PARSE_OK) {
-    auto ret = jst_ws_parser(JST_WS_AFTER, node.type());
+    auto ret = jst_ws_parser(JST_WS_AFTER);
     if (ret != JST_PARSE_OK) {
       node = JNode(JST_NULL);
       return ret;
@@ -565,124 +734,48 @@ JRetType JParser::main_parser(JNode& node, bool is_local) {
   return ret;
 }
 
-#define PUT_STR(json, json_len)                         \
-  do {                                                  \
-    char* str_head = (char*)this->stack_push(json_len); \
-    memcpy(str_head, json, json_len);                   \
-  } while (0)
-
-#define PUT_C(json_c)                            \
-  do {                                           \
-    char* str_head = (char*)this->stack_push(1); \
-    *str_head = json_c;                          \
-  } while (0)
-
-void JParser::stringify_string(const JNode& jn) {
-  JST_DEBUG(jn.type() == JST_STR);
-  std::string str = jn.data().as<JString>().value();
-  const auto jstr = str.c_str();
-  const auto slen = str.size();
-  PUT_C('"');
-  for (int i = 0; i < slen; i++) {
-    unsigned char ch = (unsigned char)jstr[i];
-    switch (ch) {
-      case '\"':
-        PUT_STR("\\\"", 2);
-        break;
-      case '\n':
-        PUT_STR("\\n", 2);
-        break;
-      case '\\':
-        PUT_STR("\\\\", 2);
-        break;
-      case '\b':
-        PUT_STR("\\b", 2);
-        break;
-      case '\f':
-        PUT_STR("\\f", 2);
-        break;
-      case '\r':
-        PUT_STR("\\r", 2);
-        break;
-      case '\t':
-        PUT_STR("\\t", 2);
-        break;
-      default:
-        if (ch < 0x20) {
-          char buffer[7] = {0};
-          sprintf(buffer, "\\u%04x", ch);
-          PUT_STR(buffer, 6);
-        } else
-          PUT_C(jstr[i]);
-        break;
-    }
+// Every stringify is two passes: the exact length first, then one write into storage of that
+// size, so the output never grows while it is being written.
+size_t JParser::stringify_size(const JNode& jn, JStringifyPlan& plan) const {
+  if (options.stringify_threads != 1 &&
+      jst_stringify_plan(jn, options.stringify_threads, options.parallel_chunk, plan)) {
+    return plan.size;
   }
-  PUT_C('"');
+  return jst_stringify_size(jn);
 }
 
-JRetType JParser::stringify_value(const JNode& jn) {
-  JRetType ret = JST_STRINGIFY_OK;
-  switch (jn.type()) {
-    case JST_NULL:
-      PUT_STR("null", 4);
-      break;
-    case JST_TRUE:
-      PUT_STR("true", 4);
-      break;
-    case JST_FALSE:
-      PUT_STR("false", 5);
-      break;
-    case JST_STR:
-      stringify_string(jn);
-      break;
-    case JST_NUM: {
-      auto num = jn.data().as<JNumber>().value();
-      this->top -= (32 - sprintf((char*)this->stack_push(32), "%.17g", num));
-      break;
-    }
-    case JST_ARR: {
-      PUT_C('[');
-      auto arr = jn.data().as<JArray>().value();
-      size_t arr_len = arr.size();
-      for (int i = 0; i < arr_len; i++) {
-        if (i > 0) PUT_C(',');
-        stringify_value(arr[i]);
-      }
-      PUT_C(']');
-      break;
-    }
-    case JST_OBJ: {
-      PUT_C('{');
-      auto obj = jn.data().as<JObject>().value();
-      size_t obj_len = obj.size();
-      for (int i = 0; i < obj_len; i++) {
-        if (i > 0) PUT_C(',');
-        JString key = obj[i].get_key();
-        PUT_C('"');
-        PUT_STR(key.c_str(), key.size());
-        PUT_C('"');
-        PUT_C(':');
-        stringify_value(obj[i].get_value());
-      }
-      PUT_C('}');
-      break;
-    }
+void JParser::stringify_write(const JNode& jn, char* out, const JStringifyPlan& plan) const {
+  if (plan.first.empty()) {
+    jst_stringify_write(jn, out, options.cache_fragments);
+  } else {
+    jst_stringify_write(jn, out, plan, options.stringify_threads, options.cache_fragments);
   }
-  return ret;
 }
 
 JRetType JParser::stringify(const JNode& jn, char** json_str, size_t& len) {
-  JRetType ret = JST_STRINGIFY_OK;
   JST_DEBUG(json_str != nullptr);
   JST_DEBUG(this->top == 0);
-  if ((ret = stringify_value(jn)) != JST_STRINGIFY_OK) {
-    return ret;
-  }
-  if (this->top) {
-    len = this->top;
-  }
-  *json_str = (char*)this->stack_pop(this->top);
-  return ret;
+  JStringifyPlan plan;
+  len = stringify_size(jn, plan);
+  char* out = (char*)this->stack_push(len);
+  stringify_write(jn, out, plan);
+  *json_str = (char*)this->stack_pop(len);
+  return JST_STRINGIFY_OK;
+}
+
+JRetType JParser::stringify(const JNode& jn, std::string& json_str) {
+  JStringifyPlan plan;
+  json_str.resize(stringify_size(jn, plan));
+  stringify_write(jn, &json_str[0], plan);
+  return JST_STRINGIFY_OK;
+}
+
+JRetType JParser::stringify(const JNode& jn, char* buf, size_t capacity, size_t& len) {
+  JStringifyPlan plan;
+  len = stringify_size(jn, plan);
+  if (len > capacity) return JST_STRINGIFY_BUFFER_TOO_SMALL;
+  stringify_write(jn, buf, plan);
+  return JST_STRINGIFY_OK;
 }
 
 }  // namespace jst
\ No newline at end of file
@@ -0,0 +1,329 @@
+#include "patch.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "basic.h"
+#include "parser.h"
+
+namespace jst {
+
+#define JST_PATCH_NONE ((size_t)-1)
+
+// The unescaped reference tokens of a JSON Pointer; false when it is malformed.
+static bool jst_pointer_split(const std::string& pointer, std::vector<std::string>& tokens) {
+  tokens.clear();
+  if (pointer.empty()) return true;
+  if (pointer[0] != '/') return false;
+  std::string token;
+  for (size_t i = 1; i < pointer.size(); i++) {
+    char c = pointer[i];
+    if (c == '/') {
+      tokens.push_back(std::move(token));
+      token.clear();
+    } else if (c == '~') {
+      char e = i + 1 < pointer.size() ? pointer[++i] : '\0';
+      if (e != '0' && e != '1') return false;
+      token += e == '0' ? '~' : '/';
+    } else {
+      token += c;
+    }
+  }
+  tokens.push_back(std::move(token));
+  return true;
+}
+
+// An array index token: decimal without leading zeros, below size. With append, "-" and size
+// itself are allowed too and name the position after the last element.
+static bool jst_pointer_index(const std::string& token, size_t size, bool append, size_t& index) {
+  if (token == "-") {
+    index = size;
+    return append;
+  }
+  if (token.empty() || token.size() > 19 || (token[0] == '0' && token.size() > 1)) return false;
+  index = 0;
+  for (char c : token) {
+    if (c < '0' || c > '9') return false;
+    index = index * 10 + (size_t)(c - '0');
+  }
+  return append ? index <= size : index < size;
+}
+
+// The value at the first n tokens, nullptr if there is none.
+static const JNode* jst_pointer_walk(const JNode& root, const std::vector<std::string>& tokens,
+                                     size_t n) {
+  const JNode* v = &root;
+  for (size_t i = 0; i < n; i++) {
+    const std::string& token = tokens[i];
+    if (v->type() == JST_ARR) {
+      const JArray& arr = v->data().as<JArray>();
+      size_t index;
+      if (!jst_pointer_index(token, arr.size(), false, index)) return nullptr;
+      v = &arr[index];
+    } else if (v->type() == JST_OBJ) {
+      v = v->data().as<JObject>().find_value(JString(token.c_str(), token.size()));
+      if (v == nullptr) return nullptr;
+    } else {
+      return nullptr;
+    }
+  }
+  return v;
+}
+
+const JNode* jst_pointer_find(const JNode& root, const std::string& pointer) {
+  std::vector<std::string> tokens;
+  if (!jst_pointer_split(pointer, tokens)) return nullptr;
+  return jst_pointer_walk(root, tokens, tokens.size());
+}
+
+// The container holding the target of path, reached through the caller's own (non-const) tree.
+static JNode* jst_patch_parent(JNode& doc, const std::vector<std::string>& path) {
+  const JNode* parent = jst_pointer_walk(doc, path, path.size() - 1);
+  if (parent == nullptr || (parent->type() != JST_ARR && parent->type() != JST_OBJ)) {
+    return nullptr;
+  }
+  return const_cast<JNode*>(parent);
+}
+
+// A string member of a patch operation, nullptr if it is missing or not a string.
+static const JString* jst_patch_string(const JNode& entry, const char* name) {
+  const JNode* v = entry.data().as<JObject>().find_value(JString(name));
+  return v != nullptr && v->type() == JST_STR ? &v->data().as<JString>() : nullptr;
+}
+
+JRetType JPatch::compile(const JNode& patch, size_t* failed_op) {
+  ops.clear();
+  this->ready = false;
+  if (failed_op != nullptr) *failed_op = 0;
+  if (patch.type() != JST_ARR) return JST_PARSE_INVALID_PATCH;
+
+  const JArray& arr = patch.data().as<JArray>();
+  ops.reserve(arr.size());
+  for (size_t i = 0; i < arr.size(); i++) {
+    if (failed_op != nullptr) *failed_op = i;
+    const JNode& entry = arr[i];
+    if (entry.type() != JST_OBJ) return JST_PARSE_INVALID_PATCH;
+    const JString* name = jst_patch_string(entry, "op");
+    const JString* path = jst_patch_string(entry, "path");
+    if (name == nullptr || path == nullptr) return JST_PARSE_INVALID_PATCH;
+
+    Op op;
+    std::string kind = name->value();
+    if (kind == "add") {
+      op.kind = ADD;
+    } else if (kind == "remove") {
+      op.kind = REMOVE;
+    } else if (kind == "replace") {
+      op.kind = REPLACE;
+    } else if (kind == "move") {
+      op.kind = MOVE;
+    } else if (kind == "copy") {
+      op.kind = COPY;
+    } else if (kind == "test") {
+      op.kind = TEST;
+    } else {
+      return JST_PARSE_INVALID_PATCH;
+    }
+    if (!jst_pointer_split(path->value(), op.path)) return JST_PARSE_INVALID_PATCH;
+    // the document itself cannot be removed: there would be nothing left to hold a value.
+    if (op.kind == REMOVE && op.path.empty()) return JST_PARSE_INVALID_PATCH;
+
+    if (op.kind == MOVE || op.kind == COPY) {
+      const JString* from = jst_patch_string(entry, "from");
+      if (from == nullptr || !jst_pointer_split(from->value(), op.from)) {
+        return JST_PARSE_INVALID_PATCH;
+      }
+    } else if (op.kind != REMOVE) {
+      const JNode* value = entry.data().as<JObject>().find_value(JString("value"));
+      if (value == nullptr) return JST_PARSE_INVALID_PATCH;
+      op.value = *value;
+    }
+    ops.push_back(std::move(op));
+  }
+  this->ready = true;
+  return JST_PARSE_OK;
+}
+
+JRetType JPatch::compile(const std::string& patch, size_t* failed_op) {
+  ops.clear();
+  this->ready = false;
+  if (failed_op != nullptr) *failed_op = 0;
+  JParser jc(patch);
+  JRetType ret = jc.parser();
+  if (ret != JST_PARSE_OK) return ret;
+  return compile(jc.root, failed_op);
+}
+
+JRetType JPatch::apply(JNode& doc, size_t* failed_op) const {
+  if (!ready) return JST_PARSE_INVALID_PATCH;
+  std::vector<Undo> log;
+  log.reserve(ops.size() + 1);
+  for (size_t i = 0; i < ops.size(); i++) {
+    JRetType ret = apply_op(doc, ops[i], log);
+    if (ret != JST_PARSE_OK) {
+      rollback(doc, log);
+      if (failed_op != nullptr) *failed_op = i;
+      return ret;
+    }
+  }
+  return JST_PARSE_OK;
+}
+
+JRetType JPatch::apply_op(JNode& doc, const Op& op, std::vector<Undo>& log) const {
+  switch (op.kind) {
+    case ADD:
+    case REPLACE:
+      return put(doc, op.path, JNode(op.value), op.kind == REPLACE, log);
+    case REMOVE:
+      return take(doc, op.path, nullptr, log);
+    case MOVE: {
+      if (op.from == op.path) return JST_PARSE_OK;
+      // a value cannot be moved into one of its own children.
+      if (op.from.size() < op.path.size() &&
+          std::equal(op.from.begin(), op.from.end(), op.path.begin())) {
+        return JST_PARSE_PATH_NOT_FOUND;
+      }
+      JNode value;
+      JRetType ret = take(doc, op.from, &value, log);
+      if (ret != JST_PARSE_OK) return ret;
+      ret = put(doc, op.path, std::move(value), false, log);
+      if (ret != JST_PARSE_OK) {
+        // nowhere to put it: the removal gets to keep the value for the rollback.
+        log.back().value = std::move(value);
+        log.back().carried = false;
+      }
+      return ret;
+    }
+    case COPY: {
+      const JNode* src = jst_pointer_walk(doc, op.from, op.from.size());
+      if (src == nullptr) return JST_PARSE_PATH_NOT_FOUND;
+      return put(doc, op.path, JNode(*src), false, log);
+    }
+    default: {
+      const JNode* v = jst_pointer_walk(doc, op.path, op.path.size());
+      if (v == nullptr) return JST_PARSE_PATH_NOT_FOUND;
+      return *v == op.value ? JST_PARSE_OK : JST_PARSE_PATCH_TEST_FAILED;
+    }
+  }
+}
+
+// Remove the value at path into *out, or into the log when out is nullptr.
+JRetType JPatch::take(JNode& doc, const std::vector<std::string>& path, JNode* out,
+                      std::vector<Undo>& log) {
+  if (path.empty()) return JST_PARSE_PATH_NOT_FOUND;
+  JNode* parent = jst_patch_parent(doc, path);
+  if (parent == nullptr) return JST_PARSE_PATH_NOT_FOUND;
+
+  Undo u;
+  u.kind = Undo::REMOVED;
+  u.carried = out != nullptr;
+  JNode& value = out != nullptr ? *out : u.value;
+  if (parent->type() == JST_ARR) {
+    JArray& arr = parent->mutable_data().as<JArray>();
+    if (!jst_pointer_index(path.back(), arr.size(), false, u.index)) {
+      return JST_PARSE_PATH_NOT_FOUND;
+    }
+    value = std::move(arr[u.index]);
+    arr.erase(u.index);
+    u.container = &arr;
+  } else {
+    JObject& obj = parent->mutable_data().as<JObject>();
+    u.index = obj.find_index(JString(path.back().c_str(), path.back().size()));
+    if (u.index == JST_PATCH_NONE) return JST_PARSE_PATH_NOT_FOUND;
+    value = std::move(obj.get_value(u.index));
+    u.key = obj.get_key(u.index);
+    obj.erase(u.index);
+    u.container = &obj;
+  }
+  log.push_back(std::move(u));
+  return JST_PARSE_OK;
+}
+
+// Add value at path, or with replace overwrite the value that must already be there.
+JRetType JPatch::put(JNode& doc, const std::vector<std::string>& path, JNode&& value,
+                     bool replace, std::vector<Undo>& log) {
+  Undo u;
+  u.kind = Undo::REPLACED;
+  u.container = nullptr;
+  u.index = 0;
+  u.carried = false;
+  JNode* target = &doc;
+  if (!path.empty()) {
+    JNode* parent = jst_patch_parent(doc, path);
+    if (parent == nullptr) return JST_PARSE_PATH_NOT_FOUND;
+    const std::string& token = path.back();
+    if (parent->type() == JST_ARR) {
+      JArray& arr = parent->mutable_data().as<JArray>();
+      if (!jst_pointer_index(token, arr.size(), !replace, u.index)) {
+        return JST_PARSE_PATH_NOT_FOUND;
+      }
+      u.container = &arr;
+      if (replace) {
+        target = &arr[u.index];
+      } else {
+        arr.insert(u.index, std::move(value));
+        u.kind = Undo::INSERTED;
+        target = nullptr;
+      }
+    } else {
+      JObject& obj = parent->mutable_data().as<JObject>();
+      u.container = &obj;
+      u.index = obj.find_index(JString(token.c_str(), token.size()));
+      if (u.index != JST_PATCH_NONE) {
+        target = &obj.get_value(u.index);
+      } else if (replace) {
+        return JST_PARSE_PATH_NOT_FOUND;
+      } else {
+        u.index = obj.size();
+        obj.push_back(JOjectElement(JString(token.c_str(), token.size()), std::move(value)));
+        u.kind = Undo::INSERTED;
+        target = nullptr;
+      }
+    }
+  }
+  if (target != nullptr) {
+    u.value = std::move(*target);
+    *target = std::move(value);
+  }
+  log.push_back(std::move(u));
+  return JST_PARSE_OK;
+}
+
+// Undo the log backwards. Each entry sees the tree exactly as its edit left it, so the recorded
+// containers and positions are still valid: containers live behind shared pointers and keep
+// their address while the nodes holding them are moved around. A value taken out again on the
+// way back is passed on to the removal that a move started with.
+void JPatch::rollback(JNode& doc, std::vector<Undo>& log) {
+  JNode carry;
+  for (size_t i = log.size(); i-- > 0;) {
+    Undo& u = log[i];
+    JArray* arr = dynamic_cast<JArray*>(u.container);
+    JObject* obj = dynamic_cast<JObject*>(u.container);
+    if (u.kind == Undo::INSERTED) {
+      if (arr != nullptr) {
+        carry = std::move((*arr)[u.index]);
+        arr->erase(u.index);
+      } else {
+        carry = std::move(obj->get_value(u.index));
+        obj->erase(u.index);
+      }
+    } else if (u.kind == Undo::REMOVED) {
+      JNode value = u.carried ? std::move(carry) : std::move(u.value);
+      if (arr != nullptr) {
+        arr->insert(u.index, std::move(value));
+      } else {
+        obj->insert(u.index, JOjectElement(std::move(u.key), std::move(value)));
+      }
+    } else {
+      JNode& target = arr != nullptr ? (*arr)[u.index]
+                      : obj != nullptr ? obj->get_value(u.index)
+                                       : doc;
+      carry = std::move(target);
+      target = std::move(u.value);
+    }
+  }
+  log.clear();
+}
+
+}  // namespace jst
@@ -0,0 +1,646 @@
+#include "pattern.h"
+
+#include <algorithm>
+
+#include "utf8.h"
+
+namespace jst {
+
+enum {
+  JST_RE_CHAR = 0,  // x: code point
+  JST_RE_ANY,       // anything but a line terminator
+  JST_RE_CLASS,     // x: index into classes
+  JST_RE_SPLIT,     // go on at x and at y
+  JST_RE_JMP,       // go on at x
+  JST_RE_BOL,
+  JST_RE_EOL,
+  JST_RE_WORD,
+  JST_RE_NOT_WORD,
+  JST_RE_MATCH,
+};
+
+static const uint32_t JST_RE_MAX_CP = 0x10FFFF;
+// stands for the missing neighbour of the first and past the last code point.
+static const uint32_t JST_RE_NONE = 0xFFFFFFFF;
+static const size_t JST_RE_MAX_INSTS = 65536;
+static const int JST_RE_MAX_REPEAT = 1000;
+static const int JST_RE_MAX_DEPTH = 256;
+
+namespace {
+
+// Parsed pattern, turned into instructions by JPatternCompiler::emit.
+struct JPatternAst {
+  enum Kind { EMPTY, INST, CAT, ALT, REPEAT } kind = EMPTY;
+  uint8_t op = 0;
+  uint32_t x = 0;
+  int min = 0, max = 0;  // max -1: unbounded
+  std::vector<JPatternAst> kids;
+};
+
+typedef std::vector<JPattern::Range> JPatternSet;
+
+static void jst_re_add(JPatternSet& set, uint32_t lo, uint32_t hi) { set.push_back({lo, hi}); }
+
+static void jst_re_normalize(JPatternSet& set) {
+  std::sort(set.begin(), set.end(),
+            [](const JPattern::Range& a, const JPattern::Range& b) { return a.lo < b.lo; });
+  JPatternSet merged;
+  for (const auto& r : set) {
+    if (!merged.empty() && r.lo <= merged.back().hi + 1) {
+      merged.back().hi = std::max(merged.back().hi, r.hi);
+    } else {
+      merged.push_back(r);
+    }
+  }
+  set.swap(merged);
+}
+
+static void jst_re_negate(JPatternSet& set) {
+  jst_re_normalize(set);
+  JPatternSet out;
+  uint32_t next = 0;
+  for (const auto& r : set) {
+    if (r.lo > next) out.push_back({next, r.lo - 1});
+    next = r.hi + 1;
+  }
+  if (next <= JST_RE_MAX_CP) out.push_back({next, JST_RE_MAX_CP});
+  set.swap(out);
+}
+
+// \d, \w and \s, and their negations for upper-case letters.
+static void jst_re_builtin(char c, JPatternSet& out) {
+  JPatternSet set;
+  switch (c | 0x20) {
+    case 'd':
+      jst_re_add(set, '0', '9');
+      break;
+    case 'w':
+      jst_re_add(set, '0', '9');
+      jst_re_add(set, 'A', 'Z');
+      jst_re_add(set, '_', '_');
+      jst_re_add(set, 'a', 'z');
+      break;
+    default:
+      jst_re_add(set, '\t', '\r');
+      jst_re_add(set, ' ', ' ');
+      jst_re_add(set, 0xA0, 0xA0);
+      jst_re_add(set, 0x1680, 0x1680);
+      jst_re_add(set, 0x2000, 0x200A);
+      jst_re_add(set, 0x2028, 0x2029);
+      jst_re_add(set, 0x202F, 0x202F);
+      jst_re_add(set, 0x205F, 0x205F);
+      jst_re_add(set, 0x3000, 0x3000);
+      jst_re_add(set, 0xFEFF, 0xFEFF);
+      break;
+  }
+  if (c >= 'A' && c <= 'Z') jst_re_negate(set);
+  out.insert(out.end(), set.begin(), set.end());
+}
+
+static bool jst_re_is_word(uint32_t c) {
+  return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_';
+}
+
+// One code point of s at i, and its length; a byte that starts no valid sequence is itself.
+static uint32_t jst_re_decode(const char* s, size_t len, size_t i, size_t& width) {
+  const unsigned char* p = (const unsigned char*)s + i;
+  width = jst_utf8_sequence(p, len - i);
+  switch (width) {
+    case 2:
+      return ((p[0] & 0x1Fu) << 6) | (p[1] & 0x3Fu);
+    case 3:
+      return ((p[0] & 0x0Fu) << 12) | ((p[1] & 0x3Fu) << 6) | (p[2] & 0x3Fu);
+    case 4:
+      return ((p[0] & 0x07u) << 18) | ((p[1] & 0x3Fu) << 12) | ((p[2] & 0x3Fu) << 6) |
+             (p[3] & 0x3Fu);
+    default:
+      width = 1;
+      return p[0];
+  }
+}
+
+// Recursive descent over the pattern (its nesting is bounded by JST_RE_MAX_DEPTH), then a
+// Thompson construction of the program.
+class JPatternCompiler {
+ public:
+  JPatternCompiler(const char* p, size_t len, std::vector<JPattern::Inst>& prog,
+                   std::vector<JPatternSet>& classes)
+      : p(p), len(len), prog(prog), classes(classes) {}
+
+  bool run() {
+    JPatternAst ast;
+    if (!alt(ast)) return false;
+    if (i != len) return false;  // a ')' without '('
+    emit(ast);
+    if (prog.size() >= JST_RE_MAX_INSTS) return false;
+    prog.push_back({JST_RE_MATCH, 0, 0});
+    return true;
+  }
+
+  size_t i = 0;
+
+ private:
+  bool more() const { return i < len; }
+  bool peek(char c) const { return i < len && p[i] == c; }
+
+  bool alt(JPatternAst& out) {
+    JPatternAst first;
+    if (!cat(first)) return false;
+    if (!peek('|')) {
+      out = std::move(first);
+      return true;
+    }
+    out.kind = JPatternAst::ALT;
+    out.kids.push_back(std::move(first));
+    while (peek('|')) {
+      i++;
+      JPatternAst next;
+      if (!cat(next)) return false;
+      out.kids.push_back(std::move(next));
+    }
+    return true;
+  }
+
+  bool cat(JPatternAst& out) {
+    out.kind = JPatternAst::CAT;
+    while (more() && p[i] != '|' && p[i] != ')') {
+      JPatternAst a;
+      if (!atom(a) || !quantifier(a)) return false;
+      out.kids.push_back(std::move(a));
+    }
+    return true;
+  }
+
+  bool number(int& n) {
+    if (!more() || p[i] < '0' || p[i] > '9') return false;
+    n = 0;
+    while (more() && p[i] >= '0' && p[i] <= '9') {
+      n = std::min(n * 10 + (p[i++] - '0'), JST_RE_MAX_REPEAT + 1);
+    }
+    return true;
+  }
+
+  // {n}, {n,} or {n,m} at i; false, with i unchanged, if there is none.
+  bool braces(int& min, int& max) {
+    size_t start = i;
+    i++;
+    if (number(min)) {
+      max = min;
+      if (peek(',')) {
+        i++;
+        max = -1;
+        if (more() && p[i] != '}' && !number(max)) max = -2;
+      }
+      if (max != -2 && peek('}')) {
+        i++;
+        return true;
+      }
+    }
+    i = start;
+    return false;
+  }
+
+  bool quantifier(JPatternAst& a) {
+    if (!more()) return true;
+    int min, max;
+    switch (p[i]) {
+      case '*':
+        min = 0, max = -1;
+        i++;
+        break;
+      case '+':
+        min = 1, max = -1;
+        i++;
+        break;
+      case '?':
+        min = 0, max = 1;
+        i++;
+        break;
+      case '{':
+        if (!braces(min, max)) return true;
+        if (min > JST_RE_MAX_REPEAT || max > JST_RE_MAX_REPEAT || (max >= 0 && max < min)) {
+          return false;
+        }
+        break;
+      default:
+        return true;
+    }
+    if (a.kind == JPatternAst::INST && a.op >= JST_RE_BOL) return false;  // nothing to repeat
+    if (peek('?')) i++;
+    if (more() && (p[i] == '*' || p[i] == '+' || p[i] == '?')) return false;
+    JPatternAst rep;
+    rep.kind = JPatternAst::REPEAT;
+    rep.min = min;
+    rep.max = max;
+    rep.kids.push_back(std::move(a));
+    a = std::move(rep);
+    return true;
+  }
+
+  static JPatternAst inst(uint8_t op, uint32_t x = 0) {
+    JPatternAst a;
+    a.kind = JPatternAst::INST;
+    a.op = op;
+    a.x = x;
+    return a;
+  }
+
+  JPatternAst set(JPatternSet&& ranges) {
+    jst_re_normalize(ranges);
+    classes.push_back(std::move(ranges));
+    return inst(JST_RE_CLASS, (uint32_t)(classes.size() - 1));
+  }
+
+  bool atom(JPatternAst& out) {
+    char c = p[i];
+    switch (c) {
+      case '(':
+        return group(out);
+      case '[':
+        return bracket(out);
+      case '.':
+        i++;
+        out = inst(JST_RE_ANY);
+        return true;
+      case '^':
+        i++;
+        out = inst(JST_RE_BOL);
+        return true;
+      case '$':
+        i++;
+        out = inst(JST_RE_EOL);
+        return true;
+      case '*':
+      case '+':
+      case '?':
+        return false;
+      case '{': {
+        int min, max;
+        if (braces(min, max)) return false;  // a quantifier with nothing before it
+        i++;
+        out = inst(JST_RE_CHAR, '{');
+        return true;
+      }
+      case '\\': {
+        i++;
+        if (!more()) return false;
+        if (p[i] == 'b' || p[i] == 'B') {
+          out = inst(p[i++] == 'b' ? JST_RE_WORD : JST_RE_NOT_WORD);
+          return true;
+        }
+        JPatternSet ranges;
+        uint32_t cp;
+        if (!escape(false, cp, ranges)) return false;
+        out = cp != JST_RE_NONE ? inst(JST_RE_CHAR, cp) : set(std::move(ranges));
+        return true;
+      }
+      default: {
+        size_t width;
+        out = inst(JST_RE_CHAR, jst_re_decode(p, len, i, width));
+        i += width;
+        return true;
+      }
+    }
+  }
+
+  bool group(JPatternAst& out) {
+    i++;
+    if (peek('?')) {
+      i++;
+      if (peek(':')) {
+        i++;
+      } else if (peek('<') && i + 1 < len && p[i + 1] != '=' && p[i + 1] != '!') {
+        // a named group; nothing refers to its name
+        while (more() && p[i] != '>') i++;
+        if (!more()) return false;
+        i++;
+      } else {
+        return false;  // lookaround
+      }
+    }
+    if (++depth > JST_RE_MAX_DEPTH) return false;
+    if (!alt(out) || !peek(')')) return false;
+    depth--;
+    i++;
+    return true;
+  }
+
+  bool hex(size_t digits, uint32_t& cp) {
+    if (len - i < digits) return false;
+    cp = 0;
+    for (size_t k = 0; k < digits; k++) {
+      int h = jst_hex_table[(unsigned char)p[i + k]];
+      if (h < 0) return false;
+      cp = (cp << 4) | h;
+    }
+    i += digits;
+    return true;
+  }
+
+  // The escape after a backslash, i at its first character: one code point in cp, or a set of
+  // them in ranges with cp = JST_RE_NONE.
+  bool escape(bool in_class, uint32_t& cp, JPatternSet& ranges) {
+    char c = p[i++];
+    cp = JST_RE_NONE;
+    switch (c) {
+      case 'd':
+      case 'D':
+      case 'w':
+      case 'W':
+      case 's':
+      case 'S':
+        jst_re_builtin(c, ranges);
+        return true;
+      case 't':
+        cp = '\t';
+        return true;
+      case 'n':
+        cp = '\n';
+        return true;
+      case 'v':
+        cp = '\v';
+        return true;
+      case 'f':
+        cp = '\f';
+        return true;
+      case 'r':
+        cp = '\r';
+        return true;
+      case 'b':
+        cp = '\b';  // only reached inside a class
+        return in_class;
+      case '0':
+        cp = 0;
+        return !(more() && p[i] >= '0' && p[i] <= '9');
+      case 'c':
+        if (!more() || !((p[i] | 0x20) >= 'a' && (p[i] | 0x20) <= 'z')) return false;
+        cp = p[i++] % 32;
+        return true;
+      case 'x':
+        return hex(2, cp);
+      case 'u': {
+        if (peek('{')) {
+          i++;
+          cp = 0;
+          size_t start = i;
+          while (more() && p[i] != '}') {
+            int h = jst_hex_table[(unsigned char)p[i++]];
+            if (h < 0 || (cp = (cp << 4) | h) > JST_RE_MAX_CP) return false;
+          }
+          if (!more() || i == start) return false;
+          i++;
+          return true;
+        }
+        if (!hex(4, cp)) return false;
+        uint32_t low;
+        size_t at = i;
+        if (cp >= 0xD800 && cp <= 0xDBFF && len - i >= 6 && p[i] == '\\' && p[i + 1] == 'u') {
+          i += 2;
+          if (hex(4, low) && low >= 0xDC00 && low <= 0xDFFF) {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+          } else {
+            i = at;
+          }
+        }
+        return true;
+      }
+      default: {
+        // backreferences and unknown letter escapes; any other character stands for itself
+        if ((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')) {
+          return false;
+        }
+        size_t width;
+        cp = jst_re_decode(p, len, i - 1, width);
+        i += width - 1;
+        return true;
+      }
+    }
+  }
+
+  bool bracket(JPatternAst& out) {
+    i++;
+    bool negate = peek('^');
+    if (negate) i++;
+    JPatternSet ranges;
+    while (more() && p[i] != ']') {
+      uint32_t lo;
+      if (!member(lo, ranges)) return false;
+      if (peek('-') && i + 1 < len && p[i + 1] != ']') {
+        i++;
+        uint32_t hi;
+        if (lo == JST_RE_NONE || !member(hi, ranges) || hi == JST_RE_NONE || hi < lo) {
+          return false;
+        }
+        jst_re_add(ranges, lo, hi);
+      } else if (lo != JST_RE_NONE) {
+        jst_re_add(ranges, lo, lo);
+      }
+    }
+    if (!more()) return false;
+    i++;
+    if (negate) jst_re_negate(ranges);
+    out = set(std::move(ranges));
+    return true;
+  }
+
+  // One member of a class: a code point in cp, or (cp = JST_RE_NONE) a set added to ranges.
+  bool member(uint32_t& cp, JPatternSet& ranges) {
+    if (p[i] == '\\') {
+      i++;
+      if (!more()) return false;
+      if (p[i] == '-') {
+        i++;
+        cp = '-';
+        return true;
+      }
+      return escape(true, cp, ranges);
+    }
+    size_t width;
+    cp = jst_re_decode(p, len, i, width);
+    i += width;
+    return true;
+  }
+
+  void push(uint8_t op, uint32_t x = 0, uint32_t y = 0) {
+    if (prog.size() < JST_RE_MAX_INSTS) prog.push_back({op, x, y});
+  }
+  uint32_t pc() const { return (uint32_t)prog.size(); }
+
+  // Stops adding once the program is full, which run() reports.
+  void emit(const JPatternAst& a) {
+    if (prog.size() >= JST_RE_MAX_INSTS) return;
+    switch (a.kind) {
+      case JPatternAst::EMPTY:
+        return;
+      case JPatternAst::INST:
+        push(a.op, a.x);
+        return;
+      case JPatternAst::CAT:
+        for (const auto& k : a.kids) emit(k);
+        return;
+      case JPatternAst::ALT: {
+        std::vector<uint32_t> jumps;
+        for (size_t k = 0; k + 1 < a.kids.size(); k++) {
+          uint32_t split = pc();
+          push(JST_RE_SPLIT, split + 1);
+          emit(a.kids[k]);
+          jumps.push_back(pc());
+          push(JST_RE_JMP);
+          if (split < prog.size()) prog[split].y = pc();
+        }
+        emit(a.kids.back());
+        for (uint32_t j : jumps) {
+          if (j < prog.size()) prog[j].x = pc();
+        }
+        return;
+      }
+      case JPatternAst::REPEAT: {
+        for (int k = 0; k < a.min; k++) emit(a.kids[0]);
+        if (a.max < 0) {
+          uint32_t loop = pc();
+          push(JST_RE_SPLIT, loop + 1);
+          emit(a.kids[0]);
+          push(JST_RE_JMP, loop);
+          if (loop < prog.size()) prog[loop].y = pc();
+          return;
+        }
+        std::vector<uint32_t> splits;
+        for (int k = a.min; k < a.max; k++) {
+          splits.push_back(pc());
+          push(JST_RE_SPLIT, pc() + 1);
+          emit(a.kids[0]);
+        }
+        for (uint32_t s : splits) {
+          if (s < prog.size()) prog[s].y = pc();
+        }
+        return;
+      }
+    }
+  }
+
+  const char* p;
+  size_t len;
+  int depth = 0;
+  std::vector<JPattern::Inst>& prog;
+  std::vector<JPatternSet>& classes;
+};
+
+}  // namespace
+
+JRetType JPattern::compile(const char* pattern, size_t len, size_t* err_offset) {
+  prog.clear();
+  classes.clear();
+  JPatternCompiler c(pattern, len, prog, classes);
+  if (!c.run()) {
+    prog.clear();
+    classes.clear();
+    if (err_offset != nullptr) *err_offset = c.i;
+    return JST_PARSE_INVALID_SCHEMA;
+  }
+  return JST_PARSE_OK;
+}
+
+namespace {
+
+// The states live at one position of the input, each added once.
+struct JPatternThreads {
+  std::vector<uint32_t> pcs;
+  std::vector<size_t> seen;  // step at which each state was last added
+};
+
+}  // namespace
+
+bool JPattern::search(const char* s, size_t len) const {
+  if (prog.empty()) return false;
+  const size_t m = prog.size();
+  JPatternThreads cur, next;
+  cur.pcs.reserve(m);
+  next.pcs.reserve(m);
+  std::vector<size_t> seen(m, (size_t)-1);
+  std::vector<uint32_t> stack;
+
+  // Follow the jumps and assertions from pc at the position between prev and here (JST_RE_NONE
+  // at either end of the input); true as soon as MATCH is reached.
+  auto add = [&](std::vector<uint32_t>& list, uint32_t start, size_t step, uint32_t prev,
+                 uint32_t here) {
+    stack.push_back(start);
+    while (!stack.empty()) {
+      uint32_t pc = stack.back();
+      stack.pop_back();
+      if (seen[pc] == step) continue;
+      seen[pc] = step;
+      const Inst& in = prog[pc];
+      switch (in.op) {
+        case JST_RE_JMP:
+          stack.push_back(in.x);
+          break;
+        case JST_RE_SPLIT:
+          stack.push_back(in.y);
+          stack.push_back(in.x);
+          break;
+        case JST_RE_BOL:
+          if (prev == JST_RE_NONE) stack.push_back(pc + 1);
+          break;
+        case JST_RE_EOL:
+          if (here == JST_RE_NONE) stack.push_back(pc + 1);
+          break;
+        case JST_RE_WORD:
+        case JST_RE_NOT_WORD:
+          if ((jst_re_is_word(prev) != jst_re_is_word(here)) == (in.op == JST_RE_WORD)) {
+            stack.push_back(pc + 1);
+          }
+          break;
+        case JST_RE_MATCH:
+          stack.clear();
+          return true;
+        default:
+          list.push_back(pc);
+          break;
+      }
+    }
+    return false;
+  };
+
+  // a pattern starting with ^ can only match from the first position
+  const bool anchored = prog[0].op == JST_RE_BOL;
+  size_t pos = 0, width = 0, step = 0;
+  uint32_t prev = JST_RE_NONE;
+  uint32_t here = len != 0 ? jst_re_decode(s, len, 0, width) : JST_RE_NONE;
+  if (add(cur.pcs, 0, step, prev, here)) return true;
+  while (pos < len && !(anchored && cur.pcs.empty())) {
+    size_t at = pos + width, next_width = 0;
+    uint32_t after = at < len ? jst_re_decode(s, len, at, next_width) : JST_RE_NONE;
+    step++;
+    next.pcs.clear();
+    for (uint32_t pc : cur.pcs) {
+      const Inst& in = prog[pc];
+      bool ok;
+      switch (in.op) {
+        case JST_RE_CHAR:
+          ok = here == in.x;
+          break;
+        case JST_RE_ANY:
+          ok = here != '\n' && here != '\r' && here != 0x2028 && here != 0x2029;
+          break;
+        default: {
+          const std::vector<Range>& set = classes[in.x];
+          auto it = std::upper_bound(set.begin(), set.end(), here,
+                                     [](uint32_t c, const Range& r) { return c < r.lo; });
+          ok = it != set.begin() && here <= (it - 1)->hi;
+          break;
+        }
+      }
+      if (ok && add(next.pcs, pc + 1, step, here, after)) return true;
+    }
+    // a match may also start here
+    if (!anchored && add(next.pcs, 0, step, here, after)) return true;
+    std::swap(cur, next);
+    prev = here;
+    here = after;
+    pos = at;
+    width = next_width;
+  }
+  return false;
+}
+
+}  // namespace jst
@@ -0,0 +1,185 @@
+#include "reader.h"
+
+#include <assert.h>
+
+#include "utf8.h"
+
+namespace jst {
+
+JReader::JReader(const char* json, size_t len, const JParserOptions& opts) : p("", opts) {
+  p.reset(json, len);
+  p.lazy = true;
+  p.err_offset = JST_NO_ERROR_OFFSET;
+  if (opts.max_bytes != 0 && len > opts.max_bytes) {
+    p.err_offset = opts.max_bytes;
+    fail(JST_PARSE_EXCEED_MAX_BYTES);
+  }
+}
+
+JTokenType JReader::fail(JRetType ret) {
+  // string errors record their own position; everything else stops at the cursor.
+  if (p.err_offset == JST_NO_ERROR_OFFSET) p.err_offset = p.str_index;
+  this->err = ret;
+  return this->tok = JST_TOKEN_ERROR;
+}
+
+void JReader::skip_ws() {
+  const char* json = p.json;
+  size_t i = p.str_index;
+  while (json[i] == ' ' || json[i] == '\n' || json[i] == '\t' || json[i] == '\r') i++;
+  p.str_index = i;
+}
+
+JTokenType JReader::next() {
+  if (this->tok == JST_TOKEN_END || this->tok == JST_TOKEN_ERROR) return this->tok;
+  skip_ws();
+  this->tok_pos = p.str_index;
+
+  if (levels.empty()) {
+    if (!this->has_root) {
+      this->has_root = true;
+      return this->tok = value();
+    }
+    if (p.str_index != p.json_len) return fail(JST_PARSE_SINGULAR);
+    return this->tok = JST_TOKEN_END;
+  }
+
+  Level& level = levels.back();
+  if (level.want_value) {
+    level.want_value = false;
+    return this->tok = value();
+  }
+
+  char c = p.json[p.str_index];
+  if (c == (level.is_object ? '}' : ']')) {
+    p.str_index++;
+    bool is_object = level.is_object;
+    levels.pop_back();
+    return this->tok = is_object ? JST_TOKEN_END_OBJECT : JST_TOKEN_END_ARRAY;
+  }
+  if (!level.empty) {
+    if (c != ',') {
+      return fail(level.is_object ? JST_PARSE_MISS_COMMA_OR_CURLY_BRACKET
+                                  : JST_PARSE_MISS_COMMA_OR_SQUARE_BRACKET);
+    }
+    p.str_index++;
+    skip_ws();
+    this->tok_pos = p.str_index;
+  }
+  level.empty = false;
+  if (!level.is_object) return this->tok = value();
+
+  if (p.json[p.str_index] != '\"') return fail(JST_PARSE_MISS_KEY);
+  this->raw_pos = p.str_index + 1;
+  JRetType ret = p.parser_string_base(this->str);
+  if (ret != JST_PARSE_OK) return fail(ret);
+  this->raw_len = p.str_index - 1 - this->raw_pos;
+  skip_ws();
+  if (p.json[p.str_index] != ':') return fail(JST_PARSE_MISS_COLON);
+  p.str_index++;
+  level.want_value = true;
+  return this->tok = JST_TOKEN_KEY;
+}
+
+JTokenType JReader::value() {
+  if (p.str_index == p.json_len) return fail(JST_PARSE_EXCEPT_VALUE);
+
+  JRetType ret;
+  switch (p.json[p.str_index]) {
+    case '{':
+    case '[': {
+      if (p.options.max_depth != 0 && levels.size() >= p.options.max_depth) {
+        return fail(JST_PARSE_EXCEED_MAX_DEPTH);
+      }
+      bool is_object = p.json[p.str_index] == '{';
+      levels.push_back({is_object, true, false});
+      p.str_index++;
+      return is_object ? JST_TOKEN_BEGIN_OBJECT : JST_TOKEN_BEGIN_ARRAY;
+    }
+    case '\"':
+      this->raw_pos = p.str_index + 1;
+      ret = p.parser_string_base(this->str);
+      if (ret != JST_PARSE_OK) return fail(ret);
+      this->raw_len = p.str_index - 1 - this->raw_pos;
+      return JST_TOKEN_STRING;
+    case 't':
+    case 'f':
+    case 'n': {
+      JNode symbol;
+      ret = p.parser_symbol(symbol);
+      if (ret != JST_PARSE_OK) return fail(ret);
+      return symbol.type() == JST_TRUE    ? JST_TOKEN_TRUE
+             : symbol.type() == JST_FALSE ? JST_TOKEN_FALSE
+                                          : JST_TOKEN_NULL;
+    }
+    default: {
+      char c = p.json[p.str_index];
+      if (c != '-' && (unsigned)(c - '0') >= 10) return fail(JST_PARSE_INVALID_VALUE);
+      size_t len = p.number_length();
+      ret = JNumber::from_text(p.json + p.str_index, len, this->num);
+      if (ret != JST_PARSE_OK) return fail(ret);
+      this->raw_pos = p.str_index;
+      this->raw_len = len;
+      p.str_index += len;
+      return JST_TOKEN_NUMBER;
+    }
+  }
+}
+
+JRetType JReader::skip() {
+  if (this->tok == JST_TOKEN_KEY) next();
+  if (this->tok == JST_TOKEN_BEGIN_OBJECT || this->tok == JST_TOKEN_BEGIN_ARRAY) {
+    return skip_container();
+  }
+  return this->err;
+}
+
+// Bracket counting only: strings are stepped over with the same scan the parser uses, so a
+// bracket inside a string is never counted, but nothing else in the subtree is checked.
+JRetType JReader::skip_container() {
+  const char* json = p.json;
+  const size_t end = p.json_len;
+  size_t i = p.str_index, nest = 1;
+  char close = 0;
+  while (i < end) {
+    char c = json[i++];
+    if (c == '\"') {
+      for (;;) {
+        if (i < end) i += jst_scan_plain(json + i, end - i, false);
+        if (i >= end) {
+          p.str_index = end;
+          fail(JST_PARSE_MISS_QUOTATION_MARK);
+          return this->err;
+        }
+        if (json[i] == '\"') break;
+        if (json[i] != '\\') {
+          p.str_index = i;
+          fail(JST_PARSE_INVALID_STRING_CHAR);
+          return this->err;
+        }
+        i += 2;
+      }
+      i++;
+    } else if (c == '[' || c == '{') {
+      nest++;
+    } else if ((c == ']' || c == '}') && --nest == 0) {
+      close = c;
+      break;
+    }
+  }
+
+  bool is_object = levels.back().is_object;
+  if (close != (is_object ? '}' : ']')) {
+    p.str_index = close == 0 ? end : i - 1;
+    fail(is_object ? JST_PARSE_MISS_COMMA_OR_CURLY_BRACKET
+                   : JST_PARSE_MISS_COMMA_OR_SQUARE_BRACKET);
+    return this->err;
+  }
+  p.str_index = i;
+  this->tok_pos = i - 1;
+  levels.pop_back();
+  this->tok = is_object ? JST_TOKEN_END_OBJECT : JST_TOKEN_END_ARRAY;
+  return JST_PARSE_OK;
+}
+
+}  // namespace jst
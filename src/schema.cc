@@ -0,0 +1,671 @@
+#include "schema.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "basic.h"
+
+namespace jst {
+
+#define JST_SCHEMA_NULL 0x01
+#define JST_SCHEMA_BOOLEAN 0x02
+#define JST_SCHEMA_OBJECT 0x04
+#define JST_SCHEMA_ARRAY 0x08
+#define JST_SCHEMA_NUMBER 0x10
+#define JST_SCHEMA_INTEGER 0x20
+#define JST_SCHEMA_STRING 0x40
+
+#define JST_SCHEMA_MINIMUM 0x01
+#define JST_SCHEMA_MAXIMUM 0x02
+#define JST_SCHEMA_EXCLUSIVE_MINIMUM 0x04
+#define JST_SCHEMA_EXCLUSIVE_MAXIMUM 0x08
+
+// compile_node() result for a schema that does not compile.
+static const int32_t JST_SCHEMA_INVALID = -3;
+
+// One reference token of a JSON Pointer.
+static std::string jst_pointer_token(const char* s, size_t len) {
+  std::string token = "/";
+  for (size_t i = 0; i < len; i++) {
+    if (s[i] == '~') {
+      token += "~0";
+    } else if (s[i] == '/') {
+      token += "~1";
+    } else {
+      token += s[i];
+    }
+  }
+  return token;
+}
+
+static JRetType jst_schema_fail(JSchemaError* err, const char* keyword, size_t offset = 0) {
+  if (err != nullptr) {
+    err->path.clear();
+    err->keyword = keyword;
+    err->offset = offset;
+  }
+  return JST_PARSE_SCHEMA_VIOLATION;
+}
+
+// On the way back up from a violation, put the step into this value in front of the path.
+static JRetType jst_schema_step(JRetType ret, JSchemaError* err, const std::string& token) {
+  if (ret == JST_PARSE_SCHEMA_VIOLATION && err != nullptr) err->path.insert(0, token);
+  return ret;
+}
+
+static JRetType jst_schema_invalid(JSchemaError* err, const std::string& path) {
+  if (err != nullptr) {
+    err->path = path;
+    err->keyword.clear();
+    err->offset = 0;
+  }
+  return JST_PARSE_INVALID_SCHEMA;
+}
+
+static bool jst_schema_is_integer(const JNumber& num) {
+  if (num.is_int()) return true;
+  double d = num.value();
+  return isfinite(d) && d == floor(d);
+}
+
+// Array and object nesting of a value, 0 for a scalar.
+static size_t jst_schema_depth(const JNode& v) {
+  size_t depth = 0;
+  if (v.type() == JST_ARR) {
+    const JArray& arr = v.data().as<JArray>();
+    for (size_t i = 0; i < arr.size(); i++) depth = std::max(depth, jst_schema_depth(arr[i]));
+  } else if (v.type() == JST_OBJ) {
+    const JObject& obj = v.data().as<JObject>();
+    for (size_t i = 0; i < obj.size(); i++) {
+      depth = std::max(depth, jst_schema_depth(obj.get_value(i)));
+    }
+  } else {
+    return 0;
+  }
+  return depth + 1;
+}
+
+static uint8_t jst_schema_type_bits(JNType type, const JNumber* num) {
+  switch (type) {
+    case JST_NULL:
+      return JST_SCHEMA_NULL;
+    case JST_TRUE:
+    case JST_FALSE:
+      return JST_SCHEMA_BOOLEAN;
+    case JST_NUM:
+      return JST_SCHEMA_NUMBER | (jst_schema_is_integer(*num) ? JST_SCHEMA_INTEGER : 0);
+    case JST_STR:
+      return JST_SCHEMA_STRING;
+    case JST_ARR:
+      return JST_SCHEMA_ARRAY;
+    default:
+      return JST_SCHEMA_OBJECT;
+  }
+}
+
+// A non-negative integer keyword value (2.0 counts, as the specification allows).
+static bool jst_schema_count(const JNode& v, size_t& out) {
+  if (v.type() != JST_NUM) return false;
+  const JNumber& num = v.data().as<JNumber>();
+  if (!jst_schema_is_integer(num) || num.value() < 0) return false;
+  out = num.is_int() ? (size_t)num.uint_value() : (size_t)num.value();
+  return true;
+}
+
+static size_t jst_code_points(const char* s, size_t len) {
+  size_t n = 0;
+  for (size_t i = 0; i < len; i++) n += ((unsigned char)s[i] & 0xC0) != 0x80;
+  return n;
+}
+
+// Number limits and string keywords, shared by both walks.
+static JRetType jst_schema_number(uint8_t bounds, double d, double minimum, double maximum,
+                                  double exclusive_minimum, double exclusive_maximum,
+                                  JSchemaError* err, size_t offset) {
+  if ((bounds & JST_SCHEMA_MINIMUM) && !(d >= minimum)) {
+    return jst_schema_fail(err, "minimum", offset);
+  }
+  if ((bounds & JST_SCHEMA_MAXIMUM) && !(d <= maximum)) {
+    return jst_schema_fail(err, "maximum", offset);
+  }
+  if ((bounds & JST_SCHEMA_EXCLUSIVE_MINIMUM) && !(d > exclusive_minimum)) {
+    return jst_schema_fail(err, "exclusiveMinimum", offset);
+  }
+  if ((bounds & JST_SCHEMA_EXCLUSIVE_MAXIMUM) && !(d < exclusive_maximum)) {
+    return jst_schema_fail(err, "exclusiveMaximum", offset);
+  }
+  return JST_PARSE_OK;
+}
+
+static JRetType jst_schema_string(size_t min_length, size_t max_length, const JPattern* pattern,
+                                  const char* s, size_t len, JSchemaError* err, size_t offset) {
+  if (min_length != 0 || max_length != SIZE_MAX) {
+    size_t n = jst_code_points(s, len);
+    if (n < min_length) return jst_schema_fail(err, "minLength", offset);
+    if (n > max_length) return jst_schema_fail(err, "maxLength", offset);
+  }
+  if (pattern != nullptr && !pattern->search(s, len)) {
+    return jst_schema_fail(err, "pattern", offset);
+  }
+  return JST_PARSE_OK;
+}
+
+// Required members seen so far: a single word for up to 64 names.
+class JSchemaSeen {
+ public:
+  explicit JSchemaSeen(size_t n) : count(0), bits(0) {
+    if (n > 64) more.resize(n);
+  }
+  void mark(int32_t bit) {
+    if (bit < 0) return;
+    if (more.empty()) {
+      uint64_t m = (uint64_t)1 << bit;
+      count += (bits & m) == 0;
+      bits |= m;
+    } else {
+      count += more[bit] == 0;
+      more[bit] = 1;
+    }
+  }
+  bool has(int32_t bit) const {
+    return more.empty() ? (bits >> bit) & 1 : more[bit] != 0;
+  }
+  size_t count;
+
+ private:
+  uint64_t bits;
+  std::vector<char> more;
+};
+
+JRetType JSchema::compile(const JNode& schema, JSchemaError* err) {
+  nodes.clear();
+  this->ready = false;
+  std::string path;
+  int32_t r = compile_node(schema, err, path);
+  if (r == JST_SCHEMA_INVALID) {
+    nodes.clear();
+    return JST_PARSE_INVALID_SCHEMA;
+  }
+  this->root = r;
+  this->ready = true;
+  return JST_PARSE_OK;
+}
+
+JRetType JSchema::compile(const std::string& schema, JSchemaError* err) {
+  nodes.clear();
+  this->ready = false;
+  JParser jc(schema);
+  JRetType ret = jc.parser();
+  if (ret != JST_PARSE_OK) {
+    if (err != nullptr) {
+      err->path.clear();
+      err->keyword.clear();
+      err->offset = jc.error_offset();
+    }
+    return ret;
+  }
+  return compile(jc.root, err);
+}
+
+int32_t JSchema::compile_node(const JNode& schema, JSchemaError* err, std::string& path) {
+  if (schema.type() == JST_TRUE) return ALLOW;
+  if (schema.type() == JST_FALSE) return DENY;
+  if (schema.type() != JST_OBJ) {
+    jst_schema_invalid(err, path);
+    return JST_SCHEMA_INVALID;
+  }
+
+  // children are appended while this node is built, so it is only stored at the end.
+  int32_t index = (int32_t)nodes.size();
+  nodes.emplace_back();
+  Node node;
+  std::vector<std::string> required;
+  const JObject& obj = schema.data().as<JObject>();
+  for (size_t i = 0; i < obj.size(); i++) {
+    const JString& key = obj.get_key(i);
+    size_t len = path.size();
+    path += jst_pointer_token(key.c_str(), key.size());
+    JRetType ret = compile_keyword(node, key.value(), obj.get_value(i), err, path, required);
+    if (ret != JST_PARSE_OK) return JST_SCHEMA_INVALID;
+    path.resize(len);
+  }
+
+  std::sort(required.begin(), required.end());
+  required.erase(std::unique(required.begin(), required.end()), required.end());
+  std::sort(node.properties.begin(), node.properties.end(),
+            [](const Property& a, const Property& b) { return a.key < b.key; });
+  size_t declared = node.properties.size();
+  for (const std::string& name : required) {
+    auto it = std::lower_bound(
+        node.properties.begin(), node.properties.begin() + declared, name,
+        [](const Property& p, const std::string& key) { return p.key < key; });
+    if (it != node.properties.begin() + declared && it->key == name) {
+      it->required = (int32_t)node.required++;
+    } else {
+      node.properties.push_back({name, node.additional, (int32_t)node.required++, false});
+    }
+  }
+  std::sort(node.properties.begin(), node.properties.end(),
+            [](const Property& a, const Property& b) { return a.key < b.key; });
+
+  nodes[index] = std::move(node);
+  return index;
+}
+
+JRetType JSchema::compile_keyword(Node& node, const std::string& key, const JNode& value,
+                                  JSchemaError* err, std::string& path,
+                                  std::vector<std::string>& required) {
+  if (key == "type") {
+    const JNode* names = &value;
+    size_t n = 1;
+    if (value.type() == JST_ARR) {
+      n = value.data().as<JArray>().size();
+      names = value.data().as<JArray>().data();
+    }
+    node.types = 0;
+    for (size_t i = 0; i < n; i++) {
+      if (names[i].type() != JST_STR) return jst_schema_invalid(err, path);
+      std::string name = names[i].data().as<JString>().value();
+      uint8_t bit = name == "null"      ? JST_SCHEMA_NULL
+                    : name == "boolean" ? JST_SCHEMA_BOOLEAN
+                    : name == "object"  ? JST_SCHEMA_OBJECT
+                    : name == "array"   ? JST_SCHEMA_ARRAY
+                    : name == "number"  ? JST_SCHEMA_NUMBER
+                    : name == "integer" ? JST_SCHEMA_INTEGER
+                    : name == "string"  ? JST_SCHEMA_STRING
+                                        : 0;
+      if (bit == 0) return jst_schema_invalid(err, path);
+      node.types |= bit;
+    }
+    // an empty list accepts nothing; keep it distinct from "no type keyword".
+    if (n == 0) node.types = 0x80;
+    return JST_PARSE_OK;
+  }
+  if (key == "enum") {
+    if (value.type() != JST_ARR) return jst_schema_invalid(err, path);
+    const JArray& arr = value.data().as<JArray>();
+    node.has_enum = true;
+    node.enum_values.assign(arr.data(), arr.data() + arr.size());
+    for (size_t i = 0; i < arr.size(); i++) {
+      node.value_depth = std::max(node.value_depth, jst_schema_depth(arr[i]));
+    }
+    return JST_PARSE_OK;
+  }
+  if (key == "const") {
+    node.has_const = true;
+    node.const_value = value;
+    node.value_depth = std::max(node.value_depth, jst_schema_depth(value));
+    return JST_PARSE_OK;
+  }
+
+  struct Bound {
+    const char* name;
+    uint8_t bit;
+    double Node::*field;
+  };
+  static const Bound bounds[] = {
+      {"minimum", JST_SCHEMA_MINIMUM, &Node::minimum},
+      {"maximum", JST_SCHEMA_MAXIMUM, &Node::maximum},
+      {"exclusiveMinimum", JST_SCHEMA_EXCLUSIVE_MINIMUM, &Node::exclusive_minimum},
+      {"exclusiveMaximum", JST_SCHEMA_EXCLUSIVE_MAXIMUM, &Node::exclusive_maximum},
+  };
+  for (const Bound& b : bounds) {
+    if (key != b.name) continue;
+    if (value.type() != JST_NUM) return jst_schema_invalid(err, path);
+    node.bounds |= b.bit;
+    node.*(b.field) = value.data().as<JNumber>().value();
+    return JST_PARSE_OK;
+  }
+
+  struct Count {
+    const char* name;
+    size_t Node::*field;
+  };
+  static const Count counts[] = {
+      {"minLength", &Node::min_length},
+      {"maxLength", &Node::max_length},
+      {"minItems", &Node::min_items},
+      {"maxItems", &Node::max_items},
+  };
+  for (const Count& c : counts) {
+    if (key != c.name) continue;
+    if (!jst_schema_count(value, node.*(c.field))) return jst_schema_invalid(err, path);
+    return JST_PARSE_OK;
+  }
+
+  if (key == "pattern") {
+    if (value.type() != JST_STR) return jst_schema_invalid(err, path);
+    node.pattern = std::make_shared<JPattern>();
+    if (node.pattern->compile(value.data().as<JString>().value()) != JST_PARSE_OK) {
+      return jst_schema_invalid(err, path);
+    }
+    return JST_PARSE_OK;
+  }
+  if (key == "items") {
+    node.items = compile_node(value, err, path);
+    return node.items == JST_SCHEMA_INVALID ? JST_PARSE_INVALID_SCHEMA : JST_PARSE_OK;
+  }
+  if (key == "additionalProperties") {
+    node.additional = compile_node(value, err, path);
+    return node.additional == JST_SCHEMA_INVALID ? JST_PARSE_INVALID_SCHEMA : JST_PARSE_OK;
+  }
+  if (key == "required") {
+    if (value.type() != JST_ARR) return jst_schema_invalid(err, path);
+    const JArray& arr = value.data().as<JArray>();
+    for (size_t i = 0; i < arr.size(); i++) {
+      if (arr[i].type() != JST_STR) return jst_schema_invalid(err, path);
+      required.push_back(arr[i].data().as<JString>().value());
+    }
+    return JST_PARSE_OK;
+  }
+  if (key == "properties") {
+    if (value.type() != JST_OBJ) return jst_schema_invalid(err, path);
+    const JObject& obj = value.data().as<JObject>();
+    for (size_t i = 0; i < obj.size(); i++) {
+      const JString& name = obj.get_key(i);
+      size_t len = path.size();
+      path += jst_pointer_token(name.c_str(), name.size());
+      int32_t child = compile_node(obj.get_value(i), err, path);
+      if (child == JST_SCHEMA_INVALID) return JST_PARSE_INVALID_SCHEMA;
+      path.resize(len);
+      // a repeated name keeps its last schema.
+      auto it = std::find_if(node.properties.begin(), node.properties.end(),
+                             [&name](const Property& p) { return p.key == name.value(); });
+      if (it != node.properties.end()) {
+        it->schema = child;
+      } else {
+        node.properties.push_back({name.value(), child, -1, true});
+      }
+    }
+    return JST_PARSE_OK;
+  }
+  return JST_PARSE_OK;
+}
+
+const JSchema::Property* JSchema::find(const Node& node, const char* key, size_t len) const {
+  size_t lo = 0, hi = node.properties.size();
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    const std::string& k = node.properties[mid].key;
+    int c = memcmp(k.data(), key, std::min(k.size(), len));
+    if (c < 0 || (c == 0 && k.size() < len)) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo == node.properties.size()) return nullptr;
+  const Property& p = node.properties[lo];
+  return p.key.size() == len && memcmp(p.key.data(), key, len) == 0 ? &p : nullptr;
+}
+
+JRetType JSchema::validate(const JNode& doc, JSchemaError* err) const {
+  if (!this->ready) return jst_schema_invalid(err, "");
+  return check(this->root, doc, err);
+}
+
+JRetType JSchema::check(int32_t index, const JNode& v, JSchemaError* err) const {
+  if (index == ALLOW) return JST_PARSE_OK;
+  if (index == DENY) return jst_schema_fail(err, "false");
+  const Node& node = nodes[index];
+
+  const JNumber* num = v.type() == JST_NUM ? &v.data().as<JNumber>() : nullptr;
+  if (node.types != 0 && (node.types & jst_schema_type_bits(v.type(), num)) == 0) {
+    return jst_schema_fail(err, "type");
+  }
+  if (node.has_const && !(v == node.const_value)) return jst_schema_fail(err, "const");
+  if (node.has_enum &&
+      std::find(node.enum_values.begin(), node.enum_values.end(), v) == node.enum_values.end()) {
+    return jst_schema_fail(err, "enum");
+  }
+
+  JRetType ret = JST_PARSE_OK;
+  switch (v.type()) {
+    case JST_NUM:
+      return jst_schema_number(node.bounds, num->value(), node.minimum, node.maximum,
+                               node.exclusive_minimum, node.exclusive_maximum, err, 0);
+    case JST_STR: {
+      const JString& s = v.data().as<JString>();
+      return jst_schema_string(node.min_length, node.max_length, node.pattern.get(), s.c_str(),
+                               s.size(), err, 0);
+    }
+    case JST_ARR: {
+      const JArray& arr = v.data().as<JArray>();
+      if (arr.size() < node.min_items) return jst_schema_fail(err, "minItems");
+      if (arr.size() > node.max_items) return jst_schema_fail(err, "maxItems");
+      if (node.items == ALLOW) return JST_PARSE_OK;
+      for (size_t i = 0; i < arr.size() && ret == JST_PARSE_OK; i++) {
+        ret = check(node.items, arr[i], err);
+        jst_schema_step(ret, err, "/" + std::to_string(i));
+      }
+      return ret;
+    }
+    case JST_OBJ: {
+      const JObject& obj = v.data().as<JObject>();
+      JSchemaSeen seen(node.required);
+      for (size_t i = 0; i < obj.size(); i++) {
+        const JString& key = obj.get_key(i);
+        const Property* p = find(node, key.c_str(), key.size());
+        if ((p == nullptr || !p->declared) && node.additional == DENY) {
+          ret = jst_schema_fail(err, "additionalProperties");
+        } else {
+          if (p != nullptr) seen.mark(p->required);
+          ret = check(p != nullptr ? p->schema : node.additional, obj.get_value(i), err);
+        }
+        if (ret != JST_PARSE_OK) {
+          return jst_schema_step(ret, err, jst_pointer_token(key.c_str(), key.size()));
+        }
+      }
+      if (seen.count == node.required) return JST_PARSE_OK;
+      // report the first missing name, at the member it should have been.
+      for (const Property& p : node.properties) {
+        if (p.required >= 0 && !seen.has(p.required)) {
+          jst_schema_fail(err, "required");
+          return jst_schema_step(JST_PARSE_SCHEMA_VIOLATION, err,
+                                 jst_pointer_token(p.key.data(), p.key.size()));
+        }
+      }
+      return JST_PARSE_OK;
+    }
+    default:
+      return JST_PARSE_OK;
+  }
+}
+
+// Step over the value the reader is on. Unlike JReader::skip() this reads every token, so the
+// syntax of unconstrained parts is still checked.
+static JRetType jst_schema_consume(JReader& r) {
+  if (r.token() == JST_TOKEN_ERROR) return r.error();
+  if (r.token() != JST_TOKEN_BEGIN_ARRAY && r.token() != JST_TOKEN_BEGIN_OBJECT) {
+    return JST_PARSE_OK;
+  }
+  size_t depth = r.depth();
+  while (r.depth() >= depth) {
+    if (r.next() == JST_TOKEN_ERROR) return r.error();
+  }
+  return JST_PARSE_OK;
+}
+
+// Tree of the value the reader is on, for enum and const. Nothing nested deeper than depth
+// levels can equal one of their values, so such a value is stepped over instead of built, with
+// deeper set; the recursion is bounded by the schema, whatever the payload.
+static JRetType jst_schema_read_node(JReader& r, JNode& out, size_t depth, bool& deeper) {
+  switch (r.token()) {
+    case JST_TOKEN_NULL:
+      out = JNode(JST_NULL);
+      return JST_PARSE_OK;
+    case JST_TOKEN_TRUE:
+      out = JNode(JST_TRUE);
+      return JST_PARSE_OK;
+    case JST_TOKEN_FALSE:
+      out = JNode(JST_FALSE);
+      return JST_PARSE_OK;
+    case JST_TOKEN_NUMBER:
+      out = JNode(r.get_number());
+      return JST_PARSE_OK;
+    case JST_TOKEN_STRING:
+      out = JNode(JString(r.get_string().c_str(), r.get_string().size()));
+      return JST_PARSE_OK;
+    case JST_TOKEN_BEGIN_ARRAY: {
+      if (depth == 0) {
+        deeper = true;
+        return jst_schema_consume(r);
+      }
+      JArray arr;
+      while (r.next() != JST_TOKEN_END_ARRAY) {
+        JNode item;
+        JRetType ret = jst_schema_read_node(r, item, depth - 1, deeper);
+        if (ret != JST_PARSE_OK) return ret;
+        arr.push_back(item);
+      }
+      out = JNode(std::move(arr));
+      return JST_PARSE_OK;
+    }
+    case JST_TOKEN_BEGIN_OBJECT: {
+      if (depth == 0) {
+        deeper = true;
+        return jst_schema_consume(r);
+      }
+      JObject obj;
+      while (r.next() == JST_TOKEN_KEY) {
+        JString key(r.get_string().c_str(), r.get_string().size());
+        JNode value;
+        r.next();
+        JRetType ret = jst_schema_read_node(r, value, depth - 1, deeper);
+        if (ret != JST_PARSE_OK) return ret;
+        obj.push_back(JOjectElement(std::move(key), std::move(value)));
+      }
+      if (r.token() != JST_TOKEN_END_OBJECT) return r.error();
+      out = JNode(std::move(obj));
+      return JST_PARSE_OK;
+    }
+    default:
+      return r.error();
+  }
+}
+
+JRetType JSchema::consume(JReader& r) const { return jst_schema_consume(r); }
+
+JRetType JSchema::check(int32_t index, JReader& r, JSchemaError* err) const {
+  if (r.token() == JST_TOKEN_ERROR) return r.error();
+  if (index == ALLOW) return consume(r);
+  size_t offset = r.offset();
+  if (index == DENY) return jst_schema_fail(err, "false", offset);
+  const Node& node = nodes[index];
+
+  if (node.has_enum || node.has_const) {
+    JNode v;
+    bool deeper = false;
+    JNType container = r.token() == JST_TOKEN_BEGIN_ARRAY ? JST_ARR : JST_OBJ;
+    JRetType ret = jst_schema_read_node(r, v, node.value_depth, deeper);
+    if (ret != JST_PARSE_OK) return ret;
+    if (deeper) {
+      // the checks of the tree walk that come first: type, then const, then enum.
+      if (node.types != 0 && (node.types & jst_schema_type_bits(container, nullptr)) == 0) {
+        return jst_schema_fail(err, "type", offset);
+      }
+      return jst_schema_fail(err, node.has_const ? "const" : "enum", offset);
+    }
+    ret = check(index, v, err);
+    if (ret != JST_PARSE_OK && err != nullptr) err->offset = offset;
+    return ret;
+  }
+
+  JTokenType tok = r.token();
+  const JNumber* num = tok == JST_TOKEN_NUMBER ? &r.get_number() : nullptr;
+  JNType type = tok == JST_TOKEN_NULL            ? JST_NULL
+                : tok == JST_TOKEN_TRUE          ? JST_TRUE
+                : tok == JST_TOKEN_FALSE         ? JST_FALSE
+                : tok == JST_TOKEN_NUMBER        ? JST_NUM
+                : tok == JST_TOKEN_STRING        ? JST_STR
+                : tok == JST_TOKEN_BEGIN_ARRAY   ? JST_ARR
+                                                 : JST_OBJ;
+  if (node.types != 0 && (node.types & jst_schema_type_bits(type, num)) == 0) {
+    return jst_schema_fail(err, "type", offset);
+  }
+
+  JRetType ret = JST_PARSE_OK;
+  switch (type) {
+    case JST_NUM:
+      return jst_schema_number(node.bounds, num->value(), node.minimum, node.maximum,
+                               node.exclusive_minimum, node.exclusive_maximum, err, offset);
+    case JST_STR: {
+      const JString& s = r.get_string();
+      return jst_schema_string(node.min_length, node.max_length, node.pattern.get(), s.c_str(),
+                               s.size(), err, offset);
+    }
+    case JST_ARR: {
+      size_t n = 0;
+      for (; r.next() != JST_TOKEN_END_ARRAY; n++) {
+        ret = check(node.items, r, err);
+        if (ret != JST_PARSE_OK) return jst_schema_step(ret, err, "/" + std::to_string(n));
+      }
+      if (n < node.min_items) return jst_schema_fail(err, "minItems", offset);
+      if (n > node.max_items) return jst_schema_fail(err, "maxItems", offset);
+      return JST_PARSE_OK;
+    }
+    case JST_OBJ: {
+      JSchemaSeen seen(node.required);
+      while (r.next() == JST_TOKEN_KEY) {
+        // keys without escapes are looked up straight in the input.
+        size_t len;
+        const char* key = r.raw(len);
+        std::string decoded;
+        if (r.get_string().size() != len) {
+          decoded = r.get_string().value();
+          key = decoded.data();
+          len = decoded.size();
+        }
+        const Property* p = find(node, key, len);
+        if ((p == nullptr || !p->declared) && node.additional == DENY) {
+          ret = jst_schema_fail(err, "additionalProperties", r.offset());
+        } else {
+          if (p != nullptr) seen.mark(p->required);
+          r.next();
+          ret = check(p != nullptr ? p->schema : node.additional, r, err);
+        }
+        if (ret != JST_PARSE_OK) return jst_schema_step(ret, err, jst_pointer_token(key, len));
+      }
+      if (r.token() != JST_TOKEN_END_OBJECT) return r.error();
+      if (seen.count == node.required) return JST_PARSE_OK;
+      for (const Property& p : node.properties) {
+        if (p.required >= 0 && !seen.has(p.required)) {
+          jst_schema_fail(err, "required", offset);
+          return jst_schema_step(JST_PARSE_SCHEMA_VIOLATION, err,
+                                 jst_pointer_token(p.key.data(), p.key.size()));
+        }
+      }
+      return JST_PARSE_OK;
+    }
+    default:
+      return JST_PARSE_OK;
+  }
+}
+
+JRetType JSchema::validate(const char* json, size_t len, JSchemaError* err,
+                           const JParserOptions& opts) const {
+  if (!this->ready) return jst_schema_invalid(err, "");
+  JReader r(json, len, opts);
+  r.next();
+  JRetType ret = check(this->root, r, err);
+  if (ret == JST_PARSE_OK && r.next() != JST_TOKEN_END) ret = r.error();
+  if (ret != JST_PARSE_OK && ret != JST_PARSE_SCHEMA_VIOLATION && err != nullptr) {
+    err->path.clear();
+    err->keyword.clear();
+    err->offset = r.error_offset();
+  }
+  return ret;
+}
+
+JRetType JSchema::parse(const char* json, size_t len, JNode& out, JSchemaError* err,
+                        const JParserOptions& opts) const {
+  JRetType ret = validate(json, len, err, opts);
+  if (ret != JST_PARSE_OK) return ret;
+  JParser jc("", opts);
+  jc.reset(json, len);
+  return jc.parser(&out);
+}
+
+}  // namespace jst
@@ -0,0 +1,358 @@
+#include "snapshot.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "basic.h"
+
+namespace jst {
+
+static_assert(sizeof(JSnapHeader) == 32, "snapshot header layout");
+static_assert(sizeof(JSnapRecord) == 16, "snapshot record layout");
+
+namespace {
+
+// Lays the tree out depth-first: a container's records are reserved first and filled in as its
+// children are appended behind them, so every payload points forward. Lengths and counts are
+// 32-bit in a record; a value that does not fit stops the walk with ret set.
+struct JSnapWriter {
+  std::string buf;
+  JRetType ret = JST_PARSE_OK;
+
+  bool fits(size_t n, JRetType error) {
+    if (n <= UINT32_MAX) return true;
+    ret = error;
+    return false;
+  }
+
+  size_t append(size_t n) {
+    size_t off = buf.size();
+    buf.resize(off + ((n + 7) & ~(size_t)7));
+    return off;
+  }
+
+  size_t bytes(const char* s, size_t len) {
+    size_t off = append(len + 1);
+    if (len != 0) memcpy(&buf[off], s, len);
+    return off;
+  }
+
+  void put(size_t off, JNType type, uint32_t length, uint64_t payload, uint8_t num_type = 0) {
+    JSnapRecord rec = {(uint8_t)type, num_type, 0, length, payload};
+    memcpy(&buf[off], &rec, sizeof(rec));
+  }
+
+  void string(const JString& s, size_t off) {
+    if (!fits(s.size(), JST_PARSE_EXCEED_MAX_STRING_LENGTH)) return;
+    put(off, JST_STR, (uint32_t)s.size(), bytes(s.c_str(), s.size()));
+  }
+
+  void node(const JNode& jn, size_t off) {
+    if (ret != JST_PARSE_OK) return;
+    switch (jn.type()) {
+      case JST_NULL:
+      case JST_TRUE:
+      case JST_FALSE:
+        put(off, jn.type(), 0, 0);
+        return;
+      case JST_NUM: {
+        const JNumber& num = jn.data().as<JNumber>();
+        uint64_t bits = 0;
+        uint32_t length = 0;
+        if (num.type() == JST_NUM_TEXT) {
+          if (!fits(num.source().size(), JST_PARSE_EXCEED_MAX_STRING_LENGTH)) return;
+          length = (uint32_t)num.source().size();
+          bits = bytes(num.source().data(), length);
+        } else if (num.type() == JST_NUM_DOUBLE) {
+          double d = num.value();
+          memcpy(&bits, &d, sizeof(bits));
+        } else {
+          bits = num.uint_value();
+        }
+        put(off, JST_NUM, length, bits, (uint8_t)num.type());
+        return;
+      }
+      case JST_STR:
+        string(jn.data().as<JString>(), off);
+        return;
+      case JST_ARR: {
+        const JArray& arr = jn.data().as<JArray>();
+        if (!fits(arr.size(), JST_PARSE_EXCEED_MAX_NODES)) return;
+        size_t block = append(arr.size() * sizeof(JSnapRecord));
+        put(off, JST_ARR, (uint32_t)arr.size(), block);
+        for (size_t i = 0; i < arr.size(); i++) node(arr[i], block + i * sizeof(JSnapRecord));
+        return;
+      }
+      case JST_OBJ: {
+        const JObject& obj = jn.data().as<JObject>();
+        size_t n = obj.size();
+        if (!fits(n, JST_PARSE_EXCEED_MAX_NODES)) return;
+        size_t block = append(n * 2 * sizeof(JSnapRecord) + n * sizeof(uint32_t));
+        put(off, JST_OBJ, (uint32_t)n, block);
+
+        std::vector<uint32_t> order(n);
+        for (size_t i = 0; i < n; i++) order[i] = (uint32_t)i;
+        // stable, so the first of several equal keys comes first, as in JObject::find_value.
+        std::stable_sort(order.begin(), order.end(), [&obj](uint32_t a, uint32_t b) {
+          const JString& ka = obj.get_key(a);
+          const JString& kb = obj.get_key(b);
+          int c = memcmp(ka.c_str(), kb.c_str(), std::min(ka.size(), kb.size()));
+          return c != 0 ? c < 0 : ka.size() < kb.size();
+        });
+        if (n != 0) {
+          memcpy(&buf[block + n * 2 * sizeof(JSnapRecord)], order.data(), n * sizeof(uint32_t));
+        }
+
+        for (size_t i = 0; i < n; i++) {
+          size_t member = block + i * 2 * sizeof(JSnapRecord);
+          string(obj.get_key(i), member);
+          node(obj.get_value(i), member + sizeof(JSnapRecord));
+        }
+        return;
+      }
+    }
+  }
+};
+
+}  // namespace
+
+JRetType JSnapshot::write(const JNode& root, std::string& out) {
+  JSnapWriter w;
+  w.append(sizeof(JSnapHeader));
+  size_t root_off = w.append(sizeof(JSnapRecord));
+  w.node(root, root_off);
+  if (w.ret != JST_PARSE_OK) return w.ret;
+
+  JSnapHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, JST_SNAP_MAGIC, sizeof(JST_SNAP_MAGIC));
+  header.version = JST_SNAP_VERSION;
+  header.byte_order = JST_SNAP_BYTE_ORDER;
+  header.size = w.buf.size();
+  header.root = root_off;
+  memcpy(&w.buf[0], &header, sizeof(header));
+  out = std::move(w.buf);
+  return JST_PARSE_OK;
+}
+
+JRetType JSnapshot::write(const JNode& root, const std::string& path) {
+  std::string out;
+  JRetType ret = write(root, out);
+  if (ret != JST_PARSE_OK) return ret;
+  FILE* fp = fopen(path.c_str(), "wb");
+  if (fp == nullptr) return JST_PARSE_FILE_ERROR;
+  bool ok = fwrite(out.data(), 1, out.size(), fp) == out.size();
+  ok = fclose(fp) == 0 && ok;
+  return ok ? JST_PARSE_OK : JST_PARSE_FILE_ERROR;
+}
+
+JRetType JSnapshot::open(const std::string& path) {
+  this->data_ = nullptr;
+  this->size_ = 0;
+  JRetType ret = file_.open(path);
+  if (ret != JST_PARSE_OK) return ret;
+  return open(file_.data(), file_.size());
+}
+
+JRetType JSnapshot::open(const char* data, size_t len) {
+  this->data_ = nullptr;
+  this->size_ = 0;
+  JSnapHeader header;
+  if (len < sizeof(header) || (uintptr_t)data % 8 != 0) return JST_PARSE_INVALID_SNAPSHOT;
+  memcpy(&header, data, sizeof(header));
+  if (memcmp(header.magic, JST_SNAP_MAGIC, sizeof(JST_SNAP_MAGIC)) != 0 ||
+      header.version != JST_SNAP_VERSION || header.byte_order != JST_SNAP_BYTE_ORDER ||
+      header.size != len || header.root % 8 != 0 || header.root < sizeof(header) ||
+      header.root > len - sizeof(JSnapRecord)) {
+    return JST_PARSE_INVALID_SNAPSHOT;
+  }
+  this->data_ = data;
+  this->size_ = len;
+  return JST_PARSE_OK;
+}
+
+JSnapView JSnapshot::root() const {
+  if (this->data_ == nullptr) return JSnapView();
+  uint64_t root = ((const JSnapHeader*)this->data_)->root;
+  return JSnapView(this->data_, (const JSnapRecord*)(this->data_ + root));
+}
+
+// Every payload must point past the record that holds it, which rules out cycles; the visit
+// count is capped by the number of record slots, which rules out blowups through shared blocks.
+JRetType JSnapshot::verify() const {
+  if (this->data_ == nullptr) return JST_PARSE_INVALID_SNAPSHOT;
+  const size_t size = this->size_;
+  auto fits = [size](uint64_t off, uint64_t len) { return off <= size && len <= size - off; };
+  // n bytes of text at p, after the record at off and NUL-terminated.
+  auto text = [&](uint64_t off, uint64_t p, uint64_t n) {
+    return p > off && fits(p, n + 1) && this->data_[p + n] == '\0';
+  };
+
+  std::vector<uint64_t> pending = {((const JSnapHeader*)this->data_)->root};
+  size_t visits = 0;
+  while (!pending.empty()) {
+    uint64_t off = pending.back();
+    pending.pop_back();
+    if (++visits > size / sizeof(JSnapRecord)) return JST_PARSE_INVALID_SNAPSHOT;
+    JSnapRecord rec;
+    memcpy(&rec, this->data_ + off, sizeof(rec));
+    uint64_t p = rec.payload, n = rec.length;
+
+    switch (rec.type) {
+      case JST_NULL:
+      case JST_TRUE:
+      case JST_FALSE:
+        break;
+      case JST_NUM:
+        if (rec.num_type > JST_NUM_TEXT) return JST_PARSE_INVALID_SNAPSHOT;
+        if (rec.num_type == JST_NUM_TEXT && !text(off, p, n)) return JST_PARSE_INVALID_SNAPSHOT;
+        break;
+      case JST_STR:
+        if (!text(off, p, n)) return JST_PARSE_INVALID_SNAPSHOT;
+        break;
+      case JST_ARR:
+        if (n == 0) break;
+        if (p <= off || p % 8 != 0 || !fits(p, n * sizeof(JSnapRecord))) {
+          return JST_PARSE_INVALID_SNAPSHOT;
+        }
+        for (uint64_t i = 0; i < n; i++) pending.push_back(p + i * sizeof(JSnapRecord));
+        break;
+      case JST_OBJ: {
+        if (n == 0) break;
+        if (p <= off || p % 8 != 0 || !fits(p, n * (2 * sizeof(JSnapRecord) + 4))) {
+          return JST_PARSE_INVALID_SNAPSHOT;
+        }
+        const uint32_t* order = (const uint32_t*)(this->data_ + p + n * 2 * sizeof(JSnapRecord));
+        for (uint64_t i = 0; i < n; i++) {
+          if (order[i] >= n || this->data_[p + i * 2 * sizeof(JSnapRecord)] != JST_STR) {
+            return JST_PARSE_INVALID_SNAPSHOT;
+          }
+          pending.push_back(p + i * 2 * sizeof(JSnapRecord));
+          pending.push_back(p + (i * 2 + 1) * sizeof(JSnapRecord));
+        }
+        break;
+      }
+      default:
+        return JST_PARSE_INVALID_SNAPSHOT;
+    }
+  }
+  return JST_PARSE_OK;
+}
+
+double JSnapView::number() const {
+  if (type() != JST_NUM) return 0;
+  switch (num_type()) {
+    case JST_NUM_INT:
+      return (double)(int64_t)rec->payload;
+    case JST_NUM_UINT:
+      return (double)rec->payload;
+    case JST_NUM_TEXT:
+      return strtod(c_str(), nullptr);
+    default: {
+      double d;
+      memcpy(&d, &rec->payload, sizeof(d));
+      return d;
+    }
+  }
+}
+
+int64_t JSnapView::int_value() const {
+  if (type() != JST_NUM) return 0;
+  return num_type() == JST_NUM_INT || num_type() == JST_NUM_UINT ? (int64_t)rec->payload
+                                                                  : (int64_t)number();
+}
+
+uint64_t JSnapView::uint_value() const {
+  if (type() != JST_NUM) return 0;
+  return num_type() == JST_NUM_INT || num_type() == JST_NUM_UINT ? rec->payload
+                                                                  : (uint64_t)number();
+}
+
+const char* JSnapView::c_str() const {
+  if (type() == JST_STR || (type() == JST_NUM && num_type() == JST_NUM_TEXT)) {
+    return at(rec->payload);
+  }
+  return "";
+}
+
+JSnapView JSnapView::operator[](size_t index) const {
+  if (index >= size()) return JSnapView();
+  const JSnapRecord* first = (const JSnapRecord*)at(rec->payload);
+  if (type() == JST_ARR) return JSnapView(base, first + index);
+  if (type() == JST_OBJ) return JSnapView(base, first + 2 * index + 1);
+  return JSnapView();
+}
+
+JSnapView JSnapView::key(size_t index) const {
+  if (type() != JST_OBJ || index >= size()) return JSnapView();
+  return JSnapView(base, (const JSnapRecord*)at(rec->payload) + 2 * index);
+}
+
+JSnapView JSnapView::find(const char* key, size_t len) const {
+  if (type() != JST_OBJ) return JSnapView();
+  size_t n = size();
+  const JSnapRecord* members = (const JSnapRecord*)at(rec->payload);
+  const uint32_t* order = (const uint32_t*)(members + 2 * n);
+  // lower bound of key in the sorted table.
+  size_t lo = 0, hi = n;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    const JSnapRecord& k = members[2 * order[mid]];
+    int c = memcmp(at(k.payload), key, std::min<size_t>(k.length, len));
+    if (c < 0 || (c == 0 && k.length < len)) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo == n) return JSnapView();
+  const JSnapRecord& k = members[2 * order[lo]];
+  if (k.length != len || memcmp(at(k.payload), key, len) != 0) return JSnapView();
+  return JSnapView(base, &k + 1);
+}
+
+JNode JSnapView::to_node() const {
+  switch (type()) {
+    case JST_NUM: {
+      JNumber num;
+      switch (num_type()) {
+        case JST_NUM_INT:
+          num = JNumber::from_int(int_value());
+          break;
+        case JST_NUM_UINT:
+          num = JNumber::from_uint(uint_value());
+          break;
+        case JST_NUM_TEXT:
+          JNumber::from_text(c_str(), size(), num);
+          break;
+        default:
+          num = JNumber(number());
+      }
+      return JNode(num);
+    }
+    case JST_STR:
+      return JNode(size() == 0 ? JString("", 0) : JString(c_str(), size()));
+    case JST_ARR: {
+      JArray arr(size());
+      for (size_t i = 0; i < size(); i++) arr[i] = (*this)[i].to_node();
+      return JNode(std::move(arr));
+    }
+    case JST_OBJ: {
+      JObject obj(size());
+      for (size_t i = 0; i < size(); i++) {
+        JSnapView k = key(i);
+        obj.push_back(JOjectElement(k.size() == 0 ? JString("", 0) : JString(k.c_str(), k.size()),
+                                    (*this)[i].to_node()));
+      }
+      return JNode(std::move(obj));
+    }
+    default:
+      return JNode(type());
+  }
+}
+
+}  // namespace jst
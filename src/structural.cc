@@ -0,0 +1,246 @@
+#include "structural.h"
+
+#include <algorithm>
+
+#include "parallel.h"
+#include "utf8.h"
+
+namespace jst {
+
+namespace {
+
+struct JChunk {
+  size_t begin = 0, end = 0;
+  bool odd_quotes = false;  // the chunk flips the in-string state
+  bool in_string = false;   // state at begin, from the prefix over odd_quotes
+  size_t utf8_error = 0;    // offset of the first bad sequence, end if none
+  std::vector<uint64_t> index;
+  // jst_structural_split: brackets left unmatched inside the chunk, the nesting at its begin
+  // and the candidate split commas.
+  std::vector<uint64_t> opens, closes;
+  bool too_deep = false;
+  size_t depth = 0;
+  std::vector<uint64_t> commas;
+};
+
+// Deeper unmatched nesting inside a chunk is left to the serial parse.
+static const size_t JST_SPLIT_MAX_DEPTH = 1024;
+
+inline bool jst_is_structural(char c) {
+  return c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',';
+}
+
+// Move a cut forward until it neither follows a backslash nor lands on a UTF-8 continuation.
+size_t jst_chunk_boundary(const char* json, size_t len, size_t at) {
+  while (at < len && (json[at - 1] == '\\' || ((unsigned char)json[at] & 0xC0) == 0x80)) at++;
+  return at;
+}
+
+void jst_count_quotes(const char* json, JChunk& chunk) {
+  size_t i = chunk.begin;
+  bool odd = false;
+  while (i < chunk.end) {
+    i += jst_scan_plain(json + i, chunk.end - i, false);
+    if (i >= chunk.end) break;
+    if (json[i] == '\"') odd = !odd;
+    i += json[i] == '\\' ? 2 : 1;
+  }
+  chunk.odd_quotes = odd;
+}
+
+// Call visit(pos, c) for every structural character and opening quote of the chunk.
+template <typename F>
+void jst_scan_chunk(const char* json, const JChunk& chunk, F&& visit) {
+  size_t i = chunk.begin;
+  bool in_string = chunk.in_string;
+  while (i < chunk.end) {
+    if (in_string) {
+      i += jst_scan_plain(json + i, chunk.end - i, false);
+      if (i >= chunk.end) break;
+      if (json[i] == '\"') in_string = false;
+      i += json[i] == '\\' ? 2 : 1;
+    } else {
+      char c = json[i];
+      if (c == '\"') {
+        in_string = true;
+        visit(i, c);
+      } else if (jst_is_structural(c)) {
+        visit(i, c);
+      }
+      i++;
+    }
+  }
+}
+
+void jst_index_chunk(const char* json, JChunk& chunk) {
+  jst_scan_chunk(json, chunk, [&chunk](size_t pos, char) { chunk.index.push_back(pos); });
+}
+
+// Brackets of the chunk that do not pair up inside it: closers first, then openers.
+void jst_match_chunk(const char* json, JChunk& chunk) {
+  jst_scan_chunk(json, chunk, [&chunk](size_t pos, char c) {
+    if (c == '[' || c == '{') {
+      if (chunk.opens.size() == JST_SPLIT_MAX_DEPTH) {
+        chunk.too_deep = true;
+      } else {
+        chunk.opens.push_back(pos);
+      }
+    } else if (c == ']' || c == '}') {
+      if (!chunk.opens.empty()) {
+        chunk.opens.pop_back();
+      } else if (chunk.closes.size() == JST_SPLIT_MAX_DEPTH) {
+        chunk.too_deep = true;
+      } else {
+        chunk.closes.push_back(pos);
+      }
+    }
+  });
+}
+
+// Cut [0, len) into one chunk per thread, count the quotes of each and validate it, then find
+// out which chunks start inside a string.
+JRetType jst_prepare_chunks(const char* json, size_t len, unsigned threads, bool validate_utf8,
+                            std::vector<JChunk>& chunks, size_t* err_offset) {
+  threads = jst_thread_count(threads);
+  size_t n = std::max<size_t>(std::min<size_t>(threads, len), 1);
+
+  size_t begin = 0;
+  for (size_t k = 1; k <= n && begin < len; k++) {
+    size_t end = k == n ? len : std::max(begin, jst_chunk_boundary(json, len, len * k / n));
+    if (end == begin) continue;
+    chunks.emplace_back();
+    chunks.back().begin = begin;
+    chunks.back().end = end;
+    begin = end;
+  }
+
+  jst_parallel_for(chunks.size(), threads, [&](size_t k) {
+    JChunk& chunk = chunks[k];
+    jst_count_quotes(json, chunk);
+    size_t size = chunk.end - chunk.begin;
+    if (validate_utf8) size = jst_utf8_validate(json + chunk.begin, size);
+    chunk.utf8_error = chunk.begin + size;
+  });
+
+  bool in_string = false;
+  for (auto& chunk : chunks) {
+    if (chunk.utf8_error != chunk.end) {
+      if (err_offset != nullptr) *err_offset = chunk.utf8_error;
+      return JST_PARSE_INVALID_UTF8;
+    }
+    chunk.in_string = in_string;
+    in_string ^= chunk.odd_quotes;
+  }
+  if (in_string) {
+    if (err_offset != nullptr) *err_offset = len;
+    return JST_PARSE_MISS_QUOTATION_MARK;
+  }
+  return JST_PARSE_OK;
+}
+
+inline bool jst_is_ws(char c) { return c == ' ' || c == '\n' || c == '\t' || c == '\r'; }
+
+inline char jst_closing(char open) { return open == '[' ? ']' : '}'; }
+
+}  // namespace
+
+JRetType jst_structural_index(const char* json, size_t len, unsigned threads,
+                              std::vector<uint64_t>& index, bool validate_utf8,
+                              size_t* err_offset) {
+  index.clear();
+  std::vector<JChunk> chunks;
+  JRetType ret = jst_prepare_chunks(json, len, threads, validate_utf8, chunks, err_offset);
+  if (ret != JST_PARSE_OK) return ret;
+
+  jst_parallel_for(chunks.size(), threads, [&](size_t k) { jst_index_chunk(json, chunks[k]); });
+
+  // merge: every chunk copies its part to its own offset of the result.
+  std::vector<size_t> offsets(chunks.size() + 1, 0);
+  for (size_t k = 0; k < chunks.size(); k++) offsets[k + 1] = offsets[k] + chunks[k].index.size();
+  index.resize(offsets.back());
+  jst_parallel_for(chunks.size(), threads, [&](size_t k) {
+    std::copy(chunks[k].index.begin(), chunks[k].index.end(), index.begin() + offsets[k]);
+    std::vector<uint64_t>().swap(chunks[k].index);
+  });
+  return JST_PARSE_OK;
+}
+
+bool jst_structural_split(const char* json, size_t len, unsigned threads, size_t chunk,
+                          JSplitPlan& plan, bool validate_utf8) {
+  plan = JSplitPlan();
+  size_t first = 0, last = len;
+  while (first < len && jst_is_ws(json[first])) first++;
+  while (last > first && jst_is_ws(json[last - 1])) last--;
+  if (last - first < 2 || (json[first] != '[' && json[first] != '{') ||
+      json[last - 1] != jst_closing(json[first])) {
+    return false;
+  }
+
+  std::vector<JChunk> chunks;
+  if (jst_prepare_chunks(json, len, threads, validate_utf8, chunks, nullptr) != JST_PARSE_OK) {
+    return false;
+  }
+  jst_parallel_for(chunks.size(), threads, [&](size_t k) { jst_match_chunk(json, chunks[k]); });
+
+  // pair the leftovers of consecutive chunks: that yields every container crossing a chunk
+  // boundary, and any container holding more than half of the input crosses one. The innermost
+  // of those is split; the root if there is none.
+  plan.open = first;
+  plan.close = last - 1;
+  plan.depth = 1;
+  std::vector<uint64_t> stack;
+  for (auto& part : chunks) {
+    if (part.too_deep) return false;
+    part.depth = stack.size();
+    for (uint64_t close : part.closes) {
+      if (stack.empty() || json[close] != jst_closing(json[stack.back()])) return false;
+      size_t open = stack.back(), depth = stack.size();
+      stack.pop_back();
+      if (depth == 1 && (open != first || close != last - 1)) return false;
+      if (depth > plan.depth && 2 * (close - open) > last - first) {
+        plan.open = open;
+        plan.close = close;
+        plan.depth = depth;
+      }
+    }
+    stack.insert(stack.end(), part.opens.begin(), part.opens.end());
+    if (stack.size() > JST_SPLIT_MAX_DEPTH) return false;
+    std::vector<uint64_t>().swap(part.opens);
+    std::vector<uint64_t>().swap(part.closes);
+  }
+  if (!stack.empty()) return false;
+
+  // the commas between members of the chosen container, at most one per `chunk` bytes within
+  // every chunk; the merge below thins them to one per `chunk` bytes overall.
+  chunk = std::max<size_t>(chunk, 1);
+  jst_parallel_for(chunks.size(), threads, [&](size_t k) {
+    JChunk& part = chunks[k];
+    if (part.end <= plan.open || part.begin > plan.close) return;
+    size_t depth = part.depth, next = part.begin;
+    jst_scan_chunk(json, part, [&](size_t pos, char c) {
+      if (c == '[' || c == '{') {
+        depth++;
+      } else if (c == ']' || c == '}') {
+        depth--;
+      } else if (c == ',' && depth == plan.depth && pos > plan.open && pos < plan.close &&
+                 pos >= next) {
+        part.commas.push_back(pos);
+        next = pos + chunk;
+      }
+    });
+  });
+
+  size_t next_split = plan.open + 1 + chunk;
+  plan.bounds.push_back(plan.open + 1);
+  for (auto& part : chunks) {
+    for (uint64_t pos : part.commas) {
+      if (pos < next_split) continue;
+      plan.bounds.push_back(pos + 1);
+      next_split = pos + chunk;
+    }
+  }
+  plan.bounds.push_back(plan.close);
+  return plan.bounds.size() > 2;
+}
+
+}  // namespace jst
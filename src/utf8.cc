@@ -0,0 +1,388 @@
+#include "utf8.h"
+
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define JST_HAVE_SSE2 1
+#define JST_HAVE_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#define JST_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace jst {
+
+const int8_t jst_hex_table[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  // 0x00
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  // 0x10
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  // 0x20
+    0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  -1, -1, -1, -1, -1, -1,  // 0x30
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,  // 0x40
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  // 0x50
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,  // 0x60
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  // 0x70
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  // 0x80
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  // 0x90
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  // 0xA0
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  // 0xB0
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  // 0xC0
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  // 0xD0
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  // 0xE0
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  // 0xF0
+};
+
+// rows past 0x7F are all zero.
+const char jst_escape_table[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 0x00
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 0x10
+    0, 0, '"', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '/',  // 0x20
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 0x30
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 0x40
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '\\', 0, 0, 0,  // 0x50
+    0, 0, '\b', 0, 0, 0, '\f', 0, 0, 0, 0, 0, 0, 0, '\n', 0,  // 0x60
+    0, 0, '\r', 0, '\t', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 0x70
+};
+
+static inline bool jst_is_special(unsigned char c, bool ascii_only) {
+  return c == '"' || c == '\\' || c < 0x20 || (ascii_only && c >= 0x80);
+}
+
+static size_t jst_scan_plain_scalar(const char* s, size_t len, bool ascii_only) {
+  size_t i = 0;
+  while (i < len && !jst_is_special((unsigned char)s[i], ascii_only)) i++;
+  return i;
+}
+
+#ifdef JST_HAVE_SSE2
+static size_t jst_scan_plain_sse2(const char* s, size_t len, bool ascii_only) {
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i bslash = _mm_set1_epi8('\\');
+  const __m128i ctrl = _mm_set1_epi8(0x1F);
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+    // v <= 0x1F (unsigned) exactly when min(v, 0x1F) == v.
+    __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, bslash)),
+                             _mm_cmpeq_epi8(_mm_min_epu8(v, ctrl), v));
+    unsigned mask = _mm_movemask_epi8(m);
+    if (ascii_only) mask |= _mm_movemask_epi8(v);
+    if (mask != 0) return i + __builtin_ctz(mask);
+  }
+  return i + jst_scan_plain_scalar(s + i, len - i, ascii_only);
+}
+#endif
+
+#ifdef JST_HAVE_AVX2
+__attribute__((target("avx2"))) static size_t jst_scan_plain_avx2(const char* s, size_t len,
+                                                                  bool ascii_only) {
+  const __m256i quote = _mm256_set1_epi8('"');
+  const __m256i bslash = _mm256_set1_epi8('\\');
+  const __m256i ctrl = _mm256_set1_epi8(0x1F);
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(s + i));
+    __m256i m =
+        _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, bslash)),
+                        _mm256_cmpeq_epi8(_mm256_min_epu8(v, ctrl), v));
+    unsigned mask = _mm256_movemask_epi8(m);
+    if (ascii_only) mask |= _mm256_movemask_epi8(v);
+    if (mask != 0) return i + __builtin_ctz(mask);
+  }
+  return i + jst_scan_plain_sse2(s + i, len - i, ascii_only);
+}
+#endif
+
+typedef size_t (*jst_scan_func)(const char*, size_t, bool);
+
+static jst_scan_func jst_select_scan() {
+#ifdef JST_HAVE_AVX2
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return jst_scan_plain_avx2;
+#endif
+#ifdef JST_HAVE_SSE2
+  return jst_scan_plain_sse2;
+#else
+  return jst_scan_plain_scalar;
+#endif
+}
+
+static const jst_scan_func jst_scan_impl = jst_select_scan();
+
+size_t jst_scan_plain(const char* s, size_t len, bool ascii_only) {
+  return jst_scan_impl(s, len, ascii_only);
+}
+
+// Scalar fallback and tail: ASCII is skipped a vector at a time with SSE2, and only the
+// non-ASCII sequences are decoded one by one.
+static size_t jst_ascii_run(const char* s, size_t len) {
+  size_t i = 0;
+#ifdef JST_HAVE_SSE2
+  for (; i + 16 <= len; i += 16) {
+    unsigned mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(s + i)));
+    if (mask != 0) return i + __builtin_ctz(mask);
+  }
+#endif
+  while (i < len && (unsigned char)s[i] < 0x80) i++;
+  return i;
+}
+
+static size_t jst_utf8_prefix_scalar(const char* s, size_t len, bool plain) {
+  size_t i = 0;
+  while (i < len) {
+    size_t run = plain ? jst_scan_plain(s + i, len - i, true) : jst_ascii_run(s + i, len - i);
+    i += run;
+    if (i >= len || (unsigned char)s[i] < 0x80) break;  // a special character
+    while (i < len && (unsigned char)s[i] >= 0x80) {
+      size_t n = jst_utf8_sequence((const unsigned char*)s + i, len - i);
+      if (n == 0) return i;
+      i += n;
+    }
+  }
+  return i;
+}
+
+#ifdef JST_HAVE_AVX2
+// The lookup validator of Keiser and Lemire ("Validating UTF-8 In Less Than One Instruction Per
+// Byte"): three 16-entry tables, indexed by the high and low nibble of each byte's predecessor
+// and by the high nibble of the byte itself, hold one bit per kind of error. Their AND is
+// nonzero exactly where a two-byte pattern is invalid; the third and fourth bytes of long
+// sequences are checked by comparing "must be a continuation" against what the tables saw.
+#define JST_UTF8_TOO_SHORT 0x01
+#define JST_UTF8_TOO_LONG 0x02
+#define JST_UTF8_OVERLONG_3 0x04
+#define JST_UTF8_TOO_LARGE 0x08
+#define JST_UTF8_SURROGATE 0x10
+#define JST_UTF8_OVERLONG_2 0x20
+#define JST_UTF8_TOO_LARGE_1000 0x40
+#define JST_UTF8_OVERLONG_4 0x40
+#define JST_UTF8_TWO_CONTS 0x80
+#define JST_UTF8_CARRY (JST_UTF8_TOO_SHORT | JST_UTF8_TOO_LONG | JST_UTF8_TWO_CONTS)
+
+static const uint8_t jst_utf8_byte1_high[16] = {
+    // 0___: ASCII followed by a continuation
+    JST_UTF8_TOO_LONG, JST_UTF8_TOO_LONG, JST_UTF8_TOO_LONG, JST_UTF8_TOO_LONG, JST_UTF8_TOO_LONG,
+    JST_UTF8_TOO_LONG, JST_UTF8_TOO_LONG, JST_UTF8_TOO_LONG,
+    // 10__: a continuation
+    JST_UTF8_TWO_CONTS, JST_UTF8_TWO_CONTS, JST_UTF8_TWO_CONTS, JST_UTF8_TWO_CONTS,
+    // 1100, 1101: two-byte leads
+    JST_UTF8_TOO_SHORT | JST_UTF8_OVERLONG_2, JST_UTF8_TOO_SHORT,
+    // 1110: three-byte lead
+    JST_UTF8_TOO_SHORT | JST_UTF8_OVERLONG_3 | JST_UTF8_SURROGATE,
+    // 1111: four-byte lead
+    JST_UTF8_TOO_SHORT | JST_UTF8_TOO_LARGE | JST_UTF8_TOO_LARGE_1000 | JST_UTF8_OVERLONG_4};
+
+static const uint8_t jst_utf8_byte1_low[16] = {
+    JST_UTF8_CARRY | JST_UTF8_OVERLONG_3 | JST_UTF8_OVERLONG_2 | JST_UTF8_OVERLONG_4,
+    JST_UTF8_CARRY | JST_UTF8_OVERLONG_2,
+    JST_UTF8_CARRY,
+    JST_UTF8_CARRY,
+    JST_UTF8_CARRY | JST_UTF8_TOO_LARGE,
+    JST_UTF8_CARRY | JST_UTF8_TOO_LARGE | JST_UTF8_TOO_LARGE_1000,
+    JST_UTF8_CARRY | JST_UTF8_TOO_LARGE | JST_UTF8_TOO_LARGE_1000,
+    JST_UTF8_CARRY | JST_UTF8_TOO_LARGE | JST_UTF8_TOO_LARGE_1000,
+    JST_UTF8_CARRY | JST_UTF8_TOO_LARGE | JST_UTF8_TOO_LARGE_1000,
+    JST_UTF8_CARRY | JST_UTF8_TOO_LARGE | JST_UTF8_TOO_LARGE_1000,
+    JST_UTF8_CARRY | JST_UTF8_TOO_LARGE | JST_UTF8_TOO_LARGE_1000,
+    JST_UTF8_CARRY | JST_UTF8_TOO_LARGE | JST_UTF8_TOO_LARGE_1000,
+    JST_UTF8_CARRY | JST_UTF8_TOO_LARGE | JST_UTF8_TOO_LARGE_1000,
+    JST_UTF8_CARRY | JST_UTF8_TOO_LARGE | JST_UTF8_TOO_LARGE_1000 | JST_UTF8_SURROGATE,
+    JST_UTF8_CARRY | JST_UTF8_TOO_LARGE | JST_UTF8_TOO_LARGE_1000,
+    JST_UTF8_CARRY | JST_UTF8_TOO_LARGE | JST_UTF8_TOO_LARGE_1000};
+
+static const uint8_t jst_utf8_byte2_high[16] = {
+    // 0___: a lead followed by ASCII
+    JST_UTF8_TOO_SHORT, JST_UTF8_TOO_SHORT, JST_UTF8_TOO_SHORT, JST_UTF8_TOO_SHORT,
+    JST_UTF8_TOO_SHORT, JST_UTF8_TOO_SHORT, JST_UTF8_TOO_SHORT, JST_UTF8_TOO_SHORT,
+    // 1000, 1001, 101_: continuations
+    JST_UTF8_TOO_LONG | JST_UTF8_OVERLONG_2 | JST_UTF8_TWO_CONTS | JST_UTF8_OVERLONG_3 |
+        JST_UTF8_TOO_LARGE_1000 | JST_UTF8_OVERLONG_4,
+    JST_UTF8_TOO_LONG | JST_UTF8_OVERLONG_2 | JST_UTF8_TWO_CONTS | JST_UTF8_OVERLONG_3 |
+        JST_UTF8_TOO_LARGE,
+    JST_UTF8_TOO_LONG | JST_UTF8_OVERLONG_2 | JST_UTF8_TWO_CONTS | JST_UTF8_SURROGATE |
+        JST_UTF8_TOO_LARGE,
+    JST_UTF8_TOO_LONG | JST_UTF8_OVERLONG_2 | JST_UTF8_TWO_CONTS | JST_UTF8_SURROGATE |
+        JST_UTF8_TOO_LARGE,
+    // 11__: a lead followed by a lead
+    JST_UTF8_TOO_SHORT, JST_UTF8_TOO_SHORT, JST_UTF8_TOO_SHORT, JST_UTF8_TOO_SHORT};
+
+// Start of the last sequence before s[i], which the vector loop may have left unfinished.
+static size_t jst_utf8_resume(const char* s, size_t i) {
+  for (size_t k = 1; k <= 3 && k <= i; k++) {
+    if ((unsigned char)s[i - k] >= 0xC0) return i - k;
+  }
+  return i;
+}
+
+// Blocks are checked whole; at the first one with an error or, if plain is set, a special
+// character, the scalar loop takes over from the start of its first sequence and finds the
+// exact position.
+__attribute__((target("ssse3"))) static size_t jst_utf8_prefix_ssse3(const char* s, size_t len,
+                                                                     bool plain) {
+  const __m128i byte1_high = _mm_loadu_si128((const __m128i*)jst_utf8_byte1_high);
+  const __m128i byte1_low = _mm_loadu_si128((const __m128i*)jst_utf8_byte1_low);
+  const __m128i byte2_high = _mm_loadu_si128((const __m128i*)jst_utf8_byte2_high);
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+  // nonzero where the last bytes of a block start a sequence it does not finish.
+  const __m128i incomplete_max = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                               (char)0xEF, (char)0xDF, (char)0xBF);
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i bslash = _mm_set1_epi8('\\');
+  const __m128i ctrl = _mm_set1_epi8(0x1F);
+  __m128i prev = _mm_setzero_si128(), prev_incomplete = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+    __m128i error;
+    if (_mm_movemask_epi8(v) == 0) {
+      error = prev_incomplete;
+      prev_incomplete = _mm_setzero_si128();
+    } else {
+      __m128i prev1 = _mm_alignr_epi8(v, prev, 15);
+      __m128i special = _mm_and_si128(
+          _mm_and_si128(
+              _mm_shuffle_epi8(byte1_high, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+              _mm_shuffle_epi8(byte1_low, _mm_and_si128(prev1, nibble))),
+          _mm_shuffle_epi8(byte2_high, _mm_and_si128(_mm_srli_epi16(v, 4), nibble)));
+      __m128i third = _mm_subs_epu8(_mm_alignr_epi8(v, prev, 14), _mm_set1_epi8(0xE0 - 0x80));
+      __m128i fourth = _mm_subs_epu8(_mm_alignr_epi8(v, prev, 13), _mm_set1_epi8(0xF0 - 0x80));
+      __m128i must23 = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8((char)0x80));
+      error = _mm_xor_si128(must23, special);
+      prev_incomplete = _mm_subs_epu8(v, incomplete_max);
+    }
+    if (plain) {
+      error = _mm_or_si128(error, _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote),
+                                                            _mm_cmpeq_epi8(v, bslash)),
+                                               _mm_cmpeq_epi8(_mm_min_epu8(v, ctrl), v)));
+    }
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) != 0xFFFF) break;
+    prev = v;
+  }
+  i = jst_utf8_resume(s, i);
+  return i + jst_utf8_prefix_scalar(s + i, len - i, plain);
+}
+
+__attribute__((target("avx2"))) static size_t jst_utf8_prefix_avx2(const char* s, size_t len,
+                                                                   bool plain) {
+  const __m256i byte1_high =
+      _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)jst_utf8_byte1_high));
+  const __m256i byte1_low =
+      _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)jst_utf8_byte1_low));
+  const __m256i byte2_high =
+      _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)jst_utf8_byte2_high));
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  const __m256i incomplete_max = _mm256_setr_epi8(
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+      -1, -1, -1, -1, -1, -1, (char)0xEF, (char)0xDF, (char)0xBF);
+  const __m256i quote = _mm256_set1_epi8('"');
+  const __m256i bslash = _mm256_set1_epi8('\\');
+  const __m256i ctrl = _mm256_set1_epi8(0x1F);
+  __m256i prev = _mm256_setzero_si256(), prev_incomplete = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(s + i));
+    __m256i error;
+    if (_mm256_movemask_epi8(v) == 0) {
+      error = prev_incomplete;
+      prev_incomplete = _mm256_setzero_si256();
+    } else {
+      // the last 16 bytes of prev and the first 16 of v, to shift bytes in across the lanes.
+      __m256i carry = _mm256_permute2x128_si256(prev, v, 0x21);
+      __m256i prev1 = _mm256_alignr_epi8(v, carry, 15);
+      __m256i special = _mm256_and_si256(
+          _mm256_and_si256(_mm256_shuffle_epi8(
+                               byte1_high, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+                           _mm256_shuffle_epi8(byte1_low, _mm256_and_si256(prev1, nibble))),
+          _mm256_shuffle_epi8(byte2_high, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble)));
+      __m256i third =
+          _mm256_subs_epu8(_mm256_alignr_epi8(v, carry, 14), _mm256_set1_epi8(0xE0 - 0x80));
+      __m256i fourth =
+          _mm256_subs_epu8(_mm256_alignr_epi8(v, carry, 13), _mm256_set1_epi8(0xF0 - 0x80));
+      __m256i must23 =
+          _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+      error = _mm256_xor_si256(must23, special);
+      prev_incomplete = _mm256_subs_epu8(v, incomplete_max);
+    }
+    if (plain) {
+      error = _mm256_or_si256(
+          error, _mm256_or_si256(
+                     _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, bslash)),
+                     _mm256_cmpeq_epi8(_mm256_min_epu8(v, ctrl), v)));
+    }
+    if (!_mm256_testz_si256(error, error)) break;
+    prev = v;
+  }
+  i = jst_utf8_resume(s, i);
+  return i + jst_utf8_prefix_scalar(s + i, len - i, plain);
+}
+#endif
+
+typedef size_t (*jst_utf8_func)(const char*, size_t, bool);
+
+static jst_utf8_func jst_select_utf8() {
+#ifdef JST_HAVE_AVX2
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return jst_utf8_prefix_avx2;
+  if (__builtin_cpu_supports("ssse3")) return jst_utf8_prefix_ssse3;
+#endif
+  return jst_utf8_prefix_scalar;
+}
+
+static const jst_utf8_func jst_utf8_impl = jst_select_utf8();
+
+size_t jst_utf8_validate(const char* s, size_t len) { return jst_utf8_impl(s, len, false); }
+
+size_t jst_scan_plain_utf8(const char* s, size_t len) { return jst_utf8_impl(s, len, true); }
+
+size_t jst_count_newlines(const char* s, size_t len, size_t* last_line) {
+  size_t count = 0, last = 0, i = 0;
+#ifdef JST_HAVE_SSE2
+  const __m128i nl = _mm_set1_epi8('\n');
+  for (; i + 16 <= len; i += 16) {
+    unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(s + i)), nl));
+    if (mask != 0) {
+      count += __builtin_popcount(mask);
+      last = i + (31 - __builtin_clz(mask)) + 1;
+    }
+  }
+#endif
+  for (; i < len; i++) {
+    if (s[i] == '\n') {
+      count++;
+      last = i + 1;
+    }
+  }
+  if (last_line != nullptr) *last_line = last;
+  return count;
+}
+
+size_t jst_unescape(const char* src, size_t len, char* dst) {
+  char* out = dst;
+  size_t i = 0;
+  while (i < len) {
+    const char* bslash = (const char*)memchr(src + i, '\\', len - i);
+    size_t run = bslash == nullptr ? len - i : bslash - (src + i);
+    memcpy(out, src + i, run);
+    out += run;
+    i += run + 1;
+    if (bslash == nullptr) break;
+    char c = jst_escape_table[(unsigned char)src[i]];
+    if (c != 0) {
+      *out++ = c;
+      i++;
+      continue;
+    }
+    unsigned hex = 0, low_hex = 0;
+    jst_parse_hex4(src + i + 1, hex);
+    i += 5;
+    if (hex >= 0xD800 && hex <= 0xDBFF) {
+      jst_parse_hex4(src + i + 2, low_hex);
+      hex = 0x10000 + (hex - 0xD800) * 0x400 + (low_hex - 0xDC00);
+      i += 6;
+    }
+    out = jst_utf8_encode(hex, out);
+  }
+  return out - dst;
+}
+
+}  // namespace jst
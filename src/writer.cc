@@ -0,0 +1,137 @@
+#include "writer.h"
+
+#include <assert.h>
+
+#include <cstring>
+
+#include "enum.h"
+#include "format.h"
+
+namespace jst {
+
+JWriter::JWriter(std::string& out, size_t buffer_size)
+    : JWriter([&out](const char* s, size_t len) { out.append(s, len); }, buffer_size) {}
+
+JWriter::JWriter(FILE* fp, size_t buffer_size)
+    : JWriter([fp](const char* s, size_t len) { fwrite(s, 1, len, fp); }, buffer_size) {}
+
+JWriter::JWriter(Sink sink, size_t buffer_size) : sink(std::move(sink)) {
+  buffer.resize(buffer_size == 0 ? 1 : buffer_size);
+}
+
+JWriter::~JWriter() { flush(); }
+
+void JWriter::flush() {
+  if (this->used == 0) return;
+  sink(buffer.data(), this->used);
+  this->used = 0;
+}
+
+// Room for len bytes at the end of the buffer. A single item larger than the buffer grows it.
+char* JWriter::reserve(size_t len) {
+  if (this->used + len > buffer.size()) {
+    flush();
+    if (len > buffer.size()) buffer.resize(len);
+  }
+  char* ret = buffer.data() + this->used;
+  this->used += len;
+  return ret;
+}
+
+void JWriter::put(const char* s, size_t len) { memcpy(reserve(len), s, len); }
+
+void JWriter::put_c(char c) { *reserve(1) = c; }
+
+void JWriter::before_value() {
+  JST_DEBUG(!done());
+  if (levels.empty()) {
+    has_root = true;
+    return;
+  }
+  Level& level = levels.back();
+  if (level.is_object) {
+    JST_DEBUG(level.want_value);
+    level.want_value = false;
+    return;
+  }
+  if (!level.empty) put_c(',');
+  level.empty = false;
+}
+
+void JWriter::begin_object() {
+  before_value();
+  put_c('{');
+  levels.push_back({true, true, false});
+}
+
+void JWriter::end_object() {
+  JST_DEBUG(!levels.empty() && levels.back().is_object && !levels.back().want_value);
+  levels.pop_back();
+  put_c('}');
+}
+
+void JWriter::begin_array() {
+  before_value();
+  put_c('[');
+  levels.push_back({false, true, false});
+}
+
+void JWriter::end_array() {
+  JST_DEBUG(!levels.empty() && !levels.back().is_object);
+  levels.pop_back();
+  put_c(']');
+}
+
+void JWriter::key(const char* s, size_t len) {
+  JST_DEBUG(!levels.empty() && levels.back().is_object && !levels.back().want_value);
+  Level& level = levels.back();
+  if (!level.empty) put_c(',');
+  level.empty = false;
+  level.want_value = true;
+  size_t size = jst_escaped_size(s, len);
+  char* out = reserve(size + 1);
+  out = jst_escaped_write(s, len, out);
+  *out = ':';
+}
+
+void JWriter::key(const char* s) { key(s, strlen(s)); }
+
+void JWriter::null() {
+  before_value();
+  put("null", 4);
+}
+
+void JWriter::value(bool b) {
+  before_value();
+  if (b)
+    put("true", 4);
+  else
+    put("false", 5);
+}
+
+// Numbers are formatted once into room for the widest one and the unused tail is given back.
+void JWriter::put_number(const JNumber& num) {
+  before_value();
+  char* out = reserve(JST_NUMBER_MAX);
+  this->used -= JST_NUMBER_MAX - (jst_number_write(num, out) - out);
+}
+
+void JWriter::value(int64_t n) { put_number(JNumber::from_int(n)); }
+
+void JWriter::value(uint64_t n) { put_number(JNumber::from_uint(n)); }
+
+void JWriter::value(double n) { put_number(JNumber(n)); }
+
+void JWriter::value(const char* s, size_t len) {
+  before_value();
+  jst_escaped_write(s, len, reserve(jst_escaped_size(s, len)));
+}
+
+void JWriter::value(const char* s) { value(s, strlen(s)); }
+
+void JWriter::value(const JNode& jn) {
+  before_value();
+  jst_stringify_write(jn, reserve(jst_stringify_size(jn)));
+}
+
+}  // namespace jst
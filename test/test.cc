@@ -1,11 +1,11 @@
+#include <string>
+
 #include "basic.h"
 #include "parser.h"
+#include "utf8.h"
 #include "utils.h"
 
 namespace jst {
-static int main_ret = 0;
-static int test_count = 0;
-static int test_pass = 0;
 
 static void test_parse_expect_value() {
   TEST_ERROR(JST_PARSE_EXCEPT_VALUE, " ");
@@ -58,6 +58,7 @@ static void test_parse_invalid_string_escape() {
   TEST_ERROR(JST_PARSE_INVALID_STRING_ESCAPE, "\"\\'\"");
   TEST_ERROR(JST_PARSE_INVALID_STRING_ESCAPE, "\"\\0\"");
   TEST_ERROR(JST_PARSE_INVALID_STRING_ESCAPE, "\"\\x12\"");
+  TEST_ERROR(JST_PARSE_INVALID_STRING_ESCAPE, "\"\\u00e9\\n\\v\"");
 }
 
 static void test_parse_invalid_string_char() {
@@ -78,6 +79,8 @@ static void test_parse_invalid_unicode_hex() {
   TEST_ERROR(JST_PARSE_INVALID_UNICODE_HEX, "\"\\u00G0\"");
   TEST_ERROR(JST_PARSE_INVALID_UNICODE_HEX, "\"\\u000/\"");
   TEST_ERROR(JST_PARSE_INVALID_UNICODE_HEX, "\"\\u000G\"");
+  TEST_ERROR(JST_PARSE_INVALID_UNICODE_HEX, "\"\\u00e9\\u00G0\"");
+  TEST_ERROR(JST_PARSE_INVALID_UNICODE_HEX, "[\"a\\n\\u00e9\\u00");
 }
 
 static void test_parse_invalid_unicode_surrogate() {
@@ -119,6 +122,144 @@ static void test_parse_miss_comma_or_curly_bracket() {
   TEST_ERROR(JST_PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{\"a\":{}");
 }
 
+static void test_parse_invalid_utf8() {
+  JParserOptions opts;
+  opts.validate_utf8 = true;
+  TEST_ERROR_OPTIONS(JST_PARSE_INVALID_UTF8, "\"\x80\"", opts);             /* stray continuation */
+  TEST_ERROR_OPTIONS(JST_PARSE_INVALID_UTF8, "\"\xC0\xAF\"", opts);         /* overlong '/' */
+  TEST_ERROR_OPTIONS(JST_PARSE_INVALID_UTF8, "\"\xE0\x80\xAF\"", opts);     /* overlong '/' */
+  TEST_ERROR_OPTIONS(JST_PARSE_INVALID_UTF8, "\"\xED\xA0\x80\"", opts);     /* surrogate U+D800 */
+  TEST_ERROR_OPTIONS(JST_PARSE_INVALID_UTF8, "\"\xF4\x90\x80\x80\"", opts); /* above U+10FFFF */
+  TEST_ERROR_OPTIONS(JST_PARSE_INVALID_UTF8, "\"\xE2\x82\"", opts);         /* truncated */
+  TEST_ERROR_OPTIONS(JST_PARSE_INVALID_UTF8, "[\"ok\",{\"\xFF\":1}]", opts);
+  TEST_PARSE_OPTIONS("\"a\xC2\xA2\xE2\x82\xAC\xF0\x9D\x84\x9E\xF4\x8F\xBF\xBFz\"", opts);
+
+  /* the offending byte sits past the first few vector blocks */
+  std::string json = "[\"" + std::string(70, 'x') + "\xE2\x82\xAC" + std::string(3, 'y') + "\xE2\x28\"]";
+  JParser jc(json, opts);
+  EXPECT_EQ_RET(JST_PARSE_INVALID_UTF8, jc.parser());
+  EXPECT_EQ_SIZE_T(json.size() - 4, jc.error_offset());
+  EXPECT_EQ_SIZE_T(json.size() - 4, jst_utf8_validate(json.c_str(), json.size()));
+  EXPECT_EQ_SIZE_T(76, jst_utf8_validate(json.c_str(), 76));
+
+  /* without validation the bytes are passed through untouched */
+  jc = JParser(json);
+  EXPECT_EQ_RET(JST_PARSE_OK, jc.parser());
+}
+
+static size_t test_utf8_reference(const std::string& s, bool plain) {
+  size_t i = 0;
+  while (i < s.size()) {
+    unsigned char c = (unsigned char)s[i];
+    if (plain && (c == '"' || c == '\\' || c < 0x20)) break;
+    size_t n = jst_utf8_sequence((const unsigned char*)s.data() + i, s.size() - i);
+    if (n == 0) break;
+    i += n;
+  }
+  return i;
+}
+
+/* the vector validators against a sequence at a time, with errors at every block position */
+static void test_utf8_blocks() {
+  const char* valid[] = {"a", "z ", "\xC3\xA9", "\xE2\x82\xAC", "\xE4\xB8\xAD\xE6\x96\x87",
+                         "\xF0\x9D\x84\x9E", "\xF4\x8F\xBF\xBF", "\xEF\xBF\xBF", "\xDF\xBF"};
+  const char* bad[] = {"\x80", "\xC0\xAF", "\xE0\x80\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80",
+                       "\xE2\x82", "\xFF", "\xC2", "\xF0\x80\x80\x80", "\xF5\x80\x80\x80",
+                       "\"", "\\", "\x01", "\xE2\x82\xAC\xAC"};
+  unsigned seed = 1;
+  bool same = true;
+  for (int round = 0; round < 4000; round++) {
+    std::string s;
+    size_t target = round % 150;
+    while (s.size() < target) {
+      seed = seed * 1103515245 + 12345;
+      s += valid[(seed >> 16) % (sizeof(valid) / sizeof(valid[0]))];
+    }
+    seed = seed * 1103515245 + 12345;
+    if (round % 5 != 0) s += bad[(seed >> 16) % (sizeof(bad) / sizeof(bad[0]))];
+    s += std::string(round % 40, (round & 1) ? 'x' : '\xE4');
+    same = same && jst_utf8_validate(s.data(), s.size()) == test_utf8_reference(s, false);
+    same = same && jst_scan_plain_utf8(s.data(), s.size()) == test_utf8_reference(s, true);
+  }
+  EXPECT_TRUE(same);
+
+  std::string cjk;
+  for (int i = 0; i < 1000; i++) cjk += "\xE4\xB8\xAD\xE6\x96\x87\xF0\x9F\x98\x80";
+  EXPECT_EQ_SIZE_T(cjk.size(), jst_utf8_validate(cjk.data(), cjk.size()));
+  EXPECT_EQ_SIZE_T(cjk.size(), jst_scan_plain_utf8(cjk.data(), cjk.size()));
+  EXPECT_EQ_SIZE_T(cjk.size() - 1, jst_utf8_validate(cjk.data(), cjk.size() - 1) + 3);
+  cjk[5000] = '"';
+  EXPECT_EQ_SIZE_T(5000, jst_scan_plain_utf8(cjk.data(), cjk.size()));
+  EXPECT_EQ_SIZE_T(5001, jst_utf8_validate(cjk.data(), cjk.size()));
+}
+
+static void test_parse_resource_limit() {
+  JParserOptions opts;
+  opts.max_bytes = 8;
+  TEST_ERROR_OPTIONS(JST_PARSE_EXCEED_MAX_BYTES, "[1,2,3,4,5]", opts);
+  TEST_PARSE_OPTIONS("[1,2,3]", opts);
+
+  opts = JParserOptions();
+  opts.max_nodes = 4;
+  TEST_ERROR_OPTIONS(JST_PARSE_EXCEED_MAX_NODES, "[1,2,3,4]", opts);
+  TEST_ERROR_OPTIONS(JST_PARSE_EXCEED_MAX_NODES, "{\"a\":[1,2],\"b\":3}", opts);
+  TEST_PARSE_OPTIONS("[1,2,3]", opts);
+
+  opts = JParserOptions();
+  opts.max_string_length = 3;
+  TEST_ERROR_OPTIONS(JST_PARSE_EXCEED_MAX_STRING_LENGTH, "\"abcd\"", opts);
+  TEST_ERROR_OPTIONS(JST_PARSE_EXCEED_MAX_STRING_LENGTH, "[\"abc\",\"abcd\"]", opts);
+  TEST_ERROR_OPTIONS(JST_PARSE_EXCEED_MAX_STRING_LENGTH, "{\"abcd\":1}", opts);
+  TEST_PARSE_OPTIONS("[\"abc\",\"\\u00A2\"]", opts);
+
+  opts = JParserOptions();
+  opts.max_depth = 2;
+  TEST_ERROR_OPTIONS(JST_PARSE_EXCEED_MAX_DEPTH, "[[[]]]", opts);
+  TEST_ERROR_OPTIONS(JST_PARSE_EXCEED_MAX_DEPTH, "[{\"a\":[1]}]", opts);
+  TEST_PARSE_OPTIONS("[[1],[2]]", opts);
+
+  opts = JParserOptions();
+  opts.max_time_us = 1;
+  std::string big = "[";
+  for (int i = 0; i < 100000; i++) big += "[\"abcdefgh\",1.5],";
+  big += "0]";
+  TEST_ERROR_OPTIONS(JST_PARSE_TIMEOUT, big, opts);
+}
+
+static void test_parse_error_location() {
+  JParser jc("{\n  \"a\": [1, 2,\n    tru ]\n}");
+  EXPECT_EQ_RET(JST_PARSE_INVALID_VALUE, jc.parser());
+  JErrorInfo info = jc.error_info();
+  EXPECT_EQ_SIZE_T(20, info.offset);
+  EXPECT_EQ_SIZE_T(3, info.line);
+  EXPECT_EQ_SIZE_T(5, info.column);
+  EXPECT_EQ_STRING("    tru ]", info.context.c_str(), info.context.size());
+  EXPECT_EQ_SIZE_T(4, info.context_offset);
+
+  /* string errors point at the offending byte, not at the opening quote */
+  jc.reset("[\"ok\",\n \"a\\qb\"]");
+  EXPECT_EQ_RET(JST_PARSE_INVALID_STRING_ESCAPE, jc.parser());
+  info = jc.error_info(2);
+  EXPECT_EQ_SIZE_T(2, info.line);
+  EXPECT_EQ_SIZE_T(5, info.column);
+  EXPECT_EQ_STRING("a\\qb", info.context.c_str(), info.context.size());
+
+  jc.reset("\"abc");
+  EXPECT_EQ_RET(JST_PARSE_MISS_QUOTATION_MARK, jc.parser());
+  EXPECT_EQ_SIZE_T(4, jc.error_offset());
+
+  /* enough lines for the vector newline count to take over */
+  std::string json = "[";
+  for (int i = 0; i < 40; i++) json += "1,\n";
+  json += "  @]";
+  jc.reset(json);
+  EXPECT_EQ_RET(JST_PARSE_INVALID_VALUE, jc.parser());
+  info = jc.error_info();
+  EXPECT_EQ_SIZE_T(41, info.line);
+  EXPECT_EQ_SIZE_T(3, info.column);
+  EXPECT_EQ_STRING("  @]", info.context.c_str(), info.context.size());
+}
+
 static void test_equal() {
   TEST_EQUAL("true", "true", 1);
   TEST_EQUAL("true", "false", 0);
@@ -137,12 +278,18 @@ static void test_equal() {
   TEST_EQUAL("{}", "{}", 1);
   TEST_EQUAL("{}", "null", 0);
   TEST_EQUAL("{}", "[]", 0);
-  //     TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"a\":1,\"b\":2}", 1);
-  //     TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"b\":2,\"a\":1}", 1);
-  //     TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"a\":1,\"b\":3}", 0);
-  //     TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"a\":1,\"b\":2,\"c\":3}", 0);
-  //     TEST_EQUAL("{\"a\":{\"b\":{\"c\":{}}}}", "{\"a\":{\"b\":{\"c\":{}}}}", 1);
-  //     TEST_EQUAL("{\"a\":{\"b\":{\"c\":{}}}}", "{\"a\":{\"b\":{\"c\":[]}}}", 0);
+  TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"a\":1,\"b\":2}", 1);
+  TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"b\":2,\"a\":1}", 1);
+  TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"a\":1,\"b\":3}", 0);
+  TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"a\":1,\"b\":2,\"c\":3}", 0);
+  TEST_EQUAL("{\"a\":{\"b\":{\"c\":{}}}}", "{\"a\":{\"b\":{\"c\":{}}}}", 1);
+  TEST_EQUAL("{\"a\":{\"b\":{\"c\":{}}}}", "{\"a\":{\"b\":{\"c\":[]}}}", 0);
+  /* repeated keys count once per occurrence, in any order */
+  TEST_EQUAL("{\"a\":1,\"b\":2,\"a\":3}", "{\"a\":3,\"a\":1,\"b\":2}", 1);
+  TEST_EQUAL("{\"a\":1,\"b\":2,\"a\":3}", "{\"a\":1,\"b\":2,\"a\":1}", 0);
+  TEST_EQUAL("{\"a\":1,\"b\":2,\"a\":3}", "{\"a\":1,\"b\":2,\"b\":3}", 0);
+  TEST_EQUAL("{\"ab\":1,\"a\":2,\"\":3}", "{\"\":3,\"ab\":1,\"a\":2}", 1);
+  TEST_EQUAL("{\"ab\":1,\"a\":2}", "{\"ab\":2,\"a\":1}", 0);
 }
 
 static void test_copy() {
@@ -184,9 +331,13 @@ static void test_parse() {
   test_parse_invalid_unicode_hex();
   test_parse_invalid_unicode_surrogate();
   test_parse_miss_comma_or_square_bracket();
-  // test_parse_miss_key();
-  // test_parse_miss_colon();
-  // test_parse_miss_comma_or_curly_bracket();
+  test_parse_resource_limit();
+  test_parse_invalid_utf8();
+  test_utf8_blocks();
+  test_parse_miss_key();
+  test_parse_miss_colon();
+  test_parse_miss_comma_or_curly_bracket();
+  test_parse_error_location();
 }
 
 static void test_jst_str_node() {
@@ -273,8 +424,8 @@ int main() {
   jst::test_jst_str_node();
   jst::test_jst_num_node();
   jst::test_equal();
-  // jst::test_copy();
-  // jst::test_move();
+  jst::test_copy();
+  jst::test_move();
   jst::test_swap();
   printf("%d/%d (%3.2f%%) passed\n", jst::test_pass, jst::test_count,
          jst::test_pass * 100.0 / jst::test_count);
@@ -5,9 +5,6 @@
 #include "utils.h"
 
 namespace jst {
-static int main_ret = 0;
-static int test_count = 0;
-static int test_pass = 0;
 
 static void test_access_null() {
   JNode jn;
@@ -115,6 +112,15 @@ static void test_access_array() {
   a.clear();
   EXPECT_EQ_SIZE_T(0, a.size());
   EXPECT_EQ_SIZE_T(i, a.capacity()); /* capacity remains unchanged */
+
+  /* a full one-slot array grows on insert, and an rvalue is taken over */
+  JArray one(1);
+  e = JNode(JString("ab", 2));
+  const JData* moved = &e.data();
+  one.insert(0, std::move(e));
+  EXPECT_EQ_SIZE_T(2, one.size());
+  EXPECT_TRUE(&one[0].data() == moved);
+  EXPECT_EQ_TYPE(JST_NULL, one[1].type());
 }
 
 static void test_access_vector() {
@@ -267,6 +273,82 @@ static void test_access_object() {
   // lept_free(&o);
 }
 
+static JNode test_access_parse(const char* json) {
+  JParser jc(json);
+  EXPECT_EQ_RET(JST_PARSE_OK, jc.parser());
+  return std::move(jc.root);
+}
+
+static void test_access_equal() {
+  EXPECT_FALSE(test_access_parse("[1,2]") == test_access_parse("[2,1]"));
+  EXPECT_FALSE(test_access_parse("[1,1]") == test_access_parse("[1,2]"));
+  EXPECT_FALSE(test_access_parse("[\"a\",[]]") == test_access_parse("[[],\"a\"]"));
+  EXPECT_TRUE(test_access_parse("[1,[2,3]]") == test_access_parse("[1.0,[2,3e0]]"));
+  EXPECT_TRUE(test_access_parse("{\"a\":1,\"b\":[2]}") ==
+              test_access_parse("{\"b\":[2],\"a\":1}"));
+  EXPECT_FALSE(test_access_parse("{\"a\":1,\"b\":2}") == test_access_parse("{\"a\":1,\"c\":2}"));
+  EXPECT_FALSE(test_access_parse("{\"a\":1,\"b\":2}") == test_access_parse("{\"b\":1,\"a\":2}"));
+
+  JNode x = test_access_parse("{\"a\":[1,\"s\",null],\"b\":{\"c\":true,\"d\":100}}");
+  JNode y = test_access_parse("{\"b\":{\"d\":100,\"c\":true},\"a\":[1,\"s\",null]}");
+  EXPECT_FALSE(x.data().hashed());
+  EXPECT_TRUE(x.hash() == y.hash());
+  EXPECT_TRUE(x.data().hashed());
+  EXPECT_TRUE(x.hash() != test_access_parse("[1,\"s\",null]").hash());
+  EXPECT_TRUE(test_access_parse("[1,2]").hash() != test_access_parse("[2,1]").hash());
+  EXPECT_TRUE(test_access_parse("[100]").hash() == test_access_parse("[1e2]").hash());
+  // operator== joins numbers in [-1, 1], so the hash must too.
+  EXPECT_TRUE(JNode(0.5).hash() == JNode(-1.0).hash());
+
+  // a copy keeps the hash; changing it drops the hash of every container above.
+  JNode z = x;
+  EXPECT_TRUE(z.data().hashed());
+  EXPECT_TRUE(z == x);
+  JNode& a = z.mutable_data().as<JObject>()[0].get_value();
+  EXPECT_FALSE(z.data().hashed());
+  z.hash();
+  a.mutable_data().as<JArray>()[1] = JNode(2.0);
+  EXPECT_FALSE(z.data().hashed());
+  EXPECT_FALSE(a.data().hashed());
+  EXPECT_TRUE(z.hash() != x.hash());
+  EXPECT_FALSE(z == x);
+  a.mutable_data().as<JArray>()[1] = JNode(JST_STR, "s", 1);
+  EXPECT_TRUE(z.hash() == x.hash());
+  EXPECT_TRUE(z == x);
+  a.mutable_data().as<JArray>().push_back(JNode());
+  EXPECT_FALSE(z.data().hashed());
+  EXPECT_FALSE(z == x);
+
+  // repeated keys count once per occurrence, with hashes cached or not.
+  const char* dup_pairs[][2] = {{"{\"a\":1,\"x\":0,\"a\":2}", "{\"a\":1,\"a\":1,\"x\":0}"},
+                                {"{\"a\":1,\"a\":2}", "{\"a\":2,\"a\":2}"},
+                                {"{\"a\":1,\"a\":2,\"b\":3}", "{\"b\":3,\"a\":2,\"a\":1}"}};
+  for (size_t k = 0; k < 3; k++) {
+    JNode p = test_access_parse(dup_pairs[k][0]), q = test_access_parse(dup_pairs[k][1]);
+    bool cold = p == q;
+    EXPECT_TRUE(cold == (q == p));
+    EXPECT_TRUE(cold == (p.hash() == q.hash()));
+    EXPECT_TRUE(p.data().hashed() && q.data().hashed());
+    EXPECT_TRUE(cold == (p == q));
+    EXPECT_TRUE(cold == (q == p));
+    EXPECT_TRUE(cold == (k == 2));
+  }
+
+  // hashes both sides already hold settle a difference without a walk.
+  JArray big_1, big_2;
+  for (int i = 0; i < 1000; i++) {
+    big_1.push_back(JNode((double)i));
+    big_2.push_back(JNode((double)i));
+  }
+  JNode n1(std::move(big_1)), n2(std::move(big_2));
+  EXPECT_TRUE(n1 == n2);
+  n2.mutable_data().as<JArray>()[999] = JNode(-1.0);
+  n1.hash();
+  n2.hash();
+  EXPECT_FALSE(n1 == n2);
+  EXPECT_FALSE(n2 == n1);
+}
+
 static void test_access() {
   test_access_null();
   test_access_boolean();
@@ -274,6 +356,7 @@ static void test_access() {
   test_access_string();
   test_access_array();
   test_access_vector();
+  test_access_equal();
   // test_access_object();
 }
 }  // namespace jst
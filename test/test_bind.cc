@@ -0,0 +1,221 @@
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "bind.h"
+#include "utils.h"
+
+namespace shapes {
+using jst::JOptional;
+
+struct Point {
+  int x = 0;
+  double y = 0.0;
+  bool operator==(const Point& p) const { return x == p.x && y == p.y; }
+};
+JST_BIND(Point, x, y)
+
+struct Style {
+  std::string color;
+  JOptional<double> width;
+  bool operator==(const Style& s) const { return color == s.color && width == s.width; }
+};
+JST_BIND(Style, color, width)
+
+struct Path {
+  std::string name;
+  std::vector<Point> points;
+  JOptional<Style> style;
+  std::vector<std::vector<int64_t>> grid;
+  std::vector<JOptional<std::string>> tags;
+  bool closed = false;
+  uint8_t layer = 0;
+  uint64_t id = 0;
+};
+JST_BIND(Path, name, points, style, grid, tags, closed, layer, id)
+
+struct Wide {
+  int f00, f01, f02, f03, f04, f05, f06, f07, f08, f09, f10, f11, f12, f13, f14, f15;
+  int f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28, f29, f30, f31;
+};
+JST_BIND(Wide, f00, f01, f02, f03, f04, f05, f06, f07, f08, f09, f10, f11, f12, f13, f14, f15,
+         f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28, f29, f30, f31)
+}  // namespace shapes
+
+namespace jst {
+
+using shapes::Path;
+using shapes::Point;
+using shapes::Style;
+using shapes::Wide;
+
+static void test_bind_parse() {
+  Path path;
+  std::string json =
+      "{\"name\":\"tri\\u0061\", \"points\":[{\"x\":1,\"y\":2.5},{\"y\":-1,\"x\":-3}],"
+      "\"style\":{\"color\":\"red\",\"width\":null},\"grid\":[[1,2],[],[3]],"
+      "\"tags\":[\"a\",null],\"closed\":true,\"layer\":255,\"id\":18446744073709551615}";
+  EXPECT_EQ_RET(JST_PARSE_OK, jst_bind_parse(json, path));
+  EXPECT_TRUE(path.name == "tria");
+  EXPECT_EQ_SIZE_T(2, path.points.size());
+  EXPECT_TRUE(path.points[0] == (Point{1, 2.5}));
+  EXPECT_TRUE(path.points[1] == (Point{-3, -1.0}));
+  EXPECT_TRUE(path.style.has_value());
+  EXPECT_TRUE(path.style->color == "red");
+  EXPECT_FALSE(path.style->width.has_value());
+  EXPECT_EQ_SIZE_T(3, path.grid.size());
+  EXPECT_TRUE(path.grid[0] == (std::vector<int64_t>{1, 2}));
+  EXPECT_TRUE(path.grid[1].empty());
+  EXPECT_TRUE(path.grid[2] == (std::vector<int64_t>{3}));
+  EXPECT_EQ_SIZE_T(2, path.tags.size());
+  EXPECT_TRUE(path.tags[0].has_value() && *path.tags[0] == "a");
+  EXPECT_FALSE(path.tags[1].has_value());
+  EXPECT_TRUE(path.closed);
+  EXPECT_EQ_INT(255, path.layer);
+  EXPECT_TRUE(path.id == UINT64_MAX);
+
+  /* missing fields keep their values, null clears an optional */
+  json = "{\"style\":null, \"name\":\"b\"}";
+  EXPECT_EQ_RET(JST_PARSE_OK, jst_bind_parse(json, path));
+  EXPECT_TRUE(path.name == "b");
+  EXPECT_FALSE(path.style.has_value());
+  EXPECT_EQ_SIZE_T(2, path.points.size());
+  EXPECT_TRUE(path.closed);
+
+  /* the last of duplicate keys wins, arrays are replaced */
+  json = "{\"points\":[{\"x\":1}],\"points\":[],\"layer\":1,\"layer\":2}";
+  EXPECT_EQ_RET(JST_PARSE_OK, jst_bind_parse(json, path));
+  EXPECT_TRUE(path.points.empty());
+  EXPECT_EQ_INT(2, path.layer);
+
+  /* escaped keys are decoded before the lookup */
+  Point p;
+  json = "{\"\\u0078\":7,\"\\u0079\":0.5}";
+  EXPECT_EQ_RET(JST_PARSE_OK, jst_bind_parse(json, p));
+  EXPECT_TRUE(p == (Point{7, 0.5}));
+}
+
+static void test_bind_unknown() {
+  Point p;
+  std::string json =
+      "{\"z\":{\"a\":[1,{\"x\":9}],\"b\":\"}\"},\"x\":4,\"xx\":5,\"\":6,\"X\":[],\"y\":1,"
+      "\"yy\":null}";
+  EXPECT_EQ_RET(JST_PARSE_OK, jst_bind_parse(json, p));
+  EXPECT_TRUE(p == (Point{4, 1.0}));
+
+  /* every field of a wide struct is found, and nothing else */
+  Wide w;
+  std::string wide = "{";
+  for (int i = 0; i < 32; i++) {
+    char key[8];
+    snprintf(key, sizeof(key), "f%02d", i);
+    wide += std::string(i == 0 ? "" : ",") + "\"" + key + "\":" + std::to_string(i * 3) +
+            ",\"g" + (key + 1) + "\":-1";
+  }
+  wide += "}";
+  EXPECT_EQ_RET(JST_PARSE_OK, jst_bind_parse(wide, w));
+  EXPECT_EQ_INT(0, w.f00);
+  EXPECT_EQ_INT(30, w.f10);
+  EXPECT_EQ_INT(48, w.f16);
+  EXPECT_EQ_INT(93, w.f31);
+  std::string out;
+  jst_bind_stringify(w, out);
+  Wide w2;
+  EXPECT_EQ_RET(JST_PARSE_OK, jst_bind_parse(out, w2));
+  EXPECT_TRUE(memcmp(&w, &w2, sizeof(w)) == 0);
+}
+
+#define TEST_BIND_ERROR(expect, offset, type, json)           \
+  do {                                                        \
+    type v;                                                   \
+    size_t err_offset = 0;                                    \
+    std::string j(json);                                      \
+    JRetType ret = jst_bind_parse(j, v, &err_offset);         \
+    EXPECT_EQ_RET(expect, ret);                               \
+    EXPECT_EQ_SIZE_T((size_t)(offset), err_offset);           \
+  } while (0)
+
+static void test_bind_error() {
+  TEST_BIND_ERROR(JST_PARSE_TYPE_MISMATCH, 0, Point, "[]");
+  TEST_BIND_ERROR(JST_PARSE_TYPE_MISMATCH, 5, Point, "{\"x\":\"1\"}");
+  TEST_BIND_ERROR(JST_PARSE_TYPE_MISMATCH, 5, Point, "{\"x\":1.5}");
+  TEST_BIND_ERROR(JST_PARSE_TYPE_MISMATCH, 5, Point, "{\"y\":true}");
+  TEST_BIND_ERROR(JST_PARSE_TYPE_MISMATCH, 5, Point, "{\"x\":null}");
+  TEST_BIND_ERROR(JST_PARSE_TYPE_MISMATCH, 10, Path, "{\"points\":{}}");
+  TEST_BIND_ERROR(JST_PARSE_TYPE_MISMATCH, 11, Path, "{\"points\":[1]}");
+  TEST_BIND_ERROR(JST_PARSE_TYPE_MISMATCH, 9, Path, "{\"tags\":[1]}");
+  TEST_BIND_ERROR(JST_PARSE_TYPE_MISMATCH, 10, Path, "{\"closed\":0}");
+  TEST_BIND_ERROR(JST_PARSE_NUMBER_TOO_BIG, 9, Path, "{\"layer\":256}");
+  TEST_BIND_ERROR(JST_PARSE_NUMBER_TOO_BIG, 9, Path, "{\"layer\":-1}");
+  TEST_BIND_ERROR(JST_PARSE_NUMBER_TOO_BIG, 5, Point, "{\"x\":2147483648}");
+  TEST_BIND_ERROR(JST_PARSE_NUMBER_TOO_BIG, 5, Point, "{\"x\":-2147483649}");
+  TEST_BIND_ERROR(JST_PARSE_NUMBER_TOO_BIG, 6, Path, "{\"id\":-1}");
+
+  /* syntax errors are the reader's */
+  TEST_BIND_ERROR(JST_PARSE_MISS_COLON, 5, Point, "{\"x\" 1}");
+  TEST_BIND_ERROR(JST_PARSE_MISS_COMMA_OR_CURLY_BRACKET, 6, Point, "{\"x\":1");
+  TEST_BIND_ERROR(JST_PARSE_INVALID_VALUE, 5, Point, "{\"x\":?}");
+  TEST_BIND_ERROR(JST_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, 13, Path, "{\"points\":[{}}");
+  TEST_BIND_ERROR(JST_PARSE_SINGULAR, 3, Point, "{} {} ");
+  TEST_BIND_ERROR(JST_PARSE_EXCEPT_VALUE, 0, Point, "");
+}
+
+static void test_bind_stringify() {
+  Path path;
+  path.name = "a\"b";
+  path.points = {{1, 0.5}, {-2, -2.5e10}};
+  path.grid = {{}, {-9223372036854775807LL - 1}};
+  path.tags = {JOptional<std::string>("t"), JOptional<std::string>()};
+  path.layer = 7;
+  path.id = UINT64_MAX;
+  std::string out;
+  jst_bind_stringify(path, out);
+  /* the empty optional field is left out, empty optionals in arrays are null */
+  EXPECT_TRUE(out ==
+              "{\"name\":\"a\\\"b\",\"points\":[{\"x\":1,\"y\":0.5},{\"x\":-2,\"y\":-25000000000}],"
+              "\"grid\":[[],[-9223372036854775808]],\"tags\":[\"t\",null],\"closed\":false,"
+              "\"layer\":7,\"id\":18446744073709551615}");
+
+  path.style = Style{"blue", JOptional<double>(2.0)};
+  jst_bind_stringify(path, out);
+  Path back;
+  EXPECT_EQ_RET(JST_PARSE_OK, jst_bind_parse(out, back));
+  EXPECT_TRUE(back.name == path.name);
+  EXPECT_TRUE(back.points == path.points);
+  EXPECT_TRUE(back.style == path.style);
+  EXPECT_TRUE(back.grid == path.grid);
+  EXPECT_TRUE(back.tags == path.tags);
+  EXPECT_TRUE(back.layer == path.layer && back.id == path.id && back.closed == path.closed);
+
+  /* a top-level vector and a writer shared with other calls */
+  std::vector<Point> points = {{3, 4.0}};
+  out.clear();
+  {
+    JWriter w(out);
+    w.begin_array();
+    jst_bind_write(w, points);
+    w.value("tail");
+    w.end_array();
+  }
+  EXPECT_TRUE(out == "[[{\"x\":3,\"y\":4}],\"tail\"]");
+}
+
+static void test_bind() {
+  test_bind_parse();
+  test_bind_unknown();
+  test_bind_error();
+  test_bind_stringify();
+}
+
+}  // namespace jst
+
+int main() {
+#ifdef _WINDOWS
+  _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif
+  jst::test_bind();
+  printf("%d/%d (%3.2f%%) passed\n", jst::test_pass, jst::test_count,
+         jst::test_pass * 100.0 / jst::test_count);
+  return jst::main_ret;
+}
@@ -0,0 +1,276 @@
+#include <stdio.h>
+
+#include <string>
+
+#include "diff.h"
+#include "parser.h"
+#include "patch.h"
+#include "utils.h"
+
+namespace jst {
+
+// Arrays in order, objects by key.
+static bool test_same(const JNode& a, const JNode& b) {
+  if (a.type() != b.type()) return false;
+  if (a.type() == JST_ARR) {
+    const JArray& x = a.data().as<JArray>();
+    const JArray& y = b.data().as<JArray>();
+    if (x.size() != y.size()) return false;
+    for (size_t i = 0; i < x.size(); i++) {
+      if (!test_same(x[i], y[i])) return false;
+    }
+    return true;
+  }
+  if (a.type() == JST_OBJ) {
+    const JObject& x = a.data().as<JObject>();
+    const JObject& y = b.data().as<JObject>();
+    if (x.size() != y.size()) return false;
+    for (size_t i = 0; i < x.size(); i++) {
+      const JNode* v = y.find_value(x.get_key(i));
+      if (v == nullptr || !test_same(x.get_value(i), *v)) return false;
+    }
+    return true;
+  }
+  return a == b;
+}
+
+// The patch turns from into to.
+static bool test_round_trip(const JNode& from, const JNode& to, const JNode& ops) {
+  JPatch p;
+  if (p.compile(ops) != JST_PARSE_OK) return false;
+  JNode doc = from;
+  return p.apply(doc) == JST_PARSE_OK && test_same(doc, to);
+}
+
+#define TEST_DIFF(expect, from, to)                              \
+  do {                                                           \
+    JNode a = test_parse(from), b = test_parse(to);              \
+    JNode ops = jst_diff(a, b);                                  \
+    EXPECT_TRUE(test_json(ops) == test_json(test_parse(expect))); \
+    EXPECT_TRUE(test_round_trip(a, b, ops));                     \
+  } while (0)
+
+static void test_diff_basic() {
+  TEST_DIFF("[]", "{\"a\":[1,{\"b\":null}],\"c\":\"d\"}", "{\"c\":\"d\",\"a\":[1,{\"b\":null}]}");
+  TEST_DIFF("[]", "1", "1.0");
+  TEST_DIFF("[{\"op\":\"replace\",\"path\":\"\",\"value\":[1]}]", "{\"a\":1}", "[1]");
+  TEST_DIFF("[{\"op\":\"replace\",\"path\":\"/a\",\"value\":\"1\"}]", "{\"a\":1}", "{\"a\":\"1\"}");
+  TEST_DIFF("[{\"op\":\"replace\",\"path\":\"/a\",\"value\":false}]", "{\"a\":true}",
+            "{\"a\":false}");
+  TEST_DIFF("[{\"op\":\"remove\",\"path\":\"/b\"},{\"op\":\"add\",\"path\":\"/c\",\"value\":3}]",
+            "{\"a\":1,\"b\":2}", "{\"a\":1,\"c\":3}");
+  TEST_DIFF("[{\"op\":\"replace\",\"path\":\"/a~1b/~0\",\"value\":2}]", "{\"a/b\":{\"~\":1}}",
+            "{\"a/b\":{\"~\":2}}");
+  /* a changed member of a record is one replace */
+  TEST_DIFF("[{\"op\":\"replace\",\"path\":\"/1/name\",\"value\":\"B\"}]",
+            "[{\"id\":1,\"name\":\"a\"},{\"id\":2,\"name\":\"b\"},{\"id\":3,\"name\":\"c\"}]",
+            "[{\"id\":1,\"name\":\"a\"},{\"id\":2,\"name\":\"B\"},{\"id\":3,\"name\":\"c\"}]");
+  /* arrays line up along the longest common subsequence */
+  TEST_DIFF("[{\"op\":\"add\",\"path\":\"/1\",\"value\":9}]", "[1,2,3]", "[1,9,2,3]");
+  TEST_DIFF("[{\"op\":\"remove\",\"path\":\"/0\"},{\"op\":\"add\",\"path\":\"/3\",\"value\":5}]",
+            "[0,1,2,3]", "[1,2,3,5]");
+  TEST_DIFF("[{\"op\":\"remove\",\"path\":\"/1\"},{\"op\":\"remove\",\"path\":\"/1\"}]",
+            "[1,2,3,4]", "[1,4]");
+  TEST_DIFF("[{\"op\":\"add\",\"path\":\"/0\",\"value\":\"x\"},"
+            "{\"op\":\"add\",\"path\":\"/2\",\"value\":\"y\"},"
+            "{\"op\":\"add\",\"path\":\"/4\",\"value\":\"z\"}]",
+            "[\"a\",\"b\"]", "[\"x\",\"a\",\"y\",\"b\",\"z\"]");
+  TEST_DIFF("[{\"op\":\"replace\",\"path\":\"/1\",\"value\":5},"
+            "{\"op\":\"remove\",\"path\":\"/2\"}]",
+            "[1,2,3,4]", "[1,5,4]");
+  TEST_DIFF("[{\"op\":\"remove\",\"path\":\"/0\"},{\"op\":\"add\",\"path\":\"/1\",\"value\":1}]",
+            "[1,2]", "[2,1]");
+  TEST_DIFF("[{\"op\":\"add\",\"path\":\"/0/0\",\"value\":0}]", "[[1],[1]]", "[[0,1],[1]]");
+  /* small numbers line up by value, though JNode::hash() does not tell them apart */
+  TEST_DIFF("[{\"op\":\"remove\",\"path\":\"/0\"}]", "[0.1,0.2,0.3]", "[0.2,0.3]");
+}
+
+// The subtree hashes stay in the trees, and a change to one is seen by the next diff.
+static void test_diff_cached() {
+  JNode a = test_parse("{\"list\":[{\"x\":[1,2]},{\"y\":3}],\"z\":{}}");
+  JNode b = a;
+  EXPECT_FALSE(a.data().hashed());
+  EXPECT_TRUE(jst_diff(a, b).data().as<JArray>().empty());
+  EXPECT_TRUE(a.data().hashed());
+  EXPECT_TRUE(b.data().hashed());
+  EXPECT_TRUE(a.data().as<JObject>().get_value(0).data().hashed());
+
+  JArray& list = b.mutable_data().as<JObject>().get_value(0).mutable_data().as<JArray>();
+  list[1].mutable_data().as<JObject>().get_value(0) = JNode(4.0);
+  JNode ops = jst_diff(a, b);
+  EXPECT_TRUE(test_json(ops) == "[{\"op\":\"replace\",\"path\":\"/list/1/y\",\"value\":4}]");
+  EXPECT_TRUE(test_round_trip(a, b, ops));
+}
+
+static void test_diff_keyed() {
+  const char* from = "[{\"id\":1,\"v\":\"a\"},{\"id\":2,\"v\":\"b\"},{\"id\":3,\"v\":\"c\"}]";
+  const char* to = "[{\"id\":2,\"v\":\"B\"},{\"id\":3,\"v\":\"c\"},{\"id\":4,\"v\":\"d\"}]";
+  JNode a = test_parse(from), b = test_parse(to);
+
+  /* by content, only {"id":3,...} lines up and the first record is rewritten into the second */
+  JNode ops = jst_diff(a, b);
+  EXPECT_TRUE(test_round_trip(a, b, ops));
+  EXPECT_EQ_SIZE_T(4, ops.data().as<JArray>().size());
+
+  JDiffOptions opts;
+  opts.array_key = "id";
+  ops = jst_diff(a, b, opts);
+  EXPECT_TRUE(test_round_trip(a, b, ops));
+  EXPECT_TRUE(test_json(ops) ==
+              "[{\"op\":\"remove\",\"path\":\"/0\"},"
+              "{\"op\":\"replace\",\"path\":\"/0/v\",\"value\":\"B\"},"
+              "{\"op\":\"add\",\"path\":\"/2\",\"value\":{\"id\":4,\"v\":\"d\"}}]");
+
+  /* lined up by the elements that occur once on each side instead */
+  opts.max_lcs_cells = 0;
+  ops = jst_diff(a, b, opts);
+  EXPECT_TRUE(test_round_trip(a, b, ops));
+}
+
+static void test_merge() {
+  /* RFC 7386, appendix A */
+  const char* cases[][3] = {
+      {"{\"a\":\"b\"}", "{\"a\":\"c\"}", "{\"a\":\"c\"}"},
+      {"{\"a\":\"b\"}", "{\"b\":\"c\"}", "{\"a\":\"b\",\"b\":\"c\"}"},
+      {"{\"a\":\"b\"}", "{\"a\":null}", "{}"},
+      {"{\"a\":\"b\",\"b\":\"c\"}", "{\"a\":null}", "{\"b\":\"c\"}"},
+      {"{\"a\":[\"b\"]}", "{\"a\":\"c\"}", "{\"a\":\"c\"}"},
+      {"{\"a\":\"c\"}", "{\"a\":[\"b\"]}", "{\"a\":[\"b\"]}"},
+      {"{\"a\":{\"b\":\"c\"}}", "{\"a\":{\"b\":\"d\",\"c\":null}}", "{\"a\":{\"b\":\"d\"}}"},
+      {"{\"a\":[{\"b\":\"c\"}]}", "{\"a\":[1]}", "{\"a\":[1]}"},
+      {"[\"a\",\"b\"]", "[\"c\",\"d\"]", "[\"c\",\"d\"]"},
+      {"{\"a\":\"b\"}", "[\"c\"]", "[\"c\"]"},
+      {"{\"a\":\"foo\"}", "null", "null"},
+      {"{\"a\":\"foo\"}", "\"bar\"", "\"bar\""},
+      {"{\"e\":null}", "{\"a\":1}", "{\"e\":null,\"a\":1}"},
+      {"[1,2]", "{\"a\":\"b\",\"c\":null}", "{\"a\":\"b\"}"},
+      {"{}", "{\"a\":{\"bb\":{\"ccc\":null}}}", "{\"a\":{\"bb\":{}}}"},
+  };
+  for (const auto& c : cases) {
+    JNode target = test_parse(c[0]);
+    jst_merge_apply(target, test_parse(c[1]));
+    EXPECT_TRUE(test_json(target) == c[2]);
+  }
+
+  JNode a = test_parse("{\"keep\":[1,2],\"drop\":true,\"deep\":{\"x\":1,\"y\":{\"z\":2}}}");
+  JNode b = test_parse("{\"keep\":[1,2],\"deep\":{\"x\":1,\"y\":{\"z\":3}},\"new\":[]}");
+  JNode patch = jst_merge_diff(a, b);
+  EXPECT_TRUE(test_json(patch) == "{\"drop\":null,\"deep\":{\"y\":{\"z\":3}},\"new\":[]}");
+  jst_merge_apply(a, patch);
+  EXPECT_TRUE(test_same(a, b));
+  EXPECT_TRUE(test_json(jst_merge_diff(b, b)) == "{}");
+  EXPECT_TRUE(test_json(jst_merge_diff(b, test_parse("[1]"))) == "[1]");
+}
+
+// Deterministic pseudo-random documents and edits of them.
+static uint64_t test_seed = 0x2545f4914f6cdd1dULL;
+
+static size_t test_rand(size_t n) {
+  test_seed = test_seed * 6364136223846793005ULL + 1442695040888963407ULL;
+  return (size_t)(test_seed >> 33) % n;
+}
+
+static JNode test_random(int depth, bool nulls) {
+  size_t kind = test_rand(depth > 0 ? 7 : 5);
+  switch (kind) {
+    case 0:
+      return nulls ? JNode(JST_NULL) : JNode(JST_TRUE);
+    case 1:
+      return JNode(test_rand(2) ? JST_TRUE : JST_FALSE);
+    case 2:
+      return JNode((double)test_rand(5));
+    case 3:
+    case 4:
+      return JNode(JString(std::string(1, (char)('a' + test_rand(4))).c_str(), 1));
+    case 5: {
+      JArray arr;
+      for (size_t i = test_rand(6); i > 0; i--) arr.push_back(test_random(depth - 1, nulls));
+      return JNode(std::move(arr));
+    }
+    default: {
+      JObject obj;
+      for (size_t i = test_rand(5); i > 0; i--) {
+        std::string key(1, (char)('k' + test_rand(6)));
+        if (obj.find_value(JString(key.c_str(), 1)) != nullptr) continue;
+        obj.push_back(JOjectElement(JString(key.c_str(), 1), test_random(depth - 1, nulls)));
+      }
+      return JNode(std::move(obj));
+    }
+  }
+}
+
+// A copy of v with a few of its values replaced, dropped or added.
+static JNode test_mutate(const JNode& v, int depth, bool nulls) {
+  if (test_rand(8) == 0) return test_random(depth, nulls);
+  if (v.type() == JST_ARR) {
+    const JArray& arr = v.data().as<JArray>();
+    JArray out;
+    for (size_t i = 0; i < arr.size(); i++) {
+      size_t r = test_rand(6);
+      if (r == 0) continue;
+      if (r == 1) out.push_back(test_random(depth - 1, nulls));
+      out.push_back(r == 2 ? test_mutate(arr[i], depth - 1, nulls) : arr[i]);
+    }
+    if (test_rand(3) == 0) out.push_back(test_random(depth - 1, nulls));
+    return JNode(std::move(out));
+  }
+  if (v.type() == JST_OBJ) {
+    const JObject& obj = v.data().as<JObject>();
+    JObject out;
+    for (size_t i = 0; i < obj.size(); i++) {
+      size_t r = test_rand(5);
+      if (r == 0) continue;
+      const JNode& value = obj.get_value(i);
+      out.push_back(JOjectElement(obj.get_key(i), r == 1 ? test_mutate(value, depth - 1, nulls)
+                                                         : value));
+    }
+    if (test_rand(3) == 0 && out.find_value(JString("n")) == nullptr) {
+      out.push_back(JOjectElement(JString("n"), test_random(depth - 1, nulls)));
+    }
+    return JNode(std::move(out));
+  }
+  return test_rand(3) == 0 ? test_random(depth, nulls) : v;
+}
+
+static void test_diff_random() {
+  JDiffOptions small;
+  small.max_lcs_cells = 4;
+  int ok = 0, merge_ok = 0;
+  for (int i = 0; i < 500; i++) {
+    JNode a = test_random(4, true);
+    JNode b = test_mutate(a, 4, true);
+    ok += test_round_trip(a, b, jst_diff(a, b));
+    ok += test_round_trip(b, a, jst_diff(b, a));
+    ok += test_round_trip(a, b, jst_diff(a, b, small));
+    ok += test_json(jst_diff(a, a)) == "[]";
+
+    /* merge patches cannot carry a null member */
+    JNode c = test_random(4, false);
+    JNode d = test_mutate(c, 4, false);
+    JNode merged = c;
+    jst_merge_apply(merged, jst_merge_diff(c, d));
+    merge_ok += test_same(merged, d);
+  }
+  EXPECT_EQ_INT(2000, ok);
+  EXPECT_EQ_INT(500, merge_ok);
+}
+
+static void test_diff() {
+  test_diff_basic();
+  test_diff_keyed();
+  test_diff_cached();
+  test_merge();
+  test_diff_random();
+}
+
+}  // namespace jst
+
+int main() {
+#ifdef _WINDOWS
+  _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif
+  jst::test_diff();
+  printf("%d/%d (%3.2f%%) passed\n", jst::test_pass, jst::test_count,
+         jst::test_pass * 100.0 / jst::test_count);
+  return jst::main_ret;
+}
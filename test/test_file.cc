@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include "document.h"
+#include "file.h"
+#include "parser.h"
+#include "structural.h"
+#include "utils.h"
+
+namespace jst {
+
+static const char* test_path = "jst_test_file.json";
+
+static void write_file(const char* path, const std::string& content) {
+  FILE* fp = fopen(path, "wb");
+  fwrite(content.data(), 1, content.size(), fp);
+  fclose(fp);
+}
+
+static void test_parse_file() {
+  write_file(test_path, " [ null , false , true , 123 , \"abc\" ] ");
+  JParser jc("");
+  JNode jn;
+  EXPECT_EQ_RET(JST_PARSE_OK, jc.parse_file(test_path, &jn));
+  EXPECT_EQ_TYPE(JST_ARR, jn.type());
+  auto arr = jn.data().as<JArray>().value();
+  EXPECT_EQ_SIZE_T(5, arr.size());
+  TEST_NODE_NUM(123.0, arr[3]);
+  TEST_NODE_STR("abc", arr[4]);
+
+  write_file(test_path, "[1,2");
+  EXPECT_EQ_RET(JST_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, jc.parse_file(test_path, &jn));
+
+  write_file(test_path, "");
+  EXPECT_EQ_RET(JST_PARSE_EXCEPT_VALUE, jc.parse_file(test_path, &jn));
+
+  EXPECT_EQ_RET(JST_PARSE_FILE_ERROR, jc.parse_file("jst_no_such_file.json", &jn));
+  remove(test_path);
+}
+
+static void test_parse_file_page_boundary() {
+  // A file that ends exactly on a page boundary has no zero-filled tail in its mapping.
+  for (size_t len : {4096, 8192, 65536}) {
+    std::string json = "\"" + std::string(len - 2, 'x') + "\"";
+    write_file(test_path, json);
+    JDocument doc = JDocument::parse_file(test_path);
+    EXPECT_EQ_RET(JST_PARSE_OK, doc.status());
+    EXPECT_EQ_TYPE(JST_STR, doc.root().type());
+    EXPECT_EQ_SIZE_T(len - 2, doc.root().data().as<JString>().size());
+
+    json[len - 1] = 'x';
+    write_file(test_path, json);
+    doc = JDocument::parse_file(test_path);
+    EXPECT_EQ_RET(JST_PARSE_MISS_QUOTATION_MARK, doc.status());
+  }
+  remove(test_path);
+}
+
+static void test_parse_file_lazy_strings() {
+  const std::string json =
+      "{\"plain\":\"abc\",\"esc\":\"a\\nb\\u00A2\\uD834\\uDD1E\\/\",\"\":\"\",\"k\\u0065y\":[\"x\"]}";
+  write_file(test_path, json);
+  JParserOptions opts;
+  opts.lazy_strings = true;
+  JDocument doc = JDocument::parse_file(test_path, opts);
+  EXPECT_EQ_RET(JST_PARSE_OK, doc.status());
+
+  /* untouched strings are written back exactly as they were read */
+  JParser jc("");
+  char* out = nullptr;
+  size_t len = 0;
+  EXPECT_EQ_RET(JST_STRINGIFY_OK, jc.stringify(doc.root(), &out, len));
+  EXPECT_TRUE(json == std::string(out, len));
+
+  const JObject& obj = doc.root().data().as<JObject>();
+  EXPECT_EQ_SIZE_T(4, obj.size());
+  const JNode* plain = obj.find_value(JString("plain"));
+  EXPECT_TRUE(plain != nullptr);
+  TEST_NODE_STR("abc", (*plain));
+  const JString& esc = obj[1].get_value().data().as<JString>();
+  EXPECT_EQ_SIZE_T(10, esc.size());
+  EXPECT_EQ_STRING("a\nb\xC2\xA2\xF0\x9D\x84\x9E/", esc.c_str(), esc.size());
+  EXPECT_TRUE(obj.find_value(JString("key")) != nullptr);
+  EXPECT_EQ_SIZE_T(0, obj[2].get_value().data().as<JString>().size());
+
+  /* copies own their characters and outlive the document */
+  JNode copy = obj[3].get_value();
+  doc = JDocument();
+  TEST_NODE_STR("x", copy.data().as<JArray>()[0]);
+
+  /* escapes are still validated while parsing */
+  write_file(test_path, "[\"ok\",\"bad\\x\"]");
+  doc = JDocument::parse_file(test_path, opts);
+  EXPECT_EQ_RET(JST_PARSE_INVALID_STRING_ESCAPE, doc.status());
+  EXPECT_EQ_SIZE_T(11, doc.error().offset);
+  remove(test_path);
+}
+
+// Generates a document larger than 4 GB and parses it through the mmap path. It needs that
+// much free disk space, so it only runs when JST_TEST_LARGE is set.
+static void test_parse_file_large() {
+  if (getenv("JST_TEST_LARGE") == nullptr) return;
+  const size_t pad = (size_t(1) << 32) + (size_t(1) << 28);
+  FILE* fp = fopen(test_path, "wb");
+  fputs("[\"head\",", fp);
+  std::string chunk(size_t(1) << 20, ' ');
+  for (size_t written = 0; written < pad; written += chunk.size())
+    fwrite(chunk.data(), 1, chunk.size(), fp);
+  fputs("-1.5e3, [true]]", fp);
+  fclose(fp);
+
+  JDocument doc = JDocument::parse_file(test_path);
+  EXPECT_EQ_RET(JST_PARSE_OK, doc.status());
+  EXPECT_EQ_TYPE(JST_ARR, doc.root().type());
+  const JArray& arr = doc.root().data().as<JArray>();
+  EXPECT_EQ_SIZE_T(3, arr.size());
+  TEST_NODE_STR("head", arr[0]);
+  TEST_NODE_NUM(-1.5e3, arr[1]);
+  EXPECT_EQ_TYPE(JST_ARR, arr[2].type());
+
+  // the structural index addresses it as well, so parse_parallel splits it too
+  JMappedFile mapped;
+  EXPECT_EQ_RET(JST_PARSE_OK, mapped.open(test_path));
+  std::vector<uint64_t> index;
+  EXPECT_EQ_RET(JST_PARSE_OK, jst_structural_index(mapped.data(), mapped.size(), 2, index, true));
+  EXPECT_EQ_SIZE_T(7, index.size());
+  EXPECT_EQ_SIZE_T(8 + pad + 6, index[3]);
+  JParserOptions opts;
+  opts.parallel_chunk = 1;
+  JParser jc("", opts);
+  jc.reset(mapped.data(), mapped.size());
+  EXPECT_EQ_RET(JST_PARSE_OK, jc.parse_parallel(nullptr, 2));
+  EXPECT_EQ_SIZE_T(3, jc.root.data().as<JArray>().size());
+  TEST_NODE_NUM(-1.5e3, jc.root.data().as<JArray>()[1]);
+  remove(test_path);
+}
+
+static void test_file() {
+  test_parse_file();
+  test_parse_file_page_boundary();
+  test_parse_file_lazy_strings();
+  test_parse_file_large();
+}
+
+}  // namespace jst
+
+int main() {
+#ifdef _WINDOWS
+  _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif
+  jst::test_file();
+  printf("%d/%d (%3.2f%%) passed\n", jst::test_pass, jst::test_count,
+         jst::test_pass * 100.0 / jst::test_count);
+  return jst::main_ret;
+}
@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "hash.h"
+#include "parser.h"
+#include "utils.h"
+
+namespace jst {
+
+static uint64_t test_hash_of(const std::string& json) { return test_parse(json).hash(); }
+
+static uint64_t test_bytes(const std::string& s, uint64_t seed = 0) {
+  return jst_hash_bytes(s.data(), s.size(), seed);
+}
+
+// The values are part of the format: stored hashes must still match after an upgrade, and every
+// kernel (scalar, SSE2, AVX2) has to reproduce them.
+static void test_hash_golden() {
+  std::string alpha;
+  for (int i = 0; i < 100; i++) alpha += (char)('a' + i % 26);
+  EXPECT_EQ_HASH(0x0ff2e69699c4857eULL, test_bytes(""));
+  EXPECT_EQ_HASH(0x2cf2c0e4994203f1ULL, test_bytes("a"));
+  EXPECT_EQ_HASH(0xc9c2b750324b177cULL, test_bytes("hello world"));
+  EXPECT_EQ_HASH(0x23133f03d6fb57d9ULL, test_bytes("0123456789abcdef0123456789abcdef"));
+  EXPECT_EQ_HASH(0x472ddfdead399cc4ULL, test_bytes(alpha));
+  EXPECT_EQ_HASH(0xf3086fc5b13d2568ULL, test_bytes(alpha, 1));
+
+  EXPECT_EQ_HASH(0x243f6a8885a308d3ULL, test_hash_of("null"));
+  EXPECT_EQ_HASH(0x13198a2e03707344ULL, test_hash_of("true"));
+  EXPECT_EQ_HASH(0xa4093822299f31d0ULL, test_hash_of("false"));
+  EXPECT_EQ_HASH(0x4ca4eb8bf9ec3928ULL, test_hash_of("2"));
+  EXPECT_EQ_HASH(0xac07dbd0c37bb6e0ULL, test_hash_of("-3.5"));
+  EXPECT_EQ_HASH(0x278863df948a64ffULL, test_hash_of("1e100"));
+  EXPECT_EQ_HASH(0x0d825878f7e4124bULL, test_hash_of("\"a\""));
+  EXPECT_EQ_HASH(0x7a3a6eb5b7762b3dULL, test_hash_of("[]"));
+  EXPECT_EQ_HASH(0x170bb4707262f482ULL, test_hash_of("{}"));
+  EXPECT_EQ_HASH(0x9525d8789467a5baULL, test_hash_of("[1,2]"));
+  EXPECT_EQ_HASH(0x3235f7f53c3f2d4eULL,
+                 test_hash_of("{\"a\":[1,\"s\",null],\"b\":{\"c\":true,\"d\":100}}"));
+}
+
+static void test_hash_bytes() {
+  // every length, through the stripes and the tail, and wherever the input starts
+  std::string text;
+  for (int i = 0; i < 300; i++) text += (char)(i * 37 + 11);
+  std::vector<uint64_t> seen;
+  bool distinct = true, aligned = true, flipped = true;
+  for (size_t len = 0; len <= 256; len++) {
+    uint64_t h = jst_hash_bytes(text.data(), len);
+    for (uint64_t prev : seen) distinct = distinct && prev != h;
+    seen.push_back(h);
+    for (size_t offset = 1; offset < 8; offset++) {
+      std::string moved = std::string(offset, 'x') + text.substr(0, len);
+      aligned = aligned && jst_hash_bytes(moved.data() + offset, len) == h;
+    }
+    for (size_t bit = 0; bit < len * 8; bit += 13) {
+      std::string changed = text.substr(0, len);
+      changed[bit / 8] ^= (char)(1 << (bit % 8));
+      flipped = flipped && test_bytes(changed) != h;
+    }
+  }
+  EXPECT_TRUE(distinct);
+  EXPECT_TRUE(aligned);
+  EXPECT_TRUE(flipped);
+
+  EXPECT_TRUE(test_bytes("abc") != test_bytes("abc", 1));
+  EXPECT_TRUE(test_bytes(std::string(8, '\0')) != test_bytes(std::string(7, '\0')));
+  // the same 32-byte stripes in another order
+  std::string a(32, 'a'), b(32, 'b');
+  EXPECT_TRUE(test_bytes(a + b) != test_bytes(b + a));
+  EXPECT_TRUE(test_bytes(a + a + b) != test_bytes(a + b + a));
+}
+
+static void test_hash_structure() {
+  // members in any order, at any depth
+  EXPECT_EQ_HASH(test_hash_of("{\"a\":1,\"b\":{\"c\":[2,3],\"d\":null}}"),
+                 test_hash_of("{\"b\":{\"d\":null,\"c\":[2,3]},\"a\":1}"));
+  EXPECT_EQ_HASH(test_hash_of("[100,200.0]"), test_hash_of("[1e2,2e2]"));
+  EXPECT_EQ_HASH(test_hash_of("0.25"), test_hash_of("-1"));
+  EXPECT_EQ_HASH(test_hash_of("\"\\u00e9\""), test_hash_of("\"\xc3\xa9\""));
+
+  EXPECT_TRUE(test_hash_of("[1,2]") != test_hash_of("[2,1]"));
+  EXPECT_TRUE(test_hash_of("[[1],[2]]") != test_hash_of("[[1,2]]"));
+  EXPECT_TRUE(test_hash_of("[[1,2]]") != test_hash_of("[1,2]"));
+  EXPECT_TRUE(test_hash_of("{\"a\":2,\"b\":3}") != test_hash_of("{\"a\":3,\"b\":2}"));
+  EXPECT_TRUE(test_hash_of("{\"a\":2}") != test_hash_of("{\"b\":2}"));
+  EXPECT_TRUE(test_hash_of("{\"ab\":\"c\"}") != test_hash_of("{\"a\":\"bc\"}"));
+  EXPECT_TRUE(test_hash_of("[]") != test_hash_of("{}"));
+  EXPECT_TRUE(test_hash_of("null") != test_hash_of("\"null\""));
+  EXPECT_TRUE(test_hash_of("2") != test_hash_of("\"2\""));
+  EXPECT_TRUE(test_hash_of("1.5") != test_hash_of("2.5"));
+  EXPECT_TRUE(test_hash_of("[null]") != test_hash_of("[null,null]"));
+}
+
+// Changing a node hashes the path above it again; the rest of the tree keeps its hashes.
+static void test_hash_cache() {
+  const char* json = "{\"left\":{\"x\":[1,2,3]},\"right\":{\"y\":[4,5,6]}}";
+  JNode doc = test_parse(json);
+  uint64_t before = doc.hash();
+  JObject& root = doc.mutable_data().as<JObject>();
+  JNode& left = root.get_value(0);
+  JNode& right = root.get_value(1);
+  EXPECT_TRUE(right.data().hashed());
+
+  JNode& x = left.mutable_data().as<JObject>().get_value(0);
+  x.mutable_data().as<JArray>()[1] = JNode(7.0);
+  EXPECT_FALSE(doc.data().hashed());
+  EXPECT_FALSE(left.data().hashed());
+  EXPECT_TRUE(right.data().hashed());
+  EXPECT_TRUE(right.data().as<JObject>().get_value(0).data().hashed());
+  uint64_t after = doc.hash();
+  EXPECT_TRUE(after != before);
+  EXPECT_EQ_HASH(test_hash_of("{\"right\":{\"y\":[4,5,6]},\"left\":{\"x\":[1,7,3]}}"), after);
+
+  x.mutable_data().as<JArray>()[1] = JNode(2.0);
+  EXPECT_EQ_HASH(before, doc.hash());
+
+  // the hash of a copy is the one of its source, cached or not
+  JNode copy = doc;
+  EXPECT_TRUE(copy.data().hashed());
+  EXPECT_EQ_HASH(before, copy.hash());
+  JParser jc("");
+  std::string text;
+  jc.stringify(doc, text);
+  EXPECT_EQ_HASH(before, test_hash_of(text));
+}
+
+// A dedup cache keyed by hash, with operator== confirming every hit.
+static void test_hash_dedup() {
+  const char* docs[] = {"{\"id\":1,\"tags\":[\"a\",\"b\"]}", "{\"tags\":[\"a\",\"b\"],\"id\":1}",
+                        "{\"id\":1,\"tags\":[\"b\",\"a\"]}", "[1,{\"id\":1}]",
+                        "{\"id\":1.0,\"tags\":[\"a\",\"b\"]}"};
+  std::unordered_multimap<uint64_t, JNode> store;
+  size_t stored = 0;
+  for (const char* d : docs) {
+    JNode doc = test_parse(d);
+    auto range = store.equal_range(doc.hash());
+    bool found = false;
+    for (auto it = range.first; it != range.second && !found; ++it) found = it->second == doc;
+    if (!found) {
+      store.emplace(doc.hash(), std::move(doc));
+      stored++;
+    }
+  }
+  EXPECT_EQ_SIZE_T(3, stored);
+}
+
+// Every kernel this machine can run, ending on the one picked at startup.
+static void test_hash_kernels() {
+  JHashKernel best = jst_hash_kernel();
+  const JHashKernel kernels[] = {JST_HASH_SCALAR, JST_HASH_SSE2, JST_HASH_AVX2};
+  int ran = 0;
+  for (JHashKernel kernel : kernels) {
+    if (!jst_hash_set_kernel(kernel)) continue;
+    EXPECT_TRUE(jst_hash_kernel() == kernel);
+    test_hash_golden();
+    test_hash_bytes();
+    ran++;
+  }
+  EXPECT_TRUE(ran >= 1);
+  EXPECT_TRUE(jst_hash_set_kernel(best));
+  EXPECT_TRUE(jst_hash_kernel() == best);
+}
+
+static void test_hash() {
+  test_hash_kernels();
+  test_hash_structure();
+  test_hash_cache();
+  test_hash_dedup();
+}
+}  // namespace jst
+
+int main() {
+#ifdef _WINDOWS
+  _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif
+  jst::test_hash();
+  printf("%d/%d (%3.2f%%) passed\n", jst::test_pass, jst::test_count,
+         jst::test_pass * 100.0 / jst::test_count);
+  return jst::main_ret;
+}
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include "literal.h"
+#include "parser.h"
+#include "utils.h"
+
+namespace jst {
+
+#define TEST_LITERAL_JSON                                                                       \
+  " {\"name\":\"toy\",\"empty\":\"\",\"n\":[0,-7,18446744073709551615,-9223372036854775808,1.5," \
+  "0.1,1e2,-0,12345678901234567890123],\"nested\":{\"z\":true,\"a\":false,\"m\":null,\"a\":1,"  \
+  "\"\":[]},\"s\":\"\\\"\\\\\\/\\b\\f\\n\\r\\t\\u00e9\\u20AC\\uD834\\uDD1E\\u0000\"} "
+
+static constexpr auto literal_doc = JST_LITERAL(TEST_LITERAL_JSON);
+static constexpr auto literal_scalar = JST_LITERAL("\t-1.25e-3\n");
+static_assert(literal_scalar.size() == sizeof(JSnapHeader) + sizeof(JSnapRecord) + 16,
+              "literal laid out at compile time");
+
+// Byte for byte what JSnapshot::write() makes of the parsed document.
+#define TEST_LITERAL_SAME(lit, json)                                      \
+  do {                                                                    \
+    JParser jc(json);                                                     \
+    EXPECT_EQ_RET(JST_PARSE_OK, jc.parser());                             \
+    std::string bin;                                                      \
+    JSnapshot::write(jc.root, bin);                                       \
+    EXPECT_EQ_SIZE_T(bin.size(), (lit).size());                           \
+    EXPECT_TRUE(bin.size() == (lit).size() &&                             \
+                memcmp(bin.data(), (lit).data(), bin.size()) == 0);       \
+  } while (0)
+
+static void test_literal_layout() {
+  TEST_LITERAL_SAME(literal_doc, TEST_LITERAL_JSON);
+  TEST_LITERAL_SAME(literal_scalar, "\t-1.25e-3\n");
+
+  static constexpr auto t = JST_LITERAL("true");
+  TEST_LITERAL_SAME(t, "true");
+  static constexpr auto empty = JST_LITERAL("[[], {}, \"\", [[[null]]]]");
+  TEST_LITERAL_SAME(empty, "[[], {}, \"\", [[[null]]]]");
+  static constexpr auto keys = JST_LITERAL(R"({"b":1,"ab":2,"a":3,"":4,"b":5,"ÿ":6,"~":7})");
+  TEST_LITERAL_SAME(keys, R"({"b":1,"ab":2,"a":3,"":4,"b":5,"ÿ":6,"~":7})");
+  static constexpr auto nums = JST_LITERAL("[1.7976931348623157e308, -1e-400, 0e999, 9e307]");
+  TEST_LITERAL_SAME(nums, "[1.7976931348623157e308, -1e-400, 0e999, 9e307]");
+}
+
+static void test_literal_view() {
+  JSnapshot snap;
+  EXPECT_EQ_RET(JST_PARSE_OK, snap.open(literal_doc.data(), literal_doc.size()));
+  EXPECT_EQ_RET(JST_PARSE_OK, snap.verify());
+
+  JSnapView root = literal_doc.root();
+  EXPECT_EQ_TYPE(JST_OBJ, root.type());
+  EXPECT_EQ_SIZE_T(5, root.size());
+  EXPECT_EQ_STRING("toy", root.find("name").c_str(), root.find("name").size());
+  EXPECT_EQ_SIZE_T(0, root.find("empty").size());
+
+  JSnapView n = root.find("n");
+  EXPECT_EQ_SIZE_T(9, n.size());
+  EXPECT_TRUE(n[1].num_type() == JST_NUM_INT && n[1].int_value() == -7);
+  EXPECT_TRUE(n[2].num_type() == JST_NUM_UINT && n[2].uint_value() == 18446744073709551615ULL);
+  EXPECT_TRUE(n[3].int_value() == INT64_MIN);
+  EXPECT_EQ_DOUBLE(1.5, n[4].number());
+  EXPECT_EQ_STRING("0.1", n[5].c_str(), n[5].size());
+  EXPECT_TRUE(n[7].num_type() == JST_NUM_TEXT);
+  EXPECT_EQ_STRING("12345678901234567890123", n[8].c_str(), n[8].size());
+
+  JSnapView nested = root.find("nested");
+  EXPECT_EQ_TYPE(JST_FALSE, nested.find("a").type());
+  EXPECT_EQ_TYPE(JST_ARR, nested.find("", 0).type());
+  EXPECT_EQ_STRING("\"\\/\b\f\n\r\t\xC3\xA9\xE2\x82\xAC\xF0\x9D\x84\x9E\0",
+                   root.find("s").c_str(), root.find("s").size());
+
+  JParser jc(TEST_LITERAL_JSON);
+  EXPECT_EQ_RET(JST_PARSE_OK, jc.parser());
+  std::string expect, actual;
+  EXPECT_EQ_RET(JST_STRINGIFY_OK, jc.stringify(jc.root, expect));
+  EXPECT_EQ_RET(JST_STRINGIFY_OK, jc.stringify(root.to_node(), actual));
+  EXPECT_TRUE(expect == actual);
+  EXPECT_EQ_DOUBLE(-1.25e-3, literal_scalar.root().number());
+}
+
+static void test_literal() {
+  test_literal_layout();
+  test_literal_view();
+}
+
+}  // namespace jst
+
+int main() {
+#ifdef _WINDOWS
+  _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif
+  jst::test_literal();
+  printf("%d/%d (%3.2f%%) passed\n", jst::test_pass, jst::test_count,
+         jst::test_pass * 100.0 / jst::test_count);
+  return jst::main_ret;
+}
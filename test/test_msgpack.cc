@@ -0,0 +1,158 @@
+#include <stdio.h>
+
+#include <string>
+
+#include "msgpack.h"
+#include "parser.h"
+#include "utils.h"
+
+namespace jst {
+
+#define TEST_MSGPACK_BYTES(expect, json)                                             \
+  do {                                                                               \
+    JParser jc(json);                                                                \
+    EXPECT_EQ_RET(JST_PARSE_OK, jc.parser());                                        \
+    std::string bin;                                                                 \
+    EXPECT_EQ_RET(JST_PARSE_OK, jst_msgpack_encode(jc.root, bin));                   \
+    EXPECT_TRUE(bin == std::string(expect, sizeof(expect) - 1));                     \
+    JNode back;                                                                      \
+    EXPECT_EQ_RET(JST_PARSE_OK, jst_msgpack_decode(bin.data(), bin.size(), back));   \
+    EXPECT_TRUE(back == jc.root);                                                    \
+  } while (0)
+
+static void test_msgpack_bytes() {
+  TEST_MSGPACK_BYTES("\xc0", "null");
+  TEST_MSGPACK_BYTES("\xc3", "true");
+  TEST_MSGPACK_BYTES("\xc2", "false");
+  TEST_MSGPACK_BYTES("\x7f", "127");
+  TEST_MSGPACK_BYTES("\xcc\x80", "128");
+  TEST_MSGPACK_BYTES("\xcd\x01\x00", "256");
+  TEST_MSGPACK_BYTES("\xce\x00\x01\x00\x00", "65536");
+  TEST_MSGPACK_BYTES("\xcf\x00\x00\x00\x01\x00\x00\x00\x00", "4294967296");
+  TEST_MSGPACK_BYTES("\xcf\xff\xff\xff\xff\xff\xff\xff\xff", "18446744073709551615");
+  TEST_MSGPACK_BYTES("\xe0", "-32");
+  TEST_MSGPACK_BYTES("\xd0\xdf", "-33");
+  TEST_MSGPACK_BYTES("\xd1\xff\x7f", "-129");
+  TEST_MSGPACK_BYTES("\xd2\xff\xff\x7f\xff", "-32769");
+  TEST_MSGPACK_BYTES("\xd3\x80\x00\x00\x00\x00\x00\x00\x00", "-9223372036854775808");
+  TEST_MSGPACK_BYTES("\xcb\x3f\xf8\x00\x00\x00\x00\x00\x00", "1.5");
+  TEST_MSGPACK_BYTES("\xa0", "\"\"");
+  TEST_MSGPACK_BYTES("\xa3\x61\x0a\x00", "\"a\\n\\u0000\"");
+  TEST_MSGPACK_BYTES("\x90", "[]");
+  TEST_MSGPACK_BYTES("\x80", "{}");
+  TEST_MSGPACK_BYTES("\x82\xa1\x61\x92\x01\xc0\xa1\x62\xa0", "{\"a\":[1,null],\"b\":\"\"}");
+}
+
+/* the str, array and map headers switch forms at 31/15, 255 and 65535 */
+static void test_msgpack_sizes() {
+  const size_t sizes[] = {15, 16, 31, 32, 255, 256, 65535, 65536};
+  for (size_t n : sizes) {
+    JArray arr(n);
+    JObject obj(n);
+    for (size_t i = 0; i < n; i++) {
+      arr[i] = JNode(JNumber::from_int((int64_t)i));
+      obj.push_back(JOjectElement(JString("k", 1), JNode(JST_TRUE)));
+    }
+    JNode str(JString(std::string(n, 'x').c_str(), n)), a(std::move(arr)), o(std::move(obj));
+    for (const JNode* jn : {&str, &a, &o}) {
+      std::string bin;
+      EXPECT_EQ_RET(JST_PARSE_OK, jst_msgpack_encode(*jn, bin));
+      EXPECT_EQ_SIZE_T(jst_msgpack_size(*jn), bin.size());
+      JNode back;
+      EXPECT_EQ_RET(JST_PARSE_OK, jst_msgpack_decode(bin.data(), bin.size(), back));
+      EXPECT_EQ_TYPE(jn->type(), back.type());
+      std::string again;
+      EXPECT_EQ_RET(JST_PARSE_OK, jst_msgpack_encode(back, again));
+      EXPECT_TRUE(again == bin);
+    }
+  }
+}
+
+/* counts past the 32-bit headers are refused, not cut down; a lower limit stands in for them */
+#define TEST_MSGPACK_LIMIT(expect, json)                                             \
+  do {                                                                               \
+    JParser jc(json);                                                                \
+    EXPECT_EQ_RET(JST_PARSE_OK, jc.parser());                                        \
+    std::string bin = "untouched";                                                   \
+    JRetType err = JST_PARSE_OK;                                                     \
+    EXPECT_EQ_SIZE_T(JST_MSGPACK_TOO_LARGE, jst_msgpack_size(jc.root, &err, 3));     \
+    EXPECT_EQ_RET(expect, err);                                                      \
+    EXPECT_EQ_RET(expect, jst_msgpack_encode(jc.root, bin, 3));                      \
+    EXPECT_TRUE(bin == "untouched");                                                 \
+  } while (0)
+
+static void test_msgpack_limit() {
+  TEST_MSGPACK_LIMIT(JST_PARSE_EXCEED_MAX_STRING_LENGTH, "\"abcd\"");
+  TEST_MSGPACK_LIMIT(JST_PARSE_EXCEED_MAX_STRING_LENGTH, "{\"a\":[{\"long\":1}]}");
+  TEST_MSGPACK_LIMIT(JST_PARSE_EXCEED_MAX_STRING_LENGTH, "[1,[\"abc\",\"abcd\"]]");
+  TEST_MSGPACK_LIMIT(JST_PARSE_EXCEED_MAX_NODES, "[1,2,3,4]");
+  TEST_MSGPACK_LIMIT(JST_PARSE_EXCEED_MAX_NODES, "{\"a\":{\"b\":1,\"c\":2,\"d\":3,\"e\":4}}");
+
+  JParser jc("{\"abc\":[1,2,\"xyz\"]}");
+  EXPECT_EQ_RET(JST_PARSE_OK, jc.parser());
+  std::string bin;
+  EXPECT_EQ_RET(JST_PARSE_OK, jst_msgpack_encode(jc.root, bin, 3));
+  EXPECT_EQ_SIZE_T(jst_msgpack_size(jc.root), bin.size());
+}
+
+static void test_msgpack_lossy() {
+  /* numbers kept as text become doubles */
+  JParser jc("[0.1,1e400,18446744073709551616]");
+  EXPECT_EQ_RET(JST_PARSE_NUMBER_TOO_BIG, jc.parser());
+  JParser jd("[0.1,18446744073709551616]");
+  EXPECT_EQ_RET(JST_PARSE_OK, jd.parser());
+  std::string bin;
+  EXPECT_EQ_RET(JST_PARSE_OK, jst_msgpack_encode(jd.root, bin));
+  JNode back;
+  EXPECT_EQ_RET(JST_PARSE_OK, jst_msgpack_decode(bin.data(), bin.size(), back));
+  const JArray& arr = back.data().as<JArray>();
+  EXPECT_TRUE(arr[0].data().as<JNumber>().type() == JST_NUM_DOUBLE);
+  EXPECT_EQ_DOUBLE(0.1, arr[0].data().as<JNumber>().value());
+  EXPECT_EQ_DOUBLE(18446744073709551616.0, arr[1].data().as<JNumber>().value());
+}
+
+#define TEST_MSGPACK_ERROR(expect, offset, bin)                                 \
+  do {                                                                          \
+    JNode jn(JST_TRUE);                                                         \
+    size_t err = 0;                                                             \
+    EXPECT_EQ_RET(expect, jst_msgpack_decode(bin, sizeof(bin) - 1, jn, &err));  \
+    EXPECT_EQ_SIZE_T(offset, err);                                              \
+    EXPECT_EQ_TYPE(JST_NULL, jn.type());                                        \
+  } while (0)
+
+static void test_msgpack_error() {
+  TEST_MSGPACK_ERROR(JST_PARSE_TRUNCATED, 0, "");
+  TEST_MSGPACK_ERROR(JST_PARSE_TRUNCATED, 1, "\xcd\x01");
+  TEST_MSGPACK_ERROR(JST_PARSE_TRUNCATED, 1, "\xa3\x61");
+  TEST_MSGPACK_ERROR(JST_PARSE_TRUNCATED, 1, "\x93\x01\x02");
+  TEST_MSGPACK_ERROR(JST_PARSE_TRUNCATED, 5, "\xdd\xff\xff\xff\xff\x01");
+  TEST_MSGPACK_ERROR(JST_PARSE_UNSUPPORTED_TYPE, 0, "\xc1");
+  TEST_MSGPACK_ERROR(JST_PARSE_UNSUPPORTED_TYPE, 1, "\x91\xc4\x01\x00");
+  TEST_MSGPACK_ERROR(JST_PARSE_UNSUPPORTED_TYPE, 1, "\x81\x01\x02");
+  TEST_MSGPACK_ERROR(JST_PARSE_SINGULAR, 1, "\xc0\xc0");
+
+  std::string deep(JST_MSGPACK_MAX_DEPTH + 1, '\x91');
+  deep += '\xc0';
+  JNode jn;
+  EXPECT_EQ_RET(JST_PARSE_EXCEED_MAX_DEPTH, jst_msgpack_decode(deep.data(), deep.size(), jn));
+}
+
+static void test_msgpack() {
+  test_msgpack_bytes();
+  test_msgpack_sizes();
+  test_msgpack_limit();
+  test_msgpack_lossy();
+  test_msgpack_error();
+}
+
+}  // namespace jst
+
+int main() {
+#ifdef _WINDOWS
+  _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif
+  jst::test_msgpack();
+  printf("%d/%d (%3.2f%%) passed\n", jst::test_pass, jst::test_count,
+         jst::test_pass * 100.0 / jst::test_count);
+  return jst::main_ret;
+}
@@ -1,11 +1,10 @@
 #include "basic.h"
+#include "document.h"
 #include "parser.h"
+#include "structural.h"
 #include "utils.h"
 
 namespace jst {
-static int main_ret = 0;
-static int test_count = 0;
-static int test_pass = 0;
 
 static void test_parse_null() {
   JParser jc(" null   ");
@@ -34,6 +33,8 @@ static void test_parse_number() {
   TEST_NUMBER(1.5, "1.5");
   TEST_NUMBER(-1.5, "-1.5");
   TEST_NUMBER(3.1416, "3.1416");
+  TEST_NUMBER(0.25, "0.25");
+  TEST_NUMBER(-0.25e-2, "-0.25e-2");
   TEST_NUMBER(1E10, "1E10");
   TEST_NUMBER(1e10, "1e10");
   TEST_NUMBER(1E+10, "1E+10");
@@ -57,6 +58,49 @@ static void test_parse_number() {
   TEST_NUMBER(-1.7976931348623157e+308, "-1.7976931348623157e+308");
 }
 
+static void test_parse_number_exact() {
+  JParser jc("[9007199254740993,-9223372036854775808,18446744073709551615,18446744073709551616,-0]");
+  EXPECT_EQ_RET(JST_PARSE_OK, jc.parser());
+  const JArray& arr = jc.root.data().as<JArray>();
+  const JNumber& above_2_53 = arr[0].data().as<JNumber>();
+  EXPECT_EQ_INT(JST_NUM_INT, above_2_53.type());
+  EXPECT_TRUE(above_2_53.int_value() == 9007199254740993LL);
+  const JNumber& int_min = arr[1].data().as<JNumber>();
+  EXPECT_EQ_INT(JST_NUM_INT, int_min.type());
+  EXPECT_TRUE(int_min.int_value() == std::numeric_limits<int64_t>::min());
+  const JNumber& uint_max = arr[2].data().as<JNumber>();
+  EXPECT_EQ_INT(JST_NUM_UINT, uint_max.type());
+  EXPECT_TRUE(uint_max.uint_value() == std::numeric_limits<uint64_t>::max());
+  /* too wide for 64 bits: kept as text, still readable as a double */
+  const JNumber& wide = arr[3].data().as<JNumber>();
+  EXPECT_EQ_INT(JST_NUM_TEXT, wide.type());
+  EXPECT_EQ_DOUBLE(18446744073709551616.0, wide.value());
+  EXPECT_EQ_INT(JST_NUM_TEXT, arr[4].data().as<JNumber>().type());
+  /* the conversion is kept: copies share it, and reading new text into a number drops it */
+  EXPECT_EQ_DOUBLE(18446744073709551616.0, wide.value());
+  JNumber reused = wide;
+  EXPECT_EQ_DOUBLE(18446744073709551616.0, reused.value());
+  EXPECT_EQ_RET(JST_PARSE_OK, JNumber::from_text("0.25", 4, reused));
+  EXPECT_EQ_DOUBLE(0.25, reused.value());
+  EXPECT_EQ_RET(JST_PARSE_OK, JNumber::from_text("1.5e308", 7, reused));
+  EXPECT_EQ_DOUBLE(1.5e308, reused.value());
+  EXPECT_EQ_RET(JST_PARSE_OK, JNumber::from_text("-0.5", 4, reused));
+  EXPECT_EQ_DOUBLE(-0.5, reused.value());
+
+  JNode exact(JST_NUM, "12345678901234567");
+  EXPECT_TRUE(exact == JNode(JNumber::from_int(12345678901234567LL)));
+  EXPECT_FALSE(exact == JNode(JNumber::from_int(12345678901234568LL)));
+
+  JParser big("1.5e308");
+  EXPECT_EQ_RET(JST_PARSE_OK, big.parser());
+  big.reset("1.8e308");
+  EXPECT_EQ_RET(JST_PARSE_NUMBER_TOO_BIG, big.parser());
+  big.reset("0.00001e313");
+  EXPECT_EQ_RET(JST_PARSE_OK, big.parser());
+  big.reset("1" + std::string(309, '0'));
+  EXPECT_EQ_RET(JST_PARSE_NUMBER_TOO_BIG, big.parser());
+}
+
 static void test_parse_string() {
   TEST_STRING("", "\"\"");
   TEST_STRING("Hello", "\"Hello\"");
@@ -68,6 +112,23 @@ static void test_parse_string() {
   TEST_STRING("\xE2\x82\xAC", "\"\\u20AC\"");            /* Euro sign U+20AC */
   TEST_STRING("\xF0\x9D\x84\x9E", "\"\\uD834\\uDD1E\""); /* G clef sign U+1D11E */
   TEST_STRING("\xF0\x9D\x84\x9E", "\"\\ud834\\udd1e\""); /* G clef sign U+1D11E */
+  TEST_STRING("\xC3\xA9\xE2\x82\xAC\n\"\xF0\x9D\x84\x9Ex", "\"\\u00e9\\u20AC\\n\\\"\\uD834\\uDD1Ex\"");
+
+  TEST_STRING("\xC3\xA9t\xC3\xA9 \xE2\x82\xAC", "\"\xC3\xA9t\xC3\xA9 \xE2\x82\xAC\""); /* raw UTF-8 */
+  TEST_STRING("0123456789abcdefghijklmnopqrstuvwxyz\n0123456789abcdefghijklmnopqrstuvwxyz",
+              "\"0123456789abcdefghijklmnopqrstuvwxyz\\n0123456789abcdefghijklmnopqrstuvwxyz\"");
+
+  /* a run of escapes long enough to grow the parse stack several times */
+  std::string json = "\"", expect;
+  for (int i = 0; i < 300; i++) {
+    json += "\\u00e9\\uD834\\uDD1E\\t";
+    expect += "\xC3\xA9\xF0\x9D\x84\x9E\t";
+  }
+  json += "\"";
+  JParser jc(json);
+  EXPECT_EQ_RET(JST_PARSE_OK, jc.parser());
+  std::string actual = jc.root.data().as<JString>().value();
+  EXPECT_TRUE(actual == expect);
 }
 
 static void test_parser_array_1() {
@@ -184,14 +245,176 @@ static void test_parse_object() {
   } while (0);
 }
 
+static void test_parse_insitu() {
+  std::string json = "{\"key\":\"Hello\\nWorld\",\"\\u20AC\":[\"\",\"\\uD834\\uDD1E!\"]}";
+  const char* buffer = json.c_str();
+  JDocument doc = JDocument::parse_insitu(std::move(json));
+  EXPECT_EQ_RET(JST_PARSE_OK, doc.status());
+  EXPECT_EQ_TYPE(JST_OBJ, doc.root().type());
+
+  const JObject& obj = doc.root().data().as<JObject>();
+  EXPECT_EQ_SIZE_T(2, obj.size());
+  TEST_OBJ_KEY("key", obj.get_key(0));
+  TEST_NODE_STR("Hello\nWorld", obj.get_value(0));
+  TEST_OBJ_KEY("\xE2\x82\xAC", obj.get_key(1));
+  const JArray& arr = obj.get_value(1).data().as<JArray>();
+  TEST_NODE_STR("", arr[0]);
+  TEST_NODE_STR("\xF0\x9D\x84\x9E!", arr[1]);
+
+  // strings borrow from the document's buffer, copies own their characters.
+  const char* key = obj.get_key(0).c_str();
+  EXPECT_TRUE(key == buffer + 2);
+  JNode copy = obj.get_value(0);
+  EXPECT_TRUE(copy.data().as<JString>().c_str() != obj.get_value(0).data().as<JString>().c_str());
+
+  JDocument moved = std::move(doc);
+  EXPECT_TRUE(moved.root().data().as<JObject>().get_key(0).c_str() == key);
+
+  doc = JDocument::parse_insitu("[\"abc\", \"a\\x\"]");
+  EXPECT_EQ_RET(JST_PARSE_INVALID_STRING_ESCAPE, doc.status());
+  EXPECT_EQ_TYPE(JST_NULL, doc.root().type());
+}
+
+static void test_parse_parallel() {
+  std::string json = "[";
+  for (int i = 0; i < 200; i++) {
+    if (i != 0) json += ", ";
+    json += "{\"id\":" + std::to_string(i) +
+            ",\"s\":\"a,]\\\"[{\",\"v\":[1.5,true,null,[]],\"o\":{\"k\":\"\\u20AC\"}}";
+  }
+  json += "]\n";
+
+  JParserOptions opts;
+  opts.parallel_chunk = 64;
+  JParser serial(json), parallel(json, opts);
+  EXPECT_EQ_RET(JST_PARSE_OK, serial.parser());
+  EXPECT_EQ_RET(JST_PARSE_OK, parallel.parse_parallel(nullptr, 4));
+  EXPECT_EQ_SIZE_T(200, parallel.root.data().as<JArray>().size());
+  EXPECT_TRUE(serial.root == parallel.root);
+  std::string a, b;
+  EXPECT_EQ_RET(JST_STRINGIFY_OK, serial.stringify(serial.root, a));
+  EXPECT_EQ_RET(JST_STRINGIFY_OK, parallel.stringify(parallel.root, b));
+  EXPECT_TRUE(a == b);
+
+  /* an error in any chunk is reported exactly as the serial parse reports it */
+  const char* bad[] = {"[1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, tru, 13]", "[1, 2, 3, 4, 5, 6, 7, 8,]",
+                       "[1, 2, 3, 4, 5, 6, 7, 8, 9 10]", "[1, 2, 3, 4, 5, 6, 7, 8] x",
+                       "[1, 2, 3, 4, 5, 6, 7, 8, 9, \"a\\x\"]", "{\"a\": [1, 2, 3, 4, 5, 6, 7]"};
+  opts.parallel_chunk = 4;
+  for (const char* s : bad) {
+    JParser ser(s), par(s, opts);
+    EXPECT_EQ_RET(ser.parser(), par.parse_parallel(nullptr, 3));
+    EXPECT_EQ_SIZE_T(ser.error_offset(), par.error_offset());
+  }
+}
+
+static void test_parse_parallel_object() {
+  std::string json = " {";
+  for (int i = 0; i < 100; i++) {
+    if (i != 0) json += ",\n";
+    json += "\"k" + std::to_string(i % 50) + "\\\\\" : [\"\\\\\", {\"x\": \"\xC3\xA9\"}]";
+  }
+  json += "} ";
+
+  JParserOptions opts;
+  opts.parallel_chunk = 32;
+  opts.validate_utf8 = true;
+  JParser serial(json), parallel(json, opts);
+  EXPECT_EQ_RET(JST_PARSE_OK, serial.parser());
+  EXPECT_EQ_RET(JST_PARSE_OK, parallel.parse_parallel(nullptr, 5));
+  EXPECT_EQ_SIZE_T(100, parallel.root.data().as<JObject>().size());
+  EXPECT_TRUE(serial.root == parallel.root);
+
+  json[json.find('\xA9')] = 'x';
+  JParser ser(json, opts), par(json, opts);
+  EXPECT_EQ_RET(JST_PARSE_INVALID_UTF8, ser.parser());
+  EXPECT_EQ_RET(JST_PARSE_INVALID_UTF8, par.parse_parallel(nullptr, 5));
+  EXPECT_EQ_SIZE_T(ser.error_offset(), par.error_offset());
+}
+
+/* a root that wraps one large container is split inside that container */
+static void test_parse_parallel_nested() {
+  std::string rows;
+  for (int i = 0; i < 100; i++) {
+    if (i != 0) rows += ",";
+    rows += "{\"id\":" + std::to_string(i) + ",\"tags\":[\"x]\",\"{y\"]}";
+  }
+  std::string json = "{\"meta\": {\"n\": 100}, \"data\": [" + rows + "], \"end\": true}";
+
+  JSplitPlan plan;
+  for (unsigned threads = 2; threads <= 6; threads++) {
+    EXPECT_TRUE(jst_structural_split(json.c_str(), json.size(), threads, 64, plan));
+    EXPECT_EQ_SIZE_T(json.find('['), plan.open);
+    EXPECT_EQ_SIZE_T(json.rfind(']'), plan.close);
+    EXPECT_EQ_SIZE_T(2, plan.depth);
+    EXPECT_TRUE(plan.bounds.size() > 2);
+  }
+
+  JParserOptions opts;
+  opts.parallel_chunk = 64;
+  JParser serial(json), parallel(json, opts);
+  EXPECT_EQ_RET(JST_PARSE_OK, serial.parser());
+  EXPECT_EQ_RET(JST_PARSE_OK, parallel.parse_parallel(nullptr, 4));
+  EXPECT_EQ_SIZE_T(3, parallel.root.data().as<JObject>().size());
+  EXPECT_TRUE(serial.root == parallel.root);
+
+  /* the depth limit counts the containers around the split one */
+  opts.max_depth = 2;
+  JParser shallow(json, opts);
+  EXPECT_EQ_RET(JST_PARSE_EXCEED_MAX_DEPTH, shallow.parse_parallel(nullptr, 4));
+  EXPECT_EQ_SIZE_T(json.find("[{") + 1, shallow.error_offset());
+
+  /* errors around the container are the serial ones too */
+  std::string bad = json;
+  bad.replace(bad.find("true"), 4, "tru");
+  opts.max_depth = 0;
+  JParser ser(bad), par(bad, opts);
+  EXPECT_EQ_RET(ser.parser(), par.parse_parallel(nullptr, 4));
+  EXPECT_EQ_SIZE_T(ser.error_offset(), par.error_offset());
+
+  /* no root container to split: nothing is scanned */
+  EXPECT_FALSE(jst_structural_split("\"[1,2]\"", 7, 2, 1, plan));
+  EXPECT_FALSE(jst_structural_split(" [1,2} ", 7, 2, 1, plan));
+  EXPECT_FALSE(jst_structural_split("[1,2]]", 6, 2, 1, plan));
+  EXPECT_TRUE(jst_structural_split("[1,2,3]", 7, 2, 1, plan));
+  std::vector<size_t> expect = {1, 3, 5, 6};
+  EXPECT_TRUE(plan.bounds == expect);
+}
+
+/* every chunking gives the same index as a single pass */
+static void test_structural_index() {
+  const char* json = "{\"a\\\"[\":[1,\"\\\\\",{}],\"b\":\"\xE2\x82\xAC,\"}";
+  size_t len = strlen(json);
+  std::vector<uint64_t> index, chunked;
+  EXPECT_EQ_RET(JST_PARSE_OK, jst_structural_index(json, len, 1, index, true));
+  std::vector<uint64_t> expect = {0, 1, 7, 8, 10, 11, 15, 16, 17, 18, 19, 20, 23, 24, 30};
+  EXPECT_TRUE(index == expect);
+  for (unsigned threads = 2; threads <= len; threads++) {
+    EXPECT_EQ_RET(JST_PARSE_OK, jst_structural_index(json, len, threads, chunked, true));
+    EXPECT_TRUE(chunked == index);
+  }
+
+  size_t offset = 0;
+  EXPECT_EQ_RET(JST_PARSE_MISS_QUOTATION_MARK, jst_structural_index("[\"a\\\"]", 6, 3, index));
+  EXPECT_EQ_RET(JST_PARSE_INVALID_UTF8,
+                jst_structural_index("[\"abc\", \"\xC3(\"]", 12, 4, index, true, &offset));
+  EXPECT_EQ_SIZE_T(9, offset);
+}
+
 static void test_parse() {
   test_parse_null();
   test_parse_bool_true();
   test_parse_bool_false();
   test_parse_number();
+  test_parse_number_exact();
   test_parse_string();
   test_parse_array();
-  // test_parse_object();
+  test_parse_object();
+  test_parse_insitu();
+  test_parse_parallel();
+  test_parse_parallel_object();
+  test_parse_parallel_nested();
+  test_structural_index();
 }
 }  // namespace jst
 
@@ -0,0 +1,246 @@
+#include <stdio.h>
+
+#include <string>
+
+#include "parser.h"
+#include "patch.h"
+#include "utils.h"
+
+namespace jst {
+
+#define TEST_PATCH(expect, doc, patch)                            \
+  do {                                                            \
+    JNode d = test_parse(doc);                                    \
+    JPatch p;                                                     \
+    EXPECT_EQ_RET(JST_PARSE_OK, p.compile(std::string(patch)));   \
+    EXPECT_EQ_RET(JST_PARSE_OK, p.apply(d));                      \
+    EXPECT_TRUE(test_json(d) == test_json(test_parse(expect)));   \
+  } while (0)
+
+// A failing patch leaves the document exactly as it was.
+#define TEST_PATCH_ERROR(expect_ret, expect_op, doc, patch)     \
+  do {                                                          \
+    JNode d = test_parse(doc);                                  \
+    std::string before = test_json(d);                          \
+    JPatch p;                                                   \
+    size_t op = 99;                                             \
+    EXPECT_EQ_RET(JST_PARSE_OK, p.compile(std::string(patch))); \
+    EXPECT_EQ_RET(expect_ret, p.apply(d, &op));                 \
+    EXPECT_EQ_SIZE_T(expect_op, op);                            \
+    EXPECT_TRUE(test_json(d) == before);                        \
+  } while (0)
+
+static void test_pointer() {
+  JNode doc = test_parse(
+      "{\"foo\":[\"bar\",\"baz\"],\"\":0,\"a/b\":1,\"c%d\":2,\"e^f\":3,\"g|h\":4,\"i\\\\j\":5,"
+      "\"k\\\"l\":6,\" \":7,\"m~n\":8}");
+  EXPECT_TRUE(jst_pointer_find(doc, "") == &doc);
+  EXPECT_EQ_TYPE(JST_ARR, jst_pointer_find(doc, "/foo")->type());
+  EXPECT_EQ_STRING("baz", jst_pointer_find(doc, "/foo/1")->data().as<JString>().c_str(), 3);
+  const char* pointers[] = {"/", "/a~1b", "/c%d", "/e^f", "/g|h", "/i\\j", "/k\"l", "/ ", "/m~0n"};
+  for (int i = 0; i < 9; i++) {
+    const JNode* v = jst_pointer_find(doc, pointers[i]);
+    EXPECT_TRUE(v != nullptr);
+    if (v != nullptr) EXPECT_EQ_INT(i, (int)v->data().as<JNumber>().int_value());
+  }
+  EXPECT_TRUE(jst_pointer_find(doc, "foo") == nullptr);
+  EXPECT_TRUE(jst_pointer_find(doc, "/m~2n") == nullptr);
+  EXPECT_TRUE(jst_pointer_find(doc, "/m~") == nullptr);
+  EXPECT_TRUE(jst_pointer_find(doc, "/foo/2") == nullptr);
+  EXPECT_TRUE(jst_pointer_find(doc, "/foo/-") == nullptr);
+  EXPECT_TRUE(jst_pointer_find(doc, "/foo/01") == nullptr);
+  EXPECT_TRUE(jst_pointer_find(doc, "/foo/0/x") == nullptr);
+  EXPECT_TRUE(jst_pointer_find(doc, "/missing") == nullptr);
+}
+
+// The examples of RFC 6902, appendix A.
+static void test_patch_rfc() {
+  TEST_PATCH("{\"foo\":\"bar\",\"baz\":\"qux\"}", "{\"foo\":\"bar\"}",
+             "[{\"op\":\"add\",\"path\":\"/baz\",\"value\":\"qux\"}]");
+  TEST_PATCH("{\"foo\":[\"bar\",\"qux\",\"baz\"]}", "{\"foo\":[\"bar\",\"baz\"]}",
+             "[{\"op\":\"add\",\"path\":\"/foo/1\",\"value\":\"qux\"}]");
+  TEST_PATCH("{\"foo\":\"bar\"}", "{\"baz\":\"qux\",\"foo\":\"bar\"}",
+             "[{\"op\":\"remove\",\"path\":\"/baz\"}]");
+  TEST_PATCH("{\"foo\":[\"bar\",\"baz\"]}", "{\"foo\":[\"bar\",\"qux\",\"baz\"]}",
+             "[{\"op\":\"remove\",\"path\":\"/foo/1\"}]");
+  TEST_PATCH("{\"baz\":\"boo\",\"foo\":\"bar\"}", "{\"baz\":\"qux\",\"foo\":\"bar\"}",
+             "[{\"op\":\"replace\",\"path\":\"/baz\",\"value\":\"boo\"}]");
+  TEST_PATCH("{\"foo\":{\"bar\":\"baz\"},\"qux\":{\"corge\":\"grault\",\"thud\":\"fred\"}}",
+             "{\"foo\":{\"bar\":\"baz\",\"waldo\":\"fred\"},\"qux\":{\"corge\":\"grault\"}}",
+             "[{\"op\":\"move\",\"from\":\"/foo/waldo\",\"path\":\"/qux/thud\"}]");
+  TEST_PATCH("{\"foo\":[\"all\",\"cows\",\"eat\",\"grass\"]}",
+             "{\"foo\":[\"all\",\"grass\",\"cows\",\"eat\"]}",
+             "[{\"op\":\"move\",\"from\":\"/foo/1\",\"path\":\"/foo/3\"}]");
+  TEST_PATCH("{\"baz\":\"qux\",\"foo\":[\"a\",2,\"c\"]}",
+             "{\"baz\":\"qux\",\"foo\":[\"a\",2,\"c\"]}",
+             "[{\"op\":\"test\",\"path\":\"/baz\",\"value\":\"qux\"},"
+             "{\"op\":\"test\",\"path\":\"/foo/1\",\"value\":2}]");
+  TEST_PATCH("{\"foo\":\"bar\",\"child\":{\"grandchild\":{}}}", "{\"foo\":\"bar\"}",
+             "[{\"op\":\"add\",\"path\":\"/child\",\"value\":{\"grandchild\":{}}}]");
+  TEST_PATCH("{\"foo\":\"bar\"}", "{\"foo\":\"bar\"}",
+             "[{\"op\":\"add\",\"path\":\"/baz\",\"value\":\"qux\",\"xyz\":123},"
+             "{\"op\":\"remove\",\"path\":\"/baz\"}]");
+  TEST_PATCH("{\"foo\":[\"bar\",[\"abc\",\"def\"]]}", "{\"foo\":[\"bar\"]}",
+             "[{\"op\":\"add\",\"path\":\"/foo/-\",\"value\":[\"abc\",\"def\"]}]");
+  TEST_PATCH("{\"~/\":[null],\"\":1}", "{\"~/\":[]}",
+             "[{\"op\":\"add\",\"path\":\"/\",\"value\":1},"
+             "{\"op\":\"add\",\"path\":\"/~0~1/0\",\"value\":null}]");
+  TEST_PATCH_ERROR(JST_PARSE_PATH_NOT_FOUND, 0, "{\"foo\":\"bar\"}",
+                   "[{\"op\":\"add\",\"path\":\"/baz/bat\",\"value\":\"qux\"}]");
+  TEST_PATCH_ERROR(JST_PARSE_PATCH_TEST_FAILED, 0, "{\"baz\":\"qux\"}",
+                   "[{\"op\":\"test\",\"path\":\"/baz\",\"value\":\"bar\"}]");
+  TEST_PATCH_ERROR(JST_PARSE_PATCH_TEST_FAILED, 0, "{\"/\":9,\"~1\":10}",
+                   "[{\"op\":\"test\",\"path\":\"/~01\",\"value\":\"10\"}]");
+  TEST_PATCH_ERROR(JST_PARSE_PATH_NOT_FOUND, 0, "{\"foo\":[\"bar\",\"baz\"]}",
+                   "[{\"op\":\"add\",\"path\":\"/foo/3\",\"value\":1}]");
+}
+
+static void test_patch_ops() {
+  /* the whole document */
+  TEST_PATCH("[1]", "{\"a\":1}", "[{\"op\":\"replace\",\"path\":\"\",\"value\":[1]}]");
+  TEST_PATCH("{\"b\":{\"a\":1}}", "{\"a\":1}",
+             "[{\"op\":\"copy\",\"from\":\"\",\"path\":\"/b\"},"
+             "{\"op\":\"remove\",\"path\":\"/a\"}]");
+  TEST_PATCH("1", "{\"a\":1}", "[{\"op\":\"move\",\"from\":\"/a\",\"path\":\"\"}]");
+  TEST_PATCH("{\"a\":1}", "{\"a\":1}", "[{\"op\":\"move\",\"from\":\"\",\"path\":\"\"}]");
+  /* add to an existing member replaces it in place */
+  TEST_PATCH("{\"a\":2,\"b\":1}", "{\"a\":1,\"b\":1}",
+             "[{\"op\":\"add\",\"path\":\"/a\",\"value\":2}]");
+  TEST_PATCH("{\"a\":[1,[2,3]],\"b\":[2,3]}", "{\"a\":[1],\"b\":[2,3]}",
+             "[{\"op\":\"copy\",\"from\":\"/b\",\"path\":\"/a/-\"}]");
+  TEST_PATCH("{\"b\":{\"c\":{\"x\":1}}}", "{\"a\":{\"x\":1},\"b\":{}}",
+             "[{\"op\":\"move\",\"from\":\"/a\",\"path\":\"/b/c\"}]");
+  TEST_PATCH("[3,1,2]", "[1,2,3]", "[{\"op\":\"move\",\"from\":\"/2\",\"path\":\"/0\"}]");
+  TEST_PATCH("[2,3,1]", "[1,2,3]", "[{\"op\":\"move\",\"from\":\"/0\",\"path\":\"/-\"}]");
+  /* a copy is independent of its source */
+  TEST_PATCH("{\"a\":[0],\"b\":[0,1]}", "{\"a\":[0]}",
+             "[{\"op\":\"copy\",\"from\":\"/a\",\"path\":\"/b\"},"
+             "{\"op\":\"add\",\"path\":\"/b/-\",\"value\":1}]");
+
+  TEST_PATCH_ERROR(JST_PARSE_PATH_NOT_FOUND, 0, "{\"a\":{\"b\":1}}",
+                   "[{\"op\":\"move\",\"from\":\"/a\",\"path\":\"/a/b\"}]");
+  TEST_PATCH_ERROR(JST_PARSE_PATH_NOT_FOUND, 0, "{\"a\":1}",
+                   "[{\"op\":\"replace\",\"path\":\"/b\",\"value\":1}]");
+  TEST_PATCH_ERROR(JST_PARSE_PATH_NOT_FOUND, 0, "[1]",
+                   "[{\"op\":\"replace\",\"path\":\"/-\",\"value\":1}]");
+  TEST_PATCH_ERROR(JST_PARSE_PATH_NOT_FOUND, 0, "[1]", "[{\"op\":\"remove\",\"path\":\"/1\"}]");
+  TEST_PATCH_ERROR(JST_PARSE_PATH_NOT_FOUND, 0, "[1]", "[{\"op\":\"remove\",\"path\":\"/a\"}]");
+  TEST_PATCH_ERROR(JST_PARSE_PATH_NOT_FOUND, 0, "{\"a\":1}",
+                   "[{\"op\":\"add\",\"path\":\"/a/b\",\"value\":1}]");
+  TEST_PATCH_ERROR(JST_PARSE_PATH_NOT_FOUND, 0, "{\"a\":1}",
+                   "[{\"op\":\"copy\",\"from\":\"/b\",\"path\":\"/c\"}]");
+  TEST_PATCH_ERROR(JST_PARSE_PATH_NOT_FOUND, 0, "{\"a\":1}",
+                   "[{\"op\":\"test\",\"path\":\"/b\",\"value\":1}]");
+}
+
+// Every kind of edit followed by a failure: all of them are taken back.
+static void test_patch_rollback() {
+  TEST_PATCH_ERROR(JST_PARSE_PATCH_TEST_FAILED, 9,
+                   "{\"a\":[1,2,{\"x\":[3]}],\"b\":{\"c\":\"d\",\"e\":null},\"f\":true}",
+                   "[{\"op\":\"add\",\"path\":\"/a/0\",\"value\":0},"
+                   "{\"op\":\"remove\",\"path\":\"/b/c\"},"
+                   "{\"op\":\"replace\",\"path\":\"/f\",\"value\":{\"g\":1}},"
+                   "{\"op\":\"move\",\"from\":\"/a/3/x\",\"path\":\"/f/g\"},"
+                   "{\"op\":\"move\",\"from\":\"/a\",\"path\":\"/b/a\"},"
+                   "{\"op\":\"copy\",\"from\":\"/b\",\"path\":\"/h\"},"
+                   "{\"op\":\"remove\",\"path\":\"/h/a/1\"},"
+                   "{\"op\":\"add\",\"path\":\"/b/e\",\"value\":[]},"
+                   "{\"op\":\"replace\",\"path\":\"\",\"value\":{}},"
+                   "{\"op\":\"test\",\"path\":\"\",\"value\":null}]");
+  /* a move whose destination does not exist keeps the value it took */
+  TEST_PATCH_ERROR(JST_PARSE_PATH_NOT_FOUND, 1, "{\"a\":[1,2],\"b\":{}}",
+                   "[{\"op\":\"remove\",\"path\":\"/a/0\"},"
+                   "{\"op\":\"move\",\"from\":\"/a/0\",\"path\":\"/c/d\"}]");
+
+  /* the very same nodes come back, nothing is rebuilt */
+  JNode doc = test_parse("{\"keep\":{\"deep\":[1,2,3]},\"list\":[{\"a\":1},{\"b\":2}]}");
+  const JData* keep = &jst_pointer_find(doc, "/keep")->data();
+  const JData* deep = &jst_pointer_find(doc, "/keep/deep")->data();
+  const JData* second = &jst_pointer_find(doc, "/list/1")->data();
+  JPatch p;
+  EXPECT_EQ_RET(JST_PARSE_OK,
+                p.compile(std::string("[{\"op\":\"move\",\"from\":\"/keep\",\"path\":\"/moved\"},"
+                                      "{\"op\":\"remove\",\"path\":\"/list/0\"},"
+                                      "{\"op\":\"test\",\"path\":\"/moved/deep/0\",\"value\":1},"
+                                      "{\"op\":\"test\",\"path\":\"/list/0/b\",\"value\":3}]")));
+  size_t op = 0;
+  EXPECT_EQ_RET(JST_PARSE_PATCH_TEST_FAILED, p.apply(doc, &op));
+  EXPECT_EQ_SIZE_T(3, op);
+  EXPECT_TRUE(&jst_pointer_find(doc, "/keep")->data() == keep);
+  EXPECT_TRUE(&jst_pointer_find(doc, "/keep/deep")->data() == deep);
+  EXPECT_TRUE(&jst_pointer_find(doc, "/list/1")->data() == second);
+  EXPECT_TRUE(test_json(doc) ==
+              "{\"keep\":{\"deep\":[1,2,3]},\"list\":[{\"a\":1},{\"b\":2}]}");
+
+  /* applied edits drop the cached fragments above them */
+  JParserOptions opts;
+  opts.cache_fragments = 1;
+  JParser jc("", opts);
+  std::string out;
+  jc.stringify(doc, out);
+  EXPECT_TRUE(jst_pointer_find(doc, "/keep")->data().fragment() != nullptr);
+  EXPECT_EQ_RET(JST_PARSE_OK,
+                p.compile(std::string("[{\"op\":\"add\",\"path\":\"/list/1/c\",\"value\":3}]")));
+  EXPECT_EQ_RET(JST_PARSE_OK, p.apply(doc));
+  EXPECT_TRUE(doc.data().fragment() == nullptr);
+  EXPECT_TRUE(jst_pointer_find(doc, "/list")->data().fragment() == nullptr);
+  EXPECT_TRUE(jst_pointer_find(doc, "/keep")->data().fragment() != nullptr);
+  out.clear();
+  jc.stringify(doc, out);
+  EXPECT_TRUE(out == "{\"keep\":{\"deep\":[1,2,3]},\"list\":[{\"a\":1},{\"b\":2,\"c\":3}]}");
+}
+
+static void test_patch_compile() {
+  JPatch p;
+  size_t op = 99;
+  EXPECT_EQ_RET(JST_PARSE_INVALID_PATCH, p.compile(std::string("{}"), &op));
+  EXPECT_EQ_SIZE_T(0, op);
+  EXPECT_FALSE(p.compiled());
+  JNode doc = test_parse("{}");
+  EXPECT_EQ_RET(JST_PARSE_INVALID_PATCH, p.apply(doc));
+  EXPECT_EQ_RET(JST_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, p.compile(std::string("[{}")));
+
+  /* the second operation is the broken one */
+  const char* invalid[] = {
+      "1",
+      "{\"path\":\"/a\"}",
+      "{\"op\":\"get\",\"path\":\"/a\"}",
+      "{\"op\":\"add\",\"path\":\"a\",\"value\":1}",
+      "{\"op\":\"add\",\"path\":\"/~\",\"value\":1}",
+      "{\"op\":\"add\",\"path\":\"/a\"}",
+      "{\"op\":\"move\",\"path\":\"/a\"}",
+      "{\"op\":\"copy\",\"path\":\"/a\",\"from\":1}",
+      "{\"op\":\"remove\",\"path\":\"\"}",
+      "{\"op\":\"test\",\"path\":1,\"value\":1}",
+  };
+  std::string first = "[{\"op\":\"test\",\"path\":\"/a\",\"value\":1},";
+  for (const char* second : invalid) {
+    op = 99;
+    std::string patch = first + second + "]";
+    EXPECT_EQ_RET(JST_PARSE_INVALID_PATCH, p.compile(patch, &op));
+    EXPECT_EQ_SIZE_T(1, op);
+  }
+  EXPECT_EQ_RET(JST_PARSE_OK, p.compile(std::string("[]")));
+  EXPECT_EQ_SIZE_T(0, p.size());
+  EXPECT_EQ_RET(JST_PARSE_OK, p.apply(doc));
+}
+
+static void test_patch() {
+  test_pointer();
+  test_patch_rfc();
+  test_patch_ops();
+  test_patch_rollback();
+  test_patch_compile();
+}
+
+}  // namespace jst
+
+int main() {
+#ifdef _WINDOWS
+  _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif
+  jst::test_patch();
+  printf("%d/%d (%3.2f%%) passed\n", jst::test_pass, jst::test_count,
+         jst::test_pass * 100.0 / jst::test_count);
+  return jst::main_ret;
+}
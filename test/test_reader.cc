@@ -0,0 +1,156 @@
+#include <stdio.h>
+
+#include <string>
+
+#include "reader.h"
+#include "utils.h"
+
+namespace jst {
+
+static void test_reader_tokens() {
+  std::string json =
+      " {\"a\" : [1, -2.5e3, true, false, null], \"s\\n\":\"x\\u00e9y\", \"o\":{}, \"e\":[]} ";
+  JReader r(json);
+  size_t len;
+  const char* raw;
+
+  EXPECT_EQ_INT(JST_TOKEN_BEGIN_OBJECT, r.next());
+  EXPECT_EQ_INT(JST_TOKEN_KEY, r.next());
+  EXPECT_TRUE(r.get_string().value() == "a");
+  EXPECT_EQ_INT(JST_TOKEN_BEGIN_ARRAY, r.next());
+  EXPECT_EQ_SIZE_T(2, r.depth());
+  EXPECT_EQ_INT(JST_TOKEN_NUMBER, r.next());
+  EXPECT_TRUE(r.get_number().is_int());
+  EXPECT_TRUE(r.get_number().int_value() == 1);
+  EXPECT_EQ_INT(JST_TOKEN_NUMBER, r.next());
+  EXPECT_EQ_DOUBLE(-2500.0, r.get_number().value());
+  raw = r.raw(len);
+  EXPECT_TRUE(std::string(raw, len) == "-2.5e3");
+  EXPECT_EQ_INT(JST_TOKEN_TRUE, r.next());
+  EXPECT_EQ_INT(JST_TOKEN_FALSE, r.next());
+  EXPECT_EQ_INT(JST_TOKEN_NULL, r.next());
+  EXPECT_EQ_INT(JST_TOKEN_END_ARRAY, r.next());
+
+  /* strings stay in the input until they are read */
+  EXPECT_EQ_INT(JST_TOKEN_KEY, r.next());
+  raw = r.raw(len);
+  EXPECT_TRUE(raw == json.c_str() + json.find("s\\n"));
+  EXPECT_TRUE(std::string(raw, len) == "s\\n");
+  EXPECT_TRUE(r.get_string().value() == "s\n");
+  EXPECT_EQ_INT(JST_TOKEN_STRING, r.next());
+  EXPECT_EQ_SIZE_T(4, r.get_string().size());
+  EXPECT_TRUE(r.get_string().value() == "x\xC3\xA9y");
+
+  EXPECT_EQ_INT(JST_TOKEN_KEY, r.next());
+  EXPECT_EQ_INT(JST_TOKEN_BEGIN_OBJECT, r.next());
+  EXPECT_EQ_INT(JST_TOKEN_END_OBJECT, r.next());
+  EXPECT_EQ_INT(JST_TOKEN_KEY, r.next());
+  EXPECT_EQ_INT(JST_TOKEN_BEGIN_ARRAY, r.next());
+  EXPECT_EQ_INT(JST_TOKEN_END_ARRAY, r.next());
+  EXPECT_EQ_INT(JST_TOKEN_END_OBJECT, r.next());
+  EXPECT_EQ_SIZE_T(0, r.depth());
+  EXPECT_EQ_INT(JST_TOKEN_END, r.next());
+  EXPECT_EQ_INT(JST_TOKEN_END, r.next());
+  EXPECT_EQ_RET(JST_PARSE_OK, r.error());
+}
+
+static void test_reader_skip() {
+  std::string json =
+      "{\"skip\":{\"x\":[1,{\"]\":\"}\\\"\"}],\"y\":null},\"keep\":[[1,2],3],\"last\":\"v\"}";
+  JReader r(json);
+  EXPECT_EQ_INT(JST_TOKEN_BEGIN_OBJECT, r.next());
+  EXPECT_EQ_INT(JST_TOKEN_KEY, r.next());
+  /* from a key: skips the value */
+  EXPECT_EQ_RET(JST_PARSE_OK, r.skip());
+  EXPECT_EQ_INT(JST_TOKEN_END_OBJECT, r.token());
+  EXPECT_EQ_SIZE_T(1, r.depth());
+  EXPECT_EQ_INT(JST_TOKEN_KEY, r.next());
+  EXPECT_TRUE(r.get_string().value() == "keep");
+  EXPECT_EQ_INT(JST_TOKEN_BEGIN_ARRAY, r.next());
+  EXPECT_EQ_INT(JST_TOKEN_BEGIN_ARRAY, r.next());
+  /* from a begin token: moves past its end */
+  EXPECT_EQ_RET(JST_PARSE_OK, r.skip());
+  EXPECT_EQ_INT(JST_TOKEN_END_ARRAY, r.token());
+  EXPECT_EQ_INT(JST_TOKEN_NUMBER, r.next());
+  EXPECT_EQ_RET(JST_PARSE_OK, r.skip());
+  EXPECT_EQ_INT(JST_TOKEN_NUMBER, r.token());
+  EXPECT_EQ_INT(JST_TOKEN_END_ARRAY, r.next());
+  EXPECT_EQ_INT(JST_TOKEN_KEY, r.next());
+  /* a scalar value is skipped as well */
+  EXPECT_EQ_RET(JST_PARSE_OK, r.skip());
+  EXPECT_EQ_INT(JST_TOKEN_STRING, r.token());
+  EXPECT_EQ_INT(JST_TOKEN_END_OBJECT, r.next());
+  EXPECT_EQ_INT(JST_TOKEN_END, r.next());
+
+  JReader bad("[{\"a\":[1,2}]");
+  EXPECT_EQ_INT(JST_TOKEN_BEGIN_ARRAY, bad.next());
+  EXPECT_EQ_INT(JST_TOKEN_BEGIN_OBJECT, bad.next());
+  EXPECT_EQ_RET(JST_PARSE_MISS_COMMA_OR_CURLY_BRACKET, bad.skip());
+  EXPECT_EQ_SIZE_T(11, bad.error_offset());
+
+  JReader open("[\"abc");
+  EXPECT_EQ_INT(JST_TOKEN_BEGIN_ARRAY, open.next());
+  EXPECT_EQ_RET(JST_PARSE_MISS_QUOTATION_MARK, open.skip());
+}
+
+#define TEST_READER_ERROR(expect, offset, json)                       \
+  do {                                                                \
+    JReader r(json);                                                  \
+    JTokenType t;                                                     \
+    while ((t = r.next()) != JST_TOKEN_END && t != JST_TOKEN_ERROR) { \
+    }                                                                 \
+    EXPECT_EQ_INT(JST_TOKEN_ERROR, t);                                \
+    EXPECT_EQ_RET(expect, r.error());                                 \
+    EXPECT_EQ_SIZE_T(offset, r.error_offset());                       \
+    JParser jc(json);                                                 \
+    EXPECT_EQ_RET(expect, jc.parser());                               \
+    EXPECT_EQ_SIZE_T(offset, jc.error_offset());                      \
+  } while (0)
+
+/* the reader stops where the parser does */
+static void test_reader_error() {
+  TEST_READER_ERROR(JST_PARSE_EXCEPT_VALUE, 1, " ");
+  TEST_READER_ERROR(JST_PARSE_EXCEPT_VALUE, 1, "[");
+  TEST_READER_ERROR(JST_PARSE_INVALID_VALUE, 3, "[1,]");
+  TEST_READER_ERROR(JST_PARSE_INVALID_VALUE, 1, "[nul]");
+  TEST_READER_ERROR(JST_PARSE_SINGULAR, 5, "null x");
+  TEST_READER_ERROR(JST_PARSE_SINGULAR, 1, "[01]");
+  TEST_READER_ERROR(JST_PARSE_NUMBER_TOO_BIG, 0, "1e309");
+  TEST_READER_ERROR(JST_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, 3, "[1 2]");
+  TEST_READER_ERROR(JST_PARSE_MISS_KEY, 1, "{1:2}");
+  TEST_READER_ERROR(JST_PARSE_MISS_COMMA_OR_CURLY_BRACKET, 7, "{\"a\":1 \"b\":2}");
+  TEST_READER_ERROR(JST_PARSE_INVALID_STRING_ESCAPE, 4, "[\"a\\x\"]");
+  TEST_READER_ERROR(JST_PARSE_MISS_QUOTATION_MARK, 4, "\"abc");
+
+  JReader colon("{\"a\" 1}");
+  EXPECT_EQ_INT(JST_TOKEN_BEGIN_OBJECT, colon.next());
+  EXPECT_EQ_INT(JST_TOKEN_ERROR, colon.next());
+  EXPECT_EQ_RET(JST_PARSE_MISS_COLON, colon.error());
+  EXPECT_EQ_SIZE_T(5, colon.error_offset());
+
+  JParserOptions opts;
+  opts.max_depth = 2;
+  JReader r("[[[1]]]", opts);
+  EXPECT_EQ_INT(JST_TOKEN_BEGIN_ARRAY, r.next());
+  EXPECT_EQ_INT(JST_TOKEN_BEGIN_ARRAY, r.next());
+  EXPECT_EQ_INT(JST_TOKEN_ERROR, r.next());
+  EXPECT_EQ_RET(JST_PARSE_EXCEED_MAX_DEPTH, r.error());
+}
+
+static void test_reader() {
+  test_reader_tokens();
+  test_reader_skip();
+  test_reader_error();
+}
+
+}  // namespace jst
+
+int main() {
+#ifdef _WINDOWS
+  _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif
+  jst::test_reader();
+  printf("%d/%d (%3.2f%%) passed\n", jst::test_pass, jst::test_count,
+         jst::test_pass * 100.0 / jst::test_count);
+  return jst::main_ret;
+}
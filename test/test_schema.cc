@@ -0,0 +1,300 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include "parser.h"
+#include "schema.h"
+#include "utils.h"
+
+namespace jst {
+
+static const char* test_schema_json =
+    "{\"type\":\"object\",\"required\":[\"id\",\"name\"],\"additionalProperties\":false,"
+    "\"properties\":{"
+    "\"id\":{\"type\":\"integer\",\"minimum\":1},"
+    "\"name\":{\"type\":\"string\",\"minLength\":1,\"maxLength\":4,"
+    "\"pattern\":\"^[a-z\\u00e9]+$\"},"
+    "\"score\":{\"type\":[\"number\",\"null\"],\"exclusiveMinimum\":0,\"maximum\":10},"
+    "\"tags\":{\"type\":\"array\",\"items\":{\"enum\":[\"a\",\"b\",[1,{\"x\":null}]]},"
+    "\"maxItems\":3},"
+    "\"kind\":{\"const\":\"user\"},"
+    "\"meta\":true,"
+    "\"never\":false,"
+    "\"a/b~\":{\"type\":\"boolean\"}}}";
+
+// Both walks must agree on the verdict, the keyword and the path.
+#define TEST_SCHEMA(expect, expect_keyword, expect_path, json)                       \
+  do {                                                                               \
+    std::string j(json);                                                             \
+    JSchemaError tree_err, text_err;                                                 \
+    JParser jc(j);                                                                   \
+    EXPECT_EQ_RET(JST_PARSE_OK, jc.parser());                                        \
+    JRetType tree_ret = schema.validate(jc.root, &tree_err);                         \
+    JRetType text_ret = schema.validate(j, &text_err);                               \
+    EXPECT_EQ_RET(expect, tree_ret);                                                 \
+    EXPECT_EQ_RET(expect, text_ret);                                                 \
+    if (expect != JST_PARSE_OK) {                                                    \
+      EXPECT_TRUE(tree_err.keyword == expect_keyword);                               \
+      EXPECT_TRUE(text_err.keyword == expect_keyword);                               \
+      EXPECT_TRUE(tree_err.path == expect_path);                                     \
+      EXPECT_TRUE(text_err.path == expect_path);                                     \
+    }                                                                                \
+  } while (0)
+
+static void test_schema_keywords() {
+  JSchema schema;
+  JSchemaError err;
+  EXPECT_EQ_RET(JST_PARSE_OK, schema.compile(std::string(test_schema_json), &err));
+  EXPECT_TRUE(schema.compiled());
+
+  TEST_SCHEMA(JST_PARSE_OK, "", "", "{\"id\":1,\"name\":\"ab\"}");
+  TEST_SCHEMA(JST_PARSE_OK, "", "",
+              "{\"name\":\"\\u00e9t\\u00e9\",\"id\":2.0,\"score\":null,\"tags\":[\"a\",[1,{\"x\":"
+              "null}]],\"kind\":\"user\",\"meta\":{\"any\":[1,{}]},\"a/b~\":true}");
+  TEST_SCHEMA(JST_PARSE_OK, "", "", "{\"id\":9007199254740993,\"name\":\"x\",\"score\":10}");
+
+  TEST_SCHEMA(JST_PARSE_SCHEMA_VIOLATION, "type", "", "[]");
+  TEST_SCHEMA(JST_PARSE_SCHEMA_VIOLATION, "required", "/name", "{\"id\":1}");
+  TEST_SCHEMA(JST_PARSE_SCHEMA_VIOLATION, "required", "/id", "{}");
+  TEST_SCHEMA(JST_PARSE_SCHEMA_VIOLATION, "additionalProperties", "/extra",
+              "{\"id\":1,\"name\":\"a\",\"extra\":1}");
+  TEST_SCHEMA(JST_PARSE_SCHEMA_VIOLATION, "false", "/never",
+              "{\"id\":1,\"name\":\"a\",\"never\":null}");
+  TEST_SCHEMA(JST_PARSE_SCHEMA_VIOLATION, "type", "/id", "{\"id\":1.5,\"name\":\"a\"}");
+  TEST_SCHEMA(JST_PARSE_SCHEMA_VIOLATION, "type", "/id", "{\"id\":\"1\",\"name\":\"a\"}");
+  TEST_SCHEMA(JST_PARSE_SCHEMA_VIOLATION, "minimum", "/id", "{\"id\":0,\"name\":\"a\"}");
+  TEST_SCHEMA(JST_PARSE_SCHEMA_VIOLATION, "minLength", "/name", "{\"id\":1,\"name\":\"\"}");
+  /* lengths are in code points */
+  TEST_SCHEMA(JST_PARSE_OK, "", "", "{\"id\":1,\"name\":\"\\u00e9\\u00e9\\u00e9\\u00e9\"}");
+  TEST_SCHEMA(JST_PARSE_SCHEMA_VIOLATION, "maxLength", "/name", "{\"id\":1,\"name\":\"abcde\"}");
+  TEST_SCHEMA(JST_PARSE_SCHEMA_VIOLATION, "pattern", "/name", "{\"id\":1,\"name\":\"aB\"}");
+  TEST_SCHEMA(JST_PARSE_SCHEMA_VIOLATION, "exclusiveMinimum", "/score",
+              "{\"id\":1,\"name\":\"a\",\"score\":0}");
+  TEST_SCHEMA(JST_PARSE_SCHEMA_VIOLATION, "maximum", "/score",
+              "{\"id\":1,\"name\":\"a\",\"score\":10.5}");
+  TEST_SCHEMA(JST_PARSE_SCHEMA_VIOLATION, "type", "/score",
+              "{\"id\":1,\"name\":\"a\",\"score\":false}");
+  TEST_SCHEMA(JST_PARSE_SCHEMA_VIOLATION, "enum", "/tags/1",
+              "{\"id\":1,\"name\":\"a\",\"tags\":[\"a\",\"c\"]}");
+  TEST_SCHEMA(JST_PARSE_SCHEMA_VIOLATION, "enum", "/tags/0",
+              "{\"id\":1,\"name\":\"a\",\"tags\":[[1,{\"x\":0}]]}");
+  TEST_SCHEMA(JST_PARSE_SCHEMA_VIOLATION, "maxItems", "/tags",
+              "{\"id\":1,\"name\":\"a\",\"tags\":[\"a\",\"a\",\"a\",\"a\"]}");
+  TEST_SCHEMA(JST_PARSE_SCHEMA_VIOLATION, "const", "/kind",
+              "{\"id\":1,\"name\":\"a\",\"kind\":\"admin\"}");
+  /* pointer tokens escape '~' and '/' */
+  TEST_SCHEMA(JST_PARSE_SCHEMA_VIOLATION, "type", "/a~1b~0",
+              "{\"id\":1,\"name\":\"a\",\"a/b~\":1}");
+  /* escaped keys are matched decoded */
+  TEST_SCHEMA(JST_PARSE_SCHEMA_VIOLATION, "type", "/id", "{\"\\u0069d\":true,\"name\":\"a\"}");
+}
+
+static void test_schema_text() {
+  JSchema schema;
+  EXPECT_EQ_RET(JST_PARSE_OK, schema.compile(std::string(test_schema_json)));
+  JSchemaError err;
+
+  /* the offset of the failing value */
+  std::string json = "{\"id\":1, \"name\":\"a\", \"tags\":[\"a\", \"z\"]}";
+  EXPECT_EQ_RET(JST_PARSE_SCHEMA_VIOLATION, schema.validate(json, &err));
+  EXPECT_EQ_SIZE_T(json.find("\"z\""), err.offset);
+  json = "{\"id\":1, \"name\":\"a\",\n \"bad\":[1,2]}";
+  EXPECT_EQ_RET(JST_PARSE_SCHEMA_VIOLATION, schema.validate(json, &err));
+  EXPECT_EQ_SIZE_T(json.find("\"bad\""), err.offset);
+
+  /* syntax errors are the reader's, also in parts no keyword looks at */
+  json = "{\"id\":1,\"name\":\"a\",\"meta\":[1,,2]}";
+  EXPECT_EQ_RET(JST_PARSE_INVALID_VALUE, schema.validate(json, &err));
+  EXPECT_EQ_SIZE_T(json.find(",,") + 1, err.offset);
+  EXPECT_TRUE(err.keyword.empty() && err.path.empty());
+  json = "{\"id\":1,\"name\":\"a\"} x";
+  EXPECT_EQ_RET(JST_PARSE_SINGULAR, schema.validate(json, &err));
+  json = "{\"id\":1,\"name\":\"a\"";
+  EXPECT_EQ_RET(JST_PARSE_MISS_COMMA_OR_CURLY_BRACKET, schema.validate(json, &err));
+
+  /* parse builds the tree only for a valid payload */
+  JNode out;
+  json = "{\"id\":3,\"name\":\"abc\",\"tags\":[]}";
+  EXPECT_EQ_RET(JST_PARSE_OK, schema.parse(json.c_str(), json.size(), out));
+  EXPECT_EQ_TYPE(JST_OBJ, out.type());
+  EXPECT_EQ_SIZE_T(3, out.data().as<JObject>().size());
+  out = JNode(JST_NULL);
+  json = "{\"id\":3}";
+  EXPECT_EQ_RET(JST_PARSE_SCHEMA_VIOLATION, schema.parse(json.c_str(), json.size(), out, &err));
+  EXPECT_EQ_TYPE(JST_NULL, out.type());
+}
+
+static void test_schema_misc() {
+  JSchema schema;
+  JSchemaError err;
+
+  /* boolean schemas and nesting */
+  EXPECT_EQ_RET(JST_PARSE_OK, schema.compile(std::string("true")));
+  EXPECT_EQ_RET(JST_PARSE_OK, schema.validate(std::string("[1,{\"a\":null}]")));
+  EXPECT_EQ_RET(JST_PARSE_OK, schema.compile(std::string("false")));
+  EXPECT_EQ_RET(JST_PARSE_SCHEMA_VIOLATION, schema.validate(std::string("null"), &err));
+  EXPECT_TRUE(err.keyword == "false");
+
+  EXPECT_EQ_RET(JST_PARSE_OK,
+                schema.compile(std::string("{\"items\":{\"items\":{\"type\":\"integer\"},"
+                                           "\"minItems\":1},\"unknown\":{\"type\":7}}")));
+  EXPECT_EQ_RET(JST_PARSE_OK, schema.validate(std::string("[[1],[2,3]]")));
+  EXPECT_EQ_RET(JST_PARSE_OK, schema.validate(std::string("\"not an array\"")));
+  EXPECT_EQ_RET(JST_PARSE_SCHEMA_VIOLATION, schema.validate(std::string("[[1],[]]"), &err));
+  EXPECT_TRUE(err.keyword == "minItems" && err.path == "/1");
+  EXPECT_EQ_RET(JST_PARSE_SCHEMA_VIOLATION, schema.validate(std::string("[[1],[2,true]]"), &err));
+  EXPECT_TRUE(err.keyword == "type" && err.path == "/1/1");
+
+  /* additionalProperties as a schema, and a required name that only it covers */
+  EXPECT_EQ_RET(JST_PARSE_OK,
+                schema.compile(std::string("{\"properties\":{\"a\":true},\"required\":[\"b\"],"
+                                           "\"additionalProperties\":{\"type\":\"string\"}}")));
+  EXPECT_EQ_RET(JST_PARSE_OK, schema.validate(std::string("{\"a\":1,\"b\":\"x\",\"c\":\"y\"}")));
+  EXPECT_EQ_RET(JST_PARSE_SCHEMA_VIOLATION, schema.validate(std::string("{\"b\":1}"), &err));
+  EXPECT_TRUE(err.keyword == "type" && err.path == "/b");
+  EXPECT_EQ_RET(JST_PARSE_SCHEMA_VIOLATION, schema.validate(std::string("{\"a\":1}"), &err));
+  EXPECT_TRUE(err.keyword == "required" && err.path == "/b");
+
+  /* enum and const only build the payload as deep as their own values go */
+  EXPECT_EQ_RET(JST_PARSE_OK,
+                schema.compile(std::string("{\"items\":{\"enum\":[1,[[2]]]},"
+                                           "\"additionalProperties\":{\"const\":[]}}")));
+  EXPECT_EQ_RET(JST_PARSE_OK, schema.validate(std::string("[1,[[2]]]")));
+  EXPECT_EQ_RET(JST_PARSE_SCHEMA_VIOLATION, schema.validate(std::string("[[[[2]]]]"), &err));
+  EXPECT_TRUE(err.keyword == "enum" && err.path == "/0" && err.offset == 1);
+  EXPECT_EQ_RET(JST_PARSE_SCHEMA_VIOLATION, schema.validate(std::string("{\"a\":[[]]}"), &err));
+  EXPECT_TRUE(err.keyword == "const" && err.path == "/a");
+  std::string deep = std::string(1000000, '[') + std::string(1000000, ']');
+  EXPECT_EQ_RET(JST_PARSE_SCHEMA_VIOLATION, schema.validate("[" + deep + "]", &err));
+  EXPECT_TRUE(err.keyword == "enum" && err.path == "/0");
+  std::string cut = "[" + deep.substr(0, 500000) + "}]";
+  EXPECT_EQ_RET(JST_PARSE_INVALID_VALUE, schema.validate(cut, &err));
+  JParserOptions opts;
+  opts.max_depth = 64;
+  EXPECT_EQ_RET(JST_PARSE_EXCEED_MAX_DEPTH, schema.validate("[" + deep + "]", &err, opts));
+  EXPECT_EQ_RET(JST_PARSE_OK, schema.compile(std::string("{\"type\":\"object\",\"const\":{}}")));
+  EXPECT_EQ_RET(JST_PARSE_SCHEMA_VIOLATION, schema.validate(deep, &err));
+  EXPECT_TRUE(err.keyword == "type" && err.offset == 0);
+
+  /* more than 64 required names */
+  std::string many = "{\"required\":[", doc = "{";
+  for (int i = 0; i < 70; i++) {
+    many += std::string(i ? "," : "") + "\"k" + std::to_string(i) + "\"";
+    if (i != 42) doc += std::string(i ? "," : "") + "\"k" + std::to_string(i) + "\":0";
+  }
+  many += "]}";
+  EXPECT_EQ_RET(JST_PARSE_OK, schema.compile(many));
+  EXPECT_EQ_RET(JST_PARSE_SCHEMA_VIOLATION, schema.validate(doc + "}", &err));
+  EXPECT_TRUE(err.keyword == "required" && err.path == "/k42");
+  EXPECT_EQ_RET(JST_PARSE_OK, schema.validate(doc + ",\"k42\":1,\"k42\":2}"));
+
+  /* schemas that do not compile */
+  EXPECT_EQ_RET(JST_PARSE_INVALID_SCHEMA, schema.compile(std::string("1"), &err));
+  EXPECT_FALSE(schema.compiled());
+  EXPECT_EQ_RET(JST_PARSE_INVALID_SCHEMA, schema.validate(std::string("1")));
+  EXPECT_EQ_RET(JST_PARSE_INVALID_SCHEMA,
+                schema.compile(std::string("{\"properties\":{\"a\":{\"type\":\"int\"}}}"), &err));
+  EXPECT_TRUE(err.path == "/properties/a/type");
+  EXPECT_EQ_RET(JST_PARSE_INVALID_SCHEMA,
+                schema.compile(std::string("{\"items\":{\"pattern\":\"(\"}}"), &err));
+  EXPECT_TRUE(err.path == "/items/pattern");
+  EXPECT_EQ_RET(JST_PARSE_INVALID_SCHEMA, schema.compile(std::string("{\"minItems\":-1}")));
+  EXPECT_EQ_RET(JST_PARSE_INVALID_SCHEMA, schema.compile(std::string("{\"minLength\":1.5}")));
+  EXPECT_EQ_RET(JST_PARSE_INVALID_SCHEMA, schema.compile(std::string("{\"required\":[1]}")));
+  EXPECT_EQ_RET(JST_PARSE_INVALID_SCHEMA, schema.compile(std::string("{\"enum\":1}")));
+  EXPECT_EQ_RET(JST_PARSE_INVALID_VALUE, schema.compile(std::string("{\"type\":}"), &err));
+  EXPECT_EQ_SIZE_T(8, err.offset);
+}
+
+// Patterns run as automata: no backtracking, no recursion, whatever the length of the string.
+static void test_schema_pattern() {
+  struct {
+    const char* pattern;
+    const char* s;
+    bool match;
+  } cases[] = {
+      {"abc", "xxabcxx", true},
+      {"^abc$", "xabc", false},
+      {"^a.c$", "a\xc3\xa9" "c", true},
+      {"^a.c$", "a\nc", false},
+      {"^[^a-c]+$", "xyz", true},
+      {"^[^a-c]+$", "xbz", false},
+      {"^[\\d\\-_]{2,3}$", "1-_", true},
+      {"^[\\d\\-_]{2,3}$", "1-_2", false},
+      {"^\\w+@\\w+\\.com$", "me@host.com", true},
+      {"^(ab|cd)*e?$", "abcdab", true},
+      {"^(ab|cd)*e?$", "abce", false},
+      {"^a{3}$", "aaa", true},
+      {"^a{3}$", "aa", false},
+      {"^a{2,}$", "aaaaa", true},
+      {"^(?:x|y)+?$", "xyyx", true},
+      {"^(?<n>[0-9]+)$", "42", true},
+      {"\\bcat\\b", "a cat!", true},
+      {"\\bcat\\b", "concat", false},
+      {"\\Bcat", "concat", true},
+      {"^[\\u00e0-\\u00ff]$", "\xc3\xa9", true},
+      {"^\\u{1F600}$", "\xf0\x9f\x98\x80", true},
+      {"^\\ud83d\\ude00$", "\xf0\x9f\x98\x80", true},
+      {"^\\x41\\t$", "A\t", true},
+      {"^a{,2}$", "a{,2}", true},
+      {"^\\s\\S$", " x", true},
+      {"^[]$", "", false},
+      {"^[^]$", "\n", true},
+      {"", "", true},
+      {"$", "abc", true},
+      {"(a|)+$", "b", true},
+  };
+  for (const auto& c : cases) {
+    JPattern p;
+    EXPECT_EQ_RET(JST_PARSE_OK, p.compile(std::string(c.pattern)));
+    if (p.search(c.s, strlen(c.s)) != c.match) {
+      fprintf(stderr, "pattern /%s/ on \"%s\"\n", c.pattern, c.s);
+    }
+    EXPECT_TRUE(p.search(c.s, strlen(c.s)) == c.match);
+  }
+
+  const char* invalid[] = {"(",     ")",        "a**",        "*a",      "[z-a]",  "a{3,2}",
+                           "(?=a)", "(?<!a)b",  "(a)\\1",     "\\k<n>",  "\\q",     "[\\B]",
+                           "^*",    "a{1001}",  "\\u{110000}", "\\c1",    "[a",     "\\"};
+  for (const char* pattern : invalid) {
+    JPattern p;
+    EXPECT_EQ_RET(JST_PARSE_INVALID_SCHEMA, p.compile(std::string(pattern)));
+  }
+  // a counted repeat is expanded; one too large for the automaton is refused
+  JPattern p;
+  EXPECT_EQ_RET(JST_PARSE_INVALID_SCHEMA, p.compile(std::string("((a{1000}){1000})")));
+
+  // a long payload used to overflow the stack of std::regex
+  JSchema schema;
+  EXPECT_EQ_RET(JST_PARSE_OK,
+                schema.compile(std::string("{\"type\":\"string\",\"pattern\":\"^(a|b)*$\"}")));
+  std::string s(1000000, 'a');
+  for (size_t i = 0; i < s.size(); i += 3) s[i] = 'b';
+  EXPECT_EQ_RET(JST_PARSE_OK, schema.validate("\"" + s + "\""));
+  JNode node(JST_STR, s.data(), s.size());
+  EXPECT_EQ_RET(JST_PARSE_OK, schema.validate(node));
+  s[s.size() - 2] = 'c';
+  JSchemaError err;
+  EXPECT_EQ_RET(JST_PARSE_SCHEMA_VIOLATION, schema.validate("\"" + s + "\"", &err));
+  EXPECT_TRUE(err.keyword == "pattern");
+}
+
+static void test_schema() {
+  test_schema_keywords();
+  test_schema_text();
+  test_schema_misc();
+  test_schema_pattern();
+}
+
+}  // namespace jst
+
+int main() {
+#ifdef _WINDOWS
+  _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif
+  jst::test_schema();
+  printf("%d/%d (%3.2f%%) passed\n", jst::test_pass, jst::test_count,
+         jst::test_pass * 100.0 / jst::test_count);
+  return jst::main_ret;
+}
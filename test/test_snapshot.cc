@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <memory>
+#include <string>
+
+#include "parser.h"
+#include "snapshot.h"
+#include "utils.h"
+
+namespace jst {
+
+static const char* test_path = "jst_test_snapshot.bin";
+static const char* test_snapshot_json =
+    "{\"name\":\"toy\",\"empty\":\"\",\"n\":[0,-7,18446744073709551615,1.5,0.1,1e2],"
+    "\"nested\":{\"z\":true,\"a\":false,\"m\":null,\"a\":1},\"list\":[[],{},\"a\\u0000b\"]}";
+
+static void test_snapshot_view() {
+  JParser jc(test_snapshot_json);
+  EXPECT_EQ_RET(JST_PARSE_OK, jc.parser());
+  std::string bin;
+  EXPECT_EQ_RET(JST_PARSE_OK, JSnapshot::write(jc.root, bin));
+
+  JSnapshot snap;
+  EXPECT_EQ_RET(JST_PARSE_OK, snap.open(bin.data(), bin.size()));
+  EXPECT_EQ_RET(JST_PARSE_OK, snap.verify());
+  JSnapView root = snap.root();
+  EXPECT_EQ_TYPE(JST_OBJ, root.type());
+  EXPECT_EQ_SIZE_T(5, root.size());
+  EXPECT_EQ_STRING("name", root.key(0).c_str(), root.key(0).size());
+  EXPECT_EQ_STRING("toy", root.find("name").c_str(), root.find("name").size());
+  EXPECT_EQ_SIZE_T(0, root.find("empty").size());
+  EXPECT_FALSE(root.find("nam").valid());
+  EXPECT_FALSE(root.find("names").valid());
+  EXPECT_FALSE(root[5].valid());
+
+  JSnapView n = root.find("n");
+  EXPECT_EQ_SIZE_T(6, n.size());
+  EXPECT_TRUE(n[0].num_type() == JST_NUM_INT && n[0].int_value() == 0);
+  EXPECT_TRUE(n[1].int_value() == -7);
+  EXPECT_TRUE(n[2].num_type() == JST_NUM_UINT && n[2].uint_value() == 18446744073709551615ULL);
+  EXPECT_EQ_DOUBLE(1.5, n[3].number());
+  EXPECT_TRUE(n[4].num_type() == JST_NUM_TEXT);
+  EXPECT_EQ_STRING("0.1", n[4].c_str(), n[4].size());
+  EXPECT_EQ_DOUBLE(100.0, n[5].number());
+
+  /* a missed lookup or another type reads as empty, numbers included */
+  JSnapView missing = root.find("nam");
+  EXPECT_TRUE(missing.num_type() == JST_NUM_DOUBLE);
+  EXPECT_EQ_DOUBLE(0.0, missing.number());
+  EXPECT_TRUE(missing.int_value() == 0 && missing.uint_value() == 0);
+  EXPECT_EQ_STRING("", missing.c_str(), 0);
+  EXPECT_FALSE(missing[0].valid());
+  EXPECT_EQ_DOUBLE(0.0, root.find("name").number());
+  EXPECT_TRUE(root.find("name").int_value() == 0);
+
+  /* lookup by key finds the first of duplicate keys, iteration keeps the order */
+  JSnapView nested = root.find("nested");
+  EXPECT_EQ_TYPE(JST_FALSE, nested.find("a").type());
+  EXPECT_EQ_TYPE(JST_TRUE, nested.find("z").type());
+  EXPECT_EQ_TYPE(JST_NULL, nested.find("m").type());
+  EXPECT_TRUE(nested.find("m").valid());
+  EXPECT_EQ_STRING("z", nested.key(0).c_str(), 1);
+  EXPECT_EQ_TYPE(JST_NUM, nested[3].type());
+
+  JSnapView list = root.find("list");
+  EXPECT_EQ_TYPE(JST_ARR, list[0].type());
+  EXPECT_EQ_SIZE_T(0, list[0].size());
+  EXPECT_EQ_TYPE(JST_OBJ, list[1].type());
+  EXPECT_FALSE(list[1].find("x").valid());
+  EXPECT_EQ_SIZE_T(3, list[2].size());
+  EXPECT_TRUE(memcmp(list[2].c_str(), "a\0b", 4) == 0);
+
+  /* the copy out is the parsed tree, numbers included */
+  JNode copy = root.to_node();
+  std::string out;
+  EXPECT_EQ_RET(JST_STRINGIFY_OK, jc.stringify(copy, out));
+  EXPECT_TRUE(out == test_snapshot_json);
+}
+
+static void test_snapshot_file() {
+  JParser jc(test_snapshot_json);
+  EXPECT_EQ_RET(JST_PARSE_OK, jc.parser());
+  EXPECT_EQ_RET(JST_PARSE_OK, JSnapshot::write(jc.root, test_path));
+
+  JSnapshot snap;
+  EXPECT_EQ_RET(JST_PARSE_OK, snap.open(test_path));
+  EXPECT_EQ_RET(JST_PARSE_OK, snap.verify());
+  EXPECT_EQ_STRING("toy", snap.root().find("name").c_str(), 3);
+  JSnapshot moved = std::move(snap);
+  EXPECT_EQ_STRING("toy", moved.root().find("name").c_str(), 3);
+  remove(test_path);
+
+  EXPECT_EQ_RET(JST_PARSE_FILE_ERROR, snap.open("jst_no_such_snapshot.bin"));
+  EXPECT_FALSE(snap.root().valid());
+}
+
+static void test_snapshot_invalid() {
+  JParser jc("[\"abc\",[1,2]]");
+  EXPECT_EQ_RET(JST_PARSE_OK, jc.parser());
+  std::string bin;
+  EXPECT_EQ_RET(JST_PARSE_OK, JSnapshot::write(jc.root, bin));
+  JSnapshot snap;
+
+  std::string bad = bin;
+  bad[0] = 'X';
+  EXPECT_EQ_RET(JST_PARSE_INVALID_SNAPSHOT, snap.open(bad.data(), bad.size()));
+  EXPECT_EQ_RET(JST_PARSE_INVALID_SNAPSHOT, snap.open(bin.data(), bin.size() - 8));
+  EXPECT_EQ_RET(JST_PARSE_INVALID_SNAPSHOT, snap.open(bin.data(), 16));
+
+  /* the header is fine, the records are not: only verify() notices */
+  JSnapRecord root;
+  memcpy(&root, &bin[sizeof(JSnapHeader)], sizeof(root));
+  bad = bin;
+  JSnapRecord loop = root;
+  loop.payload = sizeof(JSnapHeader);
+  memcpy(&bad[sizeof(JSnapHeader)], &loop, sizeof(loop));
+  EXPECT_EQ_RET(JST_PARSE_OK, snap.open(bad.data(), bad.size()));
+  EXPECT_EQ_RET(JST_PARSE_INVALID_SNAPSHOT, snap.verify());
+
+  bad = bin;
+  JSnapRecord huge = root;
+  huge.length = 1 << 30;
+  memcpy(&bad[sizeof(JSnapHeader)], &huge, sizeof(huge));
+  EXPECT_EQ_RET(JST_PARSE_OK, snap.open(bad.data(), bad.size()));
+  EXPECT_EQ_RET(JST_PARSE_INVALID_SNAPSHOT, snap.verify());
+}
+
+// A string longer than a record's 32-bit length is refused, not truncated. The string alone takes
+// 4 GB of memory, so this only runs when JST_TEST_LARGE is set.
+static void test_snapshot_too_long() {
+  if (getenv("JST_TEST_LARGE") == nullptr) return;
+  size_t len = (size_t)UINT32_MAX + 1;
+  JNode node;
+  {
+    // never written, so only the copy below commits memory.
+    std::unique_ptr<char[]> chars(new char[len]);
+    node = JNode(JString(chars.get(), len));
+  }
+  JArray arr;
+  arr.insert(0, std::move(node));
+  JNode root(std::move(arr));
+  std::string bin = "untouched";
+  EXPECT_EQ_RET(JST_PARSE_EXCEED_MAX_STRING_LENGTH, JSnapshot::write(root, bin));
+  EXPECT_TRUE(bin == "untouched");
+  EXPECT_EQ_RET(JST_PARSE_EXCEED_MAX_STRING_LENGTH, JSnapshot::write(root, test_path));
+  FILE* fp = fopen(test_path, "rb");
+  EXPECT_TRUE(fp == nullptr);
+  if (fp != nullptr) fclose(fp);
+}
+
+static void test_snapshot() {
+  test_snapshot_view();
+  test_snapshot_file();
+  test_snapshot_invalid();
+  test_snapshot_too_long();
+}
+
+}  // namespace jst
+
+int main() {
+#ifdef _WINDOWS
+  _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif
+  jst::test_snapshot();
+  printf("%d/%d (%3.2f%%) passed\n", jst::test_pass, jst::test_count,
+         jst::test_pass * 100.0 / jst::test_count);
+  return jst::main_ret;
+}
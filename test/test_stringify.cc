@@ -2,10 +2,6 @@
 #include "utils.h"
 
 namespace jst {
-static int main_ret = 0;
-static int test_count = 0;
-static int test_pass = 0;
-
 
 static void test_stringify_number() {
   TEST_ROUNDTRIP("0");
@@ -28,6 +24,14 @@ static void test_stringify_number() {
   TEST_ROUNDTRIP("-2.2250738585072014e-308");
   TEST_ROUNDTRIP("1.7976931348623157e+308"); /* Max double */
   TEST_ROUNDTRIP("-1.7976931348623157e+308");
+
+  /* integers and source text come back unchanged */
+  TEST_ROUNDTRIP("9007199254740993");
+  TEST_ROUNDTRIP("-9223372036854775808");
+  TEST_ROUNDTRIP("18446744073709551615");
+  TEST_ROUNDTRIP("123456789012345678901234567890");
+  TEST_ROUNDTRIP("0.1000000000000000055511151231257827");
+  TEST_ROUNDTRIP("1E+2");
 }
 
 static void test_stringify_string() {
@@ -50,6 +54,107 @@ static void test_stringify_object() {
       "{\"1\":1,\"2\":2,\"3\":3}}");
 }
 
+static void test_stringify_exact_size() {
+  const char* json = "{\"k\\n\":[1,-2,\"a\\u0001\\t\"],\"d\":0.5}";
+  JParser jc(json);
+  EXPECT_EQ_RET(JST_PARSE_OK, jc.parser());
+
+  std::string out;
+  EXPECT_EQ_RET(JST_STRINGIFY_OK, jc.stringify(jc.root, out));
+  EXPECT_TRUE(out == json);
+
+  char buf[64];
+  size_t len = 0;
+  EXPECT_EQ_RET(JST_STRINGIFY_BUFFER_TOO_SMALL, jc.stringify(jc.root, buf, 8, len));
+  EXPECT_EQ_SIZE_T(strlen(json), len);
+  EXPECT_EQ_RET(JST_STRINGIFY_OK, jc.stringify(jc.root, buf, len, len));
+  EXPECT_TRUE(std::string(buf, len) == json);
+
+  /* doubles built in code go through %.17g */
+  JNode num(0.1);
+  EXPECT_EQ_RET(JST_STRINGIFY_OK, jc.stringify(num, out));
+  EXPECT_TRUE(out == "0.10000000000000001");
+}
+
+static void test_stringify_fragment_cache() {
+  const char* json = "{\"static\":[1,2,{\"deep\":\"x\"}],\"live\":[0]}";
+  JParserOptions opts;
+  opts.cache_fragments = 1;
+  JParser jc(json, opts);
+  EXPECT_EQ_RET(JST_PARSE_OK, jc.parser());
+  std::string out;
+  EXPECT_EQ_RET(JST_STRINGIFY_OK, jc.stringify(jc.root, out));
+  EXPECT_TRUE(out == json);
+
+  JObject& obj = jc.root.mutable_data().as<JObject>();
+  const JArray& fixed = obj.get_value(0).data().as<JArray>();
+  const JObject& deep = fixed[2].data().as<JObject>();
+  EXPECT_TRUE(fixed.fragment() != nullptr);
+
+  /* a mutation drops the fragments on its way up and keeps its siblings' */
+  obj.get_value(1).mutable_data().as<JArray>().push_back(JNode(JST_TRUE));
+  EXPECT_TRUE(jc.root.data().fragment() == nullptr);
+  EXPECT_TRUE(fixed.fragment() != nullptr);
+  EXPECT_EQ_RET(JST_STRINGIFY_OK, jc.stringify(jc.root, out));
+  EXPECT_TRUE(out == "{\"static\":[1,2,{\"deep\":\"x\"}],\"live\":[0,true]}");
+
+  JArray& fixed_w = obj.get_value(0).mutable_data().as<JArray>();
+  fixed_w[0].data_set(JST_NULL);
+  EXPECT_TRUE(fixed.fragment() == nullptr);
+  EXPECT_TRUE(deep.fragment() != nullptr);
+  EXPECT_EQ_RET(JST_STRINGIFY_OK, jc.stringify(jc.root, out));
+  EXPECT_TRUE(out == "{\"static\":[null,2,{\"deep\":\"x\"}],\"live\":[0,true]}");
+
+  /* a retained reference still invalidates after the tree was cached again */
+  fixed_w[1] = JNode(JST_FALSE);
+  EXPECT_TRUE(jc.root.data().fragment() == nullptr);
+  obj.erase(1);
+  EXPECT_EQ_RET(JST_STRINGIFY_OK, jc.stringify(jc.root, out));
+  EXPECT_TRUE(out == "{\"static\":[null,false,{\"deep\":\"x\"}]}");
+
+  /* copies keep the fragment but not the link to the old parent */
+  JNode copy = obj.get_value(0);
+  EXPECT_TRUE(copy.data().fragment() != nullptr);
+  copy.mutable_data().as<JArray>().pop_back();
+  EXPECT_TRUE(fixed.fragment() != nullptr);
+  EXPECT_EQ_RET(JST_STRINGIFY_OK, jc.stringify(copy, out));
+  EXPECT_TRUE(out == "[null,false]");
+}
+
+static void test_stringify_parallel() {
+  std::string json = "[";
+  for (int i = 0; i < 100; i++) {
+    if (i != 0) json += ",";
+    json += "{\"id\":" + std::to_string(i) + ",\"s\":\"\\n\\u0001\",\"v\":[0.5,true,null]}";
+  }
+  json += "]";
+
+  JParserOptions opts;
+  opts.stringify_threads = 4;
+  opts.parallel_chunk = 100;
+  JParser jc(json, opts);
+  EXPECT_EQ_RET(JST_PARSE_OK, jc.parser());
+  std::string out;
+  EXPECT_EQ_RET(JST_STRINGIFY_OK, jc.stringify(jc.root, out));
+  EXPECT_TRUE(out == json);
+  char* str;
+  size_t len;
+  EXPECT_EQ_RET(JST_STRINGIFY_OK, jc.stringify(jc.root, &str, len));
+  EXPECT_TRUE(std::string(str, len) == json);
+
+  /* objects, and batches of a single child */
+  const char* obj = "{\"a\":[1,2],\"b\":{},\"c\":\"x\",\"a\":null}";
+  opts.parallel_chunk = 1;
+  opts.cache_fragments = 1;
+  JParser jo(obj, opts);
+  EXPECT_EQ_RET(JST_PARSE_OK, jo.parser());
+  EXPECT_EQ_RET(JST_STRINGIFY_OK, jo.stringify(jo.root, out));
+  EXPECT_TRUE(out == obj);
+  EXPECT_TRUE(jo.root.data().fragment() != nullptr);
+  EXPECT_EQ_RET(JST_STRINGIFY_OK, jo.stringify(jo.root, out));
+  EXPECT_TRUE(out == obj);
+}
+
 static void test_stringify() {
   TEST_ROUNDTRIP("null");
   TEST_ROUNDTRIP("false");
@@ -57,7 +162,10 @@ static void test_stringify() {
   test_stringify_number();
   test_stringify_string();
   test_stringify_array();
-  // test_stringify_object();
+  test_stringify_object();
+  test_stringify_exact_size();
+  test_stringify_fragment_cache();
+  test_stringify_parallel();
 }
 
 }  // namespace jst
@@ -0,0 +1,141 @@
+#include <math.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "parser.h"
+#include "utils.h"
+#include "writer.h"
+
+namespace jst {
+
+static void test_writer_basic() {
+  std::string out;
+  {
+    JWriter w(out);
+    w.begin_object();
+    w.key("n");
+    w.null();
+    w.key("b");
+    w.value(true);
+    w.key("i");
+    w.value(-42);
+    w.key("u");
+    w.value((uint64_t)18446744073709551615ULL);
+    w.key("d");
+    w.value(1.5);
+    w.key("s");
+    w.value("a\"b\\c\n\x01");
+    w.key("a");
+    w.begin_array();
+    w.value(1);
+    w.begin_array();
+    w.end_array();
+    w.begin_object();
+    w.end_object();
+    w.end_array();
+    w.end_object();
+    EXPECT_TRUE(w.done());
+  }
+  EXPECT_TRUE(out ==
+              "{\"n\":null,\"b\":true,\"i\":-42,\"u\":18446744073709551615,\"d\":1.5,"
+              "\"s\":\"a\\\"b\\\\c\\n\\u0001\",\"a\":[1,[],{}]}");
+
+  JParser jc(out);
+  EXPECT_EQ_RET(JST_PARSE_OK, jc.parser());
+}
+
+/* the writer and stringify share the escaping and number formatting */
+static void test_writer_matches_stringify() {
+  const char* json = "[\"\\u001f\\t\\\"\",0.5,-7,{\"k\\n\":[true,false,null]}]";
+  JParser jc(json);
+  EXPECT_EQ_RET(JST_PARSE_OK, jc.parser());
+  std::string tree;
+  EXPECT_EQ_RET(JST_STRINGIFY_OK, jc.stringify(jc.root, tree));
+
+  std::string out;
+  {
+    JWriter w(out);
+    w.begin_array();
+    w.value("\x1f\t\"");
+    w.value(0.5);
+    w.value(-7);
+    w.value(jc.root.data().as<JArray>()[3]);
+    w.end_array();
+  }
+  EXPECT_TRUE(out == tree);
+}
+
+static void test_writer_small_buffer() {
+  std::vector<std::string> chunks;
+  std::string big(100, 'x');
+  {
+    JWriter w([&chunks](const char* s, size_t len) { chunks.emplace_back(s, len); }, 8);
+    w.begin_array();
+    for (int i = 0; i < 10; i++) w.value(i);
+    w.value(big);
+    w.end_array();
+    EXPECT_TRUE(chunks.size() > 1);
+  }
+  std::string out;
+  for (auto& chunk : chunks) out += chunk;
+  EXPECT_TRUE(out == "[0,1,2,3,4,5,6,7,8,9,\"" + big + "\"]");
+
+  FILE* fp = tmpfile();
+  {
+    JWriter w(fp, 4);
+    w.begin_object();
+    w.key("key");
+    w.value("value");
+    w.end_object();
+  }
+  char buf[32] = {0};
+  rewind(fp);
+  size_t len = fread(buf, 1, sizeof(buf), fp);
+  fclose(fp);
+  EXPECT_TRUE(std::string(buf, len) == "{\"key\":\"value\"}");
+}
+
+/* JSON has no NaN or infinity: they come out as null, from the writer and from stringify */
+static void test_writer_non_finite() {
+  std::string out;
+  {
+    JWriter w(out);
+    w.begin_array();
+    w.value(NAN);
+    w.value(HUGE_VAL);
+    w.value(-HUGE_VAL);
+    w.value(2.5);
+    w.end_array();
+  }
+  EXPECT_TRUE(out == "[null,null,null,2.5]");
+  JParser jc(out);
+  EXPECT_EQ_RET(JST_PARSE_OK, jc.parser());
+
+  JArray arr;
+  arr.push_back(JNode(NAN));
+  arr.push_back(JNode(-HUGE_VAL));
+  std::string tree;
+  EXPECT_EQ_RET(JST_STRINGIFY_OK, jc.stringify(JNode(arr), tree));
+  EXPECT_TRUE(tree == "[null,null]");
+}
+
+static void test_writer() {
+  test_writer_basic();
+  test_writer_matches_stringify();
+  test_writer_small_buffer();
+  test_writer_non_finite();
+}
+
+}  // namespace jst
+
+int main() {
+#ifdef _WINDOWS
+  _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif
+  jst::test_writer();
+  printf("%d/%d (%3.2f%%) passed\n", jst::test_pass, jst::test_count,
+         jst::test_pass * 100.0 / jst::test_count);
+  return jst::main_ret;
+}
@@ -6,11 +6,18 @@
 #include <cstdlib>
 #include <iostream>
 #include <limits>
+#include <string>
 
+#include "../inc/parser.h"
 #include "../inc/utils.h"
 
 namespace jst {
 
+// Every test file is its own program with its own tally.
+static int main_ret = 0;
+static int test_count = 0;
+static int test_pass = 0;
+
 #define EXPECT_EQ_BASE(equality, expect, actual, format)                                    \
   do {                                                                                      \
     test_count++;                                                                           \
@@ -47,6 +54,10 @@ namespace jst {
   EXPECT_EQ_BASE((expect) == (actual), (size_t)expect, (size_t)actual, "%zu")
 #endif
 
+#define EXPECT_EQ_HASH(expect, actual)                                \
+  EXPECT_EQ_BASE((expect) == (actual), (unsigned long long)(expect), \
+                 (unsigned long long)(actual), "0x%016llx")
+
 #define TEST_ERROR(error, json)               \
   do {                                        \
     JParser jc(json);                         \
@@ -54,6 +65,19 @@ namespace jst {
     EXPECT_EQ_TYPE(JST_NULL, jc.root.type()); \
   } while (0)
 
+#define TEST_ERROR_OPTIONS(error, json, opts) \
+  do {                                        \
+    JParser jc(json, opts);                   \
+    EXPECT_EQ_RET(error, jc.parser());        \
+    EXPECT_EQ_TYPE(JST_NULL, jc.root.type()); \
+  } while (0)
+
+#define TEST_PARSE_OPTIONS(json, opts)        \
+  do {                                        \
+    JParser jc(json, opts);                   \
+    EXPECT_EQ_RET(JST_PARSE_OK, jc.parser()); \
+  } while (0)
+
 #define TEST_NUMBER(expect, json)                      \
   do {                                                 \
     JParser jc(json);                                  \
@@ -118,4 +142,18 @@ namespace jst {
     EXPECT_EQ_INT(equality, jn_1 == jn_2);         \
   } while (0)
 
+// Fixtures for tests that start from and compare against text.
+static inline JNode test_parse(const std::string& json) {
+  JParser jc(json);
+  EXPECT_EQ_RET(JST_PARSE_OK, jc.parser());
+  return jc.root;
+}
+
+static inline std::string test_json(const JNode& node) {
+  JParser jc("");
+  std::string out;
+  jc.stringify(node, out);
+  return out;
+}
+
 }  // namespace jst